@@ -2,13 +2,15 @@
  * @file
  * @brief	Project configuration file
  * @author	Ralf Gerhauser
- * @version	2020-01-13
+ * @version	2026-10-18
  *
  * This file allows to set miscellaneous configuration parameters.  It must be
  * included by all modules.
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added EM1_MOD_SMBUS.
+2026-10-18,agent	Added KEY_DEBOUNCE_TIME.
 2020-01-13,rage	Added prototype for ConsolePrintf().
 2016-11-22,rage	Added DMA Channel Assignment for LEUART support.
 2014-10-12,rage	Removed LED definitions.
@@ -59,6 +61,8 @@ Revision History:
 #define AUTOREPEAT_THRESHOLD	750
     /*!@brief Rate in [ms] the autorepeat feature repeats the previous key. */
 #define AUTOREPEAT_RATE		250
+    /*!@brief Debounce window in [ms] for the key EXTIs. */
+#define KEY_DEBOUNCE_TIME	10
 
 /* forward declaration */
 void    drvLEUART_puts(const char *str);
@@ -139,6 +143,7 @@ typedef enum
 typedef enum
 {
     EM1_MOD_XXX,	//!<  0: Example enum, this project always used EM2
+    EM1_MOD_SMBUS,	//!<  1: SMBus transactions are queued, see BatteryMon.c
     END_EM1_MODULES
 } EM1_MODULES;
 
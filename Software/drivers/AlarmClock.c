@@ -2,15 +2,16 @@
  * @file
  * @brief	Alarm Clock Module
  * @author	Ralf Gerhauser
- * @version	2016-09-27
+ * @version	2026-10-18
  *
  * This module implements an Alarm Clock.  It uses the Real Time Counter (RTC)
  * for this purpose.  The main features are:
  * - Base clock (1 second) for counting date and time.
  * - Up to 10 software timers with callback functionality and a granularity
  *   of one second.
- * - One high-resolution timer for short time measurements, e.g. timeout or
- *   autorepeat features for keys (push buttons).
+ * - Up to 4 high-resolution timers for short time measurements, e.g. timeout
+ *   or autorepeat features for keys (push buttons).  They share COMP1, which
+ *   is always set to the timer that expires next.
  * - Up to 10 alarm times with callback functionality and a granularity of
  *   one minute (repeated after 24h).
  *
@@ -32,6 +33,18 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Alarms are checked for each minute passed since the last
+		tick, see AlarmCheck().  Added ClockTickLast(), and
+		ClockGetMilliSec() adds the seconds since the last tick.
+2026-10-18,agent	Several high-resolution timers share COMP1, see
+		msTimerCreate().  msTimerAction() has been replaced by it.
+2026-10-18,agent	Added ClockTickSet(): the period of the COMP0 interrupt
+		can be a multiple of one second, e.g. for the monitor mode.
+2026-10-18,agent	The RTC interrupt advances <g_CurrDateTime>
+		incrementally via ClockAdvance() instead of calling time() and
+		localtime() every second.  A full conversion is only done at
+		start-up and after ClockSet().  Added ClockCycleCompare() for
+		DEBUG builds.
 2016-09-27,rage	Use INT_En/Disable() instead of __en/disable_irq().
 2016-09-27,rage	Added ClockGetMilliSec().
 2016-04-05,rage	Made all local and global variables of type "volatile".
@@ -63,6 +76,13 @@ Revision History:
 /*!@brief Calculate maximum value to prevent overflow of a 32bit register. */
 #define MAX_VALUE_FOR_32BIT	(0xFFFFFFFFUL / RTC_COUNTS_PER_SEC)
 
+/*!@brief Minimum number of ticks to set COMP1 ahead of the counter. */
+#define MS_TIMER_MIN_TICKS	3
+
+/*!@brief Leap year check for element <b>tm_year</b> (years since 1900). */
+#define IS_LEAP_YEAR(tmYear)	((((tmYear) % 4) == 0  &&  ((tmYear) % 100) != 0) \
+				|| (((tmYear) + 1900) % 400) == 0)
+
 /*=========================== Typedefs and Structs ===========================*/
 
 /*!@brief Alarm entry.
@@ -88,6 +108,16 @@ typedef struct
     TIMER_FCT Function;		//!< Function to be called when timer expires
 } SEC_TIMER;
 
+/*!
+ * @brief Structure for a high-resolution timer.
+ */
+typedef struct
+{
+    uint32_t  Start;		//!< RTC value when the timer has been started
+    uint32_t  Ticks;		//!< Duration in RTC ticks, 0 if not running
+    TIMER_FCT Function;		//!< Function to be called when timer expires
+} MS_TIMER;
+
 /*================================ Global Data ===============================*/
 
 /*!@brief Current date and time structure. */
@@ -118,12 +148,45 @@ static volatile SEC_TIMER l_sTimer[MAX_SEC_TIMERS];
 /*!@brief Maximum handle, currently in use. */
 static volatile int   l_MaxHdl;
 
-/*!@brief Function to call when high-resolution timer expires. */
-static void  (*l_msTimerFunction) (void);
+/*!@brief List of high-resolution timers. */
+static volatile MS_TIMER l_msTimer[MAX_MS_TIMERS];
 
 /*!@brief Function to call for a display update. */
 static void  (*l_DisplayUpdateFct) (void);
 
+/*!@brief Flag to request a full re-synchronisation of @ref g_CurrDateTime
+ * with the next one-second interrupt, see ClockAdvance().
+ */
+static volatile bool l_flgClockResync = true;
+
+/*!@brief Period of the COMP0 interrupt in seconds, see ClockTickSet(). */
+static volatile uint8_t l_TickSeconds = 1;
+
+/*!@brief Period of the COMP0 interrupt which is currently scheduled. */
+static volatile uint8_t l_TickCurr = 1;
+
+/*!@brief Minute whose alarms have already been checked, see AlarmCheck(). */
+static volatile int8_t l_ProcessedMin = (-1);
+
+/*!@brief Number of days per month (February of a non-leap year). */
+static const uint8_t l_DaysOfMonth[12] =
+{
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+#ifdef DEBUG
+/*!@brief CPU cycles required by the calendar update of the last one-second
+ * interrupt, see ClockCycleCompare().
+ */
+volatile uint32_t g_ClockUpdCycles;
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	ClockAdvance (struct tm *pTimeDate);
+static void	AlarmCheck (void);
+static void	msTimerSchedule (void);
+
 
 /***************************************************************************//**
  *
@@ -147,6 +210,9 @@ void	AlarmClockInit (void)
     initialCalendar.rtcCountsPerSec = RTC_COUNTS_PER_SEC;
     clockInit (&initialCalendar);
 
+    /* Initial conversion of the start time into <g_CurrDateTime> */
+    ClockUpdate (true);
+
     /* Configure the RTC */
     RTC_Init_TypeDef rtcInit;
     rtcInit.debugRun = false;
@@ -182,16 +248,17 @@ void	AlarmClockInit (void)
  *   so a variable needs to be incremented that holds the higher bits.
  *   With a clock frequency of 32.768Hz this happens every 512s (8.5min).
  * - <b>COMP0</b> is used for the 1s base clock and the software timers, and
- *   every minute all alarm times are compared to the current time.
- * - <b>COMP1</b> is used as a high-resolution timer, see @ref msTimerStart().
- *   It may be used as autorepeat timer for the keys, for example.
+ *   every minute all alarm times are compared to the current time.  Its
+ *   period may be a multiple of one second, see ClockTickSet().
+ * - <b>COMP1</b> is used for the high-resolution timers, see msTimerStart().
+ *   They may be used as autorepeat timer for the keys, for example.
  *
  ******************************************************************************/
 void	RTC_IRQHandler (void)
 {
-static int8_t	processed_min = (-1);	// already processed minute
 uint32_t	status;			// interrupt status flags
 int		i;			// index variable
+int		elapsed;		// seconds since the last COMP0
 
     /*
      * Measured execution times:
@@ -214,17 +281,42 @@ int		i;			// index variable
     /* Check for COMP0 interrupt which occurs every second */
     if (status & RTC_IF_COMP0)
     {
-	/* Generate next COMP0 interrupt after another second */
-	RTC_CompareSet (0, (RTC->COMP0 + RTC_COUNTS_PER_SEC) & 0xFFFFFF);
+	/* Generate next COMP0 interrupt after another tick period */
+	elapsed = l_TickCurr;
+	l_TickCurr = l_TickSeconds;
+	RTC_CompareSet (0, (RTC->COMP0 + l_TickCurr * RTC_COUNTS_PER_SEC)
+			   & 0xFFFFFF);
 	RTC->IFC = RTC_IFC_COMP0;
 
+#ifdef DEBUG
+	uint32_t cycStart = DWT->CYCCNT;
+#endif
 	/*
-	 * Get current UNIX time, convert to <tm>, and store in global struct
-	 * <g_CurrDateTime>.  This requires about 100us which is quite long
-	 * for an interrupt routine.  Nevertheless we need this information
-	 * for comparing the alarm times below.
+	 * Advance <g_CurrDateTime> by one second.  Getting the current UNIX
+	 * time and converting it via localtime() requires about 100us, which
+	 * is quite long for an interrupt routine that is executed every
+	 * second.  Therefore this is only done after start-up or when the
+	 * clock has been set, see ClockSet().
 	 */
-	ClockUpdate (true);
+	if (l_flgClockResync)
+	{
+	    l_flgClockResync = false;
+	    ClockUpdate (true);
+	    AlarmCheck();
+	}
+	else
+	{
+	    /* check the alarms of each minute passed since the last tick */
+	    for (i = 0;  i < elapsed;  i++)
+	    {
+		ClockAdvance (&g_CurrDateTime);
+		AlarmCheck();
+	    }
+	    ClockUpdate (false);
+	}
+#ifdef DEBUG
+	g_ClockUpdCycles = DWT->CYCCNT - cycStart;
+#endif
 
 	/* decrement software timers and call functions if reaching 0 */
 	for (i = 0;  i <= l_MaxHdl;  i++)
@@ -232,8 +324,14 @@ int		i;			// index variable
 	    if (l_sTimer[i].Counter)
 	    {
 		/* only decrement if not already 0 */
-		if (--(l_sTimer[i].Counter) == 0)
+		if (l_sTimer[i].Counter > (uint32_t)elapsed)
+		{
+		    l_sTimer[i].Counter -= elapsed;
+		}
+		else
 		{
+		    l_sTimer[i].Counter = 0;
+
 		    /* if reaching 0, call the specified function */
 		    if (l_sTimer[i].Function)
 			l_sTimer[i].Function (i);
@@ -241,25 +339,6 @@ int		i;			// index variable
 	    }
 	}
 
-	/* compare all alarm times for every minute */
-	if (processed_min != g_CurrDateTime.tm_min)
-	{
-	    processed_min = g_CurrDateTime.tm_min;
-
-	    for (i = 0;  i < MAX_ALARMS;  i++)
-	    {
-		/* we compare hours and minutes only */
-		if (l_Alarm[i].Enabled
-		&&  l_Alarm[i].Minute == g_CurrDateTime.tm_min
-		&&  (l_Alarm[i].Hour  == NONE	// repeat every hour
-		  || l_Alarm[i].Hour  == g_CurrDateTime.tm_hour))
-		{
-		    /* reached alarm time, call the specified function */
-		    if (l_Alarm[i].Function)
-			l_Alarm[i].Function (i);
-		}
-	    }
-	}
     }	// if (status & RTC_IF_COMP0)
 
     /* Check for COMP1 interrupt (high-resolution timer) */
@@ -269,9 +348,20 @@ int		i;			// index variable
 	BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 0);
 	RTC->IFC = RTC_IFC_COMP1;
 
-	/* call the specified function */
-	if (l_msTimerFunction)
-	    l_msTimerFunction();
+	/* call the functions of all expired timers, they may restart them */
+	for (i = 0;  i < MAX_MS_TIMERS;  i++)
+	{
+	    if (l_msTimer[i].Ticks != 0
+	    &&  ((RTC->CNT - l_msTimer[i].Start) & 0xFFFFFF)
+		>= l_msTimer[i].Ticks)
+	    {
+		l_msTimer[i].Ticks = 0;
+		l_msTimer[i].Function (i);
+	    }
+	}
+
+	/* set COMP1 for the next timer */
+	msTimerSchedule();
     }
 }
 
@@ -573,22 +663,88 @@ void	sTimerCancel (TIM_HDL hdl)
 
 /***************************************************************************//**
  *
- * @brief	Define an Action for the millisecond Timer
+ * @brief	Schedule the millisecond Timers
  *
- * Defines the function that should be called, when the high-resolution timer
- * expires.
+ * Sets COMP1 to the running high-resolution timer which expires next, or
+ * disables the COMP1 interrupt if no timer is running.  Must be called with
+ * interrupts disabled, or from the RTC interrupt handler.
+ *
+ ******************************************************************************/
+static void msTimerSchedule (void)
+{
+uint32_t elapsed;		// ticks since the start of a timer
+uint32_t left;			// ticks until a timer expires
+uint32_t minLeft = 0xFFFFFFFF;	// ticks until the next timer expires
+int	 i;
+
+    for (i = 0;  i < MAX_MS_TIMERS;  i++)
+    {
+	if (l_msTimer[i].Ticks == 0)
+	    continue;		// not running
+
+	elapsed = (RTC->CNT - l_msTimer[i].Start) & 0xFFFFFF;
+	left = (elapsed < l_msTimer[i].Ticks ? l_msTimer[i].Ticks - elapsed : 0);
+	if (left < minLeft)
+	    minLeft = left;
+    }
+
+    if (minLeft == 0xFFFFFFFF)
+    {
+	/* No timer is running - disable COMP1 interrupt */
+	BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 0);
+	RTC_IntClear (RTC_IFC_COMP1);
+	return;
+    }
+
+    /* COMP1 needs some ticks to be synchronized to the LF domain */
+    if (minLeft < MS_TIMER_MIN_TICKS)
+	minLeft = MS_TIMER_MIN_TICKS;
+
+    RTC_CompareSet (1, (RTC->CNT + minLeft) & 0xFFFFFF);
+
+    /* Be sure to clear IRQ flag, then enable the COMP1 interrupt */
+    RTC_IntClear (RTC_IFC_COMP1);
+    BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 1);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Create a new millisecond Timer
+ *
+ * Create a new high-resolution timer.  The routine returns a reference handle
+ * for the new timer.  After the timer has been created, msTimerStart() must
+ * be used to specify the number of milliseconds the timer should run until
+ * <b>function</b> is called.  All timers share COMP1 of the RTC.
  *
  * @param[in] function
- *	Function to be called when the timer expires.
+ *	Function to be called when the timer expires.  It is called in the
+ *	context of the RTC interrupt.
+ *
+ * @return
+ *	Handle for the newly created timer.
  *
  ******************************************************************************/
-void	msTimerAction	(void (*function)(void))
+TIM_HDL	msTimerCreate (TIMER_FCT function)
 {
+int	i;	// index variable
+
+
     /* Parameter check */
     EFM_ASSERT (function != NULL);
 
-    /* Set function pointer */
-    l_msTimerFunction = function;
+    /* Search the next available entry in the list */
+    for (i = 0;  i < MAX_MS_TIMERS;  i++)
+    {
+	if (l_msTimer[i].Function == NULL)
+	{
+	    l_msTimer[i].Ticks    = 0;
+	    l_msTimer[i].Function = function;
+	    return i;	// return handle for the newly created timer
+	}
+    }
+
+    EFM_ASSERT (false);		// no free entry, increase MAX_MS_TIMERS
+    return 0;
 }
 
 /***************************************************************************//**
@@ -597,46 +753,64 @@ void	msTimerAction	(void (*function)(void))
  *
  * This routine allows you to specify the number of milliseconds the
  * high-resolution timer should run, and starts it.  When the timer expires,
- * the function that was introduced by msTimerAction(), will be called.
+ * the function that was introduced by msTimerCreate(), will be called.
  * Use msTimerCancel() to abort this duration.
  *
+ * @param[in] hdl
+ *	Handle to specify the timer.
+ *
  * @param[in] ms
  *	Duration in milliseconds how long the timer should run.
  *
  * @see msTimerCancel().
  *
  ******************************************************************************/
-void	msTimerStart (uint32_t ms)
+void	msTimerStart (TIM_HDL hdl, uint32_t ms)
 {
     /* Parameter check */
+    EFM_ASSERT (0 <= hdl  &&  hdl < MAX_MS_TIMERS);
     EFM_ASSERT (0 < ms  &&  ms <= MAX_VALUE_FOR_32BIT);
 
     /* Verify that a function has been defined for the timer */
-    EFM_ASSERT (l_msTimerFunction != NULL);
+    EFM_ASSERT (l_msTimer[hdl].Function != NULL);
 
     /* Convert the [ms] value in number of ticks and set COMP1 */
-    RTC_CompareSet (1, (RTC->CNT + (ms * RTC_COUNTS_PER_SEC) / 1000) & 0xFFFFFF);
+    INT_Disable();
 
-    /* Be sure to clear IRQ flag, then enable the COMP1 interrupt */
-    RTC_IntClear (RTC_IFC_COMP1);
-    BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 1);
+    l_msTimer[hdl].Start = RTC->CNT;
+    l_msTimer[hdl].Ticks = (ms * RTC_COUNTS_PER_SEC) / 1000;
+    if (l_msTimer[hdl].Ticks == 0)
+	l_msTimer[hdl].Ticks = 1;
+
+    msTimerSchedule();
+
+    INT_Enable();
 }
 
 /***************************************************************************//**
  *
- * @brief	Cancel the running millisecond Timer
+ * @brief	Cancel a running millisecond Timer
  *
- * Call this routine to cancel the running millisecond timer, i.e. no action is
+ * Call this routine to cancel a running millisecond timer, i.e. no action is
  * performed when the timer expires.
  *
+ * @param[in] hdl
+ *	Handle to specify the timer.
+ *
  * @see msTimerStart().
  *
  ******************************************************************************/
-void	msTimerCancel (void)
+void	msTimerCancel (TIM_HDL hdl)
 {
-    /* Disable COMP1 interrupt */
-    BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 0);
-    RTC_IntClear (RTC_IFC_COMP1);
+    /* Parameter check */
+    EFM_ASSERT (0 <= hdl  &&  hdl < MAX_MS_TIMERS);
+
+    INT_Disable();
+
+    l_msTimer[hdl].Ticks = 0;
+    msTimerSchedule();
+
+    INT_Enable();
 }
 
 /***************************************************************************//**
@@ -752,6 +926,11 @@ void	DisplayUpdateFctInstall	(void (*function)(void))
  * DisplayUpdateFctInstall(), this will be called after the clock has been
  * updated.
  *
+ * @note
+ * The RTC interrupt handler advances @ref g_CurrDateTime via ClockAdvance()
+ * and calls this routine with <b>readTime</b> set to <b>false</b>.  The full
+ * conversion is only performed at start-up and after ClockSet().
+ *
  * @param[in] readTime
  *	Set <b>true</b> to read the current system time, convert it into a
  *	<i>tm</i> structure, and store it into the @ref g_CurrDateTime
@@ -796,6 +975,156 @@ time_t	now;
 	l_DisplayUpdateFct();
 }
 
+/***************************************************************************//**
+ *
+ * @brief	Check Alarm Times
+ *
+ * This routine is called by the RTC interrupt handler each time
+ * @ref g_CurrDateTime has been advanced or synchronized.  When a new minute
+ * has been reached, all alarm times are compared with it.  With a tick
+ * period of several seconds, see ClockTickSet(), it is called for each of
+ * these seconds, so no minute is skipped.
+ *
+ ******************************************************************************/
+static void	AlarmCheck (void)
+{
+int	i;	// index variable
+
+    if (l_ProcessedMin == g_CurrDateTime.tm_min)
+	return;				// this minute has already been checked
+
+    l_ProcessedMin = g_CurrDateTime.tm_min;
+
+    for (i = 0;  i < MAX_ALARMS;  i++)
+    {
+	/* we compare hours and minutes only */
+	if (l_Alarm[i].Enabled
+	&&  l_Alarm[i].Minute == g_CurrDateTime.tm_min
+	&&  (l_Alarm[i].Hour  == NONE	// repeat every hour
+	  || l_Alarm[i].Hour  == g_CurrDateTime.tm_hour))
+	{
+	    /* reached alarm time, call the specified function */
+	    if (l_Alarm[i].Function)
+		l_Alarm[i].Function (i);
+	}
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Advance Clock by one Second
+ *
+ * This routine increments the date and time in the <i>tm</i> structure
+ * pointed to by @p pTimeDate by exactly one second.  Carries are propagated
+ * into minute, hour, day, month, and year, including the elements
+ * <b>tm_wday</b> and <b>tm_yday</b>.  It is called by the RTC interrupt
+ * handler for each COMP0 interrupt to update @ref g_CurrDateTime, instead of
+ * converting the UNIX time via time() and localtime() every second.
+ *
+ * @param[in,out] pTimeDate
+ *	Pointer to the date and time structure to be advanced.
+ *
+ * @note
+ * The structure must already contain a valid date, i.e. it has been set up by
+ * ClockUpdate() with parameter <b>readTime</b> set to <b>true</b> before.
+ * No interrupt lock is required here, since @ref g_CurrDateTime is only
+ * advanced by the RTC interrupt, and readers like ClockGet() disable
+ * interrupts.  ClockGetMilliSec() advances a copy of it.
+ *
+ ******************************************************************************/
+static void	ClockAdvance (struct tm *pTimeDate)
+{
+int	days;		// number of days of the current month
+
+    if (++pTimeDate->tm_sec < 60)
+	return;				// most frequent case
+    pTimeDate->tm_sec = 0;
+
+    if (++pTimeDate->tm_min < 60)
+	return;
+    pTimeDate->tm_min = 0;
+
+    if (++pTimeDate->tm_hour < 24)
+	return;
+    pTimeDate->tm_hour = 0;
+
+    /* next day */
+    if (++pTimeDate->tm_wday > 6)
+	pTimeDate->tm_wday = 0;
+    pTimeDate->tm_yday++;
+
+    days = l_DaysOfMonth[pTimeDate->tm_mon];
+    if (pTimeDate->tm_mon == 1  &&  IS_LEAP_YEAR(pTimeDate->tm_year))
+	days++;				// February of a leap year
+
+    if (++pTimeDate->tm_mday <= days)
+	return;
+    pTimeDate->tm_mday = 1;
+
+    /* next month */
+    if (++pTimeDate->tm_mon < 12)
+	return;
+    pTimeDate->tm_mon  = 0;
+
+    /* next year */
+    pTimeDate->tm_yday = 0;
+    pTimeDate->tm_year++;
+}
+
+#ifdef DEBUG
+/***************************************************************************//**
+ *
+ * @brief	Compare CPU Cycles of the Calendar Update
+ *
+ * This debug routine measures the number of CPU cycles of a full conversion
+ * via time() and localtime(), as formerly executed in every RTC interrupt,
+ * and those of ClockAdvance() for the most frequent case (next second) and
+ * for the worst case (new year).  The results are printed to the console,
+ * together with the value of the last one-second interrupt.
+ *
+ ******************************************************************************/
+void	ClockCycleCompare (void)
+{
+struct tm  timeDate;
+time_t	   now;
+uint32_t   cycFull, cycSec, cycYear, cycStart;
+
+
+    /* Be sure the cycle counter of the DWT is running */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    INT_Disable();
+
+    /* Full conversion */
+    cycStart = DWT->CYCCNT;
+    now = time (NULL);
+    timeDate = *localtime(&now);
+    cycFull = DWT->CYCCNT - cycStart;
+
+    /* Incremental update: most frequent case */
+    timeDate.tm_sec = 0;
+    cycStart = DWT->CYCCNT;
+    ClockAdvance (&timeDate);
+    cycSec = DWT->CYCCNT - cycStart;
+
+    /* Incremental update: worst case, carry into the next year */
+    timeDate.tm_sec = timeDate.tm_min = 59;
+    timeDate.tm_hour = 23;
+    timeDate.tm_mday = 31;
+    timeDate.tm_mon  = 11;
+    cycStart = DWT->CYCCNT;
+    ClockAdvance (&timeDate);
+    cycYear = DWT->CYCCNT - cycStart;
+
+    INT_Enable();
+
+    ConsolePrintf ("Clock update cycles: localtime() %lu, incremental %lu"
+		   " (new year %lu), last RTC interrupt %lu\n",
+		   cycFull, cycSec, cycYear, g_ClockUpdCycles);
+}
+#endif
+
 /***************************************************************************//**
  *
  * @brief	Get System Clock
@@ -828,6 +1157,9 @@ void	ClockGet (struct tm *pTimeDateVar)
  * Like ClockGet(), this routine copies the current date and time into the
  * local <i>tm</i> structure pointed to by the <b>pTimeDateVar</b> parameter.
  * Additionally the number of milliseconds is stored in <b>pMsVar</b>.
+ * @ref g_CurrDateTime is the time of the last COMP0 interrupt, so the seconds
+ * since then are added, with a longer tick period or while the interrupt
+ * is still pending.
  *
  * @param[in] pTimeDateVar
  *	Pointer to a variable where to store the current time and date.
@@ -838,24 +1170,24 @@ void	ClockGet (struct tm *pTimeDateVar)
  ******************************************************************************/
 void	ClockGetMilliSec (struct tm *pTimeDateVar, unsigned int *pMsVar)
 {
-uint32_t	currSubSec;
+uint32_t	ticks;		// RTC ticks since the last COMP0 interrupt
+uint32_t	seconds;
 
     EFM_ASSERT (pTimeDateVar != NULL  &&  pMsVar != NULL);
 
     /* Disable interrupts */
     INT_Disable();
 
-    /* Read current RTC value - only sub-seconds are of interest */
-    currSubSec = (RTC->CNT - RTC->COMP0) % RTC_COUNTS_PER_SEC;
+    /* Time since the last tick, it may be pending still */
+    ticks = (RTC->CNT - ClockTickLast()) & 0xFFFFFF;
 
-    /* Get current date and time */
+    /* Get date and time of the last tick, and add the elapsed seconds */
     *pTimeDateVar = g_CurrDateTime;
+    for (seconds = ticks / RTC_COUNTS_PER_SEC;  seconds > 0;  seconds--)
+	ClockAdvance (pTimeDateVar);
 
-    /* NOW check if RTC overflow happened (interrupt is still pending!) */
-    if (RTC->IF & RTC_IF_COMP0)
-	*pMsVar = 999;			// use maximum [ms] value
-    else				// Calculate remaining [ms]
-	*pMsVar = currSubSec * 1000 / RTC_COUNTS_PER_SEC;
+    /* Calculate the [ms] portion */
+    *pMsVar = (ticks % RTC_COUNTS_PER_SEC) * 1000 / RTC_COUNTS_PER_SEC;
 
     /* Enable interrupts again */
     INT_Enable();
@@ -883,6 +1215,7 @@ void	ClockSet (struct tm *pNewTimeDate, bool sync)
 time_t    newRtcStartTime;
 uint32_t  rtcIEN;	// save state of the RTC Interrupt Enable register
 uint32_t  rtcCNT;	// save state of the RTC Interrupt Enable register
+int	  i;		// index variable
 
 
     EFM_ASSERT (pNewTimeDate != NULL);
@@ -923,19 +1256,87 @@ uint32_t  rtcCNT;	// save state of the RTC Interrupt Enable register
      * Calculate the respective COMP values if counter is zero.  If <sync>
      * flag is true, the milliseconds portion of the counter is also reset by
      * setting COMP0 to RTC_COUNTS_PER_SEC (i.e. the next full second).
-     * The high-resolution timer COMP1 is always changed in a way that the
-     * remaining time will be correct.
+     * The high-resolution timer COMP1 and the start times of the timers are
+     * always changed in a way that the remaining time will be correct.
      */
     RTC->COMP0 = (sync ? RTC_COUNTS_PER_SEC : RTC->COMP0 - rtcCNT);
     RTC->COMP1 -= rtcCNT;
+    for (i = 0;  i < MAX_MS_TIMERS;  i++)
+	l_msTimer[i].Start = (l_msTimer[i].Start - rtcCNT) & 0xFFFFFF;
+    if (sync)
+	l_TickCurr = 1;		// COMP0 is one second ahead now
 
     /* Set new start time and reset overflow counter */
     clockSetStartTime (newRtcStartTime);
     clockSetOverflowCounter (0);
 
+    /* Re-synchronize <g_CurrDateTime> with the next one-second interrupt */
+    l_flgClockResync = true;
+
     /* Start the clock */
     RTC_Enable (true);
 
     /* Finally restore the original state of the IEN register */
     RTC->IEN = rtcIEN;
 }
+
+/***************************************************************************//**
+ *
+ * @brief	Set Tick Period
+ *
+ * This routine sets the period of the COMP0 interrupt, i.e. how often the
+ * MCU is woken up from EM2 by the alarm clock.  The default is one second.
+ * With a longer period, @ref g_CurrDateTime is advanced and the software
+ * timers are decremented by the elapsed seconds in one interrupt, so the
+ * values may lag behind by up to one period.  time() is not affected.
+ *
+ * The period is limited to @ref CLOCK_TICK_MAX seconds, so <b>tm_sec</b>
+ * still changes with each interrupt.  The main loop uses this to detect a
+ * new second, see SeriesCheck() for example.
+ *
+ * @param[in] seconds
+ *	Period in seconds, from 1 to @ref CLOCK_TICK_MAX.  The new period
+ *	is used after the next COMP0 interrupt.
+ *
+ ******************************************************************************/
+void	ClockTickSet (int seconds)
+{
+    if (seconds < 1)
+	seconds = 1;
+    else if (seconds > CLOCK_TICK_MAX)
+	seconds = CLOCK_TICK_MAX;
+
+    l_TickSeconds = (uint8_t)seconds;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Get Tick Period
+ *
+ * Returns the period of the COMP0 interrupt in seconds, see ClockTickSet().
+ *
+ ******************************************************************************/
+int	ClockTickGet (void)
+{
+    return l_TickSeconds;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Time of the last Tick
+ *
+ * Returns the RTC counter value of the last COMP0 interrupt, i.e. the time
+ * @ref g_CurrDateTime refers to.  COMP0 already points to the next tick,
+ * which is the tick period currently scheduled ahead.
+ *
+ ******************************************************************************/
+uint32_t ClockTickLast (void)
+{
+uint32_t	cnt;
+
+    INT_Disable();
+    cnt = (RTC->COMP0 - l_TickCurr * RTC_COUNTS_PER_SEC) & 0xFFFFFF;
+    INT_Enable();
+
+    return cnt;
+}
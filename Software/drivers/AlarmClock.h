@@ -2,9 +2,15 @@
  * @file
  * @brief	Header file of module AlarmClock.c
  * @author	Ralf Gerhauser
- * @version	2016-09-14
+ * @version	2026-10-18
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added prototype for ClockTickLast().
+2026-10-18,agent	Added MAX_MS_TIMERS and msTimerCreate(), msTimerStart()
+		and msTimerCancel() take a handle now.  Removed msTimerAction().
+2026-10-18,agent	Added CLOCK_TICK_MAX and prototypes for ClockTickSet()
+		and ClockTickGet().
+2026-10-18,agent	Added prototype for ClockCycleCompare().
 2016-09-14,rage	Added prototype for ClockGetMilliSec().
 2016-04-05,rage	Made variable <g_isdst> of type "volatile".
 		Added variable <g_PowerUpTime>.
@@ -33,6 +39,11 @@ Revision History:
     #define MAX_SEC_TIMERS	10
 #endif
 
+#ifndef MAX_MS_TIMERS
+    /*!@brief Maximum number of msTimer entries */
+    #define MAX_MS_TIMERS	4
+#endif
+
 #ifndef MAX_ALARMS
     /*!@brief Maximum number of alarms */
     #define MAX_ALARMS		10
@@ -46,6 +57,11 @@ Revision History:
     /*!@brief Macro to convert milliseconds to RTC tics. */
 #define MS2TICS(ms)	((ms) * RTC_COUNTS_PER_SEC / 1000)
 
+    /*!@brief Maximum period of the COMP0 interrupt in [s], see ClockTickSet().
+     * It must be less than 60, so <b>tm_sec</b> changes with each interrupt.
+     */
+#define CLOCK_TICK_MAX	30
+
     /*!@brief Workaround for Y2K38 problem
      *
      * If the define Y2K38_WORKAROUND is 1, a workaround for the Year 2038
@@ -116,9 +132,9 @@ void	sTimerStart (TIM_HDL hdl, uint32_t seconds);
 void	sTimerCancel(TIM_HDL hdl);
 
     /* msTimer handling functions (high-resolution timer) */
-void	msTimerAction(void (*function)(void));
-void	msTimerStart (uint32_t ms);
-void	msTimerCancel(void);
+TIM_HDL	msTimerCreate(TIMER_FCT function);
+void	msTimerStart (TIM_HDL hdl, uint32_t ms);
+void	msTimerCancel(TIM_HDL hdl);
 void	msDelay (uint32_t ms);
 void	DelayTick (void);
 
@@ -128,6 +144,12 @@ void	ClockUpdate (bool readTime);
 void	ClockGet (struct tm *pTimeDateVar);
 void	ClockGetMilliSec (struct tm *pTimeDateVar, unsigned int *pMsVar);
 void	ClockSet (struct tm *pNewTimeDate, bool sync);
+void	ClockTickSet (int seconds);
+int	ClockTickGet (void);
+uint32_t ClockTickLast (void);
+#ifdef DEBUG
+void	ClockCycleCompare (void);
+#endif
 
 
 #endif /* __INC_AlarmClock_h */
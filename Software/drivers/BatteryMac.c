@@ -0,0 +1,258 @@
+/***************************************************************************//**
+ * @file
+ * @brief	ManufacturerBlockAccess Reader
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * The bq40z50 provides most of its status information via MAC subcommands.
+ * The subcommand is written to ManufacturerBlockAccess() (0x44) as SMBus
+ * block write, and the response is read back as block from the same
+ * register:
+ * <pre>
+ *   CNT  SUBCMD_LO  SUBCMD_HI  DATA[CNT-2]
+ * </pre>
+ * One block like DAStatus1 contains all cell voltages, the pack voltage,
+ * and the cell currents and powers, i.e. 16 values in one transaction
+ * instead of 16 word reads.
+ *
+ * BatteryMacSnapshot() reads the status blocks listed in @ref l_MacBlock
+ * and decodes their fields.  Fields which are also available as SBS
+ * register, e.g. CellVoltage1..4, are stored with BatteryRegSharedStore(),
+ * so the display poll and the watch list read them from the snapshot
+ * instead of the bus.  All fields are passed to a callback, see the console
+ * command "mac".
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_i2c.h"
+#include "BatteryMac.h"
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief MAC data block and its fields. */
+typedef struct
+{
+    MAC_CMD	 SubCmd;	//!< Subcommand to read the block
+    const MAC_FIELD *pField;	//!< Fields of the block
+    int		 FieldCnt;	//!< Number of fields
+} MAC_BLOCK;
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Fields of DAStatus1, cell currents in [mA], powers in [cW]. */
+static const MAC_FIELD l_DAStatus1[] =
+{  //  pName,		Offs,	Size,	flgSigned,	Cmd
+    {  "CellVoltage1",	 0,	2,	false,		SBS_CellVoltage1 },
+    {  "CellVoltage2",	 2,	2,	false,		SBS_CellVoltage2 },
+    {  "CellVoltage3",	 4,	2,	false,		SBS_CellVoltage3 },
+    {  "CellVoltage4",	 6,	2,	false,		SBS_CellVoltage4 },
+    {  "BatVoltage",	 8,	2,	false,		SBS_NONE	 },
+    {  "PackVoltage",	10,	2,	false,		SBS_NONE	 },
+    {  "CellCurrent1",	12,	2,	true,		SBS_NONE	 },
+    {  "CellCurrent2",	14,	2,	true,		SBS_NONE	 },
+    {  "CellCurrent3",	16,	2,	true,		SBS_NONE	 },
+    {  "CellCurrent4",	18,	2,	true,		SBS_NONE	 },
+    {  "CellPower1",	20,	2,	true,		SBS_NONE	 },
+    {  "CellPower2",	22,	2,	true,		SBS_NONE	 },
+    {  "CellPower3",	24,	2,	true,		SBS_NONE	 },
+    {  "CellPower4",	26,	2,	true,		SBS_NONE	 },
+    {  "Power",		28,	2,	true,		SBS_NONE	 },
+    {  "AveragePower",	30,	2,	true,		SBS_NONE	 },
+};
+
+    /*!@brief Fields of DAStatus2, temperatures in [0.1°K]. */
+static const MAC_FIELD l_DAStatus2[] =
+{  //  pName,		Offs,	Size,	flgSigned,	Cmd
+    {  "IntTemperature", 0,	2,	false,		SBS_NONE	 },
+    {  "TS1Temperature", 2,	2,	false,		SBS_NONE	 },
+    {  "TS2Temperature", 4,	2,	false,		SBS_NONE	 },
+    {  "TS3Temperature", 6,	2,	false,		SBS_NONE	 },
+    {  "TS4Temperature", 8,	2,	false,		SBS_NONE	 },
+    {  "CellTemperature",10,	2,	false,		SBS_NONE	 },
+    {  "FETTemperature",12,	2,	false,		SBS_NONE	 },
+};
+
+    /*!@brief Fields of ITStatus1, capacities in [mAh], energies in [cWh]. */
+static const MAC_FIELD l_ITStatus1[] =
+{  //  pName,		Offs,	Size,	flgSigned,	Cmd
+    {  "TrueRemQ",	 0,	2,	true,		SBS_NONE	 },
+    {  "TrueRemE",	 2,	2,	true,		SBS_NONE	 },
+    {  "InitialQ",	 4,	2,	true,		SBS_NONE	 },
+    {  "InitialE",	 6,	2,	true,		SBS_NONE	 },
+    {  "TrueFullChgQ",	 8,	2,	true,		SBS_NONE	 },
+    {  "TrueFullChgE",	10,	2,	true,		SBS_NONE	 },
+    {  "TSim",		12,	2,	false,		SBS_NONE	 },
+    {  "TAmbient",	14,	2,	false,		SBS_NONE	 },
+};
+
+    /*!@brief Fields of LifetimeData1, voltages in [mV], currents in [mA],
+     * power in [cW], temperatures in [°C].
+     */
+static const MAC_FIELD l_LifetimeData1[] =
+{  //  pName,		Offs,	Size,	flgSigned,	Cmd
+    {  "MaxCellVoltage1", 0,	2,	false,		SBS_NONE	 },
+    {  "MaxCellVoltage2", 2,	2,	false,		SBS_NONE	 },
+    {  "MaxCellVoltage3", 4,	2,	false,		SBS_NONE	 },
+    {  "MaxCellVoltage4", 6,	2,	false,		SBS_NONE	 },
+    {  "MinCellVoltage1", 8,	2,	false,		SBS_NONE	 },
+    {  "MinCellVoltage2",10,	2,	false,		SBS_NONE	 },
+    {  "MinCellVoltage3",12,	2,	false,		SBS_NONE	 },
+    {  "MinCellVoltage4",14,	2,	false,		SBS_NONE	 },
+    {  "MaxDeltaCellVolt",16,	2,	false,		SBS_NONE	 },
+    {  "MaxChargeCurrent",18,	2,	true,		SBS_NONE	 },
+    {  "MaxDsgCurrent",	20,	2,	true,		SBS_NONE	 },
+    {  "MaxAvgDsgCurrent",22,	2,	true,		SBS_NONE	 },
+    {  "MaxAvgDsgPower",24,	2,	true,		SBS_NONE	 },
+    {  "MaxTempCell",	26,	1,	true,		SBS_NONE	 },
+    {  "MinTempCell",	27,	1,	true,		SBS_NONE	 },
+    {  "MaxDeltaCellTemp",28,	1,	true,		SBS_NONE	 },
+    {  "MaxTempIntSensor",29,	1,	true,		SBS_NONE	 },
+    {  "MinTempIntSensor",30,	1,	true,		SBS_NONE	 },
+    {  "MaxTempFET",	31,	1,	true,		SBS_NONE	 },
+};
+
+    /*!@brief Fields of ChargingStatus. */
+static const MAC_FIELD l_ChargingStatus[] =
+{  //  pName,		Offs,	Size,	flgSigned,	Cmd
+    {  "ChargingStatus", 0,	3,	false,		SBS_ChargingStatus },
+};
+
+    /*!@brief List of status blocks read by BatteryMacSnapshot(). */
+static const MAC_BLOCK l_MacBlock[] =
+{
+    {  MAC_DAStatus1,	  l_DAStatus1,	   ELEM_CNT(l_DAStatus1)	},
+    {  MAC_DAStatus2,	  l_DAStatus2,	   ELEM_CNT(l_DAStatus2)	},
+    {  MAC_ITStatus1,	  l_ITStatus1,	   ELEM_CNT(l_ITStatus1)	},
+    {  MAC_LifetimeData1, l_LifetimeData1, ELEM_CNT(l_LifetimeData1)	},
+    {  MAC_ChargingStatus,l_ChargingStatus,ELEM_CNT(l_ChargingStatus)	},
+};
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read MAC Data Block
+ *
+ * Writes the subcommand to ManufacturerBlockAccess() and reads the response
+ * block.  Both transfers are executed as one unit, see BatteryRegWriteRead().
+ *
+ * @param[in] subCmd
+ *	MAC subcommand.
+ *
+ * @param[out] pBuf
+ *	Address of a buffer where to store the data, without byte count and
+ *	subcommand.
+ *
+ * @param[in] bufSize
+ *	Size of the buffer.
+ *
+ * @return
+ *	Number of data bytes stored in @p pBuf, or a negative error code, see
+ *	BatteryRegReadBlock().  @ref i2cMacMismatch is returned if the response
+ *	does not belong to the subcommand.
+ *
+ ******************************************************************************/
+int	BatteryMacRead (MAC_CMD subCmd, uint8_t *pBuf, size_t bufSize)
+{
+uint8_t	 wrBuf[3];			// byte count and subcommand
+uint8_t	 rdBuf[3 + MAC_DATA_MAX];	// byte count, subcommand, and data
+int	 status, cnt;
+
+
+    wrBuf[0] = 2;
+    wrBuf[1] = (uint8_t) subCmd;
+    wrBuf[2] = (uint8_t)(subCmd >> 8);
+
+    status = BatteryRegWriteRead (SBS_ManufacturerBlockAccess,
+				  wrBuf, sizeof(wrBuf),
+				  SBS_ManufacturerBlockAccess,
+				  rdBuf, sizeof(rdBuf));
+    if (status != i2cTransferDone)
+	return status;
+
+    /* Verify the response */
+    if (rdBuf[0] < 2  ||  rdBuf[0] > 2 + MAC_DATA_MAX
+    ||  rdBuf[1] != wrBuf[1]  ||  rdBuf[2] != wrBuf[2])
+	return i2cMacMismatch;
+
+    cnt = rdBuf[0] - 2;
+    if (cnt > (int) bufSize)
+	cnt = bufSize;
+
+    memcpy (pBuf, rdBuf + 3, cnt);
+
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read Status Snapshot via MAC
+ *
+ * Reads all status blocks of @ref l_MacBlock and decodes their fields.
+ * Fields with an equivalent SBS register are stored via
+ * BatteryRegSharedStore(), so they are not read again in this second.
+ * Blocks which cannot be read, or are too short, are skipped.
+ *
+ * @param[in] fct
+ *	Function to be called for each decoded field, or NULL.
+ *
+ * @return
+ *	Number of blocks read, or a negative error code if no block could be
+ *	read.  @ref i2cInvalidParameter is returned if the controller does not
+ *	support MAC subcommands.
+ *
+ ******************************************************************************/
+int	BatteryMacSnapshot (MAC_FIELD_FCT fct)
+{
+const MAC_FIELD *pField;
+uint8_t	 dataBuf[MAC_DATA_MAX];
+uint32_t value;
+int	 b, f, i, cnt;
+int	 idx = 0;			// index of the field in all blocks
+int	 blockCnt = 0, status = i2cInvalidParameter;
+
+
+    if (g_BatteryCtrlType != BCT_TI)
+	return i2cInvalidParameter;
+
+    for (b = 0;  b < (int) ELEM_CNT(l_MacBlock);  b++)
+    {
+	cnt = BatteryMacRead (l_MacBlock[b].SubCmd, dataBuf, sizeof(dataBuf));
+	if (cnt < 0)
+	{
+	    status = cnt;
+	    idx += l_MacBlock[b].FieldCnt;
+	    continue;
+	}
+
+	blockCnt++;
+
+	for (f = 0;  f < l_MacBlock[b].FieldCnt;  f++, idx++)
+	{
+	    pField = &l_MacBlock[b].pField[f];
+	    if (pField->Offs + pField->Size > cnt)
+		continue;		// block too short
+
+	    /* build value from data buffer (always little endian) */
+	    value = 0;
+	    for (i = pField->Size - 1;  i >= 0;  i--)
+		value = (value << 8) | dataBuf[pField->Offs + i];
+
+	    if (pField->Cmd != SBS_NONE)
+		BatteryRegSharedStore (pField->Cmd, value);
+
+	    if (fct != NULL)
+		fct (pField, idx, value);
+	}
+    }
+
+    return (blockCnt > 0 ? blockCnt : status);
+}
@@ -0,0 +1,66 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module BatteryMac.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_BatteryMac_h
+#define __INC_BatteryMac_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "BatteryMon.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Maximum number of data bytes of a MAC block. */
+#define MAC_DATA_MAX		32
+
+    /*!@brief Error code if the response does not match the subcommand,
+     * additionally to @ref I2C_TransferReturn_TypeDef
+     */
+#define i2cMacMismatch		-13
+
+    /*!@brief MAC Subcommands of the bq40z50, see ManufacturerBlockAccess() */
+typedef enum
+{
+    MAC_ChargingStatus	= 0x0055,	//!< Charging status flags
+    MAC_LifetimeData1	= 0x0060,	//!< Lifetime data block 1
+    MAC_DAStatus1	= 0x0071,	//!< Cell voltages, currents, powers
+    MAC_DAStatus2	= 0x0072,	//!< Temperatures
+    MAC_ITStatus1	= 0x0073,	//!< Impedance Track gauging status
+} MAC_CMD;
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Field of a MAC data block. */
+typedef struct
+{
+    const char	*pName;		//!< Name of the field
+    uint8_t	 Offs;		//!< Offset in the data block
+    uint8_t	 Size;		//!< Size in bytes, 1 to 4
+    bool	 flgSigned;	//!< Value is a signed integer
+    SBS_CMD	 Cmd;		//!< Equivalent SBS register, or SBS_NONE
+} MAC_FIELD;
+
+    /*!@brief Callback for each decoded field, see BatteryMacSnapshot().
+     * <b>idx</b> is the index of the field in the list of all fields.
+     */
+typedef void (*MAC_FIELD_FCT)(const MAC_FIELD *pField, int idx,
+			      uint32_t value);
+
+/*================================ Prototypes ================================*/
+
+int	 BatteryMacRead (MAC_CMD subCmd, uint8_t *pBuf, size_t bufSize);
+int	 BatteryMacSnapshot (MAC_FIELD_FCT fct);
+
+
+#endif /* __INC_BatteryMac_h */
@@ -2,7 +2,7 @@
  * @file
  * @brief	Battery Monitoring
  * @author	Ralf Gerhauser
- * @version	2020-01-13
+ * @version	2026-10-18
  *
  * This module can be used to read status information from the battery pack
  * via its SMBus interface.  It also provides function ReadVdd() to read the
@@ -55,6 +55,25 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added BatteryMonPowerSave(): the SMBus pins are disabled
+		while the queue is empty, e.g. between the sweeps of the monitor
+		mode.
+2026-10-18,agent	Added BatteryMonIsBusy() and BatteryMonAbort() for the
+		power-off sequence.
+2026-10-18,agent	Added BatterySmbFreqSet() to change the SMBus clock
+		rate.
+2026-10-18,agent	Added BatteryRegSharedStore() to store values of a MAC
+		status block, see module BatteryMac.c.
+2026-10-18,agent	Transactions can write data, and may be chained to a
+		unit, e.g. a write and the dependent read.  Added the functions
+		BatteryRegWriteValue(), BatteryRegWriteBlock(), and
+		BatteryRegWriteRead().
+2026-10-18,agent	SMBus transactions are queued and executed back to back
+		from the interrupt handler, see BatteryXactSubmit().  The
+		blocking read functions are built on top of the queue.
+2026-10-18,agent	Added BatteryRegReadShared(): periodic consumers like
+		the LCD and the watch list share one bus read per register and
+		second.
 2020-01013,rage	Implemented probing for a connected battery controller type.
 		Make information available via variables g_BatteryCtrlAddr,
 		g_BatteryCtrlType, and g_BatteryCtrlName.
@@ -68,11 +87,14 @@ Revision History:
 
 /*=============================== Header Files ===============================*/
 
+#include <time.h>
+#include <string.h>
 #include "em_cmu.h"
 #include "em_i2c.h"
 #include "em_emu.h"
 #include "em_gpio.h"
 #include "em_adc.h"
+#include "em_int.h"
 #include "AlarmClock.h"		// msDelay()
 #include "BatteryMon.h"
 #include "Display.h"
@@ -149,10 +171,58 @@ static I2C_Init_TypeDef smbInit =
     /* Status of the last SMBus transaction */
 static volatile I2C_TransferReturn_TypeDef SMB_Status;
 
+    /*!@brief Queue of SMBus transactions, see BatteryXactSubmit() */
+static SMB_XACT * volatile l_SmbQueue[SMB_QUEUE_SIZE];
+
+    /*!@brief Queue indices: <b>Head</b> is written by BatteryXactSubmit(),
+     * <b>Tail</b> when a transaction is started.
+     */
+static volatile uint16_t l_SmbQHead, l_SmbQTail;
+
+    /*!@brief Transaction currently executed on the SMBus, or NULL */
+static SMB_XACT * volatile l_pSmbCurr;
+
+    /*!@brief RTC counter when the current transaction has been started */
+static volatile uint32_t l_SmbStart;
+
+    /*!@brief Transfer sequence of the current transaction */
+static I2C_TransferSeq_TypeDef l_SmbXfer;
+
+    /*!@brief Next transaction of the current unit, see SMB_XACT.pNext */
+static SMB_XACT * volatile l_pSmbChain;
+
+    /*!@brief Command byte and data to write of the current transaction */
+static uint8_t	 l_SmbWrBuf[1 + SMB_WRITE_MAX];
+
+    /*!@brief Disable the SMBus pins while idle, see BatteryMonPowerSave() */
+static volatile bool l_flgSmbPowerSave;
+
+    /*!@brief Flag if the SMBus pins are currently disabled */
+static volatile bool l_flgSmbPinsOff;
+
+    /*!@brief Cache for BatteryRegReadShared(), valid for one second */
+static struct
+{
+    SBS_CMD	 Cmd;		//!< register which has been read
+    uint32_t	 Value;		//!< value read
+    time_t	 Time;		//!< second of the read
+} l_Shared[SHARED_CACHE_SIZE];
+
+    /*!@brief Next cache entry to replace */
+static int	 l_SharedNext;
+
+    /*!@brief Statistics: bus reads and cache hits of BatteryRegReadShared() */
+static uint32_t	 l_SharedReads, l_SharedHits;
+
 /*=========================== Forward Declarations ===========================*/
 
 static void	DisplayBatteryType(int userParm);
 static void	ADC_Config(void);
+static void	SMB_StartNext(void);
+static void	SMB_Done(SMB_XACT *pXact, int status);
+static int	SMB_Execute(SMB_XACT *pXact);
+static void	SMB_Reset(void);
+static void	SMB_PinsEnable(bool enable);
 
 
 /***************************************************************************//**
@@ -228,6 +298,41 @@ void	 BatteryMonDeinit (void)
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Set SMBus Clock Rate
+ *
+ * Changes the clock rate of the SMBus, e.g. for bulk transfers with a short
+ * cable.  This is only possible while no transaction is in progress.
+ *
+ * @param[in] freq
+ *	Clock rate in [Hz], or 0 for the default of 10kHz.
+ *
+ * @return
+ *	Actual clock rate in [Hz], or 0 if the SMBus is busy.
+ *
+ ******************************************************************************/
+uint32_t BatterySmbFreqSet (uint32_t freq)
+{
+    if (freq == 0)
+	freq = smbInit.freq;
+
+    INT_Disable();
+
+    if (l_pSmbCurr != NULL)
+    {
+	INT_Enable();
+	return 0;			// SMBus is busy
+    }
+
+    I2C_BusFreqSet (SMB_I2C_CTRL, smbInit.refFreq, freq, smbInit.clhr);
+
+    INT_Enable();
+
+    return I2C_BusFreqGet (SMB_I2C_CTRL);
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Probe for Controller Type
@@ -265,6 +370,9 @@ int	status;
 	}
     }
 
+    /* Controller may have changed - discard shared values */
+    memset (l_Shared, 0, sizeof(l_Shared));
+
     g_BatteryCtrlAddr = l_ProbeList[i].addr;
     g_BatteryCtrlName = l_ProbeList[i].name;
     g_BatteryCtrlType = l_ProbeList[i].type;
@@ -313,13 +421,343 @@ static void	DisplayBatteryType(int userParm)
  *
  * This handler is executed for each byte transferred via the SMBus interface.
  * It calls the driver function I2C_Transfer() to prepare the next data byte,
- * or generate a STOP condition at the end of a transfer.
+ * or generate a STOP condition at the end of a transfer.  When a transaction
+ * is complete, its status is stored and the next one from the queue is
+ * started immediately, so queued transactions run back to back.
  *
  ******************************************************************************/
 void	 SMB_IRQHandler (void)
 {
     /* Update <SMB_Status> */
     SMB_Status = I2C_Transfer (SMB_I2C_CTRL);
+
+    if (SMB_Status != i2cTransferInProgress  &&  l_pSmbCurr != NULL)
+    {
+	SMB_Done (l_pSmbCurr, SMB_Status);
+	SMB_StartNext();
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start next queued Transaction
+ *
+ * This internal routine starts the next transaction of the current unit,
+ * or else of the queue.  If the queue is empty, the SMBus no longer requires
+ * EM1.  It must be called from the interrupt handler or with interrupts
+ * disabled.
+ *
+ ******************************************************************************/
+static void SMB_StartNext (void)
+{
+SMB_XACT *pXact;
+
+
+    for (;;)
+    {
+	if (l_pSmbChain != NULL)
+	{
+	    pXact = l_pSmbChain;	// continue the current unit
+	    l_pSmbChain = NULL;
+	}
+	else if (l_SmbQTail != l_SmbQHead)
+	{
+	    pXact = l_SmbQueue[l_SmbQTail];
+	    l_SmbQTail = (l_SmbQTail + 1) % SMB_QUEUE_SIZE;
+	}
+	else
+	{
+	    break;			// queue is empty
+	}
+
+	/* Command byte, followed by the data to write */
+	l_SmbWrBuf[0] = SBS_CMD_ADDR(pXact->Cmd);	// register address
+	if (pXact->WrCnt > 0)
+	    memcpy (l_SmbWrBuf + 1, pXact->pWrBuf, pXact->WrCnt);
+
+	l_SmbXfer.addr  = g_BatteryCtrlAddr;	// I2C address of the controller
+	l_SmbXfer.buf[0].data = l_SmbWrBuf;	// first buffer (data to write)
+	l_SmbXfer.buf[0].len  = 1 + pXact->WrCnt;
+
+	if (pXact->Cnt > 0)
+	{
+	    /* Set up SMBus transfer S-Wr-Cmd-[data]-Sr-Rd-data1-P */
+	    l_SmbXfer.flags = I2C_FLAG_WRITE_READ; // write, then read data
+	    l_SmbXfer.buf[1].data = pXact->pBuf;	// buffer for bytes read
+	    l_SmbXfer.buf[1].len  = pXact->Cnt;	// number of bytes to read
+	}
+	else
+	{
+	    /* Set up SMBus transfer S-Wr-Cmd-data-P */
+	    l_SmbXfer.flags = I2C_FLAG_WRITE;	// write only
+	}
+
+	l_pSmbCurr = pXact;
+	l_SmbStart = RTC->CNT;
+
+	/* Start I2C Transfer */
+	SMB_Status = I2C_TransferInit (SMB_I2C_CTRL, &l_SmbXfer);
+	if (SMB_Status == i2cTransferInProgress)
+	    return;			// running, wait for interrupts
+
+	/* Early error, e.g. bus busy - try next one */
+	SMB_Done (pXact, SMB_Status);
+    }
+
+    /* Queue is empty */
+    l_pSmbCurr = NULL;
+    Bit(g_EM1_ModuleMask, EM1_MOD_SMBUS) = 0;
+
+    if (l_flgSmbPowerSave)
+	SMB_PinsEnable (false);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Transaction Done
+ *
+ * This internal routine stores the final status of a transaction.  If it
+ * was successful, the next transaction of the unit is started next.  If it
+ * failed, the rest of the unit fails with the same status.
+ *
+ ******************************************************************************/
+static void SMB_Done (SMB_XACT *pXact, int status)
+{
+SMB_XACT *pNext = pXact->pNext;	// read before the owner may reuse it
+
+
+    pXact->Status = status;
+
+    if (status == i2cTransferDone)
+    {
+	l_pSmbChain = pNext;
+    }
+    else
+    {
+	l_pSmbChain = NULL;
+	for ( ;  pNext != NULL;  pNext = pNext->pNext)
+	    pNext->Status = status;
+    }
+
+    g_flgIRQ = true;		// notify the main loop
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Submit SMBus Transaction
+ *
+ * Appends a transaction to the queue and returns immediately.  The queued
+ * transactions are executed one after another by the interrupt handler.
+ * While the queue is not empty, the main loop must not enter EM2, so the
+ * @ref EM1_MOD_SMBUS bit is set in @ref g_EM1_ModuleMask.
+ *
+ * The caller has to check <b>Status</b> of the transaction, and must call
+ * BatteryMonCheck() from the main loop to handle timeouts.  For a unit of
+ * chained transactions, the <b>Status</b> of the last one is final.
+ *
+ * @param[in] pXact
+ *	Address of the transaction, or of the first transaction of a unit.
+ *
+ * @return
+ *	0 if the transaction has been queued, @ref i2cInvalidParameter, or
+ *	@ref i2cQueueFull.
+ *
+ ******************************************************************************/
+int	 BatteryXactSubmit (SMB_XACT *pXact)
+{
+SMB_XACT *p;
+uint16_t next;
+
+
+    EFM_ASSERT(pXact != NULL);
+
+    for (p = pXact;  p != NULL;  p = p->pNext)
+    {
+	if ((p->Cnt == 0  &&  p->WrCnt == 0)  ||  p->WrCnt > SMB_WRITE_MAX
+	||  (p->Cnt > 0  &&  p->pBuf == NULL)
+	||  (p->WrCnt > 0  &&  p->pWrBuf == NULL))
+	    return i2cInvalidParameter;
+    }
+
+    INT_Disable();
+
+    next = (l_SmbQHead + 1) % SMB_QUEUE_SIZE;
+    if (next == l_SmbQTail)
+    {
+	INT_Enable();
+	return i2cQueueFull;
+    }
+
+    for (p = pXact;  p != NULL;  p = p->pNext)
+	p->Status = i2cTransferInProgress;
+
+    l_SmbQueue[l_SmbQHead] = pXact;
+    l_SmbQHead = next;
+
+    Bit(g_EM1_ModuleMask, EM1_MOD_SMBUS) = 1;
+
+    /* Start now if the SMBus is idle */
+    if (l_pSmbCurr == NULL)
+    {
+	if (l_flgSmbPinsOff)
+	    SMB_PinsEnable (true);
+
+	SMB_StartNext();
+    }
+
+    INT_Enable();
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check SMBus Queue
+ *
+ * This function must be called from the main loop.  If the current
+ * transaction does not complete within @ref I2C_XFER_TIMEOUT, the bus is
+ * reset, the transaction fails with @ref i2cTransferTimeout, and the queue
+ * continues with the next one.
+ *
+ ******************************************************************************/
+void	 BatteryMonCheck (void)
+{
+SMB_XACT *pXact = l_pSmbCurr;
+
+
+    if (pXact == NULL
+    ||  ((RTC->CNT - l_SmbStart) & 0x00FFFFFF) <= I2C_XFER_TIMEOUT)
+	return;
+
+    NVIC_DisableIRQ (SMB_IRQn);
+
+    if (l_pSmbCurr == pXact  &&  pXact->Status == i2cTransferInProgress)
+    {
+	SMB_Reset();
+	SMB_Status = (I2C_TransferReturn_TypeDef)i2cTransferTimeout;
+
+	INT_Disable();
+	SMB_Done (pXact, SMB_Status);
+	SMB_StartNext();
+	INT_Enable();
+    }
+
+    NVIC_EnableIRQ (SMB_IRQn);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if SMBus Transactions are pending
+ *
+ * Returns true if a transaction is in progress or queued.
+ *
+ ******************************************************************************/
+bool	 BatteryMonIsBusy (void)
+{
+    return l_pSmbCurr != NULL  ||  l_SmbQTail != l_SmbQHead;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Abort all SMBus Transactions
+ *
+ * Aborts the current transfer, and fails it and all queued transactions
+ * with @ref i2cTransferUsageFault.  This is used before power-off, when
+ * there is no time left to wait for them.  The bus is not recovered, see
+ * SMB_Reset(), because this would take too long.
+ *
+ ******************************************************************************/
+void	 BatteryMonAbort (void)
+{
+SMB_XACT *pXact;
+
+
+    NVIC_DisableIRQ (SMB_IRQn);
+    INT_Disable();
+
+    if (l_pSmbCurr != NULL)
+    {
+	SMB_I2C_CTRL->CMD = I2C_CMD_ABORT;
+	SMB_Done (l_pSmbCurr, i2cTransferUsageFault);	// and its unit
+    }
+
+    while (l_SmbQTail != l_SmbQHead)
+    {
+	for (pXact = l_SmbQueue[l_SmbQTail];  pXact != NULL;
+	     pXact = pXact->pNext)
+	    pXact->Status = i2cTransferUsageFault;
+
+	l_SmbQTail = (l_SmbQTail + 1) % SMB_QUEUE_SIZE;
+    }
+
+    l_pSmbCurr = NULL;
+    l_pSmbChain = NULL;
+    Bit(g_EM1_ModuleMask, EM1_MOD_SMBUS) = 0;
+
+    INT_Enable();
+    NVIC_ClearPendingIRQ (SMB_IRQn);
+    NVIC_EnableIRQ (SMB_IRQn);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	SMBus Power Save
+ *
+ * If enabled, the SCL and SDA pins are disabled whenever the queue of
+ * transactions runs empty, and enabled again with the next transaction.
+ * This disconnects the internal pull-ups from the SMBus between two sweeps,
+ * e.g. in the monitor mode, so no current flows into the lines of a pack
+ * that is asleep.  The I2C controller keeps its configuration, a bus state
+ * left over from the disabled pins is cleared by I2C_TransferInit().
+ *
+ * @param[in] enable
+ *	true to disable the pins while idle, false to keep them enabled.
+ *
+ ******************************************************************************/
+void	 BatteryMonPowerSave (bool enable)
+{
+    INT_Disable();
+
+    l_flgSmbPowerSave = enable;
+
+    if (! enable)
+	SMB_PinsEnable (true);
+    else if (l_pSmbCurr == NULL)
+	SMB_PinsEnable (false);
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enable or disable the SMBus Pins
+ *
+ * This internal routine switches SCL and SDA between the wired-AND mode with
+ * pull-up and the disabled mode.  It must be called with interrupts disabled.
+ *
+ ******************************************************************************/
+static void  SMB_PinsEnable (bool enable)
+{
+    if (enable)
+    {
+	GPIO_PinModeSet (SMB_GPIOPORT, SMB_SCL_PIN, gpioModeWiredAndPullUp, 1);
+	GPIO_PinModeSet (SMB_GPIOPORT, SMB_SDA_PIN, gpioModeWiredAndPullUp, 1);
+    }
+    else
+    {
+	GPIO_PinModeSet (SMB_GPIOPORT, SMB_SCL_PIN, gpioModeDisabled, 0);
+	GPIO_PinModeSet (SMB_GPIOPORT, SMB_SDA_PIN, gpioModeDisabled, 0);
+    }
+
+    l_flgSmbPinsOff = ! enable;
 }
 
 
@@ -413,13 +851,121 @@ int	 i;
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Read Register Value shared by periodic Consumers
+ *
+ * This routine is identical to BatteryRegReadValue(), but the value is only
+ * read once per second.  Further requests for the same register within
+ * this second return the stored value without a bus transfer.  All periodic
+ * consumers, i.e. the display poll and the watch list, use this routine, so
+ * a register that is needed by several of them is read only once.
+ *
+ * Interactive commands, which require a fresh value, must still use
+ * BatteryRegReadValue().
+ *
+ * @param[in] cmd
+ *	SBS command, i.e. the register address to be read.
+ *
+ * @param[out] pValue
+ *	Address of 32bit variable where to store the value.
+ *
+ * @return
+ *	Status code @ref i2cTransferDone (0), or a negative error code, see
+ *	BatteryRegReadValue().  Errors are not cached.
+ *
+ ******************************************************************************/
+int	 BatteryRegReadShared (SBS_CMD cmd, uint32_t *pValue)
+{
+time_t	 now = time(NULL);
+uint32_t value;
+int	 status;
+int	 i;
+
+
+    for (i = 0;  i < SHARED_CACHE_SIZE;  i++)
+    {
+	if (l_Shared[i].Cmd == cmd  &&  l_Shared[i].Time == now)
+	{
+	    l_SharedHits++;
+	    *pValue = l_Shared[i].Value;
+	    return i2cTransferDone;
+	}
+    }
+
+    l_SharedReads++;
+    status = BatteryRegReadValue (cmd, &value);
+    if (status != i2cTransferDone)
+	return status;
+
+    BatteryRegSharedStore (cmd, value);
+
+    *pValue = value;
+    return status;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Store Register Value for shared Reads
+ *
+ * Stores a register value, which has been obtained in another way, e.g.
+ * from a MAC status block, for BatteryRegReadShared().  It is valid until
+ * the end of the current second.
+ *
+ * @param[in] cmd
+ *	SBS command, i.e. the register address.
+ *
+ * @param[in] value
+ *	Value of the register.
+ *
+ ******************************************************************************/
+void	 BatteryRegSharedStore (SBS_CMD cmd, uint32_t value)
+{
+int	 i;
+
+
+    /* Replace an entry of the same register, or else the oldest entry */
+    for (i = 0;  i < SHARED_CACHE_SIZE;  i++)
+	if (l_Shared[i].Cmd == cmd)
+	    break;
+
+    if (i >= SHARED_CACHE_SIZE)
+    {
+	i = l_SharedNext;
+	if (++l_SharedNext >= SHARED_CACHE_SIZE)
+	    l_SharedNext = 0;
+    }
+
+    l_Shared[i].Cmd   = cmd;
+    l_Shared[i].Value = value;
+    l_Shared[i].Time  = time(NULL);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Statistics of the shared Register Reads
+ *
+ * Returns the number of bus reads and the number of requests, which have been
+ * served without a bus read by BatteryRegReadShared().
+ *
+ ******************************************************************************/
+void	 BatteryRegSharedStats (uint32_t *pReads, uint32_t *pHits)
+{
+    *pReads = l_SharedReads;
+    *pHits  = l_SharedHits;
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Read Data Block from the Battery Controller
  *
  * This routine reads an amount of bytes from the battery controller, as
  * specified by parameter cmd.  This contains the register address and number
- * of bytes to read.
+ * of bytes to read.  The read is queued via BatteryXactSubmit(), and the
+ * routine waits in EM1 until it is complete.
  *
  * @param[in] cmd
  *	SBS command, i.e. the register address and number of bytes to read.
@@ -441,8 +987,7 @@ int	 i;
  ******************************************************************************/
 int	BatteryRegReadBlock (SBS_CMD cmd, uint8_t *pBuf, size_t rdCnt)
 {
-I2C_TransferSeq_TypeDef smbXfer;	// SMBus transfer data
-uint8_t addrBuf[1];			// buffer for device address
+SMB_XACT xact;				// SMBus transaction
 
 
     /* Check parameters */
@@ -453,39 +998,199 @@ uint8_t addrBuf[1];			// buffer for device address
     if (rdCnt < SBS_CMD_SIZE(cmd))	// if EFM_ASSERT() is empty
 	return i2cInvalidParameter;
 
-    /* Set up SMBus transfer S-Wr-Cmd-Sr-Rd-data1-P */
-    smbXfer.addr  = g_BatteryCtrlAddr;	// I2C address of the Battery Controller
-    smbXfer.flags = I2C_FLAG_WRITE_READ; // write address, then read data
-    smbXfer.buf[0].data = addrBuf;	// first buffer (data to write)
-    addrBuf[0] = cmd;			// register address (strip higher bits)
-    smbXfer.buf[0].len  = 1;		// 1 byte for command
-    smbXfer.buf[1].data = pBuf;		// second buffer to store bytes read
-    smbXfer.buf[1].len  = rdCnt;	// number of bytes to read
+    /* Queue SMBus transfer S-Wr-Cmd-Sr-Rd-data1-P */
+    memset (&xact, 0, sizeof(xact));
+    xact.Cmd  = cmd;
+    xact.pBuf = pBuf;
+    xact.Cnt  = rdCnt;
+
+    return SMB_Execute (&xact);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write Register Value to the Battery Controller
+ *
+ * This routine writes a value to the register address specified by @p cmd.
+ * The number of bytes is taken from the size field of @p cmd, i.e. 2 for an
+ * SMBus write word, and sent in little endian order.
+ *
+ * @param[in] cmd
+ *	SBS command, i.e. the register address and size.
+ *
+ * @param[in] value
+ *	Value to write.
+ *
+ * @return
+ *	Status code @ref i2cTransferDone (0), or a negative error code, see
+ *	BatteryRegReadBlock().
+ *
+ ******************************************************************************/
+int	BatteryRegWriteValue (SBS_CMD cmd, uint32_t value)
+{
+SMB_XACT xact;				// SMBus transaction
+uint8_t	 dataBuf[4];			// value in little endian order
+int	 i;
+
+
+    if (SBS_CMD_SIZE(cmd) < 1  ||  SBS_CMD_SIZE(cmd) > sizeof(dataBuf))
+	return i2cInvalidParameter;
+
+    for (i = 0;  i < SBS_CMD_SIZE(cmd);  i++, value >>= 8)
+	dataBuf[i] = (uint8_t) value;
+
+    /* Queue SMBus transfer S-Wr-Cmd-data1-data2-P */
+    memset (&xact, 0, sizeof(xact));
+    xact.Cmd    = cmd;
+    xact.pWrBuf = dataBuf;
+    xact.WrCnt  = SBS_CMD_SIZE(cmd);
+
+    return SMB_Execute (&xact);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write Data Block to the Battery Controller
+ *
+ * This routine performs an SMBus block write, i.e. the byte count is sent
+ * before the data.
+ *
+ * @param[in] cmd
+ *	SBS command, i.e. the register address.
+ *
+ * @param[in] pData
+ *	Address of the data to write.
+ *
+ * @param[in] cnt
+ *	Number of bytes to write, 1 to 32.
+ *
+ * @return
+ *	Status code @ref i2cTransferDone (0), or a negative error code, see
+ *	BatteryRegReadBlock().
+ *
+ ******************************************************************************/
+int	BatteryRegWriteBlock (SBS_CMD cmd, const uint8_t *pData, size_t cnt)
+{
+SMB_XACT xact;				// SMBus transaction
+uint8_t	 dataBuf[SMB_WRITE_MAX];	// byte count and data
+
+
+    if (pData == NULL  ||  cnt < 1  ||  cnt > SMB_WRITE_MAX - 1)
+	return i2cInvalidParameter;
+
+    dataBuf[0] = (uint8_t) cnt;
+    memcpy (dataBuf + 1, pData, cnt);
+
+    /* Queue SMBus transfer S-Wr-Cmd-Cnt-data1-..-dataN-P */
+    memset (&xact, 0, sizeof(xact));
+    xact.Cmd    = cmd;
+    xact.pWrBuf = dataBuf;
+    xact.WrCnt  = 1 + cnt;
+
+    return SMB_Execute (&xact);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write, then Read from the Battery Controller
+ *
+ * This routine writes data to one register and reads the response from
+ * another one, e.g. a ManufacturerAccess() subcommand and the result from
+ * ManufacturerData(), or an AtRate() value and AtRateTimeToEmpty().  Both
+ * transfers are queued as one unit, so no other transaction can change the
+ * state of the controller in between.
+ *
+ * @param[in] wrCmd
+ *	SBS command of the write, i.e. the register address.
+ *
+ * @param[in] pWrData
+ *	Address of the bytes to send after the command byte.  For an SMBus
+ *	block write, the first byte must be the byte count.
+ *
+ * @param[in] wrCnt
+ *	Number of bytes to write, up to @ref SMB_WRITE_MAX.
+ *
+ * @param[in] rdCmd
+ *	SBS command of the read, i.e. the register address.
+ *
+ * @param[out] pBuf
+ *	Address of a buffer where to store the data read.
+ *
+ * @param[in] rdCnt
+ *	Number of bytes to read.
+ *
+ * @return
+ *	Status code @ref i2cTransferDone (0), or a negative error code, see
+ *	BatteryRegReadBlock().
+ *
+ ******************************************************************************/
+int	BatteryRegWriteRead (SBS_CMD wrCmd, const uint8_t *pWrData, size_t wrCnt,
+			     SBS_CMD rdCmd, uint8_t *pBuf, size_t rdCnt)
+{
+SMB_XACT xactWr, xactRd;		// SMBus transactions of the unit
 
-    /* Start I2C Transfer */
-    SMB_Status = I2C_TransferInit (SMB_I2C_CTRL, &smbXfer);
 
-    /* Check early status */
-    if (SMB_Status < 0)
-	return SMB_Status;		// return error code
+    if (wrCnt > SMB_WRITE_MAX  ||  rdCnt < 1)
+	return i2cInvalidParameter;
+
+    memset (&xactRd, 0, sizeof(xactRd));
+    xactRd.Cmd  = rdCmd;
+    xactRd.pBuf = pBuf;
+    xactRd.Cnt  = rdCnt;
+
+    memset (&xactWr, 0, sizeof(xactWr));
+    xactWr.Cmd    = wrCmd;
+    xactWr.pWrBuf = pWrData;
+    xactWr.WrCnt  = wrCnt;
+    xactWr.pNext  = &xactRd;
+
+    return SMB_Execute (&xactWr);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Execute SMBus Transaction
+ *
+ * This internal routine queues a transaction, or a unit of chained
+ * transactions, via BatteryXactSubmit() and waits in EM1 until it is
+ * complete.
+ *
+ * @return
+ *	Final status of the (last) transaction.
+ *
+ ******************************************************************************/
+static int SMB_Execute (SMB_XACT *pXact)
+{
+SMB_XACT *pLast;			// last transaction of the unit
+int	 status;
+
+
+    status = BatteryXactSubmit (pXact);
+    if (status < 0)
+	return status;			// return error code
+
+    for (pLast = pXact;  pLast->pNext != NULL;  pLast = pLast->pNext)
+	;
 
     /* Wait until data is complete or time out */
-    uint32_t start = RTC->CNT;
-    while (SMB_Status == i2cTransferInProgress)
+    while (pLast->Status == i2cTransferInProgress)
     {
 	/* Enter EM1 while waiting for I2C interrupt */
-	EMU_EnterEM1();
+	INT_Disable();
+	if (pLast->Status == i2cTransferInProgress)
+	    EMU_EnterEM1();	// a pending interrupt wakes up even if disabled
+	INT_Enable();
 
 	/* check for timeout */
-	if (((RTC->CNT - start) & 0x00FFFFFF) > I2C_XFER_TIMEOUT)
-	{
-	    SMB_Reset();
-	    SMB_Status = (I2C_TransferReturn_TypeDef)i2cTransferTimeout;
-	}
+	BatteryMonCheck();
     }
 
     /* Return final status */
-    return SMB_Status;
+    return pLast->Status;
 }
 
 
@@ -2,9 +2,21 @@
  * @file
  * @brief	Header file of module BatteryMon.c
  * @author	Peter Loës
- * @version	2020-01-13
+ * @version	2026-10-18
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added BatteryMonPowerSave().
+2026-10-18,agent	Added BatteryMonIsBusy() and BatteryMonAbort().
+2026-10-18,agent	Added BatterySmbFreqSet().  SMB_WRITE_MAX is now 35 for
+		data flash writes.
+2026-10-18,agent	Added BatteryRegSharedStore().
+2026-10-18,agent	SMB_XACT can write data, and transactions can be
+		chained. Added BatteryRegWriteValue(), BatteryRegWriteBlock(),
+		and BatteryRegWriteRead().
+2026-10-18,agent	Added SMB_XACT and BatteryXactSubmit() for queued
+		transactions.
+2026-10-18,agent	Added BatteryRegReadShared() and
+		BatteryRegSharedStats().
 2020-01-13,rage	Merged with version from Peter Loës, added BC_TYPE, variables
 		g_BatteryCtrlAddr, g_BatteryCtrlType, and g_BatteryCtrlName.
 		Added prototype for BatteryCtrlProbe().
@@ -302,6 +314,50 @@ typedef enum
      */
 #define i2cInvalidParameter		-11
 
+    /*!@brief Error code if the transaction queue is full, additionally to
+     * @ref I2C_TransferReturn_TypeDef
+     */
+#define i2cQueueFull			-12
+
+    /*!@brief Maximum number of data bytes a transaction can write, i.e. the
+     * byte count and 34 bytes of a ManufacturerBlockAccess() block write,
+     * which are the 2-byte address and 32 bytes of data flash.
+     */
+#define SMB_WRITE_MAX			35
+
+    /*!@brief Number of transactions in the SMBus queue. */
+#ifndef SMB_QUEUE_SIZE
+    #define SMB_QUEUE_SIZE		16
+#endif
+
+    /*!@brief Number of registers kept by BatteryRegReadShared(). */
+#ifndef SHARED_CACHE_SIZE
+    #define SHARED_CACHE_SIZE		8
+#endif
+
+    /*!@brief SMBus transaction.
+     *
+     * A transaction is passed to BatteryXactSubmit() and executed in the
+     * background.  The structure and the data buffer must remain valid until
+     * <b>Status</b> is no longer @ref i2cTransferInProgress.
+     *
+     * The command byte is followed by <b>WrCnt</b> bytes from <b>pWrBuf</b>.
+     * If <b>Cnt</b> is 0, this is a write, otherwise <b>Cnt</b> bytes are
+     * read after a repeated start.  Transactions linked via <b>pNext</b> are
+     * executed as one unit, no other transaction is started in between.  If
+     * one of them fails, the following ones get the same error status.
+     */
+typedef struct SMB_XACT
+{
+    SBS_CMD	 Cmd;		//!< Register address (bits [7:0])
+    const uint8_t *pWrBuf;	//!< Data to write after the command, or NULL
+    uint16_t	 WrCnt;		//!< Number of bytes to write
+    uint8_t	*pBuf;		//!< Buffer for the data read
+    uint16_t	 Cnt;		//!< Number of bytes to read, 0 for a write
+    struct SMB_XACT *pNext;	//!< Next transaction of the unit, or NULL
+    volatile int Status;	//!< i2cTransferInProgress, done (0), or error
+} SMB_XACT;
+
 /*================================ Global Data ===============================*/
 
     /* I2C Device Address of the Battery Controller */
@@ -321,10 +377,32 @@ void	 BatteryMonInit (void);
     /* Probe for Controller Type */
 void	 BatteryCtrlProbe (void);
 
+    /* Change SMBus clock rate */
+uint32_t BatterySmbFreqSet (uint32_t freq);
+
+    /* Queued transactions */
+int	 BatteryXactSubmit (SMB_XACT *pXact);
+void	 BatteryMonCheck (void);
+bool	 BatteryMonIsBusy (void);
+void	 BatteryMonAbort (void);
+void	 BatteryMonPowerSave (bool enable);
+
     /* Register read functions */
 int	 BatteryRegReadValue (SBS_CMD cmd, uint32_t *pValue);
 int	 BatteryRegReadBlock (SBS_CMD cmd, uint8_t  *pBuf, size_t bufSize);
 
+    /* Register read shared by all periodic consumers */
+int	 BatteryRegReadShared (SBS_CMD cmd, uint32_t *pValue);
+void	 BatteryRegSharedStats (uint32_t *pReads, uint32_t *pHits);
+void	 BatteryRegSharedStore (SBS_CMD cmd, uint32_t value);
+
+    /* Register write functions */
+int	 BatteryRegWriteValue (SBS_CMD cmd, uint32_t value);
+int	 BatteryRegWriteBlock (SBS_CMD cmd, const uint8_t *pData, size_t cnt);
+int	 BatteryRegWriteRead  (SBS_CMD wrCmd, const uint8_t *pWrData,
+			       size_t wrCnt, SBS_CMD rdCmd,
+			       uint8_t *pBuf, size_t rdCnt);
+
     /* Read local Vdd value */
 uint32_t ReadVdd (void);
 
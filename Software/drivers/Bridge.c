@@ -0,0 +1,531 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Serial to SMBus Bridge
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module allows PC tools to access the battery controller through the
+ * HRD, without a separate USB to SMBus adapter.  Bridge mode is entered via
+ * console command "bridge".  From then on, the received data is interpreted
+ * as binary request frames, see HostFrame.c:
+ * <pre>
+ *   SYNC  LEN  SEQ  OPS[LEN-1]  CRC[2]
+ * </pre>
+ * - <b>SYNC</b> is always @ref HOST_FRAME_SYNC.
+ * - <b>LEN</b> is the number of bytes of SEQ and OPS.
+ * - <b>SEQ</b> is a sequence number chosen by the PC, it is returned with
+ *   the results.
+ * - <b>OPS</b> is a batch of operations:
+ *   - @ref BRIDGE_OP_READ, the register address, and the number of bytes
+ *     to read.
+ *   - @ref BRIDGE_OP_WRITE, the register address, the number of bytes, and
+ *     the bytes to write.  For an SMBus block write, the PC includes the
+ *     byte count in the data.
+ *   - @ref BRIDGE_OP_WRITE_READ, a write as above, followed by the address
+ *     and size of a read.  Both are executed as one unit, i.e. no other
+ *     module can access the controller in between, e.g. to read the result
+ *     of a ManufacturerBlockAccess() command.
+ *   - @ref BRIDGE_OP_EXIT to return to the console.
+ * - <b>CRC</b> is a CRC-16/CCITT over LEN, SEQ, and OPS, the same as for the
+ *   telemetry frames, see Telemetry.c.
+ *
+ * Up to @ref BRIDGE_BATCH_CNT batches may be in flight, i.e. the PC does not
+ * need to wait for the results before sending the next request.  The
+ * operations of all batches are executed back to back on the SMBus, with
+ * up to @ref BRIDGE_XACT_CNT transactions in the queue of BatteryMon.c.
+ *
+ * The results are sent as soon as they are complete in @ref TLM_TYPE_BRIDGE
+ * frames.  The payload starts with SEQ, followed by one entry per operation:
+ * <pre>
+ *   IDX  STATUS  CNT  DATA[CNT]
+ * </pre>
+ * <b>IDX</b> is the index of the operation in the batch, <b>STATUS</b> the
+ * signed status code, 0 if successful.  A write returns no data.  If a
+ * batch is rejected as a whole, there is a single entry with IDX @ref
+ * BRIDGE_IDX_BATCH.  Frames with a CRC error are discarded, the PC has to
+ * repeat them after a timeout.
+ *
+ * Bridge mode ends with @ref BRIDGE_OP_EXIT, or after @ref
+ * BRIDGE_IDLE_TIMEOUT seconds without requests.
+ *
+ * The host side is implemented in tools/smb_bridge.py.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Requests are received by HostFrame.c, the receive
+		interrupt wakes up the main loop for the rest of a request.
+2026-10-18,agent	An Rx overrun discards the incomplete request frame, the
+		number of overruns is reported with the statistics.
+2026-10-18,agent	Added operations WRITE and WRITE_READ.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_i2c.h"
+#include "Bridge.h"
+#include "BatteryMon.h"
+#include "AlarmClock.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+#include "HostFrame.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of a request frame: SYNC, LEN, SEQ, OPS, and CRC. */
+#define REQ_FRAME_MAX		(1 + BRIDGE_OPS_MAX + HOST_FRAME_OVERHEAD)
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Request batch. */
+typedef struct
+{
+    uint8_t	 Seq;			//!< Sequence number of the request
+    uint8_t	 OpLen;			//!< Number of bytes in Ops[]
+    uint8_t	 OpOffs;		//!< Offset of the next operation to issue
+    uint8_t	 OpIssued;		//!< Number of operations issued
+    uint8_t	 OpDone;		//!< Number of results sent
+    uint8_t	 OpCnt;			//!< Number of operations
+    uint8_t	 Ops[BRIDGE_OPS_MAX];	//!< Operations
+} BATCH;
+
+    /*!@brief SMBus transaction of the bridge. */
+typedef struct
+{
+    SMB_XACT	 Xact;			//!< Transaction for BatteryMon.c
+    SMB_XACT	 XactRd;		//!< Read of a WRITE_READ operation
+    SMB_XACT	*pLast;			//!< Transaction with the final status
+    uint8_t	 Idx;			//!< Index of the operation in the batch
+    uint8_t	 Data[BRIDGE_DATA_MAX];	//!< Data buffer
+} BRIDGE_XACT;
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Flag if bridge mode is active. */
+static volatile bool	 l_flgActive;
+
+    /*!@brief Request batches, FIFO between <b>l_BatchHead</b> and <b>Tail</b>. */
+static BATCH		 l_Batch[BRIDGE_BATCH_CNT];
+static int		 l_BatchHead, l_BatchTail, l_BatchCnt;
+
+    /*!@brief Batch of the next operation to issue. */
+static int		 l_BatchIssue;
+
+    /*!@brief Transactions, FIFO between <b>l_XactHead</b> and <b>Tail</b>. */
+static BRIDGE_XACT	 l_Xact[BRIDGE_XACT_CNT];
+static int		 l_XactHead, l_XactTail, l_XactCnt;
+
+    /*!@brief Receiver and buffer for a request frame. */
+static HOST_FRAME_RX	 l_Rx;
+static uint8_t		 l_ReqBuf[REQ_FRAME_MAX];
+
+    /*!@brief Response frame, and the sequence number it is built for. */
+static TLM_FRAME	 l_Resp;
+static uint8_t		 l_RespSeq;
+
+    /*!@brief Seconds without requests. */
+static int		 l_IdleSeconds;
+
+    /*!@brief Statistics, reported when bridge mode ends. */
+static uint32_t		 l_ReqCnt, l_CrcErrCnt, l_BusyCnt, l_XactTotal;
+
+    /*!@brief Receive overruns of the LEUART when bridge mode started. */
+static uint32_t		 l_RxOverrunsStart;
+
+/*=========================== Forward Declarations ===========================*/
+
+static int  OpSize (const uint8_t *pOp, int remain);
+static void ReqProcess (void);
+static void IssueOps (void);
+static void CollectResults (void);
+static void RespEntry (uint8_t seq, uint8_t idx, int status,
+		       const uint8_t *pData, uint8_t cnt);
+static void BridgeStop (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start Bridge Mode
+ *
+ * From now on, the received data is interpreted as bridge requests.  The
+ * LEUART wakes up the main loop on the sync byte of a request, and on each
+ * further byte until the request is complete, see HostFrameReceive().
+ *
+ ******************************************************************************/
+void	BridgeStart (void)
+{
+    l_BatchHead = l_BatchTail = l_BatchCnt = l_BatchIssue = 0;
+    l_XactHead = l_XactTail = l_XactCnt = 0;
+    l_IdleSeconds = 0;
+    l_ReqCnt = l_CrcErrCnt = l_BusyCnt = l_XactTotal = 0;
+    l_RxOverrunsStart = drvLEUART_RxOverruns();
+    l_Resp.Len = 0;
+
+    HostFrameStart (&l_Rx, l_ReqBuf, 1, 1 + BRIDGE_OPS_MAX);
+
+    l_flgActive = true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if Bridge Mode is active
+ *
+ ******************************************************************************/
+bool	BridgeIsActive (void)
+{
+    return l_flgActive;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Bridge Check
+ *
+ * This function must be called from the main loop while bridge mode is
+ * active.  It receives requests, keeps the SMBus queue filled, and sends
+ * the results.
+ *
+ ******************************************************************************/
+void	BridgeCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+int	 status;
+
+
+    if (! l_flgActive)
+	return;
+
+    while ((status = HostFrameReceive (&l_Rx)) != HOST_FRAME_NONE)
+    {
+	l_IdleSeconds = 0;
+
+	if (status == HOST_FRAME_OK)
+	    ReqProcess();
+	else
+	    l_CrcErrCnt++;		// the PC repeats it after a timeout
+    }
+
+    CollectResults();
+    IssueOps();
+
+    /* Check for idle timeout */
+    if (prevSeconds != g_CurrDateTime.tm_sec)
+    {
+	prevSeconds = g_CurrDateTime.tm_sec;
+
+	if (l_BatchCnt == 0  &&  ++l_IdleSeconds > BRIDGE_IDLE_TIMEOUT)
+	{
+	    BridgeStop();
+	    return;
+	}
+    }
+
+    /*
+     * The LEUART wakes us for the next request, or the rest of it.  While
+     * transactions are pending, the SMBus interrupt wakes us up when they
+     * complete.
+     */
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Size of an Operation
+ *
+ * Checks the operation at @p pOp and returns its size in bytes.
+ *
+ * @param[in] pOp
+ *	Address of the operation code.
+ *
+ * @param[in] remain
+ *	Number of bytes left in the request.
+ *
+ * @return
+ *	Size of the operation, or 0 if it is invalid or truncated.
+ *
+ ******************************************************************************/
+static int  OpSize (const uint8_t *pOp, int remain)
+{
+int	 wrCnt;
+
+
+    switch (pOp[0])
+    {
+	case BRIDGE_OP_READ:		// READ addr cnt
+	    if (remain < 3  ||  pOp[2] < 1  ||  pOp[2] > BRIDGE_DATA_MAX)
+		return 0;
+	    return 3;
+
+	case BRIDGE_OP_WRITE:		// WRITE addr cnt data[cnt]
+	    if (remain < 3  ||  pOp[2] < 1  ||  pOp[2] > SMB_WRITE_MAX
+	    ||  remain < 3 + pOp[2])
+		return 0;
+	    return 3 + pOp[2];
+
+	case BRIDGE_OP_WRITE_READ:	// WRITE_READ addr cnt data[cnt] addr cnt
+	    if (remain < 3  ||  pOp[2] > SMB_WRITE_MAX)
+		return 0;
+	    wrCnt = pOp[2];
+	    if (remain < 3 + wrCnt + 2  ||  pOp[3 + wrCnt + 1] < 1
+	    ||  pOp[3 + wrCnt + 1] > BRIDGE_DATA_MAX)
+		return 0;
+	    return 3 + wrCnt + 2;
+
+	case BRIDGE_OP_EXIT:		// EXIT
+	    return 1;
+
+	default:
+	    return 0;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Process Request Frame
+ *
+ * Checks the operations of a complete request frame, and stores it as new
+ * batch.  The CRC has already been checked by HostFrameReceive().
+ *
+ ******************************************************************************/
+static void ReqProcess (void)
+{
+BATCH	*pBatch;
+int	 len = l_ReqBuf[1];	// length of SEQ and OPS
+int	 offs, size, opCnt = 0;
+
+
+    l_ReqCnt++;
+
+    /* Check operations */
+    for (offs = 3;  offs < 2 + len;  opCnt++)
+    {
+	size = OpSize (l_ReqBuf + offs, 2 + len - offs);
+	if (size <= 0)
+	    break;
+	offs += size;
+    }
+
+    if (offs != 2 + len  ||  opCnt == 0)
+    {
+	RespEntry (l_ReqBuf[2], BRIDGE_IDX_BATCH, BRIDGE_ERR_OP, NULL, 0);
+	TlmFrameSend (&l_Resp);
+	return;
+    }
+
+    if (l_BatchCnt >= BRIDGE_BATCH_CNT)
+    {
+	l_BusyCnt++;
+	RespEntry (l_ReqBuf[2], BRIDGE_IDX_BATCH, BRIDGE_ERR_BUSY, NULL, 0);
+	TlmFrameSend (&l_Resp);
+	return;
+    }
+
+    /* Store new batch */
+    pBatch = &l_Batch[l_BatchHead];
+    pBatch->Seq      = l_ReqBuf[2];
+    pBatch->OpLen    = len - 1;
+    pBatch->OpOffs   = 0;
+    pBatch->OpIssued = 0;
+    pBatch->OpDone   = 0;
+    pBatch->OpCnt    = opCnt;
+    memcpy (pBatch->Ops, l_ReqBuf + 3, len - 1);
+
+    l_BatchHead = (l_BatchHead + 1) % BRIDGE_BATCH_CNT;
+    l_BatchCnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Issue Operations
+ *
+ * Submits operations of the pending batches to the SMBus queue, as long as
+ * there are free transactions.
+ *
+ ******************************************************************************/
+static void IssueOps (void)
+{
+BATCH	*pBatch;
+BRIDGE_XACT *pBX;
+uint8_t	*pOp;
+int	 status;
+
+
+    while (l_BatchCnt > 0)
+    {
+	pBatch = &l_Batch[l_BatchIssue];
+
+	if (pBatch->OpOffs >= pBatch->OpLen)
+	{
+	    /* All operations of this batch issued, continue with next one */
+	    if (l_BatchIssue == (l_BatchHead + BRIDGE_BATCH_CNT - 1)
+				% BRIDGE_BATCH_CNT)
+		return;		// this is the newest batch
+	    l_BatchIssue = (l_BatchIssue + 1) % BRIDGE_BATCH_CNT;
+	    continue;
+	}
+
+	pOp = pBatch->Ops + pBatch->OpOffs;
+
+	if (*pOp == BRIDGE_OP_EXIT)
+	{
+	    /* Wait until all previous operations are complete */
+	    if (l_XactCnt > 0  ||  pBatch->OpDone != pBatch->OpIssued)
+		return;
+
+	    RespEntry (pBatch->Seq, pBatch->OpIssued, 0, NULL, 0);
+	    TlmFrameSend (&l_Resp);
+	    BridgeStop();
+	    return;
+	}
+
+	if (l_XactCnt >= BRIDGE_XACT_CNT)
+	    return;		// no free transaction
+
+	pBX = &l_Xact[l_XactHead];
+	memset (&pBX->Xact, 0, sizeof(pBX->Xact));
+	pBX->Idx = pBatch->OpIssued;
+	pBX->Xact.Cmd = (SBS_CMD) pOp[1];
+	pBX->pLast = &pBX->Xact;
+
+	if (*pOp == BRIDGE_OP_READ)
+	{
+	    /* READ addr cnt */
+	    pBX->Xact.pBuf = pBX->Data;
+	    pBX->Xact.Cnt  = pOp[2];
+	}
+	else
+	{
+	    /* WRITE addr cnt data[cnt], the data remain in the batch */
+	    pBX->Xact.pWrBuf = pOp + 3;
+	    pBX->Xact.WrCnt  = pOp[2];
+
+	    if (*pOp == BRIDGE_OP_WRITE_READ)
+	    {
+		/* ... addr cnt: chained read */
+		memset (&pBX->XactRd, 0, sizeof(pBX->XactRd));
+		pBX->XactRd.Cmd  = (SBS_CMD) pOp[3 + pOp[2]];
+		pBX->XactRd.pBuf = pBX->Data;
+		pBX->XactRd.Cnt  = pOp[3 + pOp[2] + 1];
+		pBX->Xact.pNext  = &pBX->XactRd;
+		pBX->pLast = &pBX->XactRd;
+	    }
+	}
+
+	status = BatteryXactSubmit (&pBX->Xact);
+	if (status == i2cQueueFull)
+	    return;		// SMBus queue is full, try again later
+
+	if (status < 0)
+	    pBX->pLast->Status = status;	// report error as result
+
+	l_XactHead = (l_XactHead + 1) % BRIDGE_XACT_CNT;
+	l_XactCnt++;
+	l_XactTotal++;
+
+	pBatch->OpOffs += OpSize (pOp, pBatch->OpLen - pBatch->OpOffs);
+	pBatch->OpIssued++;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Collect Results
+ *
+ * Adds the results of completed transactions to the response frame, in the
+ * order of the requests.  When all operations of a batch are done, the
+ * response is sent and the batch is released.
+ *
+ ******************************************************************************/
+static void CollectResults (void)
+{
+BRIDGE_XACT *pBX;
+BATCH	*pBatch;
+
+
+    BatteryMonCheck();		// handle SMBus timeouts
+
+    while (l_XactCnt > 0)
+    {
+	pBX = &l_Xact[l_XactTail];
+	if (pBX->pLast->Status == i2cTransferInProgress)
+	    break;		// not complete yet
+
+	pBatch = &l_Batch[l_BatchTail];
+	EFM_ASSERT(pBX->Idx == pBatch->OpDone);
+
+	RespEntry (pBatch->Seq, pBX->Idx, pBX->pLast->Status, pBX->Data,
+		   pBX->pLast->Status == i2cTransferDone ? pBX->pLast->Cnt : 0);
+
+	l_XactTail = (l_XactTail + 1) % BRIDGE_XACT_CNT;
+	l_XactCnt--;
+
+	/* Release batch, unless it ends with EXIT, see IssueOps() */
+	if (++pBatch->OpDone == pBatch->OpCnt)
+	{
+	    TlmFrameSend (&l_Resp);
+
+	    l_BatchTail = (l_BatchTail + 1) % BRIDGE_BATCH_CNT;
+	    l_BatchCnt--;
+	}
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add Response Entry
+ *
+ * Appends a result to the response frame.  If the frame belongs to another
+ * batch, or there is no more room, it is sent first.
+ *
+ ******************************************************************************/
+static void RespEntry (uint8_t seq, uint8_t idx, int status,
+		       const uint8_t *pData, uint8_t cnt)
+{
+uint8_t	 hdr[3];		// IDX, STATUS, CNT
+
+
+    if (l_Resp.Len > 0
+    &&  (l_RespSeq != seq  ||  l_Resp.Len + 3 + cnt > TLM_PAYLOAD_MAX))
+	TlmFrameSend (&l_Resp);
+
+    if (l_Resp.Len == 0)
+    {
+	TlmFrameBegin (&l_Resp, TLM_TYPE_BRIDGE);
+	TlmAddRaw (&l_Resp, &seq, 1);
+	l_RespSeq = seq;
+    }
+
+    hdr[0] = idx;
+    hdr[1] = (uint8_t)(int8_t) status;
+    hdr[2] = cnt;
+    TlmAddRaw (&l_Resp, hdr, 3);
+    TlmAddRaw (&l_Resp, pData, cnt);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop Bridge Mode
+ *
+ * Returns to the command console and reports the statistics.
+ *
+ ******************************************************************************/
+static void BridgeStop (void)
+{
+    l_flgActive = false;
+
+    HostFrameStop (&l_Rx);
+
+    ConsolePrintf ("Bridge mode ended: %lu requests, %lu transactions, "
+		   "%lu CRC errors, %lu busy, %lu Rx overruns\n", l_ReqCnt,
+		   l_XactTotal, l_CrcErrCnt, l_BusyCnt,
+		   drvLEUART_RxOverruns() - l_RxOverrunsStart);
+}
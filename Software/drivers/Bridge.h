@@ -0,0 +1,70 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Bridge.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Removed BRIDGE_SYNC, see HOST_FRAME_SYNC.
+2026-10-18,agent	Added operations WRITE and WRITE_READ.
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Bridge_h
+#define __INC_Bridge_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Maximum number of bytes of the operations in a request. */
+#define BRIDGE_OPS_MAX		254
+
+    /*!@brief Number of request batches which can be in flight. */
+#ifndef BRIDGE_BATCH_CNT
+    #define BRIDGE_BATCH_CNT	4
+#endif
+
+    /*!@brief Number of transactions queued on the SMBus at the same time. */
+#ifndef BRIDGE_XACT_CNT
+    #define BRIDGE_XACT_CNT	8
+#endif
+
+    /*!@brief Maximum number of data bytes of one transaction. */
+#define BRIDGE_DATA_MAX		40
+
+    /*!@brief Bridge mode ends after this time in [s] without requests. */
+#ifndef BRIDGE_IDLE_TIMEOUT
+    #define BRIDGE_IDLE_TIMEOUT	60
+#endif
+
+    /*!@name Operation codes of a request */
+//@{
+#define BRIDGE_OP_READ		0x01	//!< READ addr cnt
+#define BRIDGE_OP_WRITE		0x02	//!< WRITE addr cnt data[cnt]
+#define BRIDGE_OP_WRITE_READ	0x03	//!< WRITE_READ addr cnt data[cnt] addr cnt
+#define BRIDGE_OP_EXIT		0xFF	//!< EXIT: return to the console
+//@}
+
+    /*!@name Status codes of a response, additionally to the I2C codes */
+//@{
+#define BRIDGE_ERR_BUSY		-20	//!< no free batch, repeat request
+#define BRIDGE_ERR_OP		-21	//!< invalid operation in request
+//@}
+
+    /*!@brief Index of a response entry which refers to the whole batch. */
+#define BRIDGE_IDX_BATCH	0xFF
+
+/*================================ Prototypes ================================*/
+
+void	BridgeStart (void);
+bool	BridgeIsActive (void);
+void	BridgeCheck (void);
+
+
+#endif /* __INC_Bridge_h */
@@ -0,0 +1,1943 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Serial Command Console
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module implements a simple command console on the LEUART.  Received
+ * characters are collected into a line buffer.  When a line is complete, it
+ * is split into arguments and the matching entry of the command table
+ * @ref l_CmdTable is executed.
+ *
+ * ConsoleCheck() must be called from the main loop.  It is woken up by the
+ * signal frame interrupt of the LEUART, so the MCU remains in EM2 until a
+ * command arrives.  Commands never block the display loop: a snapshot dump
+ * or a trace reads only one register per call, and sets @ref g_flgIRQ to get
+ * called again.  The pack authentication is woken up by a timer when the
+ * digest is due.
+ *
+ * Available commands:
+ * - <b>help</b> lists all commands.
+ * - <b>reg</b> reads a register of the battery controller.
+ * - <b>wr</b> writes a register of the battery controller.
+ * - <b>dump</b> prints a snapshot of all items of the display item list.
+ * - <b>mac</b> reads the MAC status blocks of a TI controller.
+ * - <b>cnt</b> shows the driver counters.
+ * - <b>rate</b> shows or sets the poll interval of the display.
+ * - <b>mode</b> selects text or binary telemetry output, see Telemetry.c.
+ * - <b>trace</b> reads a register repeatedly.
+ * - <b>stream</b> sends all items periodically as delta frames.
+ * - <b>watch</b> subscribes registers with individual periods.
+ * - <b>unwatch</b> removes registers from the watch list.
+ * - <b>bridge</b> enters the serial to SMBus bridge mode, see Bridge.c.
+ * - <b>dfbackup</b> sends the data flash of a TI controller, see DataFlash.c.
+ * - <b>dfrestore</b> writes the data flash of a TI controller.
+ * - <b>export</b> sends data encrypted and signed, see Export.c, or
+ *   measures the AES throughput.
+ * - <b>auth</b> checks if the battery pack is genuine, see PackAuth.c.
+ * - <b>log</b> shows, lists, queries, or erases the session log, see Log.c.
+ * - <b>download</b> sends the flash image of the session log block by
+ *   block, see Download.c.
+ * - <b>supply</b> shows the supply voltage, or sets the warning threshold,
+ *   see Supply.c.
+ * - <b>monitor</b> starts or stops the unattended monitor mode, and shows
+ *   the residency in the energy modes and the projected lifetime of the
+ *   CR2032, see Monitor.c.  Starting it stops the delta stream and clears
+ *   the watch list, because they would wake the SMBus every few seconds.
+ * - <b>prof</b> shows the time and charge of each energy mode since
+ *   power-on, the EM0 time of each task of the main loop, and the EM1 time
+ *   of each module, see Profile.c.  "prof lcd" shows the charge on the
+ *   hidden LCD item.
+ *
+ * A snapshot of all items is written to the session log when a battery
+ * controller has been detected, and then every @ref LOG_SNAPSHOT_INTERVAL
+ * seconds.  It is collected like a binary snapshot dump, one item per call.
+ *
+ * In binary mode, <b>dump</b> and <b>trace</b> send their data as telemetry
+ * frames instead of text lines.
+ *
+ * <b>log query</b> sends the records of the last minutes, optionally only
+ * those of one pack.  The start is found by LogSeek(), then one record per
+ * call is sent as long as the LEUART has room for it.  In binary mode, each
+ * record is sent in @ref TLM_TYPE_LOG frames with the payload
+ * <pre>
+ *   OFFS  RECORD...
+ * </pre>
+ * <b>RECORD</b> is the part of the record from byte offset <b>OFFS</b> on,
+ * i.e. the @ref LOG_REC_HDR and the data, as stored in the flash.  A record
+ * longer than one frame is split, the next frame continues at the next
+ * offset.  The end of the query is a frame with OFFS 0xFF and the number of
+ * records sent (32 bit).
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	"prof" skips the example module EM1_MOD_XXX.
+2026-10-18,agent	"log list" shows one record per call, see ListStep().
+2026-10-18,agent	"help" lists one command per call, see HelpStep().
+2026-10-18,agent	"auth" waits for the digest in the background, see
+		AuthStep().
+2026-10-18,agent	An Rx overrun discards the incomplete command line,
+		"cnt" shows the number of overruns.
+2026-10-18,agent	Added command "prof", see module Profile.c.  The
+		snapshot dump skips hidden items, "log list" shows
+		LOG_TYPE_PROFILE records.
+2026-10-18,agent	Added command "monitor", see module Monitor.c.  The
+		stream and snapshot intervals count the elapsed seconds, the RTC
+		interrupt may occur less often than every second, see
+		ClockTickSet().
+2026-10-18,agent	Added command "supply", see module Supply.c.
+2026-10-18,agent	Added command "download", see module Download.c.
+2026-10-18,agent	Added "log query" to send the records of a time range,
+		"hist" shows the pack key.
+2026-10-18,agent	Added command "hist", see module History.c.
+2026-10-18,agent	Added command "series", see module Series.c.
+2026-10-18,agent	Commands "log" and "cnt" show the timing of the log
+		writer and the sampling latency.
+2026-10-18,agent	Added command "log" and periodic snapshots into the
+		session log, see module Log.c.
+2026-10-18,agent	Added command "auth", see module PackAuth.c.
+2026-10-18,agent	Added command "export", see module Export.c.
+2026-10-18,agent	Added commands "dfbackup" and "dfrestore", see module
+		DataFlash.c.
+2026-10-18,agent	Added command "mac", see module BatteryMac.c.  On a TI
+		controller, "dump" reads the MAC status blocks first, so the
+		cell voltages are taken from one block read.
+2026-10-18,agent	Added command "wr" to write a register, e.g. AtRate().
+2026-10-18,agent	Added command "bridge", see module Bridge.c.
+2026-10-18,agent	Added commands "watch" and "unwatch", see module
+		Watch.c.
+2026-10-18,agent	Added command "stream" for delta streaming of all items,
+		"cnt" shows the compression ratio.
+2026-10-18,agent	Added commands "mode" and "trace", binary snapshot dump.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "Console.h"
+#include "LEUART.h"
+#include "ExtInt.h"
+#include "Keys.h"
+#include "BatteryMon.h"
+#include "Telemetry.h"
+#include "AlarmClock.h"
+#include "Watch.h"
+#include "Bridge.h"
+#include "BatteryMac.h"
+#include "DataFlash.h"
+#include "Export.h"
+#include "PackAuth.h"
+#include "Log.h"
+#include "Series.h"
+#include "History.h"
+#include "Download.h"
+#include "Supply.h"
+#include "Monitor.h"
+#include "Profile.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Default size in bytes for the <b>reg</b> command. */
+#define REG_DEFAULT_SIZE	2
+
+    /*!@brief Maximum size in bytes for the <b>reg</b> command. */
+#define REG_MAX_SIZE		34
+
+    /*!@brief Default number of records listed by <b>log list</b>. */
+#define LOG_LIST_CNT		10
+
+    /*!@brief Maximum number of records <b>log query</b> skips per call. */
+#define QUERY_SKIP_MAX		8
+
+    /*!@brief Free space of the LEUART required to send a record, i.e. two
+     * frames, or a text line.
+     */
+#define QUERY_TX_SIZE		(2 * (TLM_HDR_SIZE + TLM_PAYLOAD_MAX + TLM_CRC_SIZE))
+
+    /*!@brief Free space of the LEUART FIFO needed for one line of the help
+     * text, see HelpStep().
+     */
+#define HELP_TX_SIZE		80
+
+    /*!@brief Marker of the end frame of <b>log query</b>. */
+#define QUERY_END		0xFF
+
+    /*!@brief Maximum number of previous sessions listed by <b>hist</b>. */
+#define HIST_LIST_CNT		5
+
+    /*!@brief Convert RTC ticks to [us], up to 8s without overflow. */
+#define TICKS_TO_US(ticks)	((ticks) * (1000000UL / 64)		\
+				 / (RTC_COUNTS_PER_SEC / 64))
+
+    /*!@name SMBus clock range in [kHz] for data flash transfers. */
+//@{
+#define DF_KHZ_MIN		10
+#define DF_KHZ_MAX		100
+//@}
+
+/*=========================== Forward Declarations ===========================*/
+
+static void CmdHelp (int argc, char *argv[]);
+static void CmdReg  (int argc, char *argv[]);
+static void CmdWr   (int argc, char *argv[]);
+static void CmdDump (int argc, char *argv[]);
+static void CmdMac  (int argc, char *argv[]);
+static void CmdCnt  (int argc, char *argv[]);
+static void CmdRate (int argc, char *argv[]);
+static void CmdMode (int argc, char *argv[]);
+static void CmdTrace (int argc, char *argv[]);
+static void CmdStream (int argc, char *argv[]);
+static void CmdWatch (int argc, char *argv[]);
+static void CmdUnwatch (int argc, char *argv[]);
+static void CmdBridge (int argc, char *argv[]);
+static void CmdDFlash (int argc, char *argv[]);
+static void CmdExport (int argc, char *argv[]);
+static void CmdAuth (int argc, char *argv[]);
+static void CmdLog  (int argc, char *argv[]);
+static void CmdSeries (int argc, char *argv[]);
+static void CmdHist (int argc, char *argv[]);
+static void CmdDownload (int argc, char *argv[]);
+static void CmdSupply (int argc, char *argv[]);
+static void CmdMonitor (int argc, char *argv[]);
+static void CmdProf (int argc, char *argv[]);
+static void ConsoleExecute (char *pLine);
+static void QueryStep (void);
+static void ListStep (void);
+static void AuthStep (void);
+static void HelpStep (void);
+static void LogRecordPrint (const LOG_REC_HDR *pHdr, const uint8_t *pData,
+			    int cnt);
+static int  RegSize (int addr);
+static void JobStop (void);
+static void DumpStep (void);
+static void LogSnapshot (void);
+static void TraceStep (void);
+static void MacField (const MAC_FIELD *pField, int idx, uint32_t value);
+static void PrintHex (const char *pLabel, const uint8_t *pData, int cnt);
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Command table. */
+static const CON_CMD l_CmdTable[] =
+{   //	pName,	pArgs,		pHelp,				Fct
+    {	"help",	"",		"list all commands",		CmdHelp	},
+    {	"reg",	"<addr> [size]","read battery register (hex)",	CmdReg	},
+    {	"wr",	"<addr> <value>","write battery register (hex)",CmdWr	},
+    {	"dump",	"",		"dump snapshot of all items",	CmdDump	},
+    {	"mac",	"",		"read MAC status blocks (TI)",	CmdMac	},
+    {	"cnt",	"",		"show counters",		CmdCnt	},
+    {	"rate",	"[seconds]",	"show/set poll interval, 0=off",CmdRate	},
+    {	"mode",	"[text|bin]",	"show/set output mode",		CmdMode	},
+    {	"trace","<addr> [count]","read register repeatedly",	CmdTrace},
+    {	"stream","[seconds]",	"delta stream all items, 0=off",CmdStream},
+    {	"watch","[addr[:sec]]..","subscribe registers (hex)",	CmdWatch},
+    {	"unwatch","<addr>|all",	"unsubscribe registers",	CmdUnwatch},
+    {	"bridge","",		"enter SMBus bridge mode",	CmdBridge},
+    {	"dfbackup","[kHz]",	"send data flash image (TI)",	CmdDFlash},
+    {	"dfrestore","[kHz]",	"write data flash image (TI)",	CmdDFlash},
+    {	"export","df|log|bench [sw]","encrypted export, AES benchmark",CmdExport},
+    {	"auth",	"[test|<hex>]",	"authenticate battery pack (TI)",CmdAuth},
+    {	"log",	"[list|query|snap|erase|<sec>]","session log in flash",CmdLog},
+    {	"series","[seconds]",	"compressed V/I/T log, 0=off",	CmdSeries},
+    {	"hist",	"[rebuild]",	"sessions of the connected pack",CmdHist},
+    {	"download","[first [count]]","send log image block by block",CmdDownload},
+    {	"supply","[mV]",	"supply voltage, warning level",CmdSupply},
+    {	"monitor","[seconds|off]","unattended monitor mode",	CmdMonitor},
+    {	"prof",	"[lcd]",	"energy mode profile",		CmdProf},
+};
+
+    /*!@brief Pointer to the display item list. */
+static const ITEM	*l_pItemList;
+
+    /*!@brief Number of elements in item list. */
+static int		 l_ItemCnt;
+
+    /*!@brief Line buffer and number of characters in it. */
+static char		 l_Line[CON_LINE_SIZE];
+static int		 l_LineLen;
+
+    /*!@brief Index of the next item to dump, or -1 if no dump is active. */
+static int		 l_DumpIdx = -1;
+
+    /*!@brief Index of the next command to list, or -1 if no help is active. */
+static int		 l_HelpIdx = -1;
+
+    /*!@brief Register to trace, and number of reads left. */
+static SBS_CMD		 l_TraceCmd;
+static int		 l_TraceCnt;
+
+    /*!@brief Interval in [s] for delta streaming, 0 if disabled. */
+static int		 l_StreamInterval;
+
+    /*!@brief Interval in [s] for snapshots into the session log, 0 if
+     * disabled.
+     */
+static int		 l_LogInterval = LOG_SNAPSHOT_INTERVAL;
+
+    /*!@brief Flag if the running snapshot dump goes to the session log. */
+static bool		 l_flgDumpLog;
+
+    /*!@brief Flag if the connected battery has been logged. */
+static bool		 l_flgLogged;
+
+    /*!@brief Telemetry frame for snapshot dump and trace in binary mode. */
+static TLM_FRAME	 l_Frame;
+
+    /*!@brief Flag if <b>log list</b> is running, its cursor, and the
+     * sequence number of the first record to show, see ListStep().
+     */
+static bool		 l_flgList;
+static LOG_CURSOR	 l_ListCursor;
+static uint32_t		 l_ListFrom;
+
+    /*!@brief Flag if a log query is running, its cursor, start time, and
+     * pack key, see QueryStep().
+     */
+static bool		 l_flgQuery;
+static LOG_CURSOR	 l_QueryCursor;
+static uint32_t		 l_QueryFrom;
+static uint32_t		 l_QueryKey;
+static bool		 l_flgQueryAll;
+
+    /*!@brief Number of records read and sent by the log query. */
+static uint32_t		 l_QueryRead;
+static uint32_t		 l_QuerySent;
+
+    /*!@brief Record buffer of the log query, header and data. */
+static uint8_t		 l_QueryRec[LOG_REC_HDR_SIZE + LOG_DATA_MAX];
+
+    /*!@brief Result of the running pack authentication, see AuthStep(). */
+static AUTH_RESULT	 l_AuthResult;
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Console
+ *
+ * This routine must be called once to initialize the console.
+ *
+ * @param[in] pItemList
+ *	Address of the display item list, used for the snapshot dump.
+ *
+ * @param[in] itemCnt
+ *	Number of elements in the item list.
+ *
+ ******************************************************************************/
+void	ConsoleInit (const ITEM *pItemList, int itemCnt)
+{
+    /* Parameter check */
+    EFM_ASSERT(pItemList != NULL);
+
+    /* Save configuration */
+    l_pItemList = pItemList;
+    l_ItemCnt   = itemCnt;
+
+    l_LineLen = 0;
+    l_DumpIdx = -1;
+    l_TraceCnt = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Console Check
+ *
+ * This function must be called from the main loop.  It reads the received
+ * characters, executes complete command lines, and continues a running
+ * snapshot dump.
+ *
+ ******************************************************************************/
+void	ConsoleCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+static int streamSeconds;	// seconds since the last streaming sweep
+static int logSeconds;		// seconds since the last log snapshot
+static uint32_t rxOverruns;	// to detect a new receive overrun
+char	 buf[16];		// chunk of received characters
+int	 cnt, i;
+int	 elapsed;		// seconds since the last check
+
+
+    /* In bridge mode, the received data are requests, see Bridge.c */
+    if (BridgeIsActive())
+    {
+	BridgeCheck();
+	return;
+    }
+
+    /* The same for a data flash transfer, see DataFlash.c */
+    if (DFlashIsActive())
+    {
+	DFlashCheck();
+	return;
+    }
+
+    /* During an export, any received character aborts it, see Export.c */
+    if (ExportIsActive())
+    {
+	ExportCheck();
+	return;
+    }
+
+    /* During a log download, the received data are acknowledgements */
+    if (DownloadIsActive())
+    {
+	DownloadCheck();
+	return;
+    }
+
+    /* Collect received characters into the line buffer */
+    while ((cnt = drvLEUART_RxRead (buf, sizeof(buf))) > 0)
+    {
+	if (rxOverruns != drvLEUART_RxOverruns())
+	{
+	    rxOverruns = drvLEUART_RxOverruns();
+	    l_LineLen = 0;		// input lost, discard the line
+	    ConsolePrintf ("*** Rx overrun, input discarded\n");
+	}
+
+	for (i = 0;  i < cnt;  i++)
+	{
+	    if (buf[i] == '\r'  ||  buf[i] == '\n')
+	    {
+		l_Line[l_LineLen] = EOS;
+		if (l_LineLen > 0)
+		    ConsoleExecute (l_Line);
+		l_LineLen = 0;
+	    }
+	    else if (l_LineLen < (int)sizeof(l_Line) - 1)
+	    {
+		l_Line[l_LineLen++] = buf[i];
+	    }
+	    /* else: line too long, discard characters until the terminator */
+	}
+    }
+
+    /* Start the next streaming sweep, if the interval is over */
+    if (prevSeconds != g_CurrDateTime.tm_sec)
+    {
+	elapsed = (g_CurrDateTime.tm_sec - prevSeconds + 60) % 60;
+	prevSeconds = g_CurrDateTime.tm_sec;
+	streamSeconds += elapsed;
+	logSeconds += elapsed;
+
+	if (l_StreamInterval > 0  &&  streamSeconds >= l_StreamInterval
+	&&  l_DumpIdx == -1  &&  l_TraceCnt == 0
+	&&  TlmModeGet() == TLM_MODE_BINARY)
+	{
+	    streamSeconds = 0;
+	    TlmStreamBegin (&l_Frame);
+	    l_DumpIdx = 0;
+	}
+
+	/* Log a snapshot when a battery is connected, then periodically */
+	if (g_BatteryCtrlType == BCT_UNKNOWN)
+	{
+	    l_flgLogged = false;	// log the next battery right away
+	}
+	else if (l_LogInterval > 0
+	     &&  (logSeconds >= l_LogInterval  ||  ! l_flgLogged)
+	     &&  l_DumpIdx == -1  &&  l_TraceCnt == 0)
+	{
+	    logSeconds = 0;
+	    l_flgLogged = true;
+	    LogSnapshot();
+	}
+    }
+
+    /* Continue a running snapshot dump, streaming sweep, trace, or query */
+    if (l_DumpIdx != -1)
+	DumpStep();
+    else if (l_TraceCnt > 0)
+	TraceStep();
+    else if (l_flgQuery)
+	QueryStep();
+    else if (l_flgList)
+	ListStep();
+    else if (l_HelpIdx != -1)
+	HelpStep();
+
+    /* The authentication is woken up by its timer, see PackAuth.c */
+    if (PackAuthIsActive())
+	AuthStep();
+
+    if (l_DumpIdx != -1  ||  l_TraceCnt > 0  ||  l_flgQuery  ||  l_flgList
+    ||  l_HelpIdx != -1)
+	g_flgIRQ = true;	// do not enter EM2, call us again
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Execute Command Line
+ *
+ * Splits the line into arguments, separated by blanks, and calls the
+ * function of the matching command.
+ *
+ ******************************************************************************/
+static void ConsoleExecute (char *pLine)
+{
+char	*argv[CON_MAX_ARGS];
+int	 argc = 0;
+unsigned int i;
+
+
+    /* Split line into arguments */
+    while (argc < CON_MAX_ARGS)
+    {
+	while (*pLine == ' '  ||  *pLine == '\t')
+	    *pLine++ = EOS;
+
+	if (*pLine == EOS)
+	    break;
+
+	argv[argc++] = pLine;
+
+	while (*pLine != EOS  &&  *pLine != ' '  &&  *pLine != '\t')
+	    pLine++;
+    }
+
+    if (argc == 0)
+	return;
+
+    for (i = 0;  i < ELEM_CNT(l_CmdTable);  i++)
+    {
+	if (strcmp (argv[0], l_CmdTable[i].pName) == 0)
+	{
+	    l_CmdTable[i].Fct (argc, argv);
+	    return;
+	}
+    }
+
+    ConsolePrintf ("Unknown command \"%s\", try \"help\"\n", argv[0]);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "help"
+ *
+ * The whole help text does not fit into the transmit FIFO of the LEUART, so
+ * HelpStep() lists one command per call of ConsoleCheck().
+ *
+ ******************************************************************************/
+static void CmdHelp (int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    JobStop();
+    l_HelpIdx = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Help Step
+ *
+ * Lists the next command of the help text, as soon as the LEUART has room
+ * for the line.
+ *
+ ******************************************************************************/
+static void HelpStep (void)
+{
+    if (drvLEUART_TxFree() < HELP_TX_SIZE)
+	return;				// wait until the LEUART has sent more
+
+    ConsolePrintf ("%-5s %-14s %s\n", l_CmdTable[l_HelpIdx].pName,
+		   l_CmdTable[l_HelpIdx].pArgs, l_CmdTable[l_HelpIdx].pHelp);
+
+    if (++l_HelpIdx >= (int) ELEM_CNT(l_CmdTable))
+	l_HelpIdx = -1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "reg"
+ *
+ * Reads a register of the battery controller.  The address is specified in
+ * hex.  If no size is given, it is taken from the item list, or defaults to
+ * a word.  Values of up to 4 bytes are shown in hex and decimal, blocks as
+ * hexdump.
+ *
+ ******************************************************************************/
+static void CmdReg (int argc, char *argv[])
+{
+uint8_t	 dataBuf[REG_MAX_SIZE];
+uint32_t value;
+SBS_CMD	 cmd;
+int	 addr, size, status, i;
+
+
+    if (argc < 2)
+    {
+	ConsolePrintf ("usage: reg <addr> [size]\n");
+	return;
+    }
+
+    addr = (int) strtoul (argv[1], NULL, 16);
+    size = (argc > 2 ? atoi(argv[2]) : 0);
+
+    if (addr < 0  ||  addr > 0xFF  ||  size < 0  ||  size > REG_MAX_SIZE)
+    {
+	ConsolePrintf ("reg: invalid address or size\n");
+	return;
+    }
+
+    /* If no size is specified, look for the register in the item list */
+    if (size == 0)
+	size = RegSize (addr);
+
+    cmd = (SBS_CMD)((size << 8) | addr);
+
+    if (size > 4)
+    {
+	status = BatteryRegReadBlock (cmd, dataBuf, size);
+	if (status == 0)
+	{
+	    ConsolePrintf ("REG 0x%02X:", addr);
+	    for (i = 0;  i < size;  i++)
+		ConsolePrintf (" %02X", dataBuf[i]);
+	    ConsolePrintf ("\n");
+	}
+    }
+    else
+    {
+	status = BatteryRegReadValue (cmd, &value);
+	if (status == 0)
+	    ConsolePrintf ("REG 0x%02X: 0x%lX (%lu)\n", addr, value, value);
+    }
+
+    if (status != 0)
+	ConsolePrintf ("REG 0x%02X: read error %d\n", addr, status);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "wr"
+ *
+ * Writes a value to a register of the battery controller, e.g. a
+ * ManufacturerAccess() subcommand, or AtRate() for a what-if query.  The
+ * address and value are specified in hex, the size is taken from the item
+ * list, or defaults to a word.
+ *
+ ******************************************************************************/
+static void CmdWr (int argc, char *argv[])
+{
+uint32_t value;
+int	 addr, size, status;
+
+
+    if (argc < 3)
+    {
+	ConsolePrintf ("usage: wr <addr> <value>\n");
+	return;
+    }
+
+    addr  = (int) strtoul (argv[1], NULL, 16);
+    value = strtoul (argv[2], NULL, 16);
+    size  = RegSize (addr);
+
+    if (addr < 0  ||  addr > 0xFF  ||  size > 4)
+    {
+	ConsolePrintf ("wr: invalid address\n");
+	return;
+    }
+
+    status = BatteryRegWriteValue ((SBS_CMD)((size << 8) | addr), value);
+    if (status != 0)
+	ConsolePrintf ("REG 0x%02X: write error %d\n", addr, status);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "dump"
+ *
+ * Starts a snapshot dump of all items of the display item list.  The items
+ * are read one by one in subsequent calls of ConsoleCheck(), see DumpStep().
+ *
+ ******************************************************************************/
+static void CmdDump (int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    JobStop();
+
+    /* Fill the shared register values from the MAC blocks, if supported */
+    BatteryMacSnapshot (NULL);
+
+    if (TlmModeGet() == TLM_MODE_BINARY)
+	TlmFrameBegin (&l_Frame, TLM_TYPE_SNAPSHOT);
+    else
+	ConsolePrintf ("--- Snapshot %ld ---\n", (long)time(NULL));
+
+    l_DumpIdx = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "mac"
+ *
+ * Reads the MAC status blocks of a TI controller and prints their fields,
+ * or sends them as @ref TLM_TYPE_SNAPSHOT frame in binary mode.
+ *
+ ******************************************************************************/
+static void CmdMac (int argc, char *argv[])
+{
+int	 status;
+
+
+    (void) argc;
+    (void) argv;
+
+    JobStop();
+
+    if (TlmModeGet() == TLM_MODE_BINARY)
+	TlmFrameBegin (&l_Frame, TLM_TYPE_SNAPSHOT);
+
+    status = BatteryMacSnapshot (MacField);
+
+    if (TlmModeGet() == TLM_MODE_BINARY)
+	TlmFrameSend (&l_Frame);
+
+    if (status < 0)
+	ConsolePrintf ("mac: read error %d\n", status);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Output MAC Field
+ *
+ * Callback of BatteryMacSnapshot() for command "mac".
+ *
+ ******************************************************************************/
+static void MacField (const MAC_FIELD *pField, int idx, uint32_t value)
+{
+int	 shift = 32 - 8 * pField->Size;
+
+
+    if (TlmModeGet() == TLM_MODE_BINARY)
+	TlmAddValue (&l_Frame, TLM_ID_MAC + idx, value);
+    else if (pField->flgSigned)
+	ConsolePrintf ("MAC %-16s %ld\n", pField->pName,
+		       (long)((int32_t)(value << shift) >> shift));
+    else
+	ConsolePrintf ("MAC %-16s %lu\n", pField->pName, value);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Dump one Item
+ *
+ * Reads and prints the next item of a running snapshot dump or streaming
+ * sweep.  Items which are not applicable for the connected battery
+ * controller are skipped.
+ *
+ ******************************************************************************/
+static void DumpStep (void)
+{
+const ITEM *pItem;
+const char *pStr;
+int	 bitMaskCtrlType = (0x8000 << g_BatteryCtrlType);
+
+
+    /* Skip items which are not applicable for this controller type */
+    while (l_DumpIdx < l_ItemCnt
+       &&  ((l_pItemList[l_DumpIdx].Cmd & bitMaskCtrlType) == 0
+	    ||  ITEM_IS_HIDDEN(&l_pItemList[l_DumpIdx])))
+	l_DumpIdx++;
+
+    if (l_DumpIdx >= l_ItemCnt)
+    {
+	if (l_flgDumpLog)
+	{
+	    LogAppend (LOG_TYPE_SNAPSHOT, l_Frame.Buf + TLM_HDR_SIZE,
+		       l_Frame.Len);
+	    l_flgDumpLog = false;
+	}
+	else if (TlmModeGet() == TLM_MODE_BINARY)
+	    TlmFrameSend (&l_Frame);
+	else
+	    ConsolePrintf ("--- End of Snapshot ---\n");
+	l_DumpIdx = -1;
+	return;
+    }
+
+    pItem = &l_pItemList[l_DumpIdx++];
+
+    if (l_flgDumpLog  ||  TlmModeGet() == TLM_MODE_BINARY)
+    {
+	/* Only collect the raw data, the frame is sent at the end */
+	TlmCapture (&l_Frame);
+	ItemDataString (pItem);
+	TlmCapture (NULL);
+	return;
+    }
+
+    pStr  = ItemDataString (pItem);
+
+    if (pItem->Cmd != SBS_NONE)
+	ConsolePrintf ("[%02X] %-16s %s\n", SBS_CMD_ADDR(pItem->Cmd),
+		       pItem->pDesc, pStr ? pStr : "READ ERROR");
+    else
+	ConsolePrintf ("     %-16s %s\n",
+		       pItem->pDesc, pStr ? pStr : "READ ERROR");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start Log Snapshot
+ *
+ * Starts a snapshot dump, whose records are collected into a frame and
+ * written to the session log at the end, independent of the output mode.
+ *
+ ******************************************************************************/
+static void LogSnapshot (void)
+{
+    /* Fill the shared register values from the MAC blocks, if supported */
+    BatteryMacSnapshot (NULL);
+
+    TlmFrameBegin (&l_Frame, TLM_TYPE_SNAPSHOT);
+    l_flgDumpLog = true;
+    l_DumpIdx = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "cnt"
+ *
+ * Shows the edge counters of the keys, the LEUART statistics, the
+ * compression ratio of the delta streaming, and the sampling latency.
+ *
+ ******************************************************************************/
+static void CmdCnt (int argc, char *argv[])
+{
+static const struct { const char *pName; int extiNum; } keys[] =
+{
+    { "POWER", KEY_POWER_PIN },
+    { "NEXT",  KEY_NEXT_PIN  },
+    { "PREV",  KEY_PREV_PIN  },
+};
+LEUART_TX_STATS stats;
+TLM_STREAM_STATS tlmStats;
+uint32_t maxIdle, maxLog;
+unsigned int i;
+
+    (void) argc;
+    (void) argv;
+
+    for (i = 0;  i < ELEM_CNT(keys);  i++)
+	ConsolePrintf ("Key %-5s: %lu edges, %lu bounces\n", keys[i].pName,
+		       ExtIntEdgeCount(keys[i].extiNum),
+		       ExtIntBounceCount(keys[i].extiNum));
+
+    drvLEUART_TxStats (&stats);
+    ConsolePrintf ("LEUART Tx: %lu bytes, %lu ticks, %lu starts, "
+		   "%lu restarts, %lu dropped\n", stats.Bytes,
+		   stats.ActiveTicks, stats.Starts, stats.Restarts,
+		   drvLEUART_DropCount());
+    ConsolePrintf ("LEUART Rx: %lu overruns\n", drvLEUART_RxOverruns());
+
+    TlmStreamStats (&tlmStats);
+    if (tlmStats.SentBytes > 0)
+	ConsolePrintf ("Stream: %lu keyframes, %lu deltas, %lu unchanged, "
+		       "%lu of %lu bytes, ratio %lu.%02lu\n",
+		       tlmStats.Keyframes, tlmStats.Deltas,
+		       tlmStats.Unchanged, tlmStats.SentBytes,
+		       tlmStats.FullBytes,
+		       tlmStats.FullBytes / tlmStats.SentBytes,
+		       (tlmStats.FullBytes % tlmStats.SentBytes) * 100
+		       / tlmStats.SentBytes);
+
+    WatchLatency (&maxIdle, &maxLog);
+    ConsolePrintf ("Sample latency: max %lu us, %lu us while logging\n",
+		   TICKS_TO_US(maxIdle), TICKS_TO_US(maxLog));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "rate"
+ *
+ * Shows or sets the interval in seconds, the data of the displayed item is
+ * read from the battery controller, see DisplayPollRateSet().
+ *
+ ******************************************************************************/
+static void CmdRate (int argc, char *argv[])
+{
+    if (argc > 1)
+	DisplayPollRateSet (atoi(argv[1]));
+
+    ConsolePrintf ("Poll interval: %ds\n", DisplayPollRateGet());
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "mode"
+ *
+ * Shows or sets the output mode of the serial link.  In binary mode, the
+ * ASCII mirror of the LCD is replaced by telemetry frames.
+ *
+ ******************************************************************************/
+static void CmdMode (int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+	JobStop();
+
+	if (strcmp (argv[1], "bin") == 0)
+	    TlmModeSet (TLM_MODE_BINARY);
+	else if (strcmp (argv[1], "text") == 0)
+	    TlmModeSet (TLM_MODE_TEXT);
+	else
+	    ConsolePrintf ("mode: use \"text\" or \"bin\"\n");
+    }
+
+    ConsolePrintf ("Output mode: %s\n",
+		   TlmModeGet() == TLM_MODE_BINARY ? "bin" : "text");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "trace"
+ *
+ * Starts to read a register repeatedly, once per pass of the main loop,
+ * see TraceStep().  Only registers of up to 4 bytes can be traced.
+ *
+ ******************************************************************************/
+static void CmdTrace (int argc, char *argv[])
+{
+int	 addr, size, cnt;
+
+
+    if (argc < 2)
+    {
+	ConsolePrintf ("usage: trace <addr> [count]\n");
+	return;
+    }
+
+    addr = (int) strtoul (argv[1], NULL, 16);
+    cnt  = (argc > 2 ? atoi(argv[2]) : 100);
+    size = (addr >= 0  &&  addr <= 0xFF ? RegSize (addr) : 0);
+
+    if (size < 1  ||  size > 4  ||  cnt <= 0)
+    {
+	ConsolePrintf ("trace: invalid address or count\n");
+	return;
+    }
+
+    JobStop();
+
+    l_TraceCmd = (SBS_CMD)((size << 8) | addr);
+    l_TraceCnt = cnt;
+
+    if (TlmModeGet() == TLM_MODE_BINARY)
+	TlmFrameBegin (&l_Frame, TLM_TYPE_TRACE);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Trace one Register Read
+ *
+ * Reads the traced register once.  In binary mode, the value is added to
+ * the trace frame, which is sent when it is full or the trace is complete.
+ *
+ ******************************************************************************/
+static void TraceStep (void)
+{
+uint32_t value;
+
+
+    l_TraceCnt--;
+
+    if (BatteryRegReadValue (l_TraceCmd, &value) < 0)
+    {
+	ConsolePrintf ("REG 0x%02X: read error\n", SBS_CMD_ADDR(l_TraceCmd));
+	JobStop();
+	return;
+    }
+
+    if (TlmModeGet() == TLM_MODE_BINARY)
+    {
+	TlmAddValue (&l_Frame, SBS_CMD_ADDR(l_TraceCmd), value);
+	if (l_TraceCnt == 0)
+	    TlmFrameSend (&l_Frame);
+    }
+    else
+    {
+	ConsolePrintf ("REG 0x%02X: 0x%lX (%lu)\n", SBS_CMD_ADDR(l_TraceCmd),
+		       value, value);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "stream"
+ *
+ * Shows or sets the interval for delta streaming.  Every interval, all items
+ * are read, one per pass of the main loop, and only the changed registers
+ * are sent, see TlmStreamBegin().  Streaming requires binary mode.
+ *
+ ******************************************************************************/
+static void CmdStream (int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+	l_StreamInterval = atoi(argv[1]);
+	if (l_StreamInterval < 0)
+	    l_StreamInterval = 0;
+    }
+
+    ConsolePrintf ("Stream interval: %ds%s\n", l_StreamInterval,
+		   TlmModeGet() == TLM_MODE_BINARY ? "" : " (needs mode bin)");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "watch"
+ *
+ * Adds registers to the watch list.  Each argument is a register address
+ * in hex, optionally followed by a colon and the period in seconds, e.g.
+ * "watch 0a 09:5 0d:10".  The default period is one second.  Without
+ * arguments, the watch list is shown.
+ *
+ ******************************************************************************/
+static void CmdWatch (int argc, char *argv[])
+{
+char	*pEnd;
+int	 addr, period, i;
+
+
+    for (i = 1;  i < argc;  i++)
+    {
+	addr = (int) strtoul (argv[i], &pEnd, 16);
+	period = (*pEnd == ':' ? atoi(pEnd + 1) : 1);
+
+	if (addr < 0  ||  addr > 0xFF
+	||  WatchAdd ((SBS_CMD)((RegSize(addr) << 8) | addr), period) < 0)
+	    ConsolePrintf ("watch: cannot add \"%s\"\n", argv[i]);
+    }
+
+    WatchList();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "unwatch"
+ *
+ * Removes a register, or with "all" every register, from the watch list.
+ *
+ ******************************************************************************/
+static void CmdUnwatch (int argc, char *argv[])
+{
+int	 cnt;
+
+
+    if (argc < 2)
+    {
+	ConsolePrintf ("usage: unwatch <addr>|all\n");
+	return;
+    }
+
+    if (strcmp (argv[1], "all") == 0)
+	cnt = WatchRemove (-1);
+    else
+	cnt = WatchRemove ((int) strtoul (argv[1], NULL, 16));
+
+    ConsolePrintf ("%d register(s) removed\n", cnt);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "bridge"
+ *
+ * Stops a running dump or trace and enters bridge mode.  From now on, the
+ * received data are binary requests for the SMBus, until the PC sends the
+ * EXIT operation, or there are no requests for @ref BRIDGE_IDLE_TIMEOUT
+ * seconds.
+ *
+ ******************************************************************************/
+static void CmdBridge (int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    JobStop();
+    ConsolePrintf ("Bridge mode, waiting for requests\n");
+    BridgeStart();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Commands "dfbackup" and "dfrestore"
+ *
+ * Stops a running dump or trace and starts the transfer of the data flash
+ * image.  The optional parameter selects the SMBus clock rate in [kHz] for
+ * the transfer, so the throughput can be compared at different rates.
+ *
+ ******************************************************************************/
+static void CmdDFlash (int argc, char *argv[])
+{
+bool	 flgBackup = (strcmp (argv[0], "dfbackup") == 0);
+int	 kHz = 0;			// default clock rate
+int	 status;
+
+
+    if (argc > 1)
+    {
+	kHz = atoi(argv[1]);
+	if (kHz < DF_KHZ_MIN  ||  kHz > DF_KHZ_MAX)
+	{
+	    ConsolePrintf ("%s: clock rate must be %d to %d kHz\n", argv[0],
+			   DF_KHZ_MIN, DF_KHZ_MAX);
+	    return;
+	}
+    }
+
+    JobStop();
+
+    status = (flgBackup ? DFlashBackup (kHz * 1000)
+			: DFlashRestore (kHz * 1000));
+    if (status < 0)
+    {
+	ConsolePrintf ("%s: not possible, error %d\n", argv[0], status);
+	return;
+    }
+
+    if (! flgBackup)
+	ConsolePrintf ("Data flash restore, waiting for data\n");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "export"
+ *
+ * Starts the encrypted export of a data source, see Export.c, or measures
+ * the throughput of the hardware and the software AES.  With "sw", the
+ * export uses the software AES.
+ *
+ ******************************************************************************/
+static void CmdExport (int argc, char *argv[])
+{
+EXPORT_SRC src;
+int	 status;
+
+
+    if (argc > 1  &&  strcmp (argv[1], "bench") == 0)
+    {
+	ExportBenchmark();
+	return;
+    }
+
+    if (argc > 1  &&  strcmp (argv[1], "df") == 0)
+	src = EXPORT_SRC_DFLASH;
+    else if (argc > 1  &&  strcmp (argv[1], "log") == 0)
+	src = EXPORT_SRC_LOG;
+    else
+    {
+	ConsolePrintf ("usage: export df|log|bench [sw]\n");
+	return;
+    }
+
+    JobStop();
+
+    status = ExportStart (src, argc > 2  &&  strcmp (argv[2], "sw") == 0);
+    if (status == i2cNoExportKey)
+	ConsolePrintf ("export: no keys programmed\n");
+    else if (status < 0)
+	ConsolePrintf ("export: not possible, error %d\n", status);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "auth"
+ *
+ * Starts the authentication of the battery pack, see PackAuthStart().
+ * AuthStep() shows the result on the console and the LCD.  The challenge may
+ * be given as 40 hex digits, e.g. to compare the digest with
+ * tools/pack_auth.py.  With "test", the known answer tests of the SHA-1
+ * implementation are run instead.
+ *
+ ******************************************************************************/
+static void CmdAuth (int argc, char *argv[])
+{
+uint8_t	 challenge[AUTH_CHALLENGE_SIZE];
+char	 hex[3];
+int	 status, i;
+
+
+    if (argc > 1  &&  strcmp (argv[1], "test") == 0)
+    {
+	status = PackAuthSelfTest();
+	ConsolePrintf ("Auth self test: %s\n", status == 0 ? "passed"
+		       : "FAILED");
+	return;
+    }
+
+    if (argc > 1)
+    {
+	if (strlen (argv[1]) != 2 * AUTH_CHALLENGE_SIZE)
+	{
+	    ConsolePrintf ("auth: challenge must have %d hex digits\n",
+			   2 * AUTH_CHALLENGE_SIZE);
+	    return;
+	}
+
+	hex[2] = EOS;
+	for (i = 0;  i < AUTH_CHALLENGE_SIZE;  i++)
+	{
+	    hex[0] = argv[1][2*i];
+	    hex[1] = argv[1][2*i + 1];
+	    challenge[i] = (uint8_t) strtoul (hex, NULL, 16);
+	}
+    }
+
+    JobStop();
+
+    status = PackAuthStart (argc > 1 ? challenge : NULL, &l_AuthResult);
+    if (status == i2cNoAuthKey)
+	ConsolePrintf ("auth: no key programmed\n");
+    else if (status < 0)
+	ConsolePrintf ("auth: error %d\n", status);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Authentication Step
+ *
+ * Called by ConsoleCheck() while an authentication is running.  When the
+ * digest has been read, the result is shown on the console and the LCD.
+ *
+ ******************************************************************************/
+static void AuthStep (void)
+{
+int	 status;
+
+
+    status = PackAuthCheck();
+    if (status > 0)
+	return;				// still waiting for the digest
+
+    if (status < 0)
+    {
+	ConsolePrintf ("auth: error %d\n", status);
+	return;
+    }
+
+    PrintHex ("Challenge", l_AuthResult.Challenge, AUTH_CHALLENGE_SIZE);
+    PrintHex ("Digest   ", l_AuthResult.Digest, SHA1_DIGEST_SIZE);
+    PrintHex ("Expected ", l_AuthResult.Expected, SHA1_DIGEST_SIZE);
+    ConsolePrintf ("Auth %s: %lu ms total, SHA-1 %lu us\n",
+		   l_AuthResult.flgGenuine ? "PASSED" : "FAILED, COUNTERFEIT",
+		   l_AuthResult.TotalTicks * 1000UL / RTC_COUNTS_PER_SEC,
+		   l_AuthResult.HashTicks * 1000000UL / RTC_COUNTS_PER_SEC);
+
+    DisplayText (1, l_AuthResult.flgGenuine ? "Pack genuine" : "COUNTERFEIT");
+    DisplayText (2, "Auth %lu ms",
+		 l_AuthResult.TotalTicks * 1000UL / RTC_COUNTS_PER_SEC);
+    DisplayNext (10, NULL, 0);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "log"
+ *
+ * Without argument, shows the statistics of the session log.  "list [n]"
+ * shows the last n records, one per call of ConsoleCheck(), see ListStep().
+ * "snap" writes a snapshot into the log now, "erase" erases the log, and a
+ * number sets the snapshot interval in seconds, 0 disables the snapshots.
+ *
+ * "query <minutes> [<key>|all]" sends the records of the last minutes.  By
+ * default only those of the connected pack are sent, if any, <key> selects
+ * another pack by its key in hex, see <b>hist</b>.
+ *
+ ******************************************************************************/
+static void CmdLog (int argc, char *argv[])
+{
+HIST_SESSION session;
+LOG_STATS   stats;
+int	 status, cnt;
+
+
+    if (argc > 1  &&  strcmp (argv[1], "list") == 0)
+    {
+	cnt = (argc > 2 ? atoi(argv[2]) : LOG_LIST_CNT);
+	if (cnt <= 0)
+	    return;
+
+	/* The last records are those with the highest sequence numbers */
+	JobStop();
+	LogStats (&stats);
+	l_ListFrom = (stats.NextSeq > (uint32_t) cnt
+		      ? stats.NextSeq - (uint32_t) cnt : 0);
+	LogRewind (&l_ListCursor);
+	l_flgList = true;
+	return;
+    }
+
+    if (argc > 1  &&  strcmp (argv[1], "query") == 0)
+    {
+	if (argc < 3)
+	{
+	    ConsolePrintf ("usage: log query <minutes> [<key>|all]\n");
+	    return;
+	}
+	JobStop();
+	l_QueryFrom = (uint32_t) time(NULL) - (uint32_t) atoi(argv[2]) * 60;
+	l_flgQueryAll = true;
+	if (argc > 3)
+	{
+	    l_flgQueryAll = (strcmp (argv[3], "all") == 0);
+	    l_QueryKey = strtoul (argv[3], NULL, 16);
+	}
+	else if (HistoryCurrent (&session))
+	{
+	    l_flgQueryAll = false;
+	    l_QueryKey = session.Key;
+	}
+	LogSeek (&l_QueryCursor, l_QueryFrom);
+	l_QueryRead = l_QuerySent = 0;
+	l_flgQuery = true;
+	return;
+    }
+
+    if (argc > 1  &&  strcmp (argv[1], "snap") == 0)
+    {
+	JobStop();
+	LogSnapshot();
+	return;
+    }
+
+    if (argc > 1  &&  strcmp (argv[1], "erase") == 0)
+    {
+	JobStop();
+	status = LogErase();
+	ConsolePrintf (status == 0 ? "Log erased\n"
+		       : "log: erase failed, error %d\n", status);
+	return;
+    }
+
+    if (argc > 1)
+    {
+	l_LogInterval = atoi(argv[1]);
+	if (l_LogInterval < 0)
+	    l_LogInterval = 0;
+    }
+
+    LogStats (&stats);
+    ConsolePrintf ("Log: %d of %d pages used, records %lu..%lu, "
+		   "%lu bytes free\n", stats.PagesUsed, LOG_PAGE_CNT,
+		   (unsigned long) stats.FirstSeq,
+		   (unsigned long) stats.NextSeq - 1,
+		   (unsigned long) stats.FreeBytes);
+    ConsolePrintf ("Erase count %lu..%lu, %lu torn records, %lu errors, "
+		   "snapshot interval %ds\n",
+		   (unsigned long) stats.EraseMin,
+		   (unsigned long) stats.EraseMax,
+		   (unsigned long) stats.Torn, (unsigned long) stats.Errors,
+		   l_LogInterval);
+    ConsolePrintf ("Writer: %lu bytes pending, %lu dropped, %lu late erases, "
+		   "max write %lu us, max erase %lu us\n",
+		   (unsigned long) stats.Pending,
+		   (unsigned long) stats.Dropped,
+		   (unsigned long) stats.LateErases,
+		   TICKS_TO_US(stats.MaxWriteTicks),
+		   TICKS_TO_US(stats.MaxEraseTicks));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	List Step
+ *
+ * Shows the next record of <b>log list</b>, as soon as the LEUART has room
+ * for it.  Up to @ref QUERY_SKIP_MAX older records are skipped per call.
+ *
+ ******************************************************************************/
+static void ListStep (void)
+{
+LOG_REC_HDR hdr;
+uint8_t	 data[4 + 16];		// reset cause and version string
+int	 len, i;
+
+
+    if (drvLEUART_TxFree() < QUERY_TX_SIZE)
+	return;				// wait until the LEUART has sent more
+
+    for (i = 0;  i < QUERY_SKIP_MAX;  i++)
+    {
+	len = LogRead (&l_ListCursor, &hdr, data, sizeof(data));
+	if (len < 0)
+	{
+	    l_flgList = false;		// end of the log
+	    return;
+	}
+
+	if (hdr.Seq >= l_ListFrom)
+	{
+	    LogRecordPrint (&hdr, data, len < (int) sizeof(data)
+					? len : (int) sizeof(data));
+	    return;
+	}
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Query Step
+ *
+ * Reads the next records of a running log query, up to @ref QUERY_SKIP_MAX
+ * records which do not match are skipped per call.  The next matching
+ * record is sent as soon as the LEUART has room for it.  At the end of the
+ * log, the end frame or a summary line is sent.
+ *
+ ******************************************************************************/
+static void QueryStep (void)
+{
+LOG_REC_HDR hdr;
+uint8_t	 offs;
+int	 len, size, cnt, i;
+
+
+    if (drvLEUART_TxFree() < QUERY_TX_SIZE)
+	return;				// wait until the LEUART has sent more
+
+    for (i = 0;  i < QUERY_SKIP_MAX;  i++)
+    {
+	len = LogRead (&l_QueryCursor, &hdr, l_QueryRec + LOG_REC_HDR_SIZE,
+		       LOG_DATA_MAX);
+	if (len < 0)
+	{
+	    /* End of the log */
+	    if (TlmModeGet() == TLM_MODE_BINARY)
+	    {
+		offs = QUERY_END;
+		TlmFrameBegin (&l_Frame, TLM_TYPE_LOG);
+		TlmAddRaw (&l_Frame, &offs, 1);
+		TlmAddRaw (&l_Frame, (uint8_t *) &l_QuerySent, 4);
+		TlmFrameSend (&l_Frame);
+	    }
+	    else
+	    {
+		ConsolePrintf ("--- %lu of %lu records ---\n",
+			       (unsigned long) l_QuerySent,
+			       (unsigned long) l_QueryRead);
+	    }
+	    l_flgQuery = false;
+	    return;
+	}
+
+	l_QueryRead++;
+	if (hdr.Time >= l_QueryFrom
+	&&  (l_flgQueryAll  ||  l_QueryCursor.PackKey == l_QueryKey))
+	    break;
+    }
+
+    if (i == QUERY_SKIP_MAX)
+	return;				// nothing found yet, call us again
+
+    l_QuerySent++;
+
+    if (TlmModeGet() != TLM_MODE_BINARY)
+    {
+	LogRecordPrint (&hdr, l_QueryRec + LOG_REC_HDR_SIZE, len);
+	return;
+    }
+
+    /* Send the record as stored, split into frames */
+    memcpy (l_QueryRec, &hdr, LOG_REC_HDR_SIZE);
+    size = LOG_REC_HDR_SIZE + len;
+    for (i = 0;  i < size;  i += cnt)
+    {
+	cnt = size - i;
+	if (cnt > TLM_PAYLOAD_MAX - 1)
+	    cnt = TLM_PAYLOAD_MAX - 1;
+
+	offs = (uint8_t) i;
+	TlmFrameBegin (&l_Frame, TLM_TYPE_LOG);
+	TlmAddRaw (&l_Frame, &offs, 1);
+	TlmAddRaw (&l_Frame, l_QueryRec + i, cnt);
+	TlmFrameSend (&l_Frame);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Print Log Record
+ *
+ * Prints a line with the header of a record.  For a session record, the
+ * reset cause and the version are shown, for a connect record the pack key.
+ *
+ * @param[in] pHdr
+ *	Header of the record.
+ *
+ * @param[in] pData
+ *	Data of the record.
+ *
+ * @param[in] cnt
+ *	Number of bytes at pData, may be less than the record has.
+ *
+ ******************************************************************************/
+static void LogRecordPrint (const LOG_REC_HDR *pHdr, const uint8_t *pData,
+			    int cnt)
+{
+static const char * const typeName[] = { "?", "session", "snapshot",
+					  "series", "pack", "connect",
+					  "profile" };
+char	 version[17];
+uint32_t value;
+PROF_RECORD prof;
+
+
+    ConsolePrintf ("#%lu %lu %-8s %d bytes", (unsigned long) pHdr->Seq,
+		   (unsigned long) pHdr->Time,
+		   typeName[pHdr->Type < ELEM_CNT(typeName) ? pHdr->Type : 0],
+		   pHdr->Len);
+
+    if (cnt >= 4)
+	memcpy (&value, pData, 4);
+
+    if (pHdr->Type == LOG_TYPE_SESSION  &&  cnt >= 4)
+    {
+	/* Reset cause and version string */
+	cnt -= 4;
+	if (cnt > (int) sizeof(version) - 1)
+	    cnt = sizeof(version) - 1;
+	memcpy (version, pData + 4, cnt);
+	version[cnt] = EOS;
+	ConsolePrintf (", reset cause 0x%02X, V%s", (unsigned int) value,
+		       version);
+    }
+    else if (pHdr->Type == LOG_TYPE_CONNECT  &&  cnt >= 4)
+    {
+	ConsolePrintf (", pack %08lX", (unsigned long) value);
+    }
+    else if (pHdr->Type == LOG_TYPE_PROFILE  &&  cnt >= (int)sizeof(prof))
+    {
+	memcpy (&prof, pData, sizeof(prof));
+	ConsolePrintf (", EM0/1/2 %lu/%lu/%lus %lu/%lu/%lu nAh",
+		       (unsigned long) prof.Seconds[PROF_EM0],
+		       (unsigned long) prof.Seconds[PROF_EM1],
+		       (unsigned long) prof.Seconds[PROF_EM2],
+		       (unsigned long) prof.ChargeNAh[PROF_EM0],
+		       (unsigned long) prof.ChargeNAh[PROF_EM1],
+		       (unsigned long) prof.ChargeNAh[PROF_EM2]);
+    }
+    ConsolePrintf ("\n");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "series"
+ *
+ * Shows or sets the sample interval of the time series, and shows the
+ * bytes per sample achieved by the compression, see module Series.c.
+ *
+ ******************************************************************************/
+static void CmdSeries (int argc, char *argv[])
+{
+SERIES_STATS stats;
+uint32_t perSample;	// bytes per sample * 100
+
+
+    if (argc > 1)
+	SeriesIntervalSet (atoi(argv[1]));
+
+    SeriesStats (&stats);
+    perSample = (stats.Samples > 0 ? stats.Bytes * 100 / stats.Samples : 0);
+    ConsolePrintf ("Series interval: %ds, %lu samples, %lu blocks, "
+		   "%lu dropped\n", SeriesIntervalGet(),
+		   (unsigned long) stats.Samples, (unsigned long) stats.Blocks,
+		   (unsigned long) stats.Dropped);
+    ConsolePrintf ("%lu bytes, %lu.%02lu bytes/sample, raw %d bytes/sample\n",
+		   (unsigned long) stats.Bytes, (unsigned long) perSample / 100,
+		   (unsigned long) perSample % 100, SERIES_RAW_SIZE);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "hist"
+ *
+ * Shows the identity of the connected pack, the change of CycleCount and
+ * state of health since its last visit, and its previous sessions, which
+ * are found via the pack history index.  "rebuild" rebuilds the index from
+ * the log.
+ *
+ ******************************************************************************/
+static void CmdHist (int argc, char *argv[])
+{
+HIST_STATS   stats;
+HIST_SESSION cur, prev;
+uint32_t seq;
+int	 status, cnt;
+
+
+    if (argc > 1  &&  strcmp (argv[1], "rebuild") == 0)
+    {
+	status = HistoryRebuild();
+	ConsolePrintf (status == 0 ? "Index rebuilt\n"
+		       : "hist: rebuild failed, error %d\n", status);
+    }
+
+    HistoryStats (&stats);
+    ConsolePrintf ("Index: page %d, generation %lu, %d of %d slots used, "
+		   "%lu rebuilds\n", stats.Page,
+		   (unsigned long) stats.Generation, stats.Used, HIST_SLOT_CNT,
+		   (unsigned long) stats.Rebuilds);
+
+    if (! HistoryCurrent (&cur))
+    {
+	ConsolePrintf ("No pack connected\n");
+	return;
+    }
+
+    ConsolePrintf ("Pack %s, key %08lX\n", cur.Name, (unsigned long) cur.Key);
+    ConsolePrintf ("S/N %d, made %d-%02d-%02d: %d cycles, SoH %d%%, "
+		   "FCC %d\n", cur.SerialNumber,
+		   (cur.ManufactureDate >> 9) + 1980,
+		   (cur.ManufactureDate >> 5) & 0x0F,
+		   cur.ManufactureDate & 0x1F,
+		   cur.CycleCount, cur.SoH, cur.FullChargeCap);
+
+    seq = cur.PrevSeq;
+    for (cnt = 0;  cnt < HIST_LIST_CNT  &&  HistoryRead (seq, &prev) == 0;
+	 cnt++)
+    {
+	if (cnt == 0)
+	    ConsolePrintf ("Since last visit: %d cycles, SoH %d%%\n",
+			   cur.CycleCount - prev.CycleCount,
+			   cur.SoH - prev.SoH);
+
+	ConsolePrintf ("#%lu %lu..%lu: %d cycles, SoH %d%%, FCC %d\n",
+		       (unsigned long) seq, (unsigned long) prev.ConnectTime,
+		       (unsigned long) prev.CloseTime, prev.CycleCount,
+		       prev.SoH, prev.FullChargeCap);
+	seq = prev.PrevSeq;
+    }
+
+    if (cnt == 0)
+	ConsolePrintf ("No previous session\n");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "download"
+ *
+ * Starts the download of the session log, see Download.c.  A PC which
+ * resumes a download gives the first block it is missing, and the number of
+ * blocks.  Without arguments, the whole log is sent.
+ *
+ ******************************************************************************/
+static void CmdDownload (int argc, char *argv[])
+{
+int	 first = 0, cnt = 0;
+int	 status;
+
+
+    if (argc > 1)
+	first = (int) strtol (argv[1], NULL, 0);
+    if (argc > 2)
+	cnt = (int) strtol (argv[2], NULL, 0);
+
+    JobStop();
+
+    status = DownloadStart (first, cnt);
+    if (status == logInvalidParameter)
+	ConsolePrintf ("usage: download [first [count]], %d blocks\n",
+		       DL_BLOCK_CNT);
+    else if (status < 0)
+	ConsolePrintf ("download: not possible, error %d\n", status);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "supply"
+ *
+ * Shows the voltage of the CR2032 and the state of the supply warning, see
+ * Supply.c.  With an argument, the warning threshold is set in [mV].
+ *
+ ******************************************************************************/
+static void CmdSupply (int argc, char *argv[])
+{
+SUPPLY_STATS stats;
+
+
+    if (argc > 1)
+	SupplyThresholdSet (atoi(argv[1]));
+
+    SupplyStats (&stats);
+    ConsolePrintf ("Supply: %lu mV, threshold %d mV, %s, %lu warnings",
+		   (unsigned long) ReadVdd(), stats.ThresholdMV,
+		   stats.flgLow ? "LOW" : "ok",
+		   (unsigned long) stats.Warnings);
+    if (stats.Warnings > 0)
+	ConsolePrintf (", last at %lu", (unsigned long) stats.LastTime);
+    ConsolePrintf ("\n");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "monitor"
+ *
+ * Starts the monitor mode with the specified sample interval in seconds, or
+ * stops it with "off", see module Monitor.c.  Then the time spent in each
+ * energy mode, the average current, and the projected lifetime of the
+ * CR2032 are shown.  The currents are typical values, not measurements.
+ *
+ ******************************************************************************/
+static void CmdMonitor (int argc, char *argv[])
+{
+MONITOR_STATS stats;
+uint64_t total;
+uint32_t pct;		// percent * 100
+int	 interval, cnt, i;
+
+
+    if (argc > 1)
+    {
+	if (strcmp (argv[1], "off") == 0)
+	{
+	    MonitorStop();
+	}
+	else if ((interval = atoi(argv[1])) > 0)
+	{
+	    JobStop();
+	    l_StreamInterval = 0;
+	    cnt = WatchRemove (-1);
+	    if (cnt > 0)
+		ConsolePrintf ("Watch list cleared (%d registers)\n", cnt);
+
+	    if (MonitorStart (interval) == 0)
+		ConsolePrintf ("Supply is low, monitor mode not started\n");
+	}
+	else
+	{
+	    ConsolePrintf ("usage: monitor [seconds|off]\n");
+	    return;
+	}
+    }
+
+    MonitorStats (&stats);
+    ConsolePrintf ("Monitor: %s, interval %ds, tick %ds, %lu wake-ups\n",
+		   stats.flgActive ? "on" : "off", stats.Interval, stats.Tick,
+		   (unsigned long) stats.Wakeups);
+
+    total = stats.Ticks[PROF_EM0] + stats.Ticks[PROF_EM1]
+	  + stats.Ticks[PROF_EM2];
+    if (total == 0)
+	return;
+
+    for (i = 0;  i < PROF_EM_CNT;  i++)
+    {
+	pct = (uint32_t)(stats.Ticks[i] * 10000 / total);
+	ConsolePrintf ("%sEM%d %lus %lu.%02lu%%", i ? ", " : "", i,
+		       (unsigned long)(stats.Ticks[i] / RTC_COUNTS_PER_SEC),
+		       (unsigned long) pct / 100, (unsigned long) pct % 100);
+    }
+    ConsolePrintf ("\nAverage %lu.%03lu uA, CR2032 of %d mAh lasts %lu days"
+		   " (typical currents)\n",
+		   (unsigned long) stats.AvgCurrentNA / 1000,
+		   (unsigned long) stats.AvgCurrentNA % 1000,
+		   MONITOR_CR2032_MAH,
+		   (unsigned long) stats.LifetimeHours / 24);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Command "prof"
+ *
+ * Shows the time and the charge of each energy mode since power-on, the
+ * share of each task in the EM0 time, and the EM1 time of each module, see
+ * module Profile.c.  "prof lcd" shows the charge on the hidden LCD item.
+ * The charge is calculated with typical currents, not measured.
+ *
+ ******************************************************************************/
+static void CmdProf (int argc, char *argv[])
+{
+static const char * const taskName[PROF_TASK_CNT] =
+{
+    "loop", "supply", "display", "console", "watch", "series", "history",
+    "smbus", "log", "monitor"
+};
+static const char * const modName[END_EM1_MODULES] =
+{
+    NULL,	// EM1_MOD_XXX is only an example, not shown
+    "smbus"	// EM1_MOD_SMBUS
+};
+static PROF_STATS stats;	// too large for the stack
+uint64_t total;
+uint32_t pct;		// percent * 100
+int	 i;
+
+
+    if (argc > 1)
+    {
+	if (strcmp (argv[1], "lcd") != 0)
+	{
+	    ConsolePrintf ("usage: prof [lcd]\n");
+	    return;
+	}
+
+	for (i = 0;  i < l_ItemCnt;  i++)
+	{
+	    if (l_pItemList[i].Frmt == FRMT_EM_PROFILE)
+	    {
+		DisplayShowItem (i);
+		break;
+	    }
+	}
+    }
+
+    ProfileStats (&stats);
+    total = stats.Ticks[PROF_EM0] + stats.Ticks[PROF_EM1]
+	  + stats.Ticks[PROF_EM2];
+    if (total == 0)
+	return;
+
+    ConsolePrintf ("Profile: %lus, %lu wake-ups, %lu.%03lu uAh"
+		   " (typical currents)\n",
+		   (unsigned long)(total / RTC_COUNTS_PER_SEC),
+		   (unsigned long) stats.Wakeups,
+		   (unsigned long)(stats.ChargeNAh[PROF_EM0]
+		    + stats.ChargeNAh[PROF_EM1] + stats.ChargeNAh[PROF_EM2])
+		    / 1000,
+		   (unsigned long)(stats.ChargeNAh[PROF_EM0]
+		    + stats.ChargeNAh[PROF_EM1] + stats.ChargeNAh[PROF_EM2])
+		    % 1000);
+
+    for (i = 0;  i < PROF_EM_CNT;  i++)
+    {
+	pct = (uint32_t)(stats.Ticks[i] * 10000 / total);
+	ConsolePrintf ("EM%d %lu ms %lu.%02lu%% %lu.%03lu uAh\n", i,
+		       (unsigned long)(stats.Ticks[i] * 1000
+				       / RTC_COUNTS_PER_SEC),
+		       (unsigned long) pct / 100, (unsigned long) pct % 100,
+		       (unsigned long) stats.ChargeNAh[i] / 1000,
+		       (unsigned long) stats.ChargeNAh[i] % 1000);
+    }
+
+    if (stats.Ticks[PROF_EM0] > 0)
+    {
+	ConsolePrintf ("EM0 by task:");
+	for (i = 0;  i < PROF_TASK_CNT;  i++)
+	{
+	    pct = (uint32_t)(stats.TaskTicks[i] * 1000
+			     / stats.Ticks[PROF_EM0]);
+	    ConsolePrintf (" %s %lu.%lu%%", taskName[i],
+			   (unsigned long) pct / 10, (unsigned long) pct % 10);
+	}
+	ConsolePrintf ("\n");
+    }
+
+    ConsolePrintf ("EM1 by module:");
+    for (i = 0;  i < END_EM1_MODULES;  i++)
+    {
+	if (modName[i] == NULL)
+	    continue;			// not a real module
+
+	ConsolePrintf (" %s %lu ms", modName[i],
+		       (unsigned long)(stats.ModTicks[i] * 1000
+				       / RTC_COUNTS_PER_SEC));
+    }
+    ConsolePrintf ("\n");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Print Data in Hex
+ *
+ ******************************************************************************/
+static void PrintHex (const char *pLabel, const uint8_t *pData, int cnt)
+{
+int	 i;
+
+
+    ConsolePrintf ("%s:", pLabel);
+    for (i = 0;  i < cnt;  i++)
+	ConsolePrintf (" %02X", pData[i]);
+    ConsolePrintf ("\n");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Register Size
+ *
+ * Returns the size of a register in bytes.  It is taken from the item list,
+ * if the register is not listed there, @ref REG_DEFAULT_SIZE is returned.
+ *
+ ******************************************************************************/
+static int  RegSize (int addr)
+{
+int	 i;
+
+
+    for (i = 0;  i < l_ItemCnt;  i++)
+    {
+	if (l_pItemList[i].Cmd != SBS_NONE
+	&&  SBS_CMD_ADDR(l_pItemList[i].Cmd) == addr)
+	    return SBS_CMD_SIZE(l_pItemList[i].Cmd);
+    }
+
+    return REG_DEFAULT_SIZE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop running Job
+ *
+ * Stops a running snapshot dump or trace.  In binary mode, data that has
+ * already been collected is sent.
+ *
+ ******************************************************************************/
+static void JobStop (void)
+{
+    if ((l_DumpIdx != -1  ||  l_TraceCnt > 0)
+    &&  ! l_flgDumpLog  &&  TlmModeGet() == TLM_MODE_BINARY)
+	TlmFrameSend (&l_Frame);
+
+    l_DumpIdx  = -1;
+    l_TraceCnt = 0;
+    l_flgDumpLog = false;	// an incomplete log snapshot is discarded
+    l_flgQuery = false;
+    l_flgList = false;
+    l_HelpIdx = -1;
+    PackAuthAbort();
+}
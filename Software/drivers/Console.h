@@ -0,0 +1,56 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Console.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Console_h
+#define __INC_Console_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "Display.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of the command line buffer in bytes. */
+#define CON_LINE_SIZE		64
+
+    /*!@brief Maximum number of arguments, including the command itself. */
+#define CON_MAX_ARGS		6
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Function to be called for a console command.
+     *
+     * The arguments are passed like for main(), i.e. <b>argv[0]</b> is the
+     * name of the command.  The function is called from the main loop and
+     * must not block, longer operations have to be split into steps, see
+     * ConsoleCheck().
+     */
+typedef void	(* CON_CMD_FCT)(int argc, char *argv[]);
+
+    /*!@brief Entry of the command table. */
+typedef struct
+{
+    const char	*pName;		//!< Command name
+    const char	*pArgs;		//!< Argument description for help
+    const char	*pHelp;		//!< Short help text
+    CON_CMD_FCT	 Fct;		//!< Function to execute the command
+} CON_CMD;
+
+/*================================ Prototypes ================================*/
+
+void	ConsoleInit  (const ITEM *pItemList, int itemCnt);
+void	ConsoleCheck (void);
+
+
+#endif /* __INC_Console_h */
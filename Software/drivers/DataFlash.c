@@ -0,0 +1,661 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Data Flash Backup and Restore
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module transfers the whole data flash image of a bq40z50 between the
+ * battery controller and a PC, e.g. for failure analysis and refurbishment.
+ * The data flash is accessed via ManufacturerBlockAccess() (0x44) in chunks
+ * of @ref DF_CHUNK_SIZE bytes: a block write of the address, followed by a
+ * block read of the data, and for the restore a block write of the address
+ * and the data.
+ *
+ * Each chunk is a unit of chained transactions, see SMB_XACT.  Up to @ref
+ * DF_PIPELINE units are queued at the same time, so the SMBus runs back to
+ * back, while the LEUART sends the previous chunks.
+ *
+ * <b>Backup</b> (console command "dfbackup") sends each chunk as
+ * @ref TLM_TYPE_DFLASH frame, the CRC of the frame covers the chunk:
+ * <pre>
+ *   ADDR[2]  STATUS  DATA[32]
+ * </pre>
+ * The frame is only sent when there is room in the LEUART FIFO, so no chunk
+ * is lost.  A chunk which cannot be read after @ref DF_RETRY_CNT attempts
+ * is sent with its error status and without data.  Any received character
+ * aborts the backup.
+ *
+ * <b>Restore</b> (console command "dfrestore") receives the chunks from the
+ * PC in frames with the same framing as the bridge requests, see
+ * HostFrame.c:
+ * <pre>
+ *   SYNC  LEN  ADDR[2]  DATA[LEN-2]  CRC[2]
+ * </pre>
+ * Each chunk is written, read back, and compared.  The result is sent as
+ * @ref TLM_TYPE_DFLASH frame with ADDR and STATUS, but without data.  The
+ * PC may send up to @ref DF_PIPELINE chunks without waiting for the result.
+ * Frames with a CRC error are discarded, the PC has to repeat them.  A
+ * frame without data ends the restore.
+ *
+ * In both cases, a final frame with ADDR 0xFFFF and the overall status is
+ * sent, followed by a text line with the number of bytes, the achieved
+ * bytes per second, and the SMBus clock rate.  The progress is shown on the
+ * LCD.
+ *
+ * The host side is implemented in tools/df_transfer.py.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Restore frames are received by HostFrame.c, the receive
+		interrupt wakes up the main loop for the rest of a frame.
+2026-10-18,agent	DFlashStop() no longer waits in a loop for the units in
+		progress, DFlashCheck() finishes the transfer.
+2026-10-18,agent	Added DFlashRead() for single chunks, e.g. for Export.c.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_i2c.h"
+#include "DataFlash.h"
+#include "BatteryMon.h"
+#include "BatteryMac.h"
+#include "AlarmClock.h"
+#include "Display.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+#include "HostFrame.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of a restore frame: SYNC, LEN, ADDR, DATA, and CRC. */
+#define RX_FRAME_MAX		(2 + DF_CHUNK_SIZE + HOST_FRAME_OVERHEAD)
+
+    /*!@brief Size of a backup frame. */
+#define TX_FRAME_SIZE		(TLM_HDR_SIZE + 3 + DF_CHUNK_SIZE + TLM_CRC_SIZE)
+
+    /*!@brief Address of the final frame. */
+#define DF_ADDR_END		0xFFFF
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Transfer state. */
+typedef enum
+{
+    DF_IDLE,			//!< No transfer active
+    DF_BACKUP,			//!< Reading the data flash
+    DF_RESTORE,			//!< Writing the data flash
+    DF_STOPPING,		//!< Waiting for units still in progress
+} DF_STATE;
+
+    /*!@brief Transfer unit of one chunk. */
+typedef struct
+{
+    SMB_XACT	 XactData;	//!< Restore: block write of address and data
+    SMB_XACT	 XactAddr;	//!< Block write of the address
+    SMB_XACT	 XactRd;	//!< Block read of address and data
+    uint16_t	 Addr;		//!< Data flash address
+    uint8_t	 Cnt;		//!< Number of data bytes
+    uint8_t	 Retry;		//!< Number of repeated attempts
+    uint8_t	 DataBuf[3 + DF_CHUNK_SIZE];	//!< Count, address, and data
+    uint8_t	 AddrBuf[3];			//!< Count and address
+    uint8_t	 RdBuf[3 + DF_CHUNK_SIZE];	//!< Count, address, and data
+} DF_UNIT;
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Current transfer state. */
+static volatile DF_STATE l_State;
+
+    /*!@brief Transfer units, FIFO between <b>l_UnitHead</b> and <b>Tail</b>. */
+static DF_UNIT		 l_Unit[DF_PIPELINE];
+static int		 l_UnitHead, l_UnitTail, l_UnitCnt;
+
+    /*!@brief Backup: next address to read. */
+static uint16_t		 l_NextAddr;
+
+    /*!@brief Restore: last address which has been written. */
+static uint16_t		 l_LastAddr;
+
+    /*!@brief Restore: the PC has sent the final frame. */
+static bool		 l_flgEnd;
+
+    /*!@brief Restore: receiver and buffer for a frame. */
+static HOST_FRAME_RX	 l_Rx;
+static uint8_t		 l_RxBuf[RX_FRAME_MAX];
+
+    /*!@brief Restore: seconds without data from the PC. */
+static int		 l_IdleSeconds;
+
+    /*!@brief Statistics: bytes transferred, failed chunks, start time. */
+static uint32_t		 l_Bytes, l_Errors, l_StartTicks;
+
+    /*!@brief Restore: number of frames discarded due to a CRC error. */
+static uint32_t		 l_CrcErrors;
+
+    /*!@brief SMBus clock rate in [Hz] during the transfer. */
+static uint32_t		 l_SmbFreq;
+
+    /*!@brief Poll interval of the display before the transfer. */
+static int		 l_PrevPollRate;
+
+    /*!@brief Final status and direction of a transfer which is stopping. */
+static int		 l_StopStatus;
+static bool		 l_flgStopBackup;
+
+    /*!@brief Telemetry frame for chunks and results. */
+static TLM_FRAME	 l_Frame;
+
+/*=========================== Forward Declarations ===========================*/
+
+static int  DFlashStart (DF_STATE state, uint32_t smbFreq);
+static void DFlashStop (int status);
+static void StopCheck (void);
+static int  UnitSubmit (DF_UNIT *pUnit);
+static int  UnitStatus (DF_UNIT *pUnit);
+static void RestoreReceive (void);
+static void RestoreFrame (void);
+static void SendResult (uint16_t addr, int status, const uint8_t *pData,
+			int cnt);
+static uint32_t BytesPerSecond (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start Data Flash Backup
+ *
+ * @param[in] smbFreq
+ *	SMBus clock rate in [Hz] during the backup, or 0 for the default.
+ *
+ * @return
+ *	0 if the backup has been started, or a negative error code.
+ *
+ ******************************************************************************/
+int	DFlashBackup (uint32_t smbFreq)
+{
+    return DFlashStart (DF_BACKUP, smbFreq);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start Data Flash Restore
+ *
+ * From now on, the received data is interpreted as restore frames.
+ *
+ * @param[in] smbFreq
+ *	SMBus clock rate in [Hz] during the restore, or 0 for the default.
+ *
+ * @return
+ *	0 if the restore has been started, or a negative error code.
+ *
+ ******************************************************************************/
+int	DFlashRestore (uint32_t smbFreq)
+{
+    return DFlashStart (DF_RESTORE, smbFreq);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if a Transfer is active
+ *
+ ******************************************************************************/
+bool	DFlashIsActive (void)
+{
+    return (l_State != DF_IDLE);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read Data Flash
+ *
+ * Reads one chunk of the data flash, and waits for the result.  This is
+ * used by other modules, while no transfer is active.
+ *
+ * @param[in] addr
+ *	Data flash address.
+ *
+ * @param[out] pBuf
+ *	Address of a buffer where to store the data.
+ *
+ * @param[in] cnt
+ *	Number of bytes to read, up to @ref DF_CHUNK_SIZE.
+ *
+ * @return
+ *	Number of bytes read, or a negative error code, see BatteryMacRead().
+ *
+ ******************************************************************************/
+int	DFlashRead (uint16_t addr, uint8_t *pBuf, int cnt)
+{
+int	 status;
+
+
+    if (l_State != DF_IDLE  ||  cnt < 1  ||  cnt > DF_CHUNK_SIZE)
+	return i2cInvalidParameter;
+
+    /* The data flash address is used as MAC subcommand */
+    status = BatteryMacRead ((MAC_CMD) addr, pBuf, cnt);
+    if (status >= 0  &&  status < cnt)
+	status = i2cMacMismatch;	// response too short
+
+    return status;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Data Flash Check
+ *
+ * This function must be called from the main loop while a transfer is
+ * active.  It collects the completed chunks in address order, sends them,
+ * and queues the next ones.
+ *
+ ******************************************************************************/
+void	DFlashCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+DF_UNIT	*pUnit;
+char	 c;
+int	 status;
+
+
+    if (l_State == DF_IDLE)
+	return;
+
+    BatteryMonCheck();		// handle SMBus timeouts
+
+    if (l_State == DF_STOPPING)
+    {
+	StopCheck();
+	return;
+    }
+
+    if (l_State == DF_BACKUP)
+    {
+	if (drvLEUART_RxRead (&c, 1) > 0)
+	{
+	    DFlashStop (i2cTransferUsageFault);	// aborted by the user
+	    return;
+	}
+    }
+    else
+    {
+	RestoreReceive();
+    }
+
+    /* Collect completed units in address order */
+    while (l_UnitCnt > 0)
+    {
+	pUnit = &l_Unit[l_UnitTail];
+	if (pUnit->XactRd.Status == i2cTransferInProgress)
+	    break;			// not complete yet
+
+	status = UnitStatus (pUnit);
+	if (status != 0  &&  pUnit->Retry < DF_RETRY_CNT - 1)
+	{
+	    if (UnitSubmit (pUnit) == 0)
+		pUnit->Retry++;
+	    break;			// wait for the repeated attempt
+	}
+
+	if (l_State == DF_BACKUP  &&  drvLEUART_TxFree() < TX_FRAME_SIZE)
+	    break;			// wait until the LEUART has sent more
+
+	if (status == 0)
+	    l_Bytes += pUnit->Cnt;
+	else
+	    l_Errors++;
+
+	if (l_State == DF_BACKUP)
+	    SendResult (pUnit->Addr, status, pUnit->RdBuf + 3,
+			status == 0 ? pUnit->Cnt : 0);
+	else
+	    SendResult (pUnit->Addr, status, NULL, 0);
+
+	l_UnitTail = (l_UnitTail + 1) % DF_PIPELINE;
+	l_UnitCnt--;
+    }
+
+    /* Backup: queue the next chunks */
+    while (l_State == DF_BACKUP  &&  l_UnitCnt < DF_PIPELINE
+	   &&  l_NextAddr < DF_END_ADDR)
+    {
+	pUnit = &l_Unit[l_UnitHead];
+	pUnit->Addr  = l_NextAddr;
+	pUnit->Cnt   = DF_CHUNK_SIZE;
+	pUnit->Retry = 0;
+
+	if (UnitSubmit (pUnit) < 0)
+	    break;			// SMBus queue is full, try again later
+
+	l_UnitHead = (l_UnitHead + 1) % DF_PIPELINE;
+	l_UnitCnt++;
+	l_NextAddr += DF_CHUNK_SIZE;
+    }
+
+    /* Check for the end of the transfer */
+    if (l_UnitCnt == 0)
+    {
+	if ((l_State == DF_BACKUP  &&  l_NextAddr >= DF_END_ADDR)
+	||  (l_State == DF_RESTORE  &&  l_flgEnd))
+	{
+	    DFlashStop (l_Errors == 0 ? 0 : i2cVerifyFailed);
+	    return;
+	}
+    }
+
+    /* Show progress once per second */
+    if (prevSeconds != g_CurrDateTime.tm_sec)
+    {
+	prevSeconds = g_CurrDateTime.tm_sec;
+
+	DisplayText (2, "%3d%% %5lu B/s", (int)
+		     (((l_State == DF_BACKUP ? l_NextAddr : l_LastAddr)
+		       - DF_START_ADDR) * 100UL / (DF_END_ADDR - DF_START_ADDR)),
+		     BytesPerSecond());
+
+	if (l_State == DF_RESTORE  &&  ++l_IdleSeconds > DF_IDLE_TIMEOUT)
+	{
+	    DFlashStop (i2cTransferTimeout);
+	    return;
+	}
+    }
+
+    /*
+     * The SMBus and the LEUART Tx DMA interrupts wake us when a backup can
+     * continue.  The LEUART Rx wakes us for the next restore frame, or the
+     * rest of it.
+     */
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start a Transfer
+ *
+ * Sets the SMBus clock rate, stops the display poll, and starts the
+ * transfer.
+ *
+ ******************************************************************************/
+static int  DFlashStart (DF_STATE state, uint32_t smbFreq)
+{
+    if (l_State != DF_IDLE  ||  g_BatteryCtrlType != BCT_TI)
+	return i2cInvalidParameter;
+
+    l_SmbFreq = BatterySmbFreqSet (smbFreq);
+    if (l_SmbFreq == 0)
+	return i2cTransferNack;		// SMBus is busy
+
+    l_UnitHead = l_UnitTail = l_UnitCnt = 0;
+    l_NextAddr = l_LastAddr = DF_START_ADDR;
+    l_flgEnd = false;
+    l_IdleSeconds = 0;
+    l_Bytes = l_Errors = l_CrcErrors = 0;
+
+    /* The display must not read registers in between */
+    l_PrevPollRate = DisplayPollRateGet();
+    DisplayPollRateSet (0);
+
+    DisplayText (1, state == DF_BACKUP ? "DF Backup" : "DF Restore");
+    DisplayText (2, "");
+
+    if (state == DF_RESTORE)
+	HostFrameStart (&l_Rx, l_RxBuf, 2, 2 + DF_CHUNK_SIZE);
+
+    l_StartTicks = RTC->CNT;
+    l_State = state;
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop the Transfer
+ *
+ * Units which are still in progress, e.g. after an abort, own their
+ * buffers until the SMBus has completed them.  So the transfer enters
+ * @ref DF_STOPPING, and StopCheck() finishes it when the last unit is done.
+ *
+ ******************************************************************************/
+static void DFlashStop (int status)
+{
+    l_StopStatus = status;
+    l_flgStopBackup = (l_State == DF_BACKUP);
+    l_State = DF_STOPPING;
+
+    StopCheck();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop Check
+ *
+ * Discards the completed units.  When no unit is in progress any more, it
+ * sends the final frame and the statistics, and restores the SMBus clock
+ * rate and the display poll.  Otherwise the SMBus interrupt wakes up the
+ * main loop for the next call by DFlashCheck().
+ *
+ ******************************************************************************/
+static void StopCheck (void)
+{
+uint32_t ticks = (RTC->CNT - l_StartTicks) & 0x00FFFFFF;
+bool	 flgBackup = l_flgStopBackup;
+int	 status = l_StopStatus;
+
+
+    while (l_UnitCnt > 0)
+    {
+	if (l_Unit[l_UnitTail].XactRd.Status == i2cTransferInProgress)
+	    return;			// wait for the SMBus
+
+	l_UnitTail = (l_UnitTail + 1) % DF_PIPELINE;
+	l_UnitCnt--;
+    }
+
+    if (! flgBackup)
+	HostFrameStop (&l_Rx);
+
+    SendResult (DF_ADDR_END, status, NULL, 0);
+
+    ConsolePrintf ("DF %s %s: %lu bytes in %lu ms, %lu bytes/s at %lu Hz, "
+		   "%lu errors, %lu CRC errors\n",
+		   flgBackup ? "backup" : "restore",
+		   status == 0 ? "done" : "failed", l_Bytes,
+		   ticks * 1000UL / RTC_COUNTS_PER_SEC, BytesPerSecond(),
+		   l_SmbFreq, l_Errors, l_CrcErrors);
+
+    DisplayText (1, "DF %s %s", flgBackup ? "Backup" : "Restore",
+		 status == 0 ? "OK" : "ERR");
+    DisplayText (2, "%lu B/s %lukHz", BytesPerSecond(), l_SmbFreq / 1000);
+    DisplayNext (10, NULL, 0);
+
+    BatterySmbFreqSet (0);
+    DisplayPollRateSet (l_PrevPollRate);
+
+    l_State = DF_IDLE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Submit a Transfer Unit
+ *
+ * Queues the transactions of one chunk as unit: for the restore the write
+ * of the data, then the write of the address and the read of the data.
+ *
+ ******************************************************************************/
+static int  UnitSubmit (DF_UNIT *pUnit)
+{
+    pUnit->AddrBuf[0] = 2;
+    pUnit->AddrBuf[1] = (uint8_t) pUnit->Addr;
+    pUnit->AddrBuf[2] = (uint8_t)(pUnit->Addr >> 8);
+
+    memset (&pUnit->XactRd, 0, sizeof(pUnit->XactRd));
+    pUnit->XactRd.Cmd    = SBS_ManufacturerBlockAccess;
+    pUnit->XactRd.pBuf   = pUnit->RdBuf;
+    pUnit->XactRd.Cnt    = sizeof(pUnit->RdBuf);
+
+    memset (&pUnit->XactAddr, 0, sizeof(pUnit->XactAddr));
+    pUnit->XactAddr.Cmd    = SBS_ManufacturerBlockAccess;
+    pUnit->XactAddr.pWrBuf = pUnit->AddrBuf;
+    pUnit->XactAddr.WrCnt  = sizeof(pUnit->AddrBuf);
+    pUnit->XactAddr.pNext  = &pUnit->XactRd;
+
+    if (l_State == DF_BACKUP)
+	return BatteryXactSubmit (&pUnit->XactAddr);
+
+    /* Restore: DataBuf contains count, address, and data */
+    memset (&pUnit->XactData, 0, sizeof(pUnit->XactData));
+    pUnit->XactData.Cmd    = SBS_ManufacturerBlockAccess;
+    pUnit->XactData.pWrBuf = pUnit->DataBuf;
+    pUnit->XactData.WrCnt  = 3 + pUnit->Cnt;
+    pUnit->XactData.pNext  = &pUnit->XactAddr;
+
+    return BatteryXactSubmit (&pUnit->XactData);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Status of a completed Transfer Unit
+ *
+ * Checks the response of the read, and for the restore compares the data.
+ *
+ ******************************************************************************/
+static int  UnitStatus (DF_UNIT *pUnit)
+{
+    if (pUnit->XactRd.Status != i2cTransferDone)
+	return pUnit->XactRd.Status;
+
+    if (pUnit->RdBuf[0] < 2 + pUnit->Cnt
+    ||  pUnit->RdBuf[1] != pUnit->AddrBuf[1]
+    ||  pUnit->RdBuf[2] != pUnit->AddrBuf[2])
+	return i2cMacMismatch;
+
+    if (l_State == DF_RESTORE
+    &&  memcmp (pUnit->RdBuf + 3, pUnit->DataBuf + 3, pUnit->Cnt) != 0)
+	return i2cVerifyFailed;
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Receive Restore Data
+ *
+ * Receives restore frames, see HostFrameReceive().  Data is only taken
+ * from the LEUART while there is a free unit, so a complete frame can
+ * always be queued.
+ *
+ ******************************************************************************/
+static void RestoreReceive (void)
+{
+int	 status;
+
+
+    while (l_UnitCnt < DF_PIPELINE  &&  ! l_flgEnd
+	   &&  (status = HostFrameReceive (&l_Rx)) != HOST_FRAME_NONE)
+    {
+	l_IdleSeconds = 0;
+
+	if (status == HOST_FRAME_OK)
+	    RestoreFrame();
+	else
+	    l_CrcErrors++;		// discard, the PC will repeat it
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Process Restore Frame
+ *
+ * Checks the address range of a complete frame, and queues the chunk.  The
+ * CRC has already been checked by HostFrameReceive().
+ *
+ ******************************************************************************/
+static void RestoreFrame (void)
+{
+DF_UNIT	*pUnit;
+int	 len = l_RxBuf[1];		// length of ADDR and DATA
+uint16_t addr;
+
+
+    if (len == 2)
+    {
+	l_flgEnd = true;		// no data: end of restore
+	return;
+    }
+
+    addr = l_RxBuf[2] | (l_RxBuf[3] << 8);
+    if (addr < DF_START_ADDR  ||  addr + (len - 2) > DF_END_ADDR)
+    {
+	SendResult (addr, i2cInvalidParameter, NULL, 0);
+	return;
+    }
+
+    pUnit = &l_Unit[l_UnitHead];
+    pUnit->Addr  = addr;
+    pUnit->Cnt   = len - 2;
+    pUnit->Retry = 0;
+    pUnit->DataBuf[0] = (uint8_t) len;		// byte count of block write
+    memcpy (pUnit->DataBuf + 1, l_RxBuf + 2, len);
+
+    if (UnitSubmit (pUnit) < 0)
+    {
+	/* Mark unit as failed, it will be repeated by DFlashCheck() */
+	pUnit->XactRd.Status = i2cQueueFull;
+    }
+
+    l_UnitHead = (l_UnitHead + 1) % DF_PIPELINE;
+    l_UnitCnt++;
+    l_LastAddr = addr;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send Result Frame
+ *
+ ******************************************************************************/
+static void SendResult (uint16_t addr, int status, const uint8_t *pData,
+			int cnt)
+{
+uint8_t	 hdr[3];			// ADDR and STATUS
+
+
+    hdr[0] = (uint8_t) addr;
+    hdr[1] = (uint8_t)(addr >> 8);
+    hdr[2] = (uint8_t)(int8_t) status;
+
+    TlmFrameBegin (&l_Frame, TLM_TYPE_DFLASH);
+    TlmAddRaw (&l_Frame, hdr, sizeof(hdr));
+    if (cnt > 0)
+	TlmAddRaw (&l_Frame, pData, cnt);
+    TlmFrameSend (&l_Frame);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Achieved Bytes per Second
+ *
+ ******************************************************************************/
+static uint32_t BytesPerSecond (void)
+{
+uint32_t ticks = (RTC->CNT - l_StartTicks) & 0x00FFFFFF;
+
+
+    if (ticks == 0)
+	return 0;
+
+    return (uint32_t)((uint64_t) l_Bytes * RTC_COUNTS_PER_SEC / ticks);
+}
@@ -0,0 +1,59 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module DataFlash.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Removed DF_SYNC, see HOST_FRAME_SYNC.
+2026-10-18,agent	Added DFlashRead().
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_DataFlash_h
+#define __INC_DataFlash_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@name Data flash address range of the bq40z50 */
+//@{
+#define DF_START_ADDR		0x4000	//!< first address
+#define DF_END_ADDR		0x6000	//!< behind the last address
+//@}
+
+    /*!@brief Number of bytes transferred per MAC block. */
+#define DF_CHUNK_SIZE		32
+
+    /*!@brief Number of chunks in flight on the SMBus. */
+#ifndef DF_PIPELINE
+    #define DF_PIPELINE		4
+#endif
+
+    /*!@brief Number of attempts per chunk. */
+#define DF_RETRY_CNT		3
+
+    /*!@brief Restore mode ends after this time in [s] without data. */
+#define DF_IDLE_TIMEOUT		30
+
+    /*!@brief Error code if the verify after write failed, additionally to
+     * @ref I2C_TransferReturn_TypeDef
+     */
+#define i2cVerifyFailed		-14
+
+/*================================ Prototypes ================================*/
+
+int	DFlashBackup  (uint32_t smbFreq);
+int	DFlashRestore (uint32_t smbFreq);
+bool	DFlashIsActive (void);
+int	DFlashRead (uint16_t addr, uint8_t *pBuf, int cnt);
+void	DFlashCheck (void);
+
+
+#endif /* __INC_DataFlash_h */
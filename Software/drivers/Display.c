@@ -2,7 +2,7 @@
  * @file
  * @brief	Display Manager
  * @author	Ralf Gerhauser
- * @version	2020-01-13
+ * @version	2026-10-18
  *
  * This is the Display Manager module.  It controls all the information on
  * the LC-Display.  The keys <b>NEXT</b> and <b>PREV</b> are used to select the
@@ -17,6 +17,21 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Hidden items, see ITEM_IS_HIDDEN(), are skipped by the
+		keys. Added DisplayShowItem() and format type FRMT_EM_PROFILE.
+2026-10-18,agent	Added DisplayAutoPowerOff() to inhibit the power-off
+		after POWER_OFF_TIMEOUT, e.g. in the monitor mode.
+2026-10-18,agent	Power-off: SupplyPowerOff() completes the SMBus
+		transactions, the log, and the LEUART output before the FET is
+		released.
+2026-10-18,agent	ItemDataString() uses BatteryRegReadShared(), so the
+		display poll and the watch list do not read the same register
+		twice.
+2026-10-18,agent	In binary telemetry mode, the raw data of the displayed
+		item is sent as TLM_TYPE_SAMPLE frame, see module Telemetry.c.
+2026-10-18,agent	The interval to read the item data is configurable now,
+		see DisplayPollRateSet().  ItemDataString() is public, so the
+		console can use it for the snapshot dump.
 2020-01-13,rage PowerUp() must be called to set Port Pin D0 and enable FET T1.
 		Added flags to initiate power-off and probing of the battery
 		controller type.
@@ -46,6 +61,9 @@ Revision History:
 #include "Display.h"
 #include "LCD_DOGM162.h"
 #include "BatteryMon.h"
+#include "Telemetry.h"
+#include "Supply.h"
+#include "Profile.h"
 
 /*=============================== Definitions ================================*/
 
@@ -112,10 +130,16 @@ static DISP_NEXT_FCT	 l_DispNextFct;
     /*!@brief User parameter for function @ref l_DispNextFct. */
 static int		 l_DispNextUserParm;
 
+    /*!@brief Interval in [s] to read the item data, 0 to disable. */
+static volatile int	 l_PollInterval = 1;
+
+    /*!@brief Flag if the device is powered off after @ref POWER_OFF_TIMEOUT.
+     */
+static volatile bool	 l_flgAutoPowerOff = true;
+
 /*=========================== Forward Declarations ===========================*/
 
 static void  DisplayUpdate (void);
-static char *ItemDataString (const ITEM *pItem);
 static void  DisplayUpdateClock (void);
 static void  SwitchLCD_Off(TIM_HDL hdl);
 static void  SwitchDeviceOff(TIM_HDL hdl);
@@ -251,7 +275,8 @@ int	bitMaskCtrlType;
 	    {
 		if (++l_ItemIdx >= l_ItemCnt)
 		    l_ItemIdx = 0;	// wrap around
-	    } while ((l_pItemList[l_ItemIdx].Cmd & bitMaskCtrlType) == 0);
+	    } while ((l_pItemList[l_ItemIdx].Cmd & bitMaskCtrlType) == 0
+		  ||  ITEM_IS_HIDDEN(&l_pItemList[l_ItemIdx]));
 
 	    break;
 
@@ -267,7 +292,8 @@ int	bitMaskCtrlType;
 	    {
 		if (--l_ItemIdx < 0)
 		    l_ItemIdx = l_ItemCnt-1; // wrap around
-	    } while ((l_pItemList[l_ItemIdx].Cmd & bitMaskCtrlType) == 0);
+	    } while ((l_pItemList[l_ItemIdx].Cmd & bitMaskCtrlType) == 0
+		  ||  ITEM_IS_HIDDEN(&l_pItemList[l_ItemIdx]));
 
 	    break;
 
@@ -278,7 +304,7 @@ int	bitMaskCtrlType;
 	    if (l_hdlLCD_Off != NONE)
 		sTimerStart (l_hdlLCD_Off, LCD_POWER_OFF_TIMEOUT);
 
-	    if (l_hdlPowerOff != NONE)
+	    if (l_hdlPowerOff != NONE  &&  l_flgAutoPowerOff)
 		sTimerStart (l_hdlPowerOff, POWER_OFF_TIMEOUT);
 
 	    return;
@@ -330,6 +356,24 @@ void	DisplaySelectItem (int index)
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Show Item
+ *
+ * Like DisplaySelectItem(), but the LCD is switched off again after @ref
+ * LCD_POWER_OFF_TIMEOUT seconds, as if the item had been selected by the
+ * keys.  This is the way to show a hidden item, see ITEM_IS_HIDDEN().
+ *
+ ******************************************************************************/
+void	DisplayShowItem (int index)
+{
+    DisplaySelectItem (index);
+
+    if (l_hdlLCD_Off != NONE)
+	sTimerStart (l_hdlLCD_Off, LCD_POWER_OFF_TIMEOUT);
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Display Update Check
@@ -348,6 +392,7 @@ void	DisplaySelectItem (int index)
 void	DisplayUpdateCheck (void)
 {
 static int  prevSeconds;
+static int  pollSeconds;
 static bool flgPowerOffActive;
 
 
@@ -363,7 +408,8 @@ static bool flgPowerOffActive;
 	    DisplayText (1, "P O W E R  O F F");
 	    DisplayText (2, "");
 
-	    ConsolePrintf ("HRDevice is switched OFF now\n\n");
+	    ConsolePrintf ("HRDevice is switched OFF now\n");
+	    SupplyPowerOff();		// bounded by SUPPLY_OFF_DEADLINE
 	    SET_POWER_PIN(0);		// set FET input to LOW
 	}
 	return;		// INHIBIT ALL OTHER ACTIONS
@@ -389,12 +435,16 @@ static bool flgPowerOffActive;
 	BatteryCtrlProbe();
     }
 
-    /* If one second is over, we need to update measurements */
+    /* If the poll interval is over, we need to update measurements */
     if (prevSeconds != g_CurrDateTime.tm_sec)
     {
 	prevSeconds = g_CurrDateTime.tm_sec;
 
-	DisplayUpdateTrigger (LCD_ITEM_DATA);
+	if (l_PollInterval > 0  &&  ++pollSeconds >= l_PollInterval)
+	{
+	    pollSeconds = 0;
+	    DisplayUpdateTrigger (LCD_ITEM_DATA);
+	}
     }
 
     /*
@@ -453,6 +503,72 @@ static bool flgPowerOffActive;
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Set Poll Rate
+ *
+ * This function sets the interval, the data of the currently displayed item
+ * is read from the battery controller.  The default is every second.
+ *
+ * @param[in] seconds
+ *	Interval in seconds, 0 disables polling.
+ *
+ ******************************************************************************/
+void	DisplayPollRateSet (int seconds)
+{
+    if (seconds < 0)
+	seconds = 0;
+
+    l_PollInterval = seconds;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get Poll Rate
+ *
+ * Returns the interval in seconds, see DisplayPollRateSet().
+ *
+ ******************************************************************************/
+int	DisplayPollRateGet (void)
+{
+    return l_PollInterval;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enable or disable Auto Power-Off
+ *
+ * By default, the whole device is switched off if no key has been asserted
+ * for @ref POWER_OFF_TIMEOUT seconds.  When disabled, the timer is cancelled
+ * and the LCD is switched off immediately.  A key still switches the LCD on
+ * for @ref LCD_POWER_OFF_TIMEOUT seconds, but does not restart the power-off
+ * timer.  Switching the device off via the POWER key is always possible.
+ *
+ * @param[in] enable
+ *	true to restart the power-off timer, false to inhibit it.
+ *
+ ******************************************************************************/
+void	DisplayAutoPowerOff (bool enable)
+{
+    l_flgAutoPowerOff = enable;
+
+    if (l_hdlPowerOff == NONE)
+	return;
+
+    if (enable)
+    {
+	sTimerStart (l_hdlPowerOff, POWER_OFF_TIMEOUT);
+    }
+    else
+    {
+	sTimerCancel (l_hdlPowerOff);
+	l_bitMaskFieldActive = 0;	// LCD off with the next update check
+    }
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Display Update
@@ -464,6 +580,7 @@ static bool flgPowerOffActive;
  ******************************************************************************/
 static void DisplayUpdate (void)
 {
+static TLM_FRAME sample;	// binary telemetry frame
 LCD_FIELD_ID	 id;
 const char	*pStr;
 
@@ -495,7 +612,20 @@ const char	*pStr;
 		break;
 
 	    case LCD_ITEM_DATA:		// display item register data
-		pStr = ItemDataString(&l_pItemList[l_ItemIdx]);
+		if (TlmModeGet() == TLM_MODE_BINARY)
+		{
+		    /* Capture raw data and send it as binary frame */
+		    TlmFrameBegin (&sample, TLM_TYPE_SAMPLE);
+		    TlmCapture (&sample);
+		    pStr = ItemDataString(&l_pItemList[l_ItemIdx]);
+		    TlmCapture (NULL);
+		    TlmFrameSend (&sample);
+		}
+		else
+		{
+		    pStr = ItemDataString(&l_pItemList[l_ItemIdx]);
+		}
+
 		if (pStr != NULL)
 		{
 		    if (l_pItemList[l_ItemIdx].Cmd != SBS_NONE)
@@ -531,8 +661,9 @@ const char	*pStr;
  * @brief	Item Data String
  *
  * This routine returns a formatted data string of the specified item data.
- * It uses BatteryRegReadWord() and BatteryRegReadBlock() to read the data
- * directly from the battery controller.
+ * It uses BatteryRegReadShared() and BatteryRegReadBlock() to read the data
+ * directly from the battery controller.  The raw data is also passed to
+ * TlmCaptureValue() or TlmCaptureBlock() for binary telemetry.
  *
  * @param[in] pItem
  *	Address of structure specifies the item that should be used.
@@ -547,7 +678,7 @@ const char	*pStr;
  *	application)!
  *
  ******************************************************************************/
-static char	*ItemDataString (const ITEM *pItem)
+char	*ItemDataString (const ITEM *pItem)
 {
 static char	 strBuf[120];	// static buffer to return string into
 uint8_t		 dataBuf[40];	// buffer for I2C data, read from the controller
@@ -579,14 +710,19 @@ int		 d, h, m;	// FRMT_DURATION: days, hours, minutes
 
 	    if (BatteryRegReadBlock (cmd, dataBuf, data) < 0)
 		return NULL;	// READ ERROR
+
+	    /* First byte contains the number of valid bytes */
+	    TlmCaptureBlock (SBS_CMD_ADDR(cmd), dataBuf + 1,
+			     dataBuf[0] < data ? dataBuf[0] : data - 1);
 	}
 	else
 	{
 	    /* Read data word - may be 1, 2, 3, or 4 bytes long */
-	    if (BatteryRegReadValue (cmd, &value) < 0)
+	    if (BatteryRegReadShared (cmd, &value) < 0)
 		return NULL;	// READ ERROR
 
 	    data = (int)value;
+	    TlmCaptureValue (SBS_CMD_ADDR(cmd), value);
 	}
     }
 
@@ -603,10 +739,12 @@ int		 d, h, m;	// FRMT_DURATION: days, hours, minutes
 	    else
 		sprintf (strBuf, "0x%02X: %s", g_BatteryCtrlAddr,
 			 g_BatteryCtrlName);
+	    TlmCaptureValue (TLM_ID_BAT_CTRL, g_BatteryCtrlAddr);
 	    break;
 
 	case FRMT_CR2032_BAT:	// Voltage of local CR2032 supply battery
 	    data = ReadVdd();
+	    TlmCaptureValue (TLM_ID_CR2032, data);
 	    sprintf (strBuf, "CR2032: %d.%03dV", data / 1000, data % 1000);
 	    break;
 
@@ -719,6 +857,21 @@ int		 d, h, m;	// FRMT_DURATION: days, hours, minutes
 	    }
           break;
 
+	case FRMT_EM_PROFILE:	// Charge of EM0/1/2 in 0.1[uAh]
+	    {
+	    PROF_STATS stats;
+
+	    ProfileStats (&stats);
+	    sprintf (strBuf, "%lu.%lu/%lu.%lu/%lu.%lu",
+		     (unsigned long) stats.ChargeNAh[PROF_EM0] / 1000,
+		     (unsigned long) stats.ChargeNAh[PROF_EM0] / 100 % 10,
+		     (unsigned long) stats.ChargeNAh[PROF_EM1] / 1000,
+		     (unsigned long) stats.ChargeNAh[PROF_EM1] / 100 % 10,
+		     (unsigned long) stats.ChargeNAh[PROF_EM2] / 1000,
+		     (unsigned long) stats.ChargeNAh[PROF_EM2] / 100 % 10);
+	    }
+	    break;
+
 	default:		// unsupported format
 	    return NULL;
 
@@ -2,9 +2,14 @@
  * @file
  * @brief	Header file of module Display.c
  * @author	Ralf Gerhauser
- * @version	2020-01-13
+ * @version	2026-10-18
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added enum FRMT_EM_PROFILE, macro ITEM_IS_HIDDEN(), and
+		the prototype for DisplayShowItem().
+2026-10-18,agent	Added prototype for DisplayAutoPowerOff().
+2026-10-18,agent	Added prototypes for DisplayPollRateSet(),
+		DisplayPollRateGet(), and ItemDataString().
 2020-01-13,rage	Added enums FRMT_BAT_CTRL and FRMT_HEXDUMP, and prototypes for
 		PowerUp() and DisplaySelectItem().
 2016-11-22,rage	Defined separate format types for Overcurrent and Highcurrent
@@ -131,6 +136,7 @@ typedef enum
     FRMT_MICROOHM,	//!< 15: Resistance in [uOhm]
     FRMT_DATE,		//!< 16: Date [15:9=Year|8:5=Month|4:0=Day]
     FRMT_TEMP,		//!< 17: U2 Temperature [0.1°K]
+    FRMT_EM_PROFILE,	//!< 18: Charge of EM0/1/2 in [uAh], see Profile.c
     FRMT_TYPE_CNT	//!< Format Type Count
 } FRMT_TYPE;
 
@@ -145,6 +151,11 @@ typedef struct
     FRMT_TYPE	 Frmt;		//!< Format to use for value representation
 } ITEM;
 
+    /*!@brief Hidden items are skipped by the keys and the snapshot dump, they
+     * can only be selected via DisplayShowItem().
+     */
+#define ITEM_IS_HIDDEN(pItem)	((pItem)->Frmt == FRMT_EM_PROFILE)
+
 /*================================ Prototypes ================================*/
 
 void	PowerUp (void);
@@ -155,6 +166,11 @@ void	DisplayUpdateCheck (void);
 void	DisplayUpdateTrigger (LCD_FIELD_ID fieldID);
 void	DisplayText (int lineNum, const char *frmt, ...);
 void	DisplayNext (unsigned int duration, DISP_NEXT_FCT fct, int userParm);
+void	DisplayPollRateSet (int seconds);
+int	DisplayPollRateGet (void);
+void	DisplayAutoPowerOff (bool enable);
+void	DisplayShowItem (int index);
+char   *ItemDataString (const ITEM *pItem);
 
 
 #endif /* __INC_Display_h */
@@ -0,0 +1,483 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Resumable Download of the Session Log
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module sends the flash image of the session log to a PC, see Log.c.
+ * At 9600 bd this takes about 40 seconds, so the transfer must survive lost
+ * or damaged bytes without starting over.  The image is divided into @ref
+ * DL_BLOCK_CNT blocks of @ref DL_BLOCK_SIZE bytes.  Each block is sent with
+ * its number and a CRC-32, and must be acknowledged by the PC.  The block
+ * data is copied directly from the flash into the LEUART FIFO, see
+ * TlmFrameSendDirect(), so no RAM is needed for it.
+ *
+ * The console command "download [first [count]]" starts the transfer with
+ * block <i>first</i>.  A PC which has lost the connection resumes with the
+ * first block it is missing.  All frames to the PC are @ref
+ * TLM_TYPE_DOWNLOAD frames, their payload starts with a kind byte:
+ * <pre>
+ *   'H'  BLOCK_SIZE[2]  BLOCK_CNT[2]  FIRST[2]  END[2]  HEAD[2]  NEXT_SEQ[4]
+ *   'D'  BLOCK[2]  CRC32[4]  DATA[BLOCK_SIZE]
+ *   'E'  STATUS  SENT[2]  REPEATED[2]
+ * </pre>
+ * The header 'H' is sent first.  <b>HEAD</b> is the head page, and
+ * <b>NEXT_SEQ</b> the sequence number of the next record of the log, so a
+ * PC which resumes can see if the log has been written meanwhile, and which
+ * pages have changed.  Records are still written during the download, the
+ * staged ones are flushed at the start.  The end frame 'E' contains the
+ * status, and the number of blocks sent and repeated.
+ *
+ * The PC acknowledges the blocks with frames in the same framing as the
+ * bridge requests, see HostFrame.c:
+ * <pre>
+ *   SYNC  LEN  CMD  BLOCK[2]  MASK[4]  CRC[2]
+ * </pre>
+ * - CMD 'A' acknowledges all blocks below <b>BLOCK</b>, and block
+ *   BLOCK + 1 + n if bit n of <b>MASK</b> is set.
+ * - CMD 'X' aborts the download.
+ *
+ * Up to @ref DL_WINDOW blocks are sent ahead of the oldest unacknowledged
+ * one, so the line is kept busy while the acknowledgements travel back.  A
+ * serial line does not reorder data, so a block below the highest one
+ * acknowledged, which is still missing, has been lost or damaged.  It is
+ * repeated at once, i.e. only the lost blocks are sent again (selective
+ * repeat).  If no acknowledgement arrives for @ref DL_ACK_TIMEOUT seconds,
+ * all unacknowledged blocks are repeated.  The download is aborted after
+ * @ref DL_IDLE_TIMEOUT seconds without any frame from the PC.
+ *
+ * The host side is implemented in tools/log_download.py.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Host frames are received by HostFrame.c, the receive
+		interrupt wakes up the main loop for the rest of a frame.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "Download.h"
+#include "AlarmClock.h"
+#include "Display.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+#include "HostFrame.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of the data of a host frame: CMD, BLOCK, and MASK. */
+#define RX_DATA_SIZE		7
+
+    /*!@brief Size of a block frame. */
+#define TX_FRAME_SIZE		(TLM_HDR_SIZE + 7 + DL_BLOCK_SIZE + TLM_CRC_SIZE)
+
+    /*!@brief Address of a block. */
+#define BLOCK_ADDR(block)	(LOG_START_ADDR + (uint32_t)(block) * DL_BLOCK_SIZE)
+
+    /*!@brief Bit mask of the blocks from l_Base to l_Next. */
+#define SENT_MASK		(l_Next - l_Base >= 32 ? 0xFFFFFFFF	\
+				 : (1UL << (l_Next - l_Base)) - 1)
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Flag if a download is active. */
+static bool		 l_flgActive;
+
+    /*!@brief Range of blocks, the first one and behind the last one. */
+static uint16_t		 l_First, l_End;
+
+    /*!@brief Oldest block not acknowledged, and next block never sent. */
+static uint16_t		 l_Base, l_Next;
+
+    /*!@brief Bit masks of the blocks from l_Base on: acknowledged, to be
+     * repeated, and repeated but not acknowledged yet.
+     */
+static uint32_t		 l_Acked, l_Resend, l_Repeated;
+
+    /*!@brief Seconds without acknowledgement, and without any host frame. */
+static int		 l_AckSeconds, l_IdleSeconds;
+
+    /*!@brief Receiver and buffer for a host frame. */
+static HOST_FRAME_RX	 l_Rx;
+static uint8_t		 l_RxBuf[RX_DATA_SIZE + HOST_FRAME_OVERHEAD];
+
+    /*!@brief Statistics: blocks sent, repeated, host frames with CRC error,
+     * and start time.
+     */
+static uint32_t		 l_Sent, l_Repeats, l_CrcErrors, l_StartTicks;
+
+    /*!@brief CRC-32 table, one entry per nibble. */
+static const uint32_t	 l_CRC32_Tab[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/*=========================== Forward Declarations ===========================*/
+
+static void DownloadStop (int status);
+static void HostReceive (void);
+static void HostCommand (void);
+static bool BlockSend (uint16_t block);
+static uint32_t CRC32 (const uint8_t *pData, int cnt);
+static uint32_t BytesPerSecond (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start Download
+ *
+ * Flushes the log, sends the header frame, and starts to send the blocks.
+ * From now on, the received data is interpreted as host frames.
+ *
+ * @param[in] first
+ *	First block to send.
+ *
+ * @param[in] cnt
+ *	Number of blocks, 0 for all up to the end of the log.
+ *
+ * @return
+ *	0 if the download has been started, or a negative error code.
+ *
+ ******************************************************************************/
+int	DownloadStart (int first, int cnt)
+{
+LOG_STATS stats;
+uint8_t	 hdr[1 + 10 + 4];
+
+
+    if (l_flgActive)
+	return logBusy;
+
+    if (cnt == 0)
+	cnt = DL_BLOCK_CNT - first;
+
+    if (first < 0  ||  cnt <= 0  ||  first + cnt > DL_BLOCK_CNT)
+	return logInvalidParameter;
+
+    LogFlush();
+    LogStats (&stats);
+
+    l_First = l_Base = l_Next = first;
+    l_End = first + cnt;
+    l_Acked = l_Resend = l_Repeated = 0;
+    l_AckSeconds = l_IdleSeconds = 0;
+    l_Sent = l_Repeats = l_CrcErrors = 0;
+
+    hdr[0] = 'H';
+    hdr[1] = (uint8_t) DL_BLOCK_SIZE;
+    hdr[2] = (uint8_t)(DL_BLOCK_SIZE >> 8);
+    hdr[3] = (uint8_t) DL_BLOCK_CNT;
+    hdr[4] = (uint8_t)(DL_BLOCK_CNT >> 8);
+    hdr[5] = (uint8_t) l_First;
+    hdr[6] = (uint8_t)(l_First >> 8);
+    hdr[7] = (uint8_t) l_End;
+    hdr[8] = (uint8_t)(l_End >> 8);
+    hdr[9] = (uint8_t) stats.HeadPage;
+    hdr[10] = (uint8_t)(stats.HeadPage >> 8);
+    memcpy (hdr + 11, &stats.NextSeq, 4);
+    TlmFrameSendDirect (TLM_TYPE_DOWNLOAD, hdr, sizeof(hdr), NULL, 0);
+
+    DisplayText (1, "Log Download");
+    DisplayText (2, "");
+
+    HostFrameStart (&l_Rx, l_RxBuf, RX_DATA_SIZE, RX_DATA_SIZE);
+
+    l_StartTicks = RTC->CNT;
+    l_flgActive = true;
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if a Download is active
+ *
+ ******************************************************************************/
+bool	DownloadIsActive (void)
+{
+    return l_flgActive;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Download Check
+ *
+ * This function must be called from the main loop while a download is
+ * active.  It processes the acknowledgements of the PC, and sends repeated
+ * and new blocks as long as there is room in the LEUART FIFO.
+ *
+ ******************************************************************************/
+void	DownloadCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+int	 i;
+
+
+    if (! l_flgActive)
+	return;
+
+    HostReceive();
+    if (! l_flgActive)
+	return;				// aborted by the PC
+
+    if (l_Base >= l_End)
+    {
+	DownloadStop (0);
+	return;
+    }
+
+    /* Repeated blocks first, then new ones within the window */
+    while (drvLEUART_TxFree() >= TX_FRAME_SIZE)
+    {
+	if (l_Resend != 0)
+	{
+	    for (i = 0;  (l_Resend & (1UL << i)) == 0;  i++)
+		;
+	    if (! BlockSend (l_Base + i))
+		break;
+	    l_Resend &= ~(1UL << i);
+	    l_Repeats++;
+	}
+	else if (l_Next < l_End  &&  l_Next - l_Base < DL_WINDOW)
+	{
+	    if (! BlockSend (l_Next))
+		break;
+	    l_Next++;
+	}
+	else
+	{
+	    break;
+	}
+    }
+
+    /* Timeouts and progress once per second */
+    if (prevSeconds != g_CurrDateTime.tm_sec)
+    {
+	prevSeconds = g_CurrDateTime.tm_sec;
+
+	DisplayText (2, "%3d%% %5lu B/s",
+		     (int)((l_Base - l_First) * 100UL / (l_End - l_First)),
+		     BytesPerSecond());
+
+	if (++l_IdleSeconds > DL_IDLE_TIMEOUT)
+	{
+	    DownloadStop (logTimeout);
+	    return;
+	}
+
+	if (++l_AckSeconds > DL_ACK_TIMEOUT  &&  l_Next > l_Base)
+	{
+	    /* Repeat all blocks which have not been acknowledged */
+	    l_Resend = l_Repeated = ~l_Acked & SENT_MASK;
+	    l_AckSeconds = 0;
+	}
+    }
+
+    /*
+     * The LEUART Tx DMA interrupt wakes us when there is space for the next
+     * block.  The LEUART Rx wakes us for the next host frame, or the rest
+     * of it.
+     */
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop the Download
+ *
+ * Sends the end frame and the statistics.
+ *
+ ******************************************************************************/
+static void DownloadStop (int status)
+{
+uint32_t ticks = (RTC->CNT - l_StartTicks) & 0x00FFFFFF;
+uint8_t	 end[1 + 1 + 4];
+
+
+    HostFrameStop (&l_Rx);
+
+    end[0] = 'E';
+    end[1] = (uint8_t)(int8_t) status;
+    end[2] = (uint8_t) l_Sent;
+    end[3] = (uint8_t)(l_Sent >> 8);
+    end[4] = (uint8_t) l_Repeats;
+    end[5] = (uint8_t)(l_Repeats >> 8);
+    TlmFrameSendDirect (TLM_TYPE_DOWNLOAD, end, sizeof(end), NULL, 0);
+
+    ConsolePrintf ("Download %s: %lu bytes in %lu ms, %lu bytes/s, "
+		   "%lu blocks repeated, %lu CRC errors\n",
+		   status == 0 ? "done" : "failed",
+		   (unsigned long)(l_Base - l_First) * DL_BLOCK_SIZE,
+		   ticks * 1000UL / RTC_COUNTS_PER_SEC, BytesPerSecond(),
+		   l_Repeats, l_CrcErrors);
+
+    DisplayText (1, "Download %s", status == 0 ? "OK" : "ERR");
+    DisplayText (2, "%lu B/s", BytesPerSecond());
+    DisplayNext (10, NULL, 0);
+
+    l_flgActive = false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Receive Host Frames
+ *
+ * Receives the host frames, see HostFrameReceive(), and processes them.
+ *
+ ******************************************************************************/
+static void HostReceive (void)
+{
+int	 status;
+
+
+    while (l_flgActive
+	   &&  (status = HostFrameReceive (&l_Rx)) != HOST_FRAME_NONE)
+    {
+	if (status == HOST_FRAME_OK)
+	    HostCommand();
+	else
+	    l_CrcErrors++;		// discard, the PC will repeat it
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Process Host Frame
+ *
+ * Marks the blocks acknowledged by a complete frame, its CRC has already
+ * been checked by HostFrameReceive().  Blocks which are missing below the
+ * highest acknowledged one are repeated.
+ *
+ ******************************************************************************/
+static void HostCommand (void)
+{
+uint16_t block;
+uint32_t mask, acked;
+int	 i;
+
+
+    l_IdleSeconds = 0;
+
+    if (l_RxBuf[2] == 'X')
+    {
+	DownloadStop (logAborted);
+	return;
+    }
+
+    block = l_RxBuf[3] | (l_RxBuf[4] << 8);
+    memcpy (&mask, l_RxBuf + 5, 4);
+
+    if (l_RxBuf[2] != 'A'  ||  block < l_Base  ||  block > l_Next)
+	return;				// unknown, or an old acknowledgement
+
+    /* Move the window */
+    if (block > l_Base)
+    {
+	i = block - l_Base;
+	l_Acked    = (i >= 32 ? 0 : l_Acked >> i);
+	l_Resend   = (i >= 32 ? 0 : l_Resend >> i);
+	l_Repeated = (i >= 32 ? 0 : l_Repeated >> i);
+	l_Base = block;
+	l_AckSeconds = 0;
+    }
+
+    /* Bit 0 is l_Base itself, which is not acknowledged */
+    acked = (mask << 1) & SENT_MASK & ~l_Acked;
+    if (acked == 0)
+	return;				// no progress, e.g. a repeated frame
+
+    l_Acked |= acked;
+    l_AckSeconds = 0;
+
+    /* Blocks below the highest acknowledged one have been lost */
+    for (i = 31;  (l_Acked & (1UL << i)) == 0;  i--)
+	;
+    mask = ~l_Acked & ~l_Repeated & ((1UL << i) - 1);
+    l_Resend   |= mask;
+    l_Repeated |= mask;
+    l_Resend   &= ~l_Acked;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send Block
+ *
+ * Sends a block directly from the flash.
+ *
+ * @return
+ *	true if the block has been sent, false if the LEUART FIFO is full.
+ *
+ ******************************************************************************/
+static bool BlockSend (uint16_t block)
+{
+const uint8_t *pData = (const uint8_t *) BLOCK_ADDR(block);
+uint32_t crc = CRC32 (pData, DL_BLOCK_SIZE);
+uint8_t	 hdr[1 + 2 + 4];
+
+
+    hdr[0] = 'D';
+    hdr[1] = (uint8_t) block;
+    hdr[2] = (uint8_t)(block >> 8);
+    memcpy (hdr + 3, &crc, 4);
+
+    if (! TlmFrameSendDirect (TLM_TYPE_DOWNLOAD, hdr, sizeof(hdr),
+			      pData, DL_BLOCK_SIZE))
+	return false;
+
+    l_Sent++;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	CRC-32
+ *
+ * Calculates the CRC-32 as used by Ethernet and zip, i.e. the reflected
+ * polynomial 0xEDB88320, initial value and final XOR 0xFFFFFFFF.
+ *
+ ******************************************************************************/
+static uint32_t CRC32 (const uint8_t *pData, int cnt)
+{
+uint32_t crc = 0xFFFFFFFF;
+
+
+    while (cnt-- > 0)
+    {
+	crc ^= *pData++;
+	crc = (crc >> 4) ^ l_CRC32_Tab[crc & 0x0F];
+	crc = (crc >> 4) ^ l_CRC32_Tab[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Achieved Bytes per Second
+ *
+ ******************************************************************************/
+static uint32_t BytesPerSecond (void)
+{
+uint32_t ticks = (RTC->CNT - l_StartTicks) & 0x00FFFFFF;
+
+
+    if (ticks == 0)
+	return 0;
+
+    return (uint32_t)((uint64_t)(l_Base - l_First) * DL_BLOCK_SIZE
+		      * RTC_COUNTS_PER_SEC / ticks);
+}
@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Download.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Removed DL_SYNC, see HOST_FRAME_SYNC.
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Download_h
+#define __INC_Download_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "Log.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Number of bytes per block, a page holds a whole number of them. */
+#define DL_BLOCK_SIZE		128
+
+    /*!@brief Number of blocks of the log. */
+#define DL_BLOCK_CNT		(LOG_SIZE / DL_BLOCK_SIZE)
+
+    /*!@brief Number of blocks which may be sent without acknowledgement,
+     * up to 32.  It must cover the round trip time to the host, at 9600 bd
+     * a block takes about 165ms.
+     */
+#ifndef DL_WINDOW
+    #define DL_WINDOW		16
+#endif
+
+    /*!@brief Unacknowledged blocks are repeated after this time in [s]. */
+#define DL_ACK_TIMEOUT		2
+
+    /*!@brief The download is aborted after this time in [s] without a frame
+     * from the host.
+     */
+#define DL_IDLE_TIMEOUT		30
+
+    /*!@name Error codes, additionally to the codes of Log.h */
+//@{
+#define logTimeout		-14	//!< no frame from the host
+#define logAborted		-15	//!< download aborted by the host
+//@}
+
+/*================================ Prototypes ================================*/
+
+int	DownloadStart (int first, int cnt);
+bool	DownloadIsActive (void);
+void	DownloadCheck (void);
+
+
+#endif /* __INC_Download_h */
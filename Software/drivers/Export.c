@@ -0,0 +1,989 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Encrypted and Authenticated Export
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module exports pack data, e.g. the data flash image of the battery
+ * controller or the session log, in a form which can be handed to customers
+ * and auditors: the data is encrypted, and any modification is detected by
+ * the verifier tools/export_verify.py.
+ *
+ * The data is protected with AES-128 in SIV mode (synthetic IV):
+ * - The MAC is an AES-CMAC with key K2 over the header and the plaintext.
+ * - The data is encrypted in CTR mode with key K1, the initial counter is
+ *   the MAC with bit 31 of the last word cleared.
+ *
+ * The MAC doubles as nonce, so no counter or random number has to be kept
+ * across resets.  This requires two passes over the data: the first one
+ * calculates the MAC, the second one encrypts and sends the data.  The data
+ * must not change in between, so the session log is held during its export,
+ * see LogHold().  The data flash may still be changed by the controller, so
+ * the second pass calculates the MAC again.  If it differs, the export ends
+ * with @ref i2cSourceChanged instead of an export the verifier would reject
+ * as modified.
+ *
+ * Both passes use the AES hardware via emlib.  A software implementation
+ * of AES-128 is used instead if requested, so the throughput of both can be
+ * compared, see ExportBenchmark().  The benchmark runs in the background,
+ * one chunk per call of ExportCheck(), like an export.
+ *
+ * The CPU writes the AES data registers, DMA is not used for them.  Each
+ * chunk is processed in one call of ExportCheck(), and the next step needs
+ * the result, i.e. the CBC chaining value of the CMAC or the encrypted data
+ * to send.  So the CPU would wait for the DMA anyway, and the AES would need
+ * further DMA channels beside those of the LEUART, see config.h.
+ *
+ * The 32-byte header contains:
+ * <pre>
+ *   "HRDX"  VERSION  SOURCE  0  0  LENGTH[4]  TIME[4]  UID[8]  0[8]
+ * </pre>
+ * The data is sent as @ref TLM_TYPE_EXPORT frames, the first byte of the
+ * payload is the kind of the frame:
+ * - <b>'H'</b>, the header and the MAC, sent after the first pass.
+ * - <b>'D'</b>, the offset (4 bytes) and up to @ref EXPORT_CHUNK_SIZE bytes
+ *   of encrypted data.
+ * - <b>'E'</b> and the signed status, 0 if the export was successful.
+ *
+ * The keys K1 and K2 are stored in the user data page at @ref
+ * EXPORT_KEY_ADDR, behind @ref EXPORT_KEY_MAGIC.  They are generated by
+ * tools/export_verify.py and programmed together with the firmware.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	ExportBenchmark() processes one chunk per call of
+		ExportCheck(), see BenchStep().
+2026-10-18,agent	Added the session log as data source, see Log.c.  The
+		log is held during the export, the second pass checks the MAC.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_cmu.h"
+#include "em_aes.h"
+#include "em_i2c.h"
+#include "Export.h"
+#include "DataFlash.h"
+#include "Log.h"
+#include "AlarmClock.h"
+#include "Display.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief AES block size in bytes. */
+#define AES_BLOCK		16
+
+    /*!@brief Multiplication by 2 in GF(2^8), see MixColumns. */
+#define XTIME(x)	((uint8_t)(((x) << 1) ^ ((x) & 0x80 ? 0x1B : 0)))
+
+    /*!@brief Size of the export header. */
+#define HDR_SIZE		32
+
+    /*!@brief Version of the export format. */
+#define EXPORT_VERSION		1
+
+    /*!@brief Size of the largest frame, see 'D'. */
+#define TX_FRAME_SIZE	(TLM_HDR_SIZE + 5 + EXPORT_CHUNK_SIZE + TLM_CRC_SIZE)
+
+    /*!@brief Number of bytes protected by ExportBenchmark() per engine. */
+#define BENCH_SIZE		8192
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Export state. */
+typedef enum
+{
+    EXP_IDLE,			//!< No export active
+    EXP_MAC,			//!< First pass: calculate the MAC
+    EXP_DATA,			//!< Second pass: encrypt and send the data
+    EXP_BENCH,			//!< AES benchmark, see ExportBenchmark()
+} EXP_STATE;
+
+    /*!@brief Data source. */
+typedef struct
+{
+    EXPORT_SRC	 Src;		//!< Source identifier
+    uint32_t	 Size;		//!< Number of bytes to export
+    int (*Read)(uint32_t offs, uint8_t *pBuf, int cnt);	//!< Read function
+} EXP_SOURCE;
+
+/*=========================== Forward Declarations ===========================*/
+
+static int  ReadDFlash (uint32_t offs, uint8_t *pBuf, int cnt);
+static int  ReadLog (uint32_t offs, uint8_t *pBuf, int cnt);
+static void ExportStop (int status);
+static void BenchEngineStart (int engine);
+static void BenchStep (void);
+static void BenchStop (bool flgDone);
+static bool KeysLoad (void);
+static void CmacInit (void);
+static void CmacUpdate (const uint8_t *pData, int cnt);
+static void CmacFinal (uint8_t *pMac);
+static void AesMac (const uint8_t *pData, int cnt);
+static void AesCtr (uint8_t *pData, int cnt);
+static void AesBlock (uint8_t *pOut, const uint8_t *pIn);
+static void AesSoftKeyExpand (uint8_t *pRoundKey, const uint8_t *pKey);
+static void AesSoftEncrypt (const uint8_t *pRoundKey, uint8_t *pBlock);
+static void SendFrame (uint8_t kind, const uint8_t *pData1, int cnt1,
+		       const uint8_t *pData2, int cnt2);
+
+/*================================ Local Data ================================*/
+
+    /*!@brief List of data sources. */
+static const EXP_SOURCE l_Source[] =
+{   //	Src,			Size,				Read
+    {	EXPORT_SRC_DFLASH,	DF_END_ADDR - DF_START_ADDR,	ReadDFlash },
+    {	EXPORT_SRC_LOG,		LOG_SIZE,			ReadLog    },
+};
+
+    /*!@brief S-box of the software AES. */
+static const uint8_t l_SBox[256] =
+{
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5,
+    0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0,
+    0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC,
+    0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A,
+    0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0,
+    0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B,
+    0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85,
+    0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5,
+    0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17,
+    0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88,
+    0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C,
+    0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9,
+    0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6,
+    0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E,
+    0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94,
+    0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68,
+    0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16,
+};
+
+    /*!@brief Current export state and source. */
+static volatile EXP_STATE l_State;
+static const EXP_SOURCE	*l_pSrc;
+
+    /*!@brief Offset of the next chunk in the current pass. */
+static uint32_t		 l_Offs;
+
+    /*!@brief Use the software AES instead of the hardware. */
+static bool		 l_flgSoftAES;
+
+    /*!@brief Keys K1 (encryption) and K2 (MAC), 32-bit aligned for emlib. */
+static uint32_t		 l_KeyEnc[AES_BLOCK / 4];
+static uint32_t		 l_KeyMac[AES_BLOCK / 4];
+
+    /*!@brief Expanded keys of the software AES. */
+static uint8_t		 l_RoundKeyEnc[11 * AES_BLOCK];
+static uint8_t		 l_RoundKeyMac[11 * AES_BLOCK];
+
+    /*!@brief CMAC state: chaining value, held back block, and its length. */
+static uint32_t		 l_MacX[AES_BLOCK / 4];
+static uint32_t		 l_MacLast[AES_BLOCK / 4];
+static int		 l_MacLen;
+
+    /*!@brief Header, and the MAC which is the initial counter. */
+static uint32_t		 l_Hdr[HDR_SIZE / 4];
+static uint32_t		 l_Mac[AES_BLOCK / 4];
+
+    /*!@brief CTR mode counter. */
+static uint32_t		 l_Ctr[AES_BLOCK / 4];
+
+    /*!@brief Data buffer, and scratch buffer for the CBC output of the CMAC */
+static uint32_t		 l_Buf[EXPORT_CHUNK_SIZE / 4];
+static uint32_t		 l_Scratch[EXPORT_CHUNK_SIZE / 4];
+
+    /*!@brief Start time of the export in RTC ticks. */
+static uint32_t		 l_StartTicks;
+
+    /*!@brief Telemetry frame. */
+static TLM_FRAME	 l_Frame;
+
+    /*!@brief Benchmark: current engine, and the RTC ticks and the MAC of
+     * both engines.
+     */
+static int		 l_BenchEngine;
+static uint32_t		 l_BenchTicks[2];
+static uint32_t		 l_BenchMac[2][AES_BLOCK / 4];
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start Export
+ *
+ * Loads the keys and starts the first pass.  The export is continued by
+ * ExportCheck().
+ *
+ * @param[in] src
+ *	Data source to export.
+ *
+ * @param[in] flgSoftAES
+ *	If true, the software AES is used instead of the hardware.
+ *
+ * @return
+ *	0 if the export has been started, or a negative error code.
+ *	@ref i2cNoExportKey is returned if no keys are programmed.
+ *
+ ******************************************************************************/
+int	ExportStart (EXPORT_SRC src, bool flgSoftAES)
+{
+uint8_t	*pHdr = (uint8_t *) l_Hdr;
+uint32_t value;
+int	 i;
+
+
+    if (l_State != EXP_IDLE)
+	return i2cInvalidParameter;
+
+    for (i = 0;  i < (int) ELEM_CNT(l_Source);  i++)
+	if (l_Source[i].Src == src)
+	    break;
+
+    if (i >= (int) ELEM_CNT(l_Source))
+	return i2cInvalidParameter;
+
+    l_pSrc = &l_Source[i];
+    l_flgSoftAES = flgSoftAES;
+
+    if (! KeysLoad())
+	return i2cNoExportKey;
+
+    /* Build the header */
+    memset (l_Hdr, 0, sizeof(l_Hdr));
+    memcpy (pHdr, "HRDX", 4);
+    pHdr[4] = EXPORT_VERSION;
+    pHdr[5] = (uint8_t) src;
+
+    value = l_pSrc->Size;
+    for (i = 0;  i < 4;  i++, value >>= 8)
+	pHdr[8 + i] = (uint8_t) value;
+
+    value = (uint32_t) time(NULL);
+    for (i = 0;  i < 4;  i++, value >>= 8)
+	pHdr[12 + i] = (uint8_t) value;
+
+    value = DEVINFO->UNIQUEL;
+    for (i = 0;  i < 4;  i++, value >>= 8)
+	pHdr[16 + i] = (uint8_t) value;
+
+    value = DEVINFO->UNIQUEH;
+    for (i = 0;  i < 4;  i++, value >>= 8)
+	pHdr[20 + i] = (uint8_t) value;
+
+    /* First pass: MAC over the header and the data */
+    CmacInit();
+    CmacUpdate (pHdr, HDR_SIZE);
+
+    DisplayText (1, "Export MAC");
+    DisplayText (2, "");
+
+    /* The log must not change between the passes */
+    if (src == EXPORT_SRC_LOG)
+	LogHold (true);
+
+    l_Offs = 0;
+    l_StartTicks = RTC->CNT;
+    l_State = EXP_MAC;
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if an Export is active
+ *
+ ******************************************************************************/
+bool	ExportIsActive (void)
+{
+    return (l_State != EXP_IDLE);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Export Check
+ *
+ * This function must be called from the main loop while an export is
+ * active.  It processes one chunk per call.  Any received character
+ * aborts the export.
+ *
+ ******************************************************************************/
+void	ExportCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+uint8_t	*pBuf = (uint8_t *) l_Buf;
+uint32_t mac[AES_BLOCK / 4];
+uint8_t	 offs[4];
+char	 c;
+int	 cnt, status, i;
+
+
+    if (l_State == EXP_IDLE)
+	return;
+
+    if (l_State == EXP_BENCH)
+    {
+	BenchStep();
+	return;
+    }
+
+    if (drvLEUART_RxRead (&c, 1) > 0)
+    {
+	ExportStop (i2cTransferUsageFault);	// aborted by the user
+	return;
+    }
+
+    if (l_State == EXP_DATA  &&  drvLEUART_TxFree() < TX_FRAME_SIZE)
+    {
+	g_flgIRQ = true;		// wait until the LEUART has sent more
+	return;
+    }
+
+    /* Read the next chunk */
+    cnt = l_pSrc->Size - l_Offs;
+    if (cnt > EXPORT_CHUNK_SIZE)
+	cnt = EXPORT_CHUNK_SIZE;
+
+    if (cnt > 0)
+    {
+	status = l_pSrc->Read (l_Offs, pBuf, cnt);
+	if (status < 0)
+	{
+	    ExportStop (status);
+	    return;
+	}
+    }
+
+    if (l_State == EXP_MAC)
+    {
+	if (cnt > 0)
+	    CmacUpdate (pBuf, cnt);
+
+	l_Offs += cnt;
+	if (l_Offs >= l_pSrc->Size)
+	{
+	    /* End of first pass: send the header, start encryption */
+	    CmacFinal ((uint8_t *) l_Mac);
+	    SendFrame ('H', (uint8_t *) l_Hdr, HDR_SIZE,
+		       (uint8_t *) l_Mac, AES_BLOCK);
+
+	    memcpy (l_Ctr, l_Mac, AES_BLOCK);
+	    ((uint8_t *) l_Ctr)[12] &= 0x7F;
+
+	    /* The second pass calculates the MAC again */
+	    CmacInit();
+	    CmacUpdate ((uint8_t *) l_Hdr, HDR_SIZE);
+
+	    DisplayText (1, "Export Data");
+	    l_Offs = 0;
+	    l_State = EXP_DATA;
+	}
+    }
+    else
+    {
+	if (cnt == 0)
+	{
+	    /* Check that the data has not changed since the first pass */
+	    CmacFinal ((uint8_t *) mac);
+	    ExportStop (memcmp (mac, l_Mac, AES_BLOCK) == 0
+			? 0 : i2cSourceChanged);
+	    return;
+	}
+
+	CmacUpdate (pBuf, cnt);
+
+	/* Encrypt complete blocks, the padding is not sent */
+	memset (pBuf + cnt, 0, EXPORT_CHUNK_SIZE - cnt);
+	AesCtr (pBuf, (cnt + AES_BLOCK - 1) & ~(AES_BLOCK - 1));
+
+	for (i = 0;  i < 4;  i++)
+	    offs[i] = (uint8_t)(l_Offs >> (8 * i));
+
+	SendFrame ('D', offs, sizeof(offs), pBuf, cnt);
+	l_Offs += cnt;
+    }
+
+    /* Show progress once per second */
+    if (prevSeconds != g_CurrDateTime.tm_sec)
+    {
+	prevSeconds = g_CurrDateTime.tm_sec;
+	DisplayText (2, "%3d%%", (int)(l_Offs * 100UL / l_pSrc->Size));
+    }
+
+    g_flgIRQ = true;		// do not enter EM2, call us again
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop Export
+ *
+ * Sends the end frame and the statistics, and clears the keys.
+ *
+ ******************************************************************************/
+static void ExportStop (int status)
+{
+uint32_t ticks = (RTC->CNT - l_StartTicks) & 0x00FFFFFF;
+uint8_t	 code = (uint8_t)(int8_t) status;
+
+
+    SendFrame ('E', &code, 1, NULL, 0);
+
+    ConsolePrintf ("Export %s: %lu bytes in %lu ms, %lu bytes/s, %s AES\n",
+		   status == 0 ? "done" : "failed", l_Offs,
+		   ticks * 1000UL / RTC_COUNTS_PER_SEC, ticks == 0 ? 0UL :
+		   (uint32_t)((uint64_t) l_Offs * RTC_COUNTS_PER_SEC / ticks),
+		   l_flgSoftAES ? "software" : "hardware");
+
+    DisplayText (1, "Export %s", status == 0 ? "OK" : "ERR");
+    DisplayNext (10, NULL, 0);
+
+    memset (l_KeyEnc, 0, sizeof(l_KeyEnc));
+    memset (l_KeyMac, 0, sizeof(l_KeyMac));
+    memset (l_RoundKeyEnc, 0, sizeof(l_RoundKeyEnc));
+    memset (l_RoundKeyMac, 0, sizeof(l_RoundKeyMac));
+    CMU_ClockEnable (cmuClock_AES, false);
+
+    if (l_pSrc->Src == EXPORT_SRC_LOG)
+	LogHold (false);
+
+    l_State = EXP_IDLE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	AES Benchmark
+ *
+ * Starts to encrypt and authenticate @ref BENCH_SIZE bytes with the hardware
+ * AES and then with the software AES.  ExportCheck() processes one chunk
+ * per call, see BenchStep(), and finally prints the throughput of both.
+ * The MACs of both runs are compared, so this is also a self-test of the
+ * software AES.  A fixed test key is used, the export keys are not needed.
+ *
+ ******************************************************************************/
+void	ExportBenchmark (void)
+{
+    if (l_State != EXP_IDLE)
+	return;
+
+    l_pSrc = NULL;
+    BenchEngineStart (0);
+    l_State = EXP_BENCH;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start a Benchmark Run
+ *
+ * Sets up the test key and data for the given engine, 0 is the hardware
+ * AES, 1 the software AES.
+ *
+ ******************************************************************************/
+static void BenchEngineStart (int engine)
+{
+int	 i;
+
+
+    l_BenchEngine = engine;
+    l_BenchTicks[engine] = 0;
+    l_flgSoftAES = (engine == 1);
+    l_Offs = 0;
+
+    /* Test key and data */
+    for (i = 0;  i < AES_BLOCK;  i++)
+    {
+	((uint8_t *) l_KeyEnc)[i] = (uint8_t) i;
+	((uint8_t *) l_KeyMac)[i] = (uint8_t)(0x80 + i);
+    }
+    for (i = 0;  i < EXPORT_CHUNK_SIZE;  i++)
+	((uint8_t *) l_Buf)[i] = (uint8_t) i;
+
+    memset (l_Ctr, 0, sizeof(l_Ctr));
+    CMU_ClockEnable (cmuClock_AES, true);
+    AesSoftKeyExpand (l_RoundKeyEnc, (uint8_t *) l_KeyEnc);
+    AesSoftKeyExpand (l_RoundKeyMac, (uint8_t *) l_KeyMac);
+
+    CmacInit();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Benchmark Step
+ *
+ * Authenticates and encrypts one chunk.  Only the time of the calculation
+ * is counted, not the time of the main loop in between.  Any received
+ * character aborts the benchmark.
+ *
+ ******************************************************************************/
+static void BenchStep (void)
+{
+uint32_t start;
+char	 c;
+
+
+    if (drvLEUART_RxRead (&c, 1) > 0)
+    {
+	BenchStop (false);		// aborted by the user
+	return;
+    }
+
+    start = RTC->CNT;
+
+    CmacUpdate ((uint8_t *) l_Buf, EXPORT_CHUNK_SIZE);
+    AesCtr ((uint8_t *) l_Buf, EXPORT_CHUNK_SIZE);
+    l_Offs += EXPORT_CHUNK_SIZE;
+
+    if (l_Offs >= BENCH_SIZE)
+	CmacFinal ((uint8_t *) l_BenchMac[l_BenchEngine]);
+
+    l_BenchTicks[l_BenchEngine] += (RTC->CNT - start) & 0x00FFFFFF;
+
+    if (l_Offs >= BENCH_SIZE)
+    {
+	if (l_BenchEngine == 1)
+	{
+	    BenchStop (true);
+	    return;
+	}
+	BenchEngineStart (1);
+    }
+
+    g_flgIRQ = true;		// do not enter EM2, call us again
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop the Benchmark
+ *
+ * Prints the throughput of both engines, if the benchmark is complete, and
+ * clears the test keys.
+ *
+ ******************************************************************************/
+static void BenchStop (bool flgDone)
+{
+uint32_t bps;
+int	 engine;
+
+
+    for (engine = 0;  flgDone  &&  engine < 2;  engine++)
+    {
+	bps = (l_BenchTicks[engine] == 0 ? 0 : (uint32_t)((uint64_t) BENCH_SIZE
+				* RTC_COUNTS_PER_SEC / l_BenchTicks[engine]));
+	ConsolePrintf ("AES %s: %d bytes in %lu ms, %lu.%lu KB/s\n",
+		       engine == 0 ? "hardware" : "software", BENCH_SIZE,
+		       l_BenchTicks[engine] * 1000UL / RTC_COUNTS_PER_SEC,
+		       bps / 1024, (bps % 1024) * 10 / 1024);
+    }
+
+    if (flgDone)
+	ConsolePrintf ("AES results %s\n",
+		       memcmp (l_BenchMac[0], l_BenchMac[1], AES_BLOCK) == 0
+		       ? "match" : "DIFFER");
+    else
+	ConsolePrintf ("AES benchmark aborted\n");
+
+    memset (l_KeyEnc, 0, sizeof(l_KeyEnc));
+    memset (l_KeyMac, 0, sizeof(l_KeyMac));
+    memset (l_RoundKeyEnc, 0, sizeof(l_RoundKeyEnc));
+    memset (l_RoundKeyMac, 0, sizeof(l_RoundKeyMac));
+    CMU_ClockEnable (cmuClock_AES, false);
+
+    l_State = EXP_IDLE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read Data Flash
+ *
+ * Data source function for @ref EXPORT_SRC_DFLASH.
+ *
+ ******************************************************************************/
+static int  ReadDFlash (uint32_t offs, uint8_t *pBuf, int cnt)
+{
+int	 i, status;
+
+
+    for (i = 0;  i < cnt;  i += DF_CHUNK_SIZE)
+    {
+	status = DFlashRead (DF_START_ADDR + offs + i, pBuf + i,
+			     cnt - i < DF_CHUNK_SIZE ? cnt - i : DF_CHUNK_SIZE);
+	if (status < 0)
+	    return status;
+    }
+
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read Session Log
+ *
+ * Data source function for @ref EXPORT_SRC_LOG, the raw pages of the log.
+ *
+ ******************************************************************************/
+static int  ReadLog (uint32_t offs, uint8_t *pBuf, int cnt)
+{
+    memcpy (pBuf, (const void *)(LOG_START_ADDR + offs), cnt);
+
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Load Keys
+ *
+ * Copies the keys from the user data page, and enables the AES hardware.
+ *
+ * @return
+ *	false if no keys are programmed.
+ *
+ ******************************************************************************/
+static bool KeysLoad (void)
+{
+const uint32_t *pKey = (const uint32_t *) EXPORT_KEY_ADDR;
+
+
+    if (pKey[0] != EXPORT_KEY_MAGIC)
+	return false;
+
+    memcpy (l_KeyEnc, pKey + 1, AES_BLOCK);
+    memcpy (l_KeyMac, pKey + 1 + AES_BLOCK / 4, AES_BLOCK);
+
+    AesSoftKeyExpand (l_RoundKeyEnc, (uint8_t *) l_KeyEnc);
+    AesSoftKeyExpand (l_RoundKeyMac, (uint8_t *) l_KeyMac);
+
+    CMU_ClockEnable (cmuClock_AES, true);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	CMAC Init
+ *
+ ******************************************************************************/
+static void CmacInit (void)
+{
+    memset (l_MacX, 0, sizeof(l_MacX));
+    l_MacLen = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	CMAC Update
+ *
+ * The last block of the message has to be treated differently, so one
+ * block is always held back.  The complete blocks in front of it are
+ * processed in one call of the AES, for this <b>pData</b> must be 32-bit
+ * aligned, and <b>cnt</b> a multiple of 16, except for the last call.
+ *
+ ******************************************************************************/
+static void CmacUpdate (const uint8_t *pData, int cnt)
+{
+int	 n;
+
+
+    while (cnt > 0)
+    {
+	if (l_MacLen == AES_BLOCK)
+	{
+	    AesMac ((uint8_t *) l_MacLast, AES_BLOCK);
+	    l_MacLen = 0;
+	}
+
+	if (l_MacLen == 0  &&  cnt > AES_BLOCK)
+	{
+	    /* All complete blocks, except the last one */
+	    n = (cnt - 1) & ~(AES_BLOCK - 1);
+	    AesMac (pData, n);
+	    pData += n;
+	    cnt -= n;
+	    continue;
+	}
+
+	n = AES_BLOCK - l_MacLen;
+	if (n > cnt)
+	    n = cnt;
+
+	memcpy ((uint8_t *) l_MacLast + l_MacLen, pData, n);
+	l_MacLen += n;
+	pData += n;
+	cnt -= n;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	CMAC Final
+ *
+ * Processes the held back block with subkey K1 if it is complete, or padded
+ * with subkey K2 otherwise, see RFC 4493.
+ *
+ ******************************************************************************/
+static void CmacFinal (uint8_t *pMac)
+{
+uint32_t subKey[AES_BLOCK / 4];
+uint8_t	*pK = (uint8_t *) subKey;
+uint8_t	*pLast = (uint8_t *) l_MacLast;
+int	 n, i, carry;
+
+
+    /* L = AES(K, 0), then K1 = L << 1, and K2 = K1 << 1 */
+    memset (subKey, 0, sizeof(subKey));
+    AesBlock (pK, pK);
+
+    for (n = (l_MacLen == AES_BLOCK ? 1 : 2);  n > 0;  n--)
+    {
+	carry = pK[0] & 0x80;
+	for (i = 0;  i < AES_BLOCK - 1;  i++)
+	    pK[i] = (uint8_t)((pK[i] << 1) | (pK[i + 1] >> 7));
+	pK[AES_BLOCK - 1] = (uint8_t)(pK[AES_BLOCK - 1] << 1);
+	if (carry)
+	    pK[AES_BLOCK - 1] ^= 0x87;
+    }
+
+    if (l_MacLen < AES_BLOCK)
+    {
+	pLast[l_MacLen] = 0x80;
+	memset (pLast + l_MacLen + 1, 0, AES_BLOCK - l_MacLen - 1);
+    }
+
+    for (i = 0;  i < AES_BLOCK;  i++)
+	pLast[i] ^= pK[i];
+
+    AesMac (pLast, AES_BLOCK);
+    memcpy (pMac, l_MacX, AES_BLOCK);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	CBC-MAC over complete Blocks
+ *
+ * Updates the chaining value @ref l_MacX with key K2.
+ *
+ ******************************************************************************/
+static void AesMac (const uint8_t *pData, int cnt)
+{
+uint8_t	*pX = (uint8_t *) l_MacX;
+int	 i;
+
+
+    if (! l_flgSoftAES)
+    {
+	AES_CBC128 ((uint8_t *) l_Scratch, pData, cnt, (uint8_t *) l_KeyMac,
+		    pX, true);
+	memcpy (l_MacX, (uint8_t *) l_Scratch + cnt - AES_BLOCK, AES_BLOCK);
+	return;
+    }
+
+    for ( ;  cnt > 0;  cnt -= AES_BLOCK, pData += AES_BLOCK)
+    {
+	for (i = 0;  i < AES_BLOCK;  i++)
+	    pX[i] ^= pData[i];
+	AesSoftEncrypt (l_RoundKeyMac, pX);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	CTR Mode Encryption of complete Blocks
+ *
+ * Encrypts the data in place with key K1, and advances the counter.
+ *
+ ******************************************************************************/
+static void AesCtr (uint8_t *pData, int cnt)
+{
+uint8_t	 key[AES_BLOCK];
+uint8_t	*pCtr = (uint8_t *) l_Ctr;
+int	 i;
+
+
+    if (! l_flgSoftAES)
+    {
+	AES_CTR128 (pData, pData, cnt, (uint8_t *) l_KeyEnc, pCtr,
+		    AES_CTRUpdate32Bit);
+	return;
+    }
+
+    for ( ;  cnt > 0;  cnt -= AES_BLOCK, pData += AES_BLOCK)
+    {
+	memcpy (key, pCtr, AES_BLOCK);
+	AesSoftEncrypt (l_RoundKeyEnc, key);
+	for (i = 0;  i < AES_BLOCK;  i++)
+	    pData[i] ^= key[i];
+
+	/* Increment the last 32 bits, big endian */
+	for (i = AES_BLOCK - 1;  i >= AES_BLOCK - 4;  i--)
+	    if (++pCtr[i] != 0)
+		break;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Encrypt one Block with Key K2
+ *
+ ******************************************************************************/
+static void AesBlock (uint8_t *pOut, const uint8_t *pIn)
+{
+    if (! l_flgSoftAES)
+    {
+	AES_ECB128 (pOut, pIn, AES_BLOCK, (uint8_t *) l_KeyMac, true);
+	return;
+    }
+
+    memmove (pOut, pIn, AES_BLOCK);
+    AesSoftEncrypt (l_RoundKeyMac, pOut);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Software AES-128 Key Expansion
+ *
+ * Calculates the 11 round keys, see FIPS-197.
+ *
+ ******************************************************************************/
+static void AesSoftKeyExpand (uint8_t *pRoundKey, const uint8_t *pKey)
+{
+uint8_t	 t[4], tmp, rcon = 0x01;
+int	 i;
+
+
+    memcpy (pRoundKey, pKey, AES_BLOCK);
+
+    for (i = AES_BLOCK;  i < 11 * AES_BLOCK;  i += 4)
+    {
+	memcpy (t, pRoundKey + i - 4, 4);
+
+	if (i % AES_BLOCK == 0)
+	{
+	    /* RotWord, SubWord, and Rcon */
+	    tmp  = t[0];
+	    t[0] = l_SBox[t[1]] ^ rcon;
+	    t[1] = l_SBox[t[2]];
+	    t[2] = l_SBox[t[3]];
+	    t[3] = l_SBox[tmp];
+	    rcon = (uint8_t)((rcon << 1) ^ (rcon & 0x80 ? 0x1B : 0));
+	}
+
+	pRoundKey[i + 0] = pRoundKey[i - AES_BLOCK + 0] ^ t[0];
+	pRoundKey[i + 1] = pRoundKey[i - AES_BLOCK + 1] ^ t[1];
+	pRoundKey[i + 2] = pRoundKey[i - AES_BLOCK + 2] ^ t[2];
+	pRoundKey[i + 3] = pRoundKey[i - AES_BLOCK + 3] ^ t[3];
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Software AES-128 Block Encryption
+ *
+ * Encrypts one block in place.  The state is stored column by column, as
+ * the input block, see FIPS-197.
+ *
+ ******************************************************************************/
+static void AesSoftEncrypt (const uint8_t *pRoundKey, uint8_t *pBlock)
+{
+uint8_t	 s[AES_BLOCK], a0, a1, a2, a3, t;
+int	 round, c, i;
+
+
+    for (i = 0;  i < AES_BLOCK;  i++)
+	s[i] = pBlock[i] ^ pRoundKey[i];
+
+    for (round = 1;  round <= 10;  round++)
+    {
+	/* SubBytes and ShiftRows: row r is rotated left by r columns */
+	for (c = 0;  c < 4;  c++)
+	{
+	    pBlock[4*c + 0] = l_SBox[s[4*c + 0]];
+	    pBlock[4*c + 1] = l_SBox[s[(4*c +  5) % AES_BLOCK]];
+	    pBlock[4*c + 2] = l_SBox[s[(4*c + 10) % AES_BLOCK]];
+	    pBlock[4*c + 3] = l_SBox[s[(4*c + 15) % AES_BLOCK]];
+	}
+
+	/* MixColumns, except for the last round */
+	for (c = 0;  c < 4;  c++)
+	{
+	    a0 = pBlock[4*c + 0];
+	    a1 = pBlock[4*c + 1];
+	    a2 = pBlock[4*c + 2];
+	    a3 = pBlock[4*c + 3];
+
+	    if (round < 10)
+	    {
+		t = a0 ^ a1 ^ a2 ^ a3;
+		s[4*c + 0] = a0 ^ t ^ XTIME(a0 ^ a1);
+		s[4*c + 1] = a1 ^ t ^ XTIME(a1 ^ a2);
+		s[4*c + 2] = a2 ^ t ^ XTIME(a2 ^ a3);
+		s[4*c + 3] = a3 ^ t ^ XTIME(a3 ^ a0);
+	    }
+	    else
+	    {
+		s[4*c + 0] = a0;
+		s[4*c + 1] = a1;
+		s[4*c + 2] = a2;
+		s[4*c + 3] = a3;
+	    }
+	}
+
+	/* AddRoundKey */
+	for (i = 0;  i < AES_BLOCK;  i++)
+	    s[i] ^= pRoundKey[round * AES_BLOCK + i];
+    }
+
+    memcpy (pBlock, s, AES_BLOCK);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send Export Frame
+ *
+ ******************************************************************************/
+static void SendFrame (uint8_t kind, const uint8_t *pData1, int cnt1,
+		       const uint8_t *pData2, int cnt2)
+{
+    TlmFrameBegin (&l_Frame, TLM_TYPE_EXPORT);
+    TlmAddRaw (&l_Frame, &kind, 1);
+    TlmAddRaw (&l_Frame, pData1, cnt1);
+    if (cnt2 > 0)
+	TlmAddRaw (&l_Frame, pData2, cnt2);
+    TlmFrameSend (&l_Frame);
+}
@@ -0,0 +1,63 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Export.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Added error code i2cSourceChanged.
+2026-10-18,agent	Added EXPORT_SRC_LOG for the session log.
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Export_h
+#define __INC_Export_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Number of data bytes per export frame, a multiple of 16. */
+#define EXPORT_CHUNK_SIZE	128
+
+    /*!@brief Address of the export keys, the user data page is not erased
+     * when the firmware is updated.
+     */
+#ifndef EXPORT_KEY_ADDR
+    #define EXPORT_KEY_ADDR	USERDATA_BASE
+#endif
+
+    /*!@brief Magic number in front of the keys, "HRDK" */
+#define EXPORT_KEY_MAGIC	0x4B445248
+
+    /*!@brief Error code if no keys are programmed, additionally to
+     * @ref I2C_TransferReturn_TypeDef
+     */
+#define i2cNoExportKey		-15
+
+    /*!@brief Error code if the data has changed between the two passes */
+#define i2cSourceChanged	-17
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Data sources which can be exported. */
+typedef enum
+{
+    EXPORT_SRC_DFLASH = 1,	//!< Data flash image of the TI controller
+    EXPORT_SRC_LOG,		//!< Session log in the internal flash
+} EXPORT_SRC;
+
+/*================================ Prototypes ================================*/
+
+int	ExportStart (EXPORT_SRC src, bool flgSoftAES);
+bool	ExportIsActive (void);
+void	ExportCheck (void);
+void	ExportBenchmark (void);
+
+
+#endif /* __INC_Export_h */
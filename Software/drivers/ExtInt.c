@@ -2,7 +2,7 @@
  * @file
  * @brief	External Interrupt Handling
  * @author	Ralf Gerhauser
- * @version	2016-11-22
+ * @version	2026-10-18
  *
  * The purpose of this module is to handle any kind of external interrupts
  * (EXTI).  In detail, this includes:
@@ -11,6 +11,9 @@
  * - An interrupt service routine (ISR), which detects rising and falling edge
  *   EXTIs, gets time stamp information, and calls the corresponding module
  *   handler.
+ * - A per-EXTI debounce filter and edge counters.  The level of an EXTI with
+ *   an edge within the debounce window is checked again when the window
+ *   closes, via a high-resolution timer, see msTimerCreate().
  *
  * @note
  * This module <b>only</b> deals with the EXTI functionality, the affected
@@ -19,6 +22,13 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	ExtIntInit() now builds a dispatch table with the
+		handlers and the GPIO port of each EXTI, so EXTI_Handler() no
+		longer has to walk the configuration list and decode
+		EXTIPSELL/H. Added debounce filter, see EXTI_INIT element
+		<DebounceMs>. The level is read again when the debounce window
+		closes, so the final level of a short pulse is not lost. Added
+		ExtIntEdgeCount() and ExtIntBounceCount().
 2016-11-22,rage	Clear interrupts early to be able to receive new interrupts.
 2016-04-13,rage	BugFix: Always detect rising and falling edges, so no interrupts
 		can get lost.  Determine real signal state from input port.
@@ -40,6 +50,8 @@ Revision History:
 #include "em_device.h"
 #include "em_assert.h"
 #include "em_bitband.h"
+#include "AlarmClock.h"
+#include "config.h"		// include project configuration parameters
 
 
 /*=============================== Definitions ================================*/
@@ -47,6 +59,18 @@ Revision History:
 
 /*=========================== Typedefs and Structs ===========================*/
 
+/*!@brief Dispatch entry of one EXTI, built by ExtIntInit(). */
+typedef struct
+{
+    EXTI_FCT	IntFct[EXTI_MAX_FCT_PER_LINE]; //!< handlers, NULL if unused
+    uint8_t	PortNum;	//!< GPIO port number the EXTI is connected to
+    bool	LastLvl;	//!< last level that has been reported
+    uint32_t	DebounceCnt;	//!< debounce window in RTC counts, 0 for none
+    uint32_t	LastTime;	//!< RTC time stamp of the last reported edge
+    uint32_t	EdgeCnt;	//!< number of edges seen in total
+    uint32_t	BounceCnt;	//!< number of edges suppressed by the filter
+} EXTI_LINE;
+
 
 /*======================== External Data and Routines ========================*/
 
@@ -56,15 +80,24 @@ Revision History:
 
 /*================================ Local Data ================================*/
 
-    /*! Local pointer to EXTI configuration */
-static const EXTI_INIT *l_pExtIntCfg;
+    /*! Dispatch table, one entry per EXTI */
+static EXTI_LINE l_ExtiLine[16];
 
     /*! Bit mask of all EXTIs in use */
 static volatile uint32_t l_extiBitMask;
 
+    /*! Bit mask of EXTIs to check again when the debounce window closes */
+static volatile uint32_t l_PendingMask;
+
+    /*! Timer for the end of the debounce window, -1 if no debouncing */
+static TIM_HDL	 l_hdlDebounce = -1;
+
 /*=========================== Forward Declarations ===========================*/
 
 void	EXTI_Handler (void);
+static void DebounceTimerStart (EXTI_LINE *pLine, uint32_t timeStamp);
+static void DebounceTimerFct (TIM_HDL hdl);
+static void ReportEdge (int extiNum, bool extiLvl, uint32_t timeStamp);
 
 
 /***************************************************************************//**
@@ -90,12 +123,14 @@ void	EXTI_Handler (void);
  ******************************************************************************/
 void	ExtIntInit (const EXTI_INIT *pInitStruct)
 {
+EXTI_LINE *pLine;		// pointer to dispatch entry
+uint32_t   debounceCnt;		// debounce window in RTC counts
+int	   extiNum;		// EXTI number
+int	   i;
+
     /* Parameter check */
     EFM_ASSERT(pInitStruct != NULL);
 
-    /* Save configuration */
-    l_pExtIntCfg = pInitStruct;
-
     /* Disable and clear all EXTIs */
     GPIO->IEN = 0;
     GPIO->EXTIRISE = 0;
@@ -108,10 +143,65 @@ void	ExtIntInit (const EXTI_INIT *pInitStruct)
      */
     l_extiBitMask = 0;
 
+    for (extiNum = 0;  extiNum < 16;  extiNum++)
+    {
+	pLine = &l_ExtiLine[extiNum];
+
+	for (i = 0;  i < EXTI_MAX_FCT_PER_LINE;  i++)
+	    pLine->IntFct[i] = NULL;
+
+	pLine->DebounceCnt = 0;
+	pLine->EdgeCnt = pLine->BounceCnt = 0;
+
+	/* get associated port number, routing must already be set up */
+	if (extiNum < 8)
+	    pLine->PortNum = (GPIO->EXTIPSELL >> (extiNum * 4)) & 0x7;
+	else
+	    pLine->PortNum = (GPIO->EXTIPSELH >> ((extiNum-8) * 4)) & 0x7;
+
+	/* initial level, so the first edge is compared against reality */
+	pLine->LastLvl = GPIO->P[pLine->PortNum].DIN & (1 << extiNum)
+			 ? true : false;
+
+	/* time stamp far enough in the past to accept the first edge */
+	pLine->LastTime = RTC->CNT - 0x800000;
+    }
+
+    /* build the dispatch table from the configuration list */
     while (pInitStruct->IntBitMask != 0)
     {
 	l_extiBitMask |= pInitStruct->IntBitMask;	// add to bit mask
 
+	debounceCnt = ((uint32_t)pInitStruct->DebounceMs * RTC_COUNTS_PER_SEC)
+		      / 1000;
+
+	for (extiNum = 0;  extiNum < 16;  extiNum++)
+	{
+	    if ((pInitStruct->IntBitMask & (1 << extiNum)) == 0)
+		continue;
+
+	    pLine = &l_ExtiLine[extiNum];
+
+	    /* add handler to the list of this EXTI */
+	    for (i = 0;  i < EXTI_MAX_FCT_PER_LINE;  i++)
+	    {
+		if (pLine->IntFct[i] == NULL)
+		{
+		    pLine->IntFct[i] = pInitStruct->IntFct;
+		    break;
+		}
+	    }
+	    EFM_ASSERT(i < EXTI_MAX_FCT_PER_LINE);	// too many handlers
+
+	    /* the longest debounce window of all handlers wins */
+	    if (pLine->DebounceCnt < debounceCnt)
+		pLine->DebounceCnt = debounceCnt;
+	}
+
+	/* a timer checks the level again at the end of a debounce window */
+	if (debounceCnt > 0  &&  l_hdlDebounce < 0)
+	    l_hdlDebounce = msTimerCreate (DebounceTimerFct);
+
 	pInitStruct++;
     }
 
@@ -198,6 +288,45 @@ void	ExtIntEnable (int extiNum)
     BITBAND_Peripheral (&(GPIO->IEN), extiNum, 1);
 }
 
+/***************************************************************************//**
+ *
+ * @brief	Get Edge Count
+ *
+ * Returns the total number of edges, which have been detected for the
+ * specified external interrupt since ExtIntInit(), including bounces.
+ *
+ * @param[in] extiNum
+ *	Number of the external interrupt.
+ *
+ ******************************************************************************/
+uint32_t ExtIntEdgeCount (int extiNum)
+{
+    /* Parameter check */
+    EFM_ASSERT(0 <= extiNum  &&  extiNum <= 15);
+
+    return l_ExtiLine[extiNum].EdgeCnt;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Get Bounce Count
+ *
+ * Returns the number of edges of the specified external interrupt, which
+ * have been suppressed by the debounce filter, i.e. which have not been
+ * passed to the handlers.
+ *
+ * @param[in] extiNum
+ *	Number of the external interrupt.
+ *
+ ******************************************************************************/
+uint32_t ExtIntBounceCount (int extiNum)
+{
+    /* Parameter check */
+    EFM_ASSERT(0 <= extiNum  &&  extiNum <= 15);
+
+    return l_ExtiLine[extiNum].BounceCnt;
+}
+
 /***************************************************************************//**
  *
  * @brief	Interrupt Handler for even GPIOs
@@ -233,16 +362,25 @@ void	GPIO_ODD_IRQHandler (void)
  * The sequence of operations in detail:
  * -# Receive EXTI on rising or falling edge.
  * -# Read current RTC value for time stamp.
- * -# For each interrupt perform the following actions:
- *    - Determine and call the corresponding handler.
- *    - Change the trigger type, i.e. rising to falling edge, and vice versa.
  * -# Clear all received interrupts at once.
+ * -# For each interrupt perform the following actions:
+ *    - Read the current level from the GPIO port stored in the dispatch table.
+ *    - Drop the edge if it lies within the debounce window of the last
+ *      reported edge, or if the level did not change.  In the first case,
+ *      the level is checked again when the window closes, see
+ *      DebounceTimerFct().
+ *    - Call all handlers of this EXTI from the dispatch table.
  * -# Return from interrupt.
  *
  * @note
  * The time stamp is read from the Real Time Counter (RTC), so its resolution
  * depends on the RTC.
  *
+ * @note
+ * The debounce window should be shorter than the shortest valid pulse of the
+ * signal, otherwise the trailing edge of the pulse is reported late, i.e.
+ * when the window closes.
+ *
  ******************************************************************************/
 void	EXTI_Handler (void)
 {
@@ -251,9 +389,8 @@ uint32_t  status;		// interrupt status flags
 uint32_t  irqMask;		// bit mask of active external interrupts
 int	  extiNum;		// EXTI number
 uint32_t  extiBitMask;		// bit mask for EXTI number <extiNum>
-int	  portNum;		// GPIO port number of an EXTI
 bool	  extiLvl;		// current level of EXTI
-const EXTI_INIT *pExtIntCfg;	// pointer to EXTI configuration data
+EXTI_LINE *pLine;		// pointer to dispatch entry of this EXTI
 
     /* get time stamp from RTC */
     timeStamp = RTC->CNT;
@@ -282,24 +419,114 @@ const EXTI_INIT *pExtIntCfg;	// pointer to EXTI configuration data
 	/* remove this interrupt from the bit mask */
 	irqMask &= ~extiBitMask;
 
-	/* get associated port number */
-	if (extiNum < 8)
-	    portNum = (GPIO->EXTIPSELL >> (extiNum * 4)) & 0x7;
-	else
-	    portNum = (GPIO->EXTIPSELH >> ((extiNum-8) * 4)) & 0x7;
+	pLine = &l_ExtiLine[extiNum];
+	pLine->EdgeCnt++;
 
 	/* determine whether rising or falling edge */
-	extiLvl = GPIO->P[portNum].DIN & extiBitMask ? true : false;
+	extiLvl = GPIO->P[pLine->PortNum].DIN & extiBitMask ? true : false;
 
-	/* see which functions to be called for this EXTI */
-	for (pExtIntCfg = l_pExtIntCfg;
-	     pExtIntCfg->IntBitMask != 0;  pExtIntCfg++)
+	/* drop bounces, but check the level again at the end of the window */
+	if (((timeStamp - pLine->LastTime) & 0xFFFFFF) < pLine->DebounceCnt)
 	{
-	    if (pExtIntCfg->IntBitMask & extiBitMask)
-	    {
-		/* call all handlers that request this EXTI */
-		pExtIntCfg->IntFct(extiNum, extiLvl, timeStamp);
-	    }
+	    pLine->BounceCnt++;
+	    l_PendingMask |= extiBitMask;
+	    DebounceTimerStart (pLine, timeStamp);
+	    continue;
+	}
+
+	/* drop edges that did not change the level */
+	if (extiLvl == pLine->LastLvl)
+	{
+	    pLine->BounceCnt++;
+	    continue;
+	}
+
+	ReportEdge (extiNum, extiLvl, timeStamp);
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Start Debounce Timer
+ *
+ * Starts the timer, so it expires when the debounce window of the specified
+ * EXTI closes.
+ *
+ ******************************************************************************/
+static void DebounceTimerStart (EXTI_LINE *pLine, uint32_t timeStamp)
+{
+uint32_t  left;			// ticks until the window closes
+
+    left = pLine->DebounceCnt - ((timeStamp - pLine->LastTime) & 0xFFFFFF);
+
+    /* round up to the next millisecond */
+    msTimerStart (l_hdlDebounce, (left * 1000 + RTC_COUNTS_PER_SEC - 1)
+				 / RTC_COUNTS_PER_SEC);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Debounce Timer Function
+ *
+ * Called when the debounce window of an EXTI, which had an edge within the
+ * window, closes.  It reads the level of each pending EXTI again, and
+ * reports an edge if it differs from the last reported level.  So the final
+ * level is not lost, if the last bounce or a short pulse lies within the
+ * window.  EXTIs whose window is still open are checked later.
+ *
+ ******************************************************************************/
+static void DebounceTimerFct (TIM_HDL hdl)
+{
+uint32_t  timeStamp;		// current time value from RTC
+uint32_t  pending;		// EXTIs to check
+int	  extiNum;		// EXTI number
+bool	  extiLvl;		// current level of EXTI
+EXTI_LINE *pLine;		// pointer to dispatch entry of this EXTI
+
+    (void) hdl;
+
+    timeStamp = RTC->CNT;
+    pending = l_PendingMask & GPIO->IEN;
+    l_PendingMask = 0;
+
+    while (pending)
+    {
+	extiNum = 31 - __CLZ (pending);
+	pending &= ~(0x1 << extiNum);
+
+	pLine = &l_ExtiLine[extiNum];
+
+	/* an edge has been reported since, its window is still open */
+	if (((timeStamp - pLine->LastTime) & 0xFFFFFF) < pLine->DebounceCnt)
+	{
+	    l_PendingMask |= (0x1 << extiNum);
+	    DebounceTimerStart (pLine, timeStamp);
+	    continue;
 	}
+
+	extiLvl = GPIO->P[pLine->PortNum].DIN & (0x1 << extiNum) ? true : false;
+	if (extiLvl != pLine->LastLvl)
+	    ReportEdge (extiNum, extiLvl, timeStamp);
     }
 }
+
+/***************************************************************************//**
+ *
+ * @brief	Report Edge
+ *
+ * Stores the new level and the time stamp of the specified EXTI, and calls
+ * all of its handlers from the dispatch table.
+ *
+ ******************************************************************************/
+static void ReportEdge (int extiNum, bool extiLvl, uint32_t timeStamp)
+{
+EXTI_LINE *pLine = &l_ExtiLine[extiNum];
+int	  i;
+
+    pLine->LastTime = timeStamp;
+    pLine->LastLvl  = extiLvl;
+
+    /* call all handlers that request this EXTI */
+    for (i = 0;  i < EXTI_MAX_FCT_PER_LINE  &&  pLine->IntFct[i];  i++)
+	pLine->IntFct[i](extiNum, extiLvl, timeStamp);
+}
@@ -2,9 +2,11 @@
  * @file
  * @brief	Header file of module ExtInt.c
  * @author	Ralf Gerhauser
- * @version	2016-04-13
+ * @version	2026-10-18
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added element <DebounceMs> to structure EXTI_INIT, added
+		EXTI_MAX_FCT_PER_LINE and prototypes for the edge counters.
 2016-04-13,rage	Removed element <IntTrigMask> from structure EXTI_INIT.
 2016-02-16,rage	Added prototypes for ExtIntEnableAll() and ExtIntDisableAll().
 2014-05-12,rage	Added prototypes for ExtIntEnable() and ExtIntDisable().
@@ -22,6 +24,10 @@ Revision History:
 
 /*=============================== Definitions ================================*/
 
+    /*!@brief Maximum number of handlers which can be connected to one EXTI. */
+#ifndef EXTI_MAX_FCT_PER_LINE
+    #define EXTI_MAX_FCT_PER_LINE	2
+#endif
 
 /*=========================== Typedefs and Structs ===========================*/
 
@@ -35,12 +41,17 @@ typedef void	(* EXTI_FCT)(int extiNum, bool extiLvl, uint32_t timeStamp);
  * This structure is used as 0-terminated array to connect certain EXTIs
  * with their corresponding handler.
  *
+ * Element <b>DebounceMs</b> specifies a debounce window in milliseconds.
+ * Edges of an EXTI which occur within this time after the last reported
+ * edge are counted as bounces and not passed to the handler.  Use 0 to
+ * disable debouncing, e.g. for signals that are not generated by switches.
+ *
  * <b>Typical Example:</b>
  * @code
  * static const EXTI_INIT l_ExtIntCfg[] =
- * { //	IntBitMask,	IntFct
- *    {	KEY_EXTI_MASK,	KeyHandler	},
- *    {	0,		NULL		}
+ * { //	IntBitMask,	IntFct,		DebounceMs
+ *    {	KEY_EXTI_MASK,	KeyHandler,	KEY_DEBOUNCE_TIME },
+ *    {	0,		NULL,		0		  }
  * };
  * @endcode
  */
@@ -48,6 +59,7 @@ typedef struct
 {
     uint16_t  IntBitMask;	//!< Bit mask defines affected EXTIs
     EXTI_FCT  IntFct;		//!< Function to be called for above EXTIs
+    uint16_t  DebounceMs;	//!< Debounce window in [ms], 0 for none
 } EXTI_INIT;
 
 /*================================ Prototypes ================================*/
@@ -59,5 +71,9 @@ void	ExtIntDisableAll (void);
 void	ExtIntEnable (int extiNum);
 void	ExtIntDisable(int extiNum);
 
+    /* Statistics */
+uint32_t ExtIntEdgeCount  (int extiNum);
+uint32_t ExtIntBounceCount(int extiNum);
+
 
 #endif /* __INC_ExtInt_h */
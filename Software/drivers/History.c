@@ -0,0 +1,668 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Pack History Index
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module keeps the history of each battery pack.  When a pack is
+ * connected, its identity, i.e. ManufacturerName, SerialNumber, and
+ * ManufactureDate, and the values CycleCount, state of health, and
+ * FullChargeCapacity are read.  When the pack is removed, the session is
+ * closed and appended to the session log as @ref LOG_TYPE_PACK record, see
+ * @ref HIST_SESSION.  Each record contains the sequence number of the
+ * previous session of the same pack, so the sessions of a pack form a chain
+ * from the newest to the oldest one.
+ *
+ * To find the newest session of a pack without scanning the log, an index
+ * maps the hash of the identity to the sequence number of this record.  The
+ * index is a hash table with @ref HIST_SLOT_CNT slots in one flash page
+ * below the log, see @ref HIST_START_ADDR.  Flash words can only be written
+ * once, so an update does not change a slot, but writes the key with the
+ * new sequence number into the next free slot of the probe sequence, i.e.
+ * linear probing from slot key % @ref HIST_SLOT_CNT on.  A lookup takes the
+ * highest sequence number of all slots with this key, and checks the
+ * identity in the record of the log.  So hash collisions, slots which have
+ * been torn by a power failure, and records which have been overwritten in
+ * the log are all detected.
+ *
+ * When the page is full, it is compacted into the other page: only the
+ * newest slot of each pack is kept, up to @ref HIST_PACK_MAX packs.  The
+ * page header with the generation number is written last, so an
+ * interrupted compaction leaves the old page valid.  The index can always
+ * be rebuilt from the log by HistoryRebuild(), this is done automatically
+ * if no valid index page is found at start-up, or if a page header is
+ * damaged, since the other page may be outdated then.
+ * tools/history_sim.py checks the index with simulated packs.
+ *
+ * Additionally, a @ref LOG_TYPE_CONNECT record with the key is written when
+ * a session is opened, and one with key 0 when it is closed.  They assign
+ * the records in between to the pack, see LogSeek().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Packs whose keys collide are kept apart by compaction
+		and rebuild, torn slots are dropped by the compaction.  A
+		damaged page header makes HistoryInit() rebuild the index,
+		instead of using the older page.
+2026-10-18,agent	The session is closed and not opened again while the
+		supply voltage is low, see Supply.c.
+2026-10-18,agent	Write LOG_TYPE_CONNECT records when a session is opened
+		and closed.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_msc.h"
+#include "History.h"
+#include "AlarmClock.h"
+#include "BatteryMon.h"
+#include "Telemetry.h"
+#include "Supply.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Address of an index page. */
+#define PAGE_ADDR(page)		((uint32_t)(HIST_START_ADDR + (page) * FLASH_PAGE_SIZE))
+
+    /*!@brief Address of a slot. */
+#define SLOT_ADDR(page, i)	(PAGE_ADDR(page) + HIST_PAGE_HDR_SIZE + (i) * 8)
+
+    /*!@brief Pointer to a slot. */
+#define SLOT(page, i)		((const HIST_SLOT *) SLOT_ADDR(page, i))
+
+    /*!@brief Content of an erased flash word. */
+#define ERASED_WORD		0xFFFFFFFF
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Index page header, as stored in the flash. */
+typedef struct
+{
+    uint32_t	 Magic;		//!< @ref HIST_PAGE_MAGIC
+    uint32_t	 Generation;	//!< The valid page with the highest one is used
+    uint32_t	 SlotCnt;	//!< @ref HIST_SLOT_CNT
+    uint32_t	 Crc;		//!< CRC-16 of the fields above
+} HIST_PAGE_HDR;
+
+    /*!@brief Slot of the index. */
+typedef struct
+{
+    uint32_t	 Key;		//!< Hash of the identity, erased if free
+    uint32_t	 Seq;		//!< Sequence number of the session record
+} HIST_SLOT;
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool SessionOpen (void);
+static uint32_t IdentityKey (const HIST_SESSION *pId);
+static bool IdentityEqual (const HIST_SESSION *pA, const HIST_SESSION *pB);
+static int  IndexInsert (uint32_t key, uint32_t seq);
+static int  PageWrite (void);
+static int  SlotWrite (int page, uint32_t key, uint32_t seq);
+static void TabAdd (const HIST_SESSION *pSession, uint32_t seq);
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Index page in use, -1 if none. */
+static int		 l_Page = -1;
+
+    /*!@brief Generation of the index page in use. */
+static uint32_t		 l_Gen;
+
+    /*!@brief Number of used slots in the index page. */
+static int		 l_Used;
+
+    /*!@brief Number of rebuilds. */
+static uint32_t		 l_Rebuilds;
+
+    /*!@brief Newest session per key, to compact or rebuild the index. */
+static HIST_SLOT	 l_Tab[HIST_PACK_MAX];
+static int		 l_TabCnt;
+
+    /*!@brief Flag if a pack is connected, and its session. */
+static bool		 l_flgOpen;
+static HIST_SESSION	 l_Cur;
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the History
+ *
+ * Finds the valid index page with the highest generation.  If there is
+ * none, the index is rebuilt from the log.  This is also done if the header
+ * of a page has been written, but is not valid.  Then the other page may be
+ * older than the damaged one, and miss the newest sessions.  An erased
+ * header is no damage, the compaction into this page has been interrupted.
+ * This routine must be called once after LogInit().
+ *
+ ******************************************************************************/
+void	HistoryInit (void)
+{
+HIST_PAGE_HDR hdr;
+bool	 flgDamaged = false;
+int	 page, i;
+
+
+    l_Page = -1;
+
+    /* The index must not overlap the firmware image */
+    if (LogImageEnd() > HIST_START_ADDR)
+	return;
+
+    for (page = 0;  page < HIST_PAGE_CNT;  page++)
+    {
+	memcpy (&hdr, (const void *) PAGE_ADDR(page), sizeof(hdr));
+	if (hdr.Magic == HIST_PAGE_MAGIC  &&  hdr.SlotCnt == HIST_SLOT_CNT
+	&&  hdr.Crc == TlmCRC16 (0xFFFF, (const uint8_t *) &hdr,
+				 offsetof(HIST_PAGE_HDR, Crc)))
+	{
+	    if (l_Page < 0  ||  hdr.Generation > l_Gen)
+	    {
+		l_Page = page;
+		l_Gen = hdr.Generation;
+	    }
+	}
+	else if (hdr.Magic != ERASED_WORD)
+	{
+	    flgDamaged = true;
+	}
+    }
+
+    /* A valid page is kept, the rebuild writes into the other one */
+    if (l_Page < 0  ||  flgDamaged)
+    {
+	HistoryRebuild();
+	return;
+    }
+
+    l_Used = 0;
+    for (i = 0;  i < HIST_SLOT_CNT;  i++)
+	if (SLOT(l_Page, i)->Key != ERASED_WORD)
+	    l_Used++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	History Check
+ *
+ * This function must be called from the main loop.  Once per second, it
+ * checks if a pack has been connected or removed, and opens or closes its
+ * session.  Opening is retried every second until all registers could be
+ * read.
+ *
+ ******************************************************************************/
+void	HistoryCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+
+
+    if (prevSeconds == g_CurrDateTime.tm_sec)
+	return;
+
+    prevSeconds = g_CurrDateTime.tm_sec;
+
+    if (g_BatteryCtrlType == BCT_UNKNOWN  ||  SupplyIsLow())
+	HistoryClose();
+    else if (! l_flgOpen  &&  SessionOpen())
+    {
+	l_flgOpen = true;
+	LogAppend (LOG_TYPE_CONNECT, &l_Cur.Key, sizeof(l_Cur.Key));
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Close Session
+ *
+ * Appends the session of the connected pack to the log and updates the
+ * index.  This is called when the pack is removed, and before power-off.
+ *
+ ******************************************************************************/
+void	HistoryClose (void)
+{
+uint32_t seq, key = 0;
+
+
+    if (! l_flgOpen)
+	return;
+
+    l_flgOpen = false;
+    l_Cur.CloseTime = (uint32_t) time(NULL);
+
+    seq = LogNextSeq();
+    if (LogAppend (LOG_TYPE_PACK, &l_Cur, sizeof(l_Cur)) == 0)
+	IndexInsert (l_Cur.Key, seq);
+
+    LogAppend (LOG_TYPE_CONNECT, &key, sizeof(key));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Current Session
+ *
+ * Returns the session of the connected pack.  <b>PrevSeq</b> is the
+ * sequence number of its previous session, see HistoryRead().
+ *
+ * @return
+ *	true if a pack is connected and its session is open.
+ *
+ ******************************************************************************/
+bool	HistoryCurrent (HIST_SESSION *pSession)
+{
+    if (l_flgOpen)
+	*pSession = l_Cur;
+
+    return l_flgOpen;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Lookup Pack
+ *
+ * Finds the newest session of a pack via the index.
+ *
+ * @param[in] pId
+ *	Session whose identity fields, i.e. <b>Key</b>, <b>Name</b>,
+ *	<b>SerialNumber</b>, and <b>ManufactureDate</b>, are set.
+ *
+ * @return
+ *	Sequence number of the newest session record, 0 if none is found.
+ *
+ ******************************************************************************/
+uint32_t HistoryLookup (const HIST_SESSION *pId)
+{
+HIST_SESSION session;
+const HIST_SLOT *pSlot;
+uint32_t best = 0;
+int	 i, n;
+
+
+    if (l_Page < 0)
+	return 0;
+
+    i = pId->Key % HIST_SLOT_CNT;
+    for (n = 0;  n < HIST_SLOT_CNT;  n++)
+    {
+	pSlot = SLOT(l_Page, i);
+	if (pSlot->Key == ERASED_WORD)
+	    break;			// end of the probe sequence
+
+	if (pSlot->Key == pId->Key  &&  pSlot->Seq != ERASED_WORD
+	&&  pSlot->Seq > best  &&  HistoryRead (pSlot->Seq, &session) == 0
+	&&  IdentityEqual (&session, pId))
+	    best = pSlot->Seq;
+
+	i = (i + 1) % HIST_SLOT_CNT;
+    }
+
+    return best;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read Session
+ *
+ * Reads a session record from the log.
+ *
+ * @param[in] seq
+ *	Sequence number of the record, e.g. from HistoryLookup(), or
+ *	<b>PrevSeq</b> of another session.
+ *
+ * @param[out] pSession
+ *	Address where to store the session.
+ *
+ * @return
+ *	0 if the session has been read, -1 if it is not in the log (anymore).
+ *
+ ******************************************************************************/
+int	HistoryRead (uint32_t seq, HIST_SESSION *pSession)
+{
+LOG_REC_HDR hdr;
+
+
+    if (seq == 0
+    ||  LogFind (seq, &hdr, (uint8_t *) pSession, sizeof(*pSession))
+	!= (int) sizeof(*pSession)
+    ||  hdr.Type != LOG_TYPE_PACK)
+	return -1;
+
+    pSession->Name[HIST_NAME_MAX - 1] = EOS;
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Rebuild the Index
+ *
+ * Scans the log for session records and writes a new index page with the
+ * newest session of each pack.  This takes about 20ms for the page erase,
+ * plus the time to read the log.
+ *
+ * @return
+ *	0 if the index has been written, or a negative error code of type
+ *	@ref msc_Return_TypeDef.
+ *
+ ******************************************************************************/
+int	HistoryRebuild (void)
+{
+HIST_SESSION session;
+LOG_CURSOR cursor;
+LOG_REC_HDR hdr;
+int	 len, status;
+
+
+    if (LogImageEnd() > HIST_START_ADDR)
+	return logNotAvailable;
+
+    l_TabCnt = 0;
+    LogRewind (&cursor);
+    while ((len = LogRead (&cursor, &hdr, (uint8_t *) &session,
+			   sizeof(session))) >= 0)
+    {
+	if (hdr.Type == LOG_TYPE_PACK  &&  len == (int) sizeof(session))
+	    TabAdd (&session, hdr.Seq);
+    }
+
+    MSC_Init();
+    status = PageWrite();
+    MSC_Deinit();
+
+    l_Rebuilds++;
+
+    return status;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	History Statistics
+ *
+ ******************************************************************************/
+void	HistoryStats (HIST_STATS *pStats)
+{
+    pStats->Page = l_Page;
+    pStats->Generation = l_Gen;
+    pStats->Used = l_Used;
+    pStats->Rebuilds = l_Rebuilds;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Open Session
+ *
+ * Reads identity and values of the connected pack, and looks up its
+ * previous session.
+ *
+ * @return
+ *	true if the session has been opened, false if a register could not be
+ *	read.
+ *
+ ******************************************************************************/
+static bool SessionOpen (void)
+{
+uint8_t	 name[SBS_CMD_SIZE(SBS_ManufacturerName)];
+uint32_t serial, date, cycles, fcc, value;
+int	 len;
+
+
+    if (BatteryRegReadValue (SBS_SerialNumber, &serial) < 0
+    ||  BatteryRegReadValue (SBS_ManufactureDate, &date) < 0
+    ||  BatteryRegReadValue (SBS_CycleCount, &cycles) < 0
+    ||  BatteryRegReadValue (SBS_FullChargeCapacity, &fcc) < 0)
+	return false;
+
+    memset (&l_Cur, 0, sizeof(l_Cur));
+    l_Cur.SerialNumber    = serial;
+    l_Cur.ManufactureDate = date;
+    l_Cur.CycleCount      = cycles;
+    l_Cur.FullChargeCap   = fcc;
+
+    /* TI provides StateOfHealth, otherwise use the design capacity */
+    if (g_BatteryCtrlType == BCT_TI
+    &&  BatteryRegReadValue (SBS_StateOfHealth, &value) == 0)
+	l_Cur.SoH = value;
+    else if (BatteryRegReadValue (SBS_DesignCapacity, &value) == 0
+	 &&  value > 0)
+	l_Cur.SoH = fcc * 100 / value;
+
+    /* First byte contains the number of valid bytes */
+    if (BatteryRegReadBlock (SBS_ManufacturerName, name, sizeof(name)) == 0)
+    {
+	len = name[0];
+	if (len > (int) sizeof(name) - 1)
+	    len = sizeof(name) - 1;
+	if (len > HIST_NAME_MAX - 1)
+	    len = HIST_NAME_MAX - 1;
+	memcpy (l_Cur.Name, name + 1, len);
+    }
+
+    l_Cur.Key = IdentityKey (&l_Cur);
+    l_Cur.ConnectTime = (uint32_t) time(NULL);
+    l_Cur.PrevSeq = HistoryLookup (&l_Cur);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Identity Key
+ *
+ * Calculates the FNV-1a hash of ManufacturerName, SerialNumber, and
+ * ManufactureDate.
+ *
+ ******************************************************************************/
+static uint32_t IdentityKey (const HIST_SESSION *pId)
+{
+uint8_t	 data[4];
+uint32_t hash = 2166136261UL;
+int	 i;
+
+
+    for (i = 0;  i < HIST_NAME_MAX  &&  pId->Name[i] != EOS;  i++)
+	hash = (hash ^ (uint8_t) pId->Name[i]) * 16777619UL;
+
+    memcpy (data, &pId->SerialNumber, 2);
+    memcpy (data + 2, &pId->ManufactureDate, 2);
+    for (i = 0;  i < 4;  i++)
+	hash = (hash ^ data[i]) * 16777619UL;
+
+    /* An erased word marks a free slot */
+    return (hash == ERASED_WORD ? hash - 1 : hash);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Compare Identities
+ *
+ ******************************************************************************/
+static bool IdentityEqual (const HIST_SESSION *pA, const HIST_SESSION *pB)
+{
+    return (pA->Key == pB->Key
+	&&  pA->SerialNumber == pB->SerialNumber
+	&&  pA->ManufactureDate == pB->ManufactureDate
+	&&  strncmp (pA->Name, pB->Name, HIST_NAME_MAX) == 0);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Insert into Index
+ *
+ * Writes a slot for the session record.  If only one free slot is left,
+ * the index is compacted into the other page first.  Slots whose record
+ * cannot be read as a session with this key are dropped then, e.g. a slot
+ * torn by a power failure, or a session which has been overwritten in the
+ * log.
+ *
+ ******************************************************************************/
+static int  IndexInsert (uint32_t key, uint32_t seq)
+{
+HIST_SESSION session;
+const HIST_SLOT *pSlot;
+int	 i, status = mscReturnOk;
+
+
+    MSC_Init();
+
+    if (l_Page < 0  ||  l_Used >= HIST_SLOT_CNT - 1)
+    {
+	/* Keep the newest session of each pack */
+	l_TabCnt = 0;
+	for (i = 0;  l_Page >= 0  &&  i < HIST_SLOT_CNT;  i++)
+	{
+	    pSlot = SLOT(l_Page, i);
+	    if (pSlot->Key != ERASED_WORD
+	    &&  HistoryRead (pSlot->Seq, &session) == 0
+	    &&  session.Key == pSlot->Key)
+		TabAdd (&session, pSlot->Seq);
+	}
+
+	status = PageWrite();
+    }
+
+    if (status == mscReturnOk)
+	status = SlotWrite (l_Page, key, seq);
+
+    if (status == mscReturnOk)
+	l_Used++;
+
+    MSC_Deinit();
+
+    return status;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write Index Page
+ *
+ * Erases the page which is not in use, writes the slots of @ref l_Tab, and
+ * then the header with the next generation.  The flash controller must have
+ * been unlocked.
+ *
+ ******************************************************************************/
+static int  PageWrite (void)
+{
+HIST_PAGE_HDR hdr;
+int	 page = (l_Page < 0 ? 0 : (l_Page + 1) % HIST_PAGE_CNT);
+int	 i, status;
+
+
+    status = LogFlashErase (PAGE_ADDR(page));
+
+    for (i = 0;  i < l_TabCnt  &&  status == mscReturnOk;  i++)
+	status = SlotWrite (page, l_Tab[i].Key, l_Tab[i].Seq);
+
+    hdr.Magic      = HIST_PAGE_MAGIC;
+    hdr.Generation = l_Gen + 1;
+    hdr.SlotCnt    = HIST_SLOT_CNT;
+    hdr.Crc	   = TlmCRC16 (0xFFFF, (const uint8_t *) &hdr,
+			       offsetof(HIST_PAGE_HDR, Crc));
+
+    if (status == mscReturnOk)
+	status = LogFlashWrite (PAGE_ADDR(page), &hdr, sizeof(hdr));
+
+    if (status == mscReturnOk
+    &&  memcmp (&hdr, (const void *) PAGE_ADDR(page), sizeof(hdr)) != 0)
+	status = mscReturnInvalidAddr;
+
+    if (status != mscReturnOk)
+	return status;		// the old page remains valid
+
+    l_Page = page;
+    l_Gen  = hdr.Generation;
+    l_Used = l_TabCnt;
+
+    return mscReturnOk;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write Slot
+ *
+ * Writes key and sequence number into the first free slot of the probe
+ * sequence.  The flash controller must have been unlocked.
+ *
+ ******************************************************************************/
+static int  SlotWrite (int page, uint32_t key, uint32_t seq)
+{
+HIST_SLOT slot = { key, seq };
+int	 i, n;
+
+
+    i = key % HIST_SLOT_CNT;
+    for (n = 0;  n < HIST_SLOT_CNT;  n++)
+    {
+	if (SLOT(page, i)->Key == ERASED_WORD)
+	    return LogFlashWrite (SLOT_ADDR(page, i), &slot, sizeof(slot));
+
+	i = (i + 1) % HIST_SLOT_CNT;
+    }
+
+    return mscReturnInvalidAddr;	// no free slot
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add to Table
+ *
+ * Keeps the newest sequence number per pack in @ref l_Tab.  Different
+ * packs may have the same key, so the identity is compared with the record
+ * of an entry with this key.  If the table is full, the pack with the oldest
+ * session is replaced.
+ *
+ * @param[in] pSession
+ *	Session which has been read from the log.
+ *
+ * @param[in] seq
+ *	Sequence number of its record.
+ *
+ ******************************************************************************/
+static void TabAdd (const HIST_SESSION *pSession, uint32_t seq)
+{
+HIST_SESSION session;
+int	 i, oldest = 0;
+
+
+    for (i = 0;  i < l_TabCnt;  i++)
+    {
+	if (l_Tab[i].Key == pSession->Key
+	&&  HistoryRead (l_Tab[i].Seq, &session) == 0
+	&&  IdentityEqual (&session, pSession))
+	{
+	    if (seq > l_Tab[i].Seq)
+		l_Tab[i].Seq = seq;
+	    return;
+	}
+	if (l_Tab[i].Seq < l_Tab[oldest].Seq)
+	    oldest = i;
+    }
+
+    if (l_TabCnt < HIST_PACK_MAX)
+	i = l_TabCnt++;
+    else if (seq > l_Tab[oldest].Seq)
+	i = oldest;
+    else
+	return;
+
+    l_Tab[i].Key = pSession->Key;
+    l_Tab[i].Seq = seq;
+}
@@ -0,0 +1,90 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module History.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	HIST_START_ADDR is the origin of linker region HRDDATA.
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_History_h
+#define __INC_History_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "Log.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Number of flash pages of the index, they are used alternately. */
+#define HIST_PAGE_CNT		2
+
+    /*!@brief Start address of the index, the pages below the log.  This is
+     * the origin of the region HRDDATA of the linker scripts.
+     */
+#define HIST_START_ADDR		(LOG_START_ADDR - HIST_PAGE_CNT * FLASH_PAGE_SIZE)
+
+    /*!@brief Magic number of an index page header, "HIDX" */
+#define HIST_PAGE_MAGIC		0x58444948
+
+    /*!@brief Size of the index page header in bytes. */
+#define HIST_PAGE_HDR_SIZE	16
+
+    /*!@brief Number of slots per index page. */
+#define HIST_SLOT_CNT		((FLASH_PAGE_SIZE - HIST_PAGE_HDR_SIZE) / 8)
+
+    /*!@brief Maximum number of packs kept in the index.  This is half the
+     * slots, so the index can take as many updates before it is compacted.
+     */
+#define HIST_PACK_MAX		(HIST_SLOT_CNT / 2)
+
+    /*!@brief Maximum length of the ManufacturerName. */
+#define HIST_NAME_MAX		22
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Session of a battery pack, stored as @ref LOG_TYPE_PACK record.
+     * The first fields identify the pack, the values are read at connect.
+     */
+typedef struct
+{
+    uint32_t	 PrevSeq;	//!< Previous session of this pack, 0 if none
+    uint32_t	 Key;		//!< Hash of the identity
+    uint32_t	 ConnectTime;	//!< Time the pack was connected, see time()
+    uint32_t	 CloseTime;	//!< Time the pack was removed
+    uint16_t	 SerialNumber;	//!< SerialNumber
+    uint16_t	 ManufactureDate; //!< ManufactureDate
+    uint16_t	 CycleCount;	//!< CycleCount
+    uint16_t	 SoH;		//!< State of health in [%]
+    uint16_t	 FullChargeCap;	//!< FullChargeCapacity
+    char	 Name[HIST_NAME_MAX];	//!< ManufacturerName, 0-terminated
+} HIST_SESSION;
+
+    /*!@brief Statistics, see HistoryStats(). */
+typedef struct
+{
+    int		 Page;		//!< Index page in use, -1 if none
+    uint32_t	 Generation;	//!< Incremented with each compaction
+    int		 Used;		//!< Number of used slots
+    uint32_t	 Rebuilds;	//!< Number of rebuilds from the log
+} HIST_STATS;
+
+/*================================ Prototypes ================================*/
+
+void	HistoryInit (void);
+void	HistoryCheck (void);
+void	HistoryClose (void);
+bool	HistoryCurrent (HIST_SESSION *pSession);
+uint32_t HistoryLookup (const HIST_SESSION *pId);
+int	HistoryRead (uint32_t seq, HIST_SESSION *pSession);
+int	HistoryRebuild (void);
+void	HistoryStats (HIST_STATS *pStats);
+
+
+#endif /* __INC_History_h */
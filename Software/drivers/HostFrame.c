@@ -0,0 +1,169 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Receiver of Binary Frames from the PC
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * The binary protocols from the PC to the HRD, i.e. the bridge requests,
+ * see Bridge.c, the data flash restore, see DataFlash.c, and the download
+ * acknowledgements, see Download.c, all use the same framing:
+ * <pre>
+ *   SYNC  LEN  DATA[LEN]  CRC[2]
+ * </pre>
+ * - <b>SYNC</b> is always @ref HOST_FRAME_SYNC.
+ * - <b>LEN</b> is the number of data bytes, its valid range is given by the
+ *   protocol.  A frame with another length is discarded, and the receiver
+ *   searches for the next sync byte.
+ * - <b>CRC</b> is a CRC-16/CCITT over LEN and DATA, the same as for the
+ *   telemetry frames, see Telemetry.c.
+ *
+ * The LEUART wakes up the main loop on the sync byte.  While the rest of a
+ * frame is pending, HostFrameReceive() arms the receive interrupt for the
+ * next byte, see drvLEUART_RxWake(), so the main loop does not need to poll.
+ * Only the bytes of the current frame are taken from the LEUART, a caller
+ * which has no room for the next frame can leave it in the receive buffer.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_device.h"
+#include "em_assert.h"
+#include "HostFrame.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start receiving Frames
+ *
+ * Initializes the receiver, and lets the LEUART wake up the main loop on
+ * the sync byte.
+ *
+ * @param[out] pRx
+ *	Receiver to initialize.
+ *
+ * @param[in] pBuf
+ *	Receive buffer, it must hold <b>lenMax</b> + @ref HOST_FRAME_OVERHEAD
+ *	bytes.
+ *
+ * @param[in] lenMin
+ *	Smallest valid LEN of the protocol.
+ *
+ * @param[in] lenMax
+ *	Largest valid LEN of the protocol.
+ *
+ ******************************************************************************/
+void	 HostFrameStart (HOST_FRAME_RX *pRx, uint8_t *pBuf,
+			 int lenMin, int lenMax)
+{
+    EFM_ASSERT (pRx != NULL  &&  pBuf != NULL);
+    EFM_ASSERT (lenMin <= lenMax  &&  lenMax <= 255);
+
+    pRx->pBuf = pBuf;
+    pRx->Len = 0;
+    pRx->LenMin = (uint8_t) lenMin;
+    pRx->LenMax = (uint8_t) lenMax;
+    pRx->flgDone = false;
+    pRx->Overruns = drvLEUART_RxOverruns();
+
+    drvLEUART_RxSigFrame (HOST_FRAME_SYNC);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop receiving Frames
+ *
+ * The LEUART wakes up the main loop on the end of a command line again.
+ *
+ ******************************************************************************/
+void	 HostFrameStop (HOST_FRAME_RX *pRx)
+{
+    pRx->Len = 0;
+
+    drvLEUART_RxWake (false);
+    drvLEUART_RxSigFrame ('\n');
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Receive a Frame
+ *
+ * Takes the received bytes of the current frame from the LEUART.  A frame
+ * which has been returned before is discarded by the next call.  If the
+ * LEUART has lost data, the incomplete frame is discarded.
+ *
+ * @param[in,out] pRx
+ *	Receiver, see HostFrameStart().
+ *
+ * @return
+ *	@ref HOST_FRAME_OK if a frame is complete, its LEN is at index 1 of
+ *	the buffer and its data at index 2.  @ref HOST_FRAME_CRC_ERR if it
+ *	has a CRC error, or @ref HOST_FRAME_NONE if no frame is complete.
+ *
+ ******************************************************************************/
+int	 HostFrameReceive (HOST_FRAME_RX *pRx)
+{
+uint8_t	*pBuf = pRx->pBuf;
+int	 need;			// number of bytes missing in the frame
+int	 cnt;
+uint16_t crc;
+
+
+    if (pRx->flgDone)
+    {
+	pRx->flgDone = false;
+	pRx->Len = 0;
+    }
+
+    for (;;)
+    {
+	/* Read only the bytes of this frame */
+	need = (pRx->Len < 2 ? 1 : pBuf[1] + HOST_FRAME_OVERHEAD - pRx->Len);
+	cnt = drvLEUART_RxRead ((char *)pBuf + pRx->Len, need);
+
+	if (pRx->Overruns != drvLEUART_RxOverruns())
+	{
+	    pRx->Overruns = drvLEUART_RxOverruns();
+	    pRx->Len = 0;		// data lost, wait for the next sync byte
+	}
+
+	if (cnt == 0)
+	    break;
+
+	if (pRx->Len == 0  &&  pBuf[0] != HOST_FRAME_SYNC)
+	    continue;			// search for sync byte
+
+	pRx->Len += cnt;
+
+	if (pRx->Len == 2
+	&&  (pBuf[1] < pRx->LenMin  ||  pBuf[1] > pRx->LenMax))
+	{
+	    pRx->Len = 0;		// invalid length, re-sync
+	    continue;
+	}
+
+	if (pRx->Len > 2  &&  pRx->Len == pBuf[1] + HOST_FRAME_OVERHEAD)
+	{
+	    pRx->flgDone = true;
+	    drvLEUART_RxWake (false);
+
+	    crc = pBuf[2 + pBuf[1]] | (pBuf[2 + pBuf[1] + 1] << 8);
+	    if (TlmCRC16 (0xFFFF, pBuf + 1, 1 + pBuf[1]) != crc)
+		return HOST_FRAME_CRC_ERR;
+
+	    return HOST_FRAME_OK;
+	}
+    }
+
+    /* Wake up on the next byte while a frame is incomplete */
+    drvLEUART_RxWake (pRx->Len > 0);
+
+    return HOST_FRAME_NONE;
+}
@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module HostFrame.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_HostFrame_h
+#define __INC_HostFrame_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Sync byte at the start of each frame from the PC. */
+#define HOST_FRAME_SYNC		0x5A
+
+    /*!@brief Number of bytes of a frame besides LEN bytes: SYNC, LEN, CRC. */
+#define HOST_FRAME_OVERHEAD	4
+
+    /*!@brief Return codes of HostFrameReceive(). */
+#define HOST_FRAME_NONE		0	//!< no complete frame yet
+#define HOST_FRAME_OK		1	//!< frame received
+#define HOST_FRAME_CRC_ERR	(-1)	//!< frame with CRC error, discarded
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Receiver of frames from the PC.
+ *
+ * The frame is stored in <b>pBuf</b>, starting with the sync byte, i.e. LEN
+ * is at index 1, and the data at index 2.  All elements are private to
+ * module HostFrame.c, use the functions below.
+ */
+typedef struct
+{
+    uint8_t	*pBuf;		//!< receive buffer
+    uint16_t	 Len;		//!< number of bytes in the buffer
+    uint8_t	 LenMin;	//!< smallest valid LEN
+    uint8_t	 LenMax;	//!< largest valid LEN
+    bool	 flgDone;	//!< frame complete, start a new one
+    uint32_t	 Overruns;	//!< receive overruns of the LEUART so far
+} HOST_FRAME_RX;
+
+/*================================ Prototypes ================================*/
+
+void	 HostFrameStart (HOST_FRAME_RX *pRx, uint8_t *pBuf,
+			 int lenMin, int lenMax);
+void	 HostFrameStop (HOST_FRAME_RX *pRx);
+int	 HostFrameReceive (HOST_FRAME_RX *pRx);
+
+
+#endif /* __INC_HostFrame_h */
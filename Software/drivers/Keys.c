@@ -13,6 +13,7 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	The autorepeat timer is created via msTimerCreate().
 2016-11-22,rage	Added support for Power-Key.
 2015-06-22,rage	Derived from project "AlarmClock".
 */
@@ -58,10 +59,15 @@ static KEY_STATE     l_KeyState = KEY_IDLE;
     /*! Variable to keep autorepeat key code */
 static KEYCODE	     l_KeyCode;
 
+#if KEY_AUTOREPEAT
+    /*! Handle of the autorepeat timer */
+static TIM_HDL	     l_hdlKeyTimer;
+#endif
+
 /*=========================== Forward Declarations ===========================*/
 
 #if KEY_AUTOREPEAT
-static void  KeyTimerFct (void);
+static void  KeyTimerFct (TIM_HDL hdl);
 #endif
 
 
@@ -122,7 +128,7 @@ void	KeyInit (const KEY_INIT *pInitStruct)
 
 #if KEY_AUTOREPEAT
     /* Install high-resolution timer routine for autorepeat */
-    msTimerAction (KeyTimerFct);
+    l_hdlKeyTimer = msTimerCreate (KeyTimerFct);
 #endif
 }
 
@@ -201,7 +207,7 @@ KEYCODE	   keyCode;		// translated key code
 
 #if KEY_AUTOREPEAT
 	/* be sure to cancel a running timer */
-	msTimerCancel();
+	msTimerCancel (l_hdlKeyTimer);
 #endif
 
 	/* pass a KEYCODE_XXX_RELEASE code to the KEY_FCT */
@@ -223,7 +229,7 @@ KEYCODE	   keyCode;		// translated key code
 
 #if KEY_AUTOREPEAT
 	/* start timer with autorepeat threshold */
-	msTimerStart (l_pKeyInit->AR_Threshold);
+	msTimerStart (l_hdlKeyTimer, l_pKeyInit->AR_Threshold);
 #endif
     }
 
@@ -245,10 +251,10 @@ KEYCODE	   keyCode;		// translated key code
  *   key rate, i.e. the currently asserted key has to be repeated.
  *
  ******************************************************************************/
-static void  KeyTimerFct (void)
+static void  KeyTimerFct (TIM_HDL hdl)
 {
     /* re-start timer with autorepeat rate */
-    msTimerStart (l_pKeyInit->AR_Rate);
+    msTimerStart (hdl, l_pKeyInit->AR_Rate);
 
     /* call the specified KEY_FCT with the REPEAT code */
     l_pKeyInit->KeyFct (l_KeyCode);
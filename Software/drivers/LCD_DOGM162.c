@@ -2,7 +2,7 @@
  * @file
  * @brief	Routines for LCD Module EA DOGM162
  * @author	Ralf Gerhauser
- * @version	2020-01-13
+ * @version	2026-10-18
  *
  * This module contains the low-level, i.e. the DOGM162 specific part of the
  * display routine.  They are used by module Display.c, but should never be
@@ -10,6 +10,13 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	LCD_vPrintf: The copy for the LEUART only holds the LCD
+		contents, the text of the field is passed to
+		drvLEUART_printf() directly, see l_SerLine.
+2026-10-18,agent	No ASCII mirror to the LEUART in binary telemetry mode.
+2026-10-18,agent	LCD_vPrintf: Replaced the copy of the serial output
+		string and strcmp() by a flag, which is set when a field has
+		changed. Output to LEUART via drvLEUART_printf() in one piece.
 2020-02-13,rage	Use LCD_SetContrast() to set contrast before calling LCD_Init().
 		LCD_vPrintf: Increased buffer sizes, wrap output on LCD if data
 		string ist longer than the field width.
@@ -31,6 +38,8 @@ Revision History:
 #include "em_gpio.h"
 #include "AlarmClock.h"
 #include "LCD_DOGM162.h"
+#include "LEUART.h"
+#include "Telemetry.h"
 
 /*=============================== Definitions ================================*/
 
@@ -142,6 +151,13 @@ static volatile int l_Contrast = 30;
     /*!@brief Flag if LCD is on. */
 static volatile bool l_flgLCD_IsOn;
 
+    /*!@brief Copy of the LCD contents for the LEUART, see LCD_Printf(). */
+static char l_SerLine[LCD_DIMENSION_Y][LCD_DIMENSION_X] =
+{
+    "                ",
+    "                "
+};
+
 /*=========================== Forward Declarations ===========================*/
 
 static uint8_t BusyRead (void);
@@ -293,12 +309,13 @@ void LCD_PowerOff (void)
  * LEUART support is realized in the following way: Since the LCD consists
  * of several independent fields on its two lines, which may be updated
  * separately at different times, it is not useful to write this information
- * directly to the LEUART.  Instead a copy of the complete LCD contents is held
- * in a memory buffer and updated synchronously to the LCD.  This buffer will
- * be written to the LEUART after dedicated fields have been updated (i.e.
- * LCD_ITEM_DATA and LCD_LINE2_TEXT), and, the content of the buffer has
- * changed.  As a special feature, if the length of LCD_LINE2_TEXT field is
- * longer than the LCD line, it will be output to the LEUART in complete length.
+ * directly to the LEUART.  Instead a copy of the LCD contents is held in
+ * @ref l_SerLine and updated synchronously to the LCD.  It will be written
+ * to the LEUART after dedicated fields have been updated (i.e. LCD_ITEM_DATA
+ * and LCD_LINE2_TEXT), and, the content has changed.  As a special feature,
+ * if the text of such a field is longer than the field, it will be output to
+ * the LEUART in complete length.  The lines are formatted directly into the
+ * transmit FIFO by drvLEUART_printf(), followed by the text of the field.
  *
  * @param[in] id
  *	Identifier of type @ref LCD_FIELD_ID to select a field on the LCD.
@@ -342,10 +359,11 @@ va_list	 args;
 void LCD_vPrintf (LCD_FIELD_ID id, const char *frmt, va_list args)
 {
 static int  strStart;
-static char currSerBuf[130] = "                                ";
-static char prevSerBuf[130];
-char	 buffer[120];		// must be smaller than currSerBuf/prevSerBuf!
-int	 len, fieldWidth;
+static uint32_t serTail;		// hash of the text beyond the field
+static bool flgSerChanged = true;	// set if l_SerLine has been changed
+char	 buffer[120];		// formatted text of the field
+int	 len, fieldWidth, i;
+uint32_t tail;
 char	*pField;
 
 
@@ -391,27 +409,39 @@ char	*pField;
     while (len < fieldWidth)
 	buffer[len++] = ' ';
 
-    /* First update the respective part of the serial output string */
-    pField = currSerBuf+(l_pField[id].Y * (LCD_DIMENSION_X+1) + l_pField[id].X);
-    strncpy(pField, buffer, len);
-
-    /* Be sure to put a space between the two line fields */
-    currSerBuf[LCD_DIMENSION_X] = ' ';
+    /* First update the respective part of the serial output lines */
+    pField = &l_SerLine[l_pField[id].Y][l_pField[id].X];
+    if (memcmp(pField, buffer, fieldWidth) != 0)
+    {
+	memcpy(pField, buffer, fieldWidth);
+	flgSerChanged = true;
+    }
 
     /* At the end of the update sequence write string to LEUART */
     if (id == LCD_ITEM_DATA  ||  id == LCD_LINE2_TEXT)
     {
-	/* Terminate data string for serial console output */
-	pField[len] = EOS;
+	/* The text beyond the field is not held in l_SerLine */
+	for (tail = 0, i = fieldWidth;  i < len;  i++)
+	    tail = tail * 31 + (uint8_t)buffer[i];
+	if (tail != serTail)
+	{
+	    serTail = tail;
+	    flgSerChanged = true;
+	}
 
 	/* Has output changed? */
-	if (strcmp(currSerBuf, prevSerBuf) != 0)
+	if (flgSerChanged)
 	{
-	    /* Yes, update serial buffer and write it to the LEUART */
-	    strcpy(prevSerBuf, currSerBuf);
-
-	    drvLEUART_puts(currSerBuf);
-	    drvLEUART_puts("\n");
+	    /* Yes, write it to the LEUART */
+	    flgSerChanged = false;
+
+	    /* No ASCII mirror in binary telemetry mode */
+	    if (TlmModeGet() == TLM_MODE_TEXT)
+		drvLEUART_printf("%.*s%s%.*s%.*s\n",
+				 l_pField[id].Y > 0 ? LCD_DIMENSION_X : 0,
+				 l_SerLine[0], l_pField[id].Y > 0 ? " " : "",
+				 l_pField[id].X, l_SerLine[l_pField[id].Y],
+				 len, buffer);
 
 	    strStart = 0;
 	}
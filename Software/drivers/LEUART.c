@@ -3,14 +3,16 @@
  * @brief	LEUART Driver
  * @author	Energy Micro AS
  * @author	Ralf Gerhauser
- * @version	2015-01-15
+ * @version	2026-10-18
  *
  * This is the driver for the Low Energy UART.  It is used to write log and
  * debug information to a connected host system.  The LEUART device to use
  * can be set via the @ref LEUART define, for an assignment of the DMA channel,
  * see @ref DMA_CHAN_LEUART_RX and @ref DMA_CHAN_LEUART_TX.
  *
- * @note This driver only supports data transmission.
+ * If @ref ENABLE_LEUART_RECEIVER is set, received data is written by DMA into
+ * a circular buffer, and the signal frame interrupt notifies the application
+ * about a complete line, see drvLEUART_RxRead().
  *
  ******************************************************************************
  * @section License
@@ -42,18 +44,51 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added drvLEUART_RxWake() to wake up the main loop on the
+		next received byte, e.g. for the rest of a binary frame.
+2026-10-18,agent	fmtFormat(): Added the precision of strings, e.g. "%.*s".
+2026-10-18,agent	Added drvLEUART_TxIdle().
+2026-10-18,agent	Added drvLEUART_WriteV() to write a block from several
+		parts, e.g. directly from the flash.
+2026-10-18,agent	Added drvLEUART_TxFree() for flow control of bulk
+		transfers. The Tx DMA interrupt sets g_flgIRQ, so a waiting
+		transfer continues when the FIFO has free space again.
+2026-10-18,agent	Added drvLEUART_RxSigFrame() to change the wake-up
+		character.
+2026-10-18,agent	Added drvLEUART_Write() to send binary telemetry frames.
+2026-10-18,agent	Receiver: DMA in ping-pong mode into a circular buffer
+		instead of the 40 byte g_CmdLine, the signal frame interrupt
+		wakes up the main loop.  Added drvLEUART_RxRead().  The buffer
+		holds more than a bridge request frame, overruns are detected
+		and counted, see drvLEUART_RxOverruns().
+2026-10-18,agent	Added drvLEUART_printf() and drvLEUART_vprintf(), which
+		format directly into the transmit FIFO, and
+		drvLEUART_DropCount(). Dropped output is reported by a marker.
+2026-10-18,agent	LEUART Tx uses both DMA descriptors in ping-pong mode,
+		so the line stays busy across the FIFO wrap-around and between
+		bursts.  Completed descriptors are detected by their cycle
+		control, since one DMA interrupt may report both of them. Added
+		drvLEUART_TxStats() and, for DEBUG, drvLEUART_TxRateTest() to
+		measure the throughput.
+2026-10-18,agent	The transmit FIFO is now a RING_BUF, see module
+		RingBuf.c. drvLEUART_puts() reserves space for the whole string,
+		so it may be called from several contexts, including ISRs.  The
+		DMA is claimed via the consumer lock instead of INT_Disable().
 2016-09-27,rage	Use INT_En/Disable() instead of __en/disable_irq().
 */
 
 /*=============================== Header Files ===============================*/
 
+#include <stdarg.h>
+#include <string.h>
 #include "em_chip.h"
 #include "em_device.h"
 #include "em_cmu.h"
 #include "em_emu.h"
-#include "em_int.h"
 #include "em_leuart.h"
+#include "em_assert.h"
 #include "LEUART.h"
+#include "RingBuf.h"
 
 /*=============================== Definitions ================================*/
 
@@ -70,14 +105,33 @@ Revision History:
 #define LEUART_PIN_RX		5		//!< Rx pin
 //@}
 
-    /*! Size of the transmit FIFO in bytes */
+    /*! Size of the transmit FIFO in bytes (must be a power of 2) */
 #define TX_FIFO_SIZE		1024
 
+    /*! Maximum number of bytes per DMA transfer */
+#define DMA_MAX_XFER_CNT	1024
+
 #if ENABLE_LEUART_RECEIVER
-    /*! Size of the command line buffer in bytes */
-#define CMD_LINE_SIZE		40
+    /*! Size of the receive buffer in bytes, each half is one DMA descriptor.
+     * It holds more than a bridge request frame (259 bytes), and 533ms of
+     * data at 9600bd, while the main loop is blocked, e.g. by a flash erase.
+     */
+#define RX_BUF_SIZE		512
+#define RX_HALF_SIZE		(RX_BUF_SIZE / 2)
 #endif
 
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Output sink of the formatter, see fmtFormat(). */
+typedef struct
+{
+    uint16_t	Idx;		//!< FIFO index of the reserved space
+    uint16_t	Cnt;		//!< number of bytes counted/written so far
+    uint16_t	Max;		//!< size of the reserved space
+    bool	flgStore;	//!< false: count only, true: write to FIFO
+    bool	flgLF2CRLF;	//!< translate \<LF> to \<CR>\<LF>
+} FMT_SINK;
+
 /*======================== External Data and Routines ========================*/
 
 extern DMA_DESCRIPTOR_TypeDef g_DMA_ControlBlock[];
@@ -89,11 +143,8 @@ extern DMA_CB_TypeDef g_DMA_Callback[];
 volatile bool	g_flgLEUART_LF2CRLF = true;
 
 #if ENABLE_LEUART_RECEIVER
-/*!@brief Global flag to notify new command in g_CmdLine */
-volatile bool	g_flgCmdLine;
-
-/*!@brief Command line buffer */
-char	 g_CmdLine[CMD_LINE_SIZE];
+/*!@brief Global flag, set when a line terminator has been received */
+volatile bool	g_flgLEUART_RxLine;
 #endif
 
 /*================================ Local Data ================================*/
@@ -144,105 +195,234 @@ DMA_CfgDescr_TypeDef descrCfgTx =
 static DMA_CfgChannel_TypeDef chnlCfgRx =
 {
     .highPri   = false,			// Normal priority
-    .enableInt = false,			// No interrupt for callback function
+    .enableInt = false,			// Interrupt is enabled separately
     .select    = DMAREQ_LEUART_RXDATAV,	// DMA Req. is LEUARTx RX data available
-    .cb        = NULL,			// No callback function
+    .cb = &(g_DMA_Callback[DMA_CHAN_LEUART_RX]), // Callback for RX half full
 };
 
 /* Setting up channel descriptor */
 DMA_CfgDescr_TypeDef descrCfgRx =
 {
     .dstInc  = dmaDataInc1,		// Increment destination address by one
-    .srcInc  = dmaDataIncNone,		// o not increment source address
+    .srcInc  = dmaDataIncNone,		// Do not increment source address
     .size    = dmaDataSize1,		// Data size is one byte
     .arbRate = dmaArbitrate1,		// Rearbitrate for each byte received
     .hprot   = 0,			// No read/write source protection
 };
 #endif
 
-/* Transmit FIFO and index variables */
+#if ENABLE_LEUART_RECEIVER
+/* Receive buffer, filled circularly by DMA, and read position */
+static uint8_t	 rxBuf[RX_BUF_SIZE];
+static uint32_t	 rxPosRd;		// total number of bytes read
+
+/* Number of halves completed by the DMA, and of detected overruns */
+static volatile uint32_t rxHalfCnt;
+static uint32_t	 rxOverruns;
+#endif
+
+/* Transmit FIFO and its ring buffer control structure */
 static uint8_t	 txFIFO[TX_FIFO_SIZE];
-static volatile uint16_t txIdxPut, txIdxGet, txIdxGetNext;
+static RING_BUF	 txRing = { .pBuf = txFIFO, .Mask = TX_FIFO_SIZE - 1 };
+
+/* State of the two DMA descriptors (0: primary, 1: alternate) */
+static volatile uint16_t txDescrCnt[2];	// number of bytes armed per descriptor
+static volatile uint8_t	 txDescrFirst;	// oldest descriptor in flight
+static volatile uint8_t	 txDescrBusy;	// number of descriptors in flight
+static volatile uint16_t txIdxArm;	// FIFO index behind the last armed byte
+
+/* Set by the DMA interrupt, the descriptors must be checked for completion */
+static volatile bool	 txDonePending;
 
-/* Flag if DMA transfer is in progress */
-static volatile bool	flgDMArun;
+/* Forward declarations */
+static void txReportDrops (void);
+#if ENABLE_LEUART_RECEIVER
+static void dmaRxHalfDone (unsigned int channel, bool primary, void *user);
+#endif
+
+/* Throughput statistics */
+static LEUART_TX_STATS	 txStats;
+static uint32_t		 txStartTime;	// RTC value when the DMA became busy
+static bool		 txActive;	// true while the DMA is busy
 
 
 /**************************************************************************//**
- * @brief  DMA Callback function
+ * @brief  Get DMA descriptor of the LEUART Tx channel
  *
- * When the DMA transfer is completed, disables the DMA wake-up on TX in the
- * LEUART to enable the DMA to sleep even when the LEUART buffer is empty.
+ * @param[in] alt
+ *	0 for the primary, 1 for the alternate descriptor.
  *
  ******************************************************************************/
-void dmaTransferStart (void)
+static DMA_DESCRIPTOR_TypeDef *txDescr (int alt)
 {
-uint16_t	idxPut;		// local index variable
-int16_t		cnt;		// number of bytes to send
+    return (alt ? (DMA_DESCRIPTOR_TypeDef *)DMA->ALTCTRLBASE
+		: (DMA_DESCRIPTOR_TypeDef *)DMA->CTRLBASE) + DMA_CHAN_LEUART_TX;
+}
 
 
-    INT_Disable();
+/**************************************************************************//**
+ * @brief  Process completed DMA descriptors
+ *
+ * Releases the bytes of all completed descriptors from the transmit FIFO.
+ * A descriptor is completed when the DMA controller has set its cycle
+ * control to zero.  The interrupts are not counted, because DMA->IF has only
+ * one done bit per channel: if both descriptors complete before the interrupt
+ * is served, e.g. while a flash erase has disabled the interrupts, this is
+ * reported only once.  Must be called with the consumer lock of the FIFO
+ * held.
+ *
+ ******************************************************************************/
+static void dmaTransferRelease (void)
+{
+int	 first;			// oldest descriptor in flight
+
 
-    if (flgDMArun)
+    txDonePending = false;
+
+    while (txDescrBusy > 0)
     {
-	INT_Enable();
-	return;			// do not disturb a running DMA transfer
+	first = txDescrFirst;
+	if ((txDescr(first)->CTRL & _DMA_CTRL_CYCLE_CTRL_MASK) != 0)
+	    break;		// still in flight
+
+	RingBufConsume(&txRing, txDescrCnt[first]);
+	txStats.Bytes += txDescrCnt[first];
+	txDescrCnt[first] = 0;
+	txDescrFirst = first ^ 1;
+	txDescrBusy--;
     }
 
-    flgDMArun = true;		// set flag for DMA activity
-    INT_Enable();
+    if (txDescrBusy == 0  ||  DMA_ChannelEnabled(DMA_CHAN_LEUART_TX))
+	return;
 
-    /* Use local index that will not change */
-    idxPut = txIdxPut;
+    /*
+     * The channel has stopped although a descriptor is still in flight, i.e.
+     * its cycle control is valid.  The controller switched to it before it
+     * has been armed - restart the channel from this descriptor.
+     */
+    if (txDescrFirst)
+	DMA->CHALTS = (1 << DMA_CHAN_LEUART_TX);
+    else
+	DMA->CHALTC = (1 << DMA_CHAN_LEUART_TX);
+
+    DMA->CHENS = (1 << DMA_CHAN_LEUART_TX);
+    txStats.Restarts++;
+}
 
-    /* Calculate how many bytes to transfer */
-    cnt = idxPut - txIdxGet;
 
-    if (cnt == 0)
-    {
-	flgDMArun = false;	// clear flag again
-	return;
-    }
+/**************************************************************************//**
+ * @brief  Arm DMA descriptors
+ *
+ * Arms all free DMA descriptors with the next contiguous blocks of the
+ * transmit FIFO.  Both descriptors are used in ping-pong mode, so the DMA
+ * controller switches from one to the other without a gap on the line, also
+ * across the wrap-around of the FIFO.  Must be called with the consumer lock
+ * of the FIFO held.
+ *
+ ******************************************************************************/
+static void dmaTransferArm (void)
+{
+DMA_DESCRIPTOR_TypeDef *pDescr;	// descriptor to arm
+uint8_t	 *pData;		// start address of the data block
+uint16_t  cnt;			// number of bytes to send
+int	  sel;			// descriptor to arm
 
-    if (cnt < 0)
+
+    while (txDescrBusy < 2)
     {
-	/* Limit DMA transfer to end of FIFO buffer */
-	idxPut = sizeof(txFIFO);
-	cnt = idxPut - txIdxGet;	// calculate number of bytes
+	cnt = txRing.Head - txIdxArm;
+	if (cnt == 0)
+	    break;
+
+	/* Get contiguous block, DMA can maximum handle 1024 bytes */
+	pData = RingBufSpan(&txRing, txIdxArm, &cnt);
+	if (cnt > DMA_MAX_XFER_CNT)
+	    cnt = DMA_MAX_XFER_CNT;
+
+	/* A new sequence always starts with the primary descriptor */
+	if (txDescrBusy == 0)
+	    txDescrFirst = 0;
+
+	sel = (txDescrFirst + txDescrBusy) & 1;
+
+	/* Set source end address, size, and ping-pong mode */
+	pDescr = txDescr(sel);
+	pDescr->SRCEND = pData + cnt - 1;
+	pDescr->CTRL = (pDescr->CTRL & ~(_DMA_CTRL_CYCLE_CTRL_MASK
+					| _DMA_CTRL_N_MINUS_1_MASK))
+		     | ((uint32_t)(cnt - 1) << _DMA_CTRL_N_MINUS_1_SHIFT)
+		     | ((uint32_t)dmaCycleCtrlPingPong
+			<< _DMA_CTRL_CYCLE_CTRL_SHIFT);
+
+	txDescrCnt[sel] = cnt;
+	txIdxArm += cnt;
+
+	if (txDescrBusy++ == 0)
+	{
+	    /* DMA was idle - enable DMA wake-up from LEUART TX and start it */
+	    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 1;
+
+	    txStartTime = RTC->CNT;
+	    txActive = true;
+	    txStats.Starts++;
+
+	    DMA->CHALTC = (1 << DMA_CHAN_LEUART_TX);
+	    DMA->CHENS  = (1 << DMA_CHAN_LEUART_TX);
+	}
     }
-    else if (cnt > 1024)
+}
+
+
+/**************************************************************************//**
+ * @brief  Start DMA transfer
+ *
+ * Services the LEUART Tx DMA: releases completed descriptors and arms free
+ * ones with new data from the transmit FIFO.  This may be called from thread
+ * and interrupt context.  If another context is currently servicing the DMA,
+ * the routine returns immediately, the other context will see the new data
+ * or completion request when it re-checks after releasing the lock.
+ *
+ ******************************************************************************/
+void dmaTransferStart (void)
+{
+    do
     {
-	/* DMA can maximum handle 1024 bytes per transfer - limit it */
-	cnt = 1024;
-	idxPut = txIdxGet + cnt;	// calculate source end address
-    }
+	if (! RingBufConsumerLock(&txRing))
+	    return;
+
+	dmaTransferRelease();
+	dmaTransferArm();
 
-    /* Calculate next value of the Get Index */
-    txIdxGetNext = txIdxGet + cnt;
-    if (txIdxGetNext >= sizeof(txFIFO))
-	txIdxGetNext -= sizeof(txFIFO);
+	if (txDescrBusy == 0  &&  txActive)
+	{
+	    /* DMA is idle now - disable DMA wake-up from LEUART TX */
+	    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 0;
 
-    /* Set new DMA source end address directly in the DMA descriptor */
-    g_DMA_ControlBlock[DMA_CHAN_LEUART_TX].SRCEND = &txFIFO[idxPut-1];
+	    txStats.ActiveTicks += (RTC->CNT - txStartTime) & 0xFFFFFF;
+	    txActive = false;
+	}
 
-    /* Enable DMA wake-up from LEUART TX */
-    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 1;
+	RingBufConsumerUnlock(&txRing);
 
-    /* (Re)starting the transfer. Using Basic Mode */
-    DMA_ActivateBasic(DMA_CHAN_LEUART_TX, // Activate channel selected
-		      true,		// Use primary descriptor
-		      false,		// No DMA burst
-		      NULL,		// Keep destination address
-		      NULL,		// Keep source address
-		      cnt - 1);		// Size of buffer - 1
+    } while (txDonePending
+	 ||  (txDescrBusy < 2  &&  txRing.Head != txIdxArm));
 }
 
 
 /**************************************************************************//**
  * @brief  DMA Callback function
  *
- * When the DMA transfer is completed, disables the DMA wake-up on TX in the
- * LEUART to enable the DMA to sleep even when the LEUART buffer is empty.
+ * Called by the DMA interrupt handler each time a descriptor has been
+ * completed, or both of them.  The DMA is serviced, see
+ * dmaTransferStart().  Since this frees space in the transmit FIFO,
+ * @ref g_flgIRQ is set to let the main loop continue a bulk transfer, see
+ * drvLEUART_TxFree().  When the last descriptor has been completed, the DMA
+ * wake-up on TX in the LEUART is disabled to enable the DMA to sleep even
+ * when the LEUART buffer is empty.
+ *
+ * @note
+ * Parameter <b>primary</b> is not used, since the order of the descriptors
+ * is tracked by the driver itself.
  *
  ******************************************************************************/
 void dmaTransferDone(unsigned int channel, bool primary, void *user)
@@ -251,20 +431,83 @@ void dmaTransferDone(unsigned int channel, bool primary, void *user)
     (void) primary;
     (void) user;
 
-    /* Disable DMA wake-up from LEUART TX */
-    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 0;
+    txDonePending = true;
+
+    dmaTransferStart();
 
-    /* Update Get Index */
-    txIdxGet = txIdxGetNext;
+    g_flgIRQ = true;		// FIFO space has been freed, notify main loop
+}
 
-    /* Clear DMA running flag */
-    flgDMArun = false;
 
-    /* Check if still data to send */
-    dmaTransferStart();
+/***************************************************************************//**
+ *
+ * @brief  Get transmit statistics
+ *
+ * Returns the number of bytes sent by the DMA, and the time the DMA was busy
+ * in RTC ticks.  Together they give the achieved throughput, which can be
+ * compared with the theoretical limit @ref LEUART_TX_BYTES_PER_SEC.
+ *
+ * @param[out] pStats
+ *	Address of the structure to fill.
+ *
+ * @note
+ * A running sequence is not included in <b>ActiveTicks</b>.
+ *
+ ******************************************************************************/
+void	 drvLEUART_TxStats (LEUART_TX_STATS *pStats)
+{
+    *pStats = txStats;
 }
 
 
+#ifdef DEBUG
+/***************************************************************************//**
+ *
+ * @brief  Measure transmit throughput
+ *
+ * Writes a burst of lines, larger than the transmit FIFO can hold at once,
+ * so the DMA has to cross the wrap-around of the FIFO, waits until it has been
+ * sent, and reports the achieved throughput compared with the theoretical
+ * limit of the configured baudrate.
+ *
+ ******************************************************************************/
+void	 drvLEUART_TxRateTest (void)
+{
+LEUART_TX_STATS stats;		// statistics of the test burst
+uint32_t  rate;			// achieved throughput in [bytes/s]
+int	  i;
+
+
+    txStats.Bytes = txStats.ActiveTicks = 0;
+    txStats.Starts = txStats.Restarts = 0;
+
+    for (i = 0;  i < 16;  i++)
+    {
+	drvLEUART_puts("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		       "abcdefghijklmnopqrstuvwxyz0123456789\n");
+
+	/* keep the FIFO filled, but do not overflow it */
+	while (RingBufFree(&txRing) < 80)
+	    EMU_EnterEM1();
+    }
+
+    /* wait until the DMA is idle */
+    while (txDescrBusy != 0  ||  RingBufUsed(&txRing) != 0)
+	EMU_EnterEM1();
+
+    drvLEUART_TxStats(&stats);
+    rate = stats.ActiveTicks ? (uint32_t)((uint64_t)stats.Bytes
+			* RTC_COUNTS_PER_SEC / stats.ActiveTicks) : 0;
+
+    ConsolePrintf("LEUART Tx: %lu bytes, %lu ticks, %lu bytes/s of %lu, "
+		  "%lu starts, %lu restarts\n",
+		  stats.Bytes, stats.ActiveTicks, rate,
+		  (uint32_t)LEUART_TX_BYTES_PER_SEC(leuartInit.baudrate),
+		  stats.Starts, stats.Restarts);
+}
+#endif
+
+
 /**************************************************************************//**
  * @brief  Setup Low Energy UART with DMA operation
  *
@@ -283,29 +526,44 @@ static void setupLeuartDma(void)
     /* Initializing DMA, channel and descriptor for Tx */
     DMA_Init(&dmaInit);
     DMA_CfgChannel(DMA_CHAN_LEUART_TX, &chnlCfgTx);
-    DMA_CfgDescr(DMA_CHAN_LEUART_TX, true, &descrCfgTx);
+    DMA_CfgDescr(DMA_CHAN_LEUART_TX, true,  &descrCfgTx);
+    DMA_CfgDescr(DMA_CHAN_LEUART_TX, false, &descrCfgTx);
 
-    /* Set new DMA destination end address directly in the DMA descriptor */
-    g_DMA_ControlBlock[DMA_CHAN_LEUART_TX].DSTEND = &LEUART->TXDATA;
+    /* Set DMA destination end address directly in both DMA descriptors */
+    txDescr(0)->DSTEND = &LEUART->TXDATA;
+    txDescr(1)->DSTEND = &LEUART->TXDATA;
+    DMA->CHUSEBURSTC = (1 << DMA_CHAN_LEUART_TX);
 
     /* Enable DMA Transfer Complete Interrupt */
-    DMA->IEN = (DMA_IEN_CH0DONE << DMA_CHAN_LEUART_TX);
+    DMA->IEN = (DMA_IEN_CH0DONE << DMA_CHAN_LEUART_TX)
+#if ENABLE_LEUART_RECEIVER
+	     | (DMA_IEN_CH0DONE << DMA_CHAN_LEUART_RX)
+#endif
+	     ;
 
     /* Enable DMA interrupt vector */
     NVIC_EnableIRQ(DMA_IRQn);
 
 #if ENABLE_LEUART_RECEIVER
-    /* Initializing DMA, channel and descriptor */
+    /* Setting call-back function to re-arm the descriptors */
+    g_DMA_Callback[DMA_CHAN_LEUART_RX].cbFunc  = dmaRxHalfDone;
+    g_DMA_Callback[DMA_CHAN_LEUART_RX].userPtr = NULL;
+
+    /* Initializing DMA, channel and both descriptors */
     DMA_CfgChannel(DMA_CHAN_LEUART_RX, &chnlCfgRx);
-    DMA_CfgDescr(DMA_CHAN_LEUART_RX, true, &descrCfgRx);
+    DMA_CfgDescr(DMA_CHAN_LEUART_RX, true,  &descrCfgRx);
+    DMA_CfgDescr(DMA_CHAN_LEUART_RX, false, &descrCfgRx);
 
-    /* Starting the transfer. Using Basic Mode */
-    DMA_ActivateBasic(DMA_CHAN_LEUART_RX, // Activate channel selected
-		      true,		// Use primary descriptor
+    /* Starting the transfer.  Using Ping-Pong Mode, one half per descriptor */
+    rxPosRd = rxHalfCnt = 0;
+    DMA_ActivatePingPong(DMA_CHAN_LEUART_RX, // Activate channel selected
 		      false,		// No DMA burst
-		      (void *) g_CmdLine,	// Destination address
+		      (void *) rxBuf,	// Primary: first half of the buffer
 		      (void *) &LEUART->RXDATA,	// Source address is register
-		      CMD_LINE_SIZE - 1);	// Size of buffer - 1
+		      RX_HALF_SIZE - 1,	// Size of half buffer - 1
+		      (void *) (rxBuf + RX_HALF_SIZE), // Alternate: second half
+		      (void *) &LEUART->RXDATA,	// Source address is register
+		      RX_HALF_SIZE - 1);	// Size of half buffer - 1
 
     /* Set LEUART signal frame to <NL> (or <CR>) */
     LEUART->SIGFRAME = '\n';
@@ -364,11 +622,12 @@ void	drvLEUART_Init (uint32_t baud)
 		    1);				// Pull-Up
 #endif
 
+    /* Initialize the transmit FIFO */
+    RingBufInit(&txRing, txFIFO, sizeof(txFIFO));
+    txIdxArm = 0;
+
     /* Setup LEUART with DMA */
     setupLeuartDma();
-
-    /* Set index variables to the beginning of the FIFO */
-    txIdxPut = txIdxGet = 0;
 }
 
 
@@ -376,13 +635,16 @@ void	drvLEUART_Init (uint32_t baud)
 /**************************************************************************//**
  * @brief LEUART IRQ handler
  *
- * When a character has been received by the LEUART, this interrupt routine will
- * store the character into the rxFIFO.
+ * The received characters are transferred into the receive buffer by DMA,
+ * so the LEUART interrupt only occurs for the signal frame, i.e. when a line
+ * terminator has been received.  It sets @ref g_flgLEUART_RxLine and
+ * @ref g_flgIRQ to wake up the main loop, see drvLEUART_RxRead().  If armed
+ * by drvLEUART_RxWake(), the interrupt also occurs once for the next byte.
  *
  *****************************************************************************/
 void LEUART_IRQHandler(void)
 {
-uint32_t leuartif, len;
+uint32_t leuartif;
 
     /* Store and reset pending interrupts */
     leuartif = LEUART_IntGet(LEUART);
@@ -391,23 +653,188 @@ uint32_t leuartif, len;
     /* Check for frame found */
     if (leuartif & LEUART_IF_SIGF)
     {
-	/* Zero-terminate RX command line buffer */
-	len = CMD_LINE_SIZE - 2
-	    - ((g_DMA_ControlBlock[DMA_CHAN_LEUART_RX].CTRL >> 4) & 0x3FF);
-
-	g_CmdLine[len] = EOS;
-
-	/* set flag to notify new command is available */
-	g_flgCmdLine = true;
-
-	/* Re-start DMA */
-	DMA_ActivateBasic(DMA_CHAN_LEUART_RX, // Activate channel selected
-			  true,		// Use primary descriptor
-			  false,	// No DMA burst
-			  NULL,		// keep destination address
-			  NULL,		// keep source address
-			  CMD_LINE_SIZE - 1);	// Size of buffer - 1
+	/* set flags to notify a new line is available */
+	g_flgLEUART_RxLine = true;
+	g_flgIRQ = true;
     }
+
+    /* Any received byte, the DMA may have read it already */
+    if (LEUART->IEN & LEUART_IEN_RXDATAV)
+    {
+	LEUART_IntDisable(LEUART, LEUART_IEN_RXDATAV);	// one-shot
+	g_flgIRQ = true;
+    }
+}
+
+
+/**************************************************************************//**
+ * @brief  DMA Callback function for Rx
+ *
+ * Called by the DMA interrupt handler each time one half of the receive
+ * buffer has been filled.  The completed descriptor is re-armed for the same
+ * half, while the DMA continues with the other one.
+ *
+ ******************************************************************************/
+static void dmaRxHalfDone(unsigned int channel, bool primary, void *user)
+{
+    (void) user;
+
+    rxHalfCnt++;
+
+    DMA_RefreshPingPong(channel,	// DMA channel
+			primary,	// Descriptor which has been completed
+			false,		// No DMA burst
+			NULL,		// keep destination address
+			NULL,		// keep source address
+			RX_HALF_SIZE - 1, // Size of half buffer - 1
+			false);		// Continue ping-pong cycle
+}
+
+
+/**************************************************************************//**
+ * @brief  Get current write position of the receive DMA
+ *
+ * Returns the total number of bytes the DMA has written into the receive
+ * buffer.  The halves completed so far select the descriptor in use, and its
+ * control word gives the number of bytes it has already transferred.  If the
+ * descriptor has just been completed, the end of its half is returned, which
+ * is still correct.
+ *
+ ******************************************************************************/
+static uint32_t rxPosWrite (void)
+{
+DMA_DESCRIPTOR_TypeDef *pDescr;	// descriptor currently in use
+uint32_t ctrl;			// control word of this descriptor
+uint32_t halfCnt;		// number of completed halves
+uint16_t left;			// number of bytes not transferred yet
+
+
+    do
+    {
+	halfCnt = rxHalfCnt;
+	pDescr = ((halfCnt & 1) ? (DMA_DESCRIPTOR_TypeDef *)DMA->ALTCTRLBASE
+		  : (DMA_DESCRIPTOR_TypeDef *)DMA->CTRLBASE) + DMA_CHAN_LEUART_RX;
+	ctrl = pDescr->CTRL;
+
+    } while (halfCnt != rxHalfCnt);	// the DMA interrupt has intervened
+
+    if ((ctrl & _DMA_CTRL_CYCLE_CTRL_MASK) == 0)
+	left = 0;		// completed, not re-armed yet
+    else
+	left = ((ctrl & _DMA_CTRL_N_MINUS_1_MASK)
+		>> _DMA_CTRL_N_MINUS_1_SHIFT) + 1;
+
+    return halfCnt * RX_HALF_SIZE + RX_HALF_SIZE - left;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Read received data
+ *
+ * Copies the data, which has been received since the last call, from the
+ * receive buffer.  This routine must only be called from the main loop.
+ *
+ * @param[out] pBuf
+ *	Address of the destination buffer.
+ *
+ * @param[in] maxCnt
+ *	Size of the destination buffer in bytes.
+ *
+ * @return
+ *	Number of bytes copied.
+ *
+ * @note
+ * The receive buffer holds @ref RX_BUF_SIZE bytes.  If more data arrives
+ * before it is read, older data has been overwritten.  This overrun is
+ * counted, see drvLEUART_RxOverruns(), and all pending data is discarded,
+ * so the caller resynchronizes on the next line or frame.
+ *
+ ******************************************************************************/
+int	 drvLEUART_RxRead (char *pBuf, int maxCnt)
+{
+uint32_t posWr = rxPosWrite();
+int	 cnt = 0;
+
+
+    g_flgLEUART_RxLine = false;
+
+    if (posWr - rxPosRd > RX_BUF_SIZE)
+    {
+	rxOverruns++;
+	rxPosRd = posWr;		// discard the remains
+    }
+
+    while (rxPosRd != posWr  &&  cnt < maxCnt)
+	pBuf[cnt++] = rxBuf[rxPosRd++ % RX_BUF_SIZE];
+
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Get number of receive overruns
+ *
+ * Returns the number of times received data has been overwritten before it
+ * could be read, see drvLEUART_RxRead().
+ *
+ ******************************************************************************/
+uint32_t drvLEUART_RxOverruns (void)
+{
+    return rxOverruns;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Set receive signal frame character
+ *
+ * The LEUART wakes up the main loop when this character has been received,
+ * see @ref g_flgLEUART_RxLine.  The default is \<LF>, i.e. the end of a
+ * command line.  Binary protocols may use their sync byte instead.
+ *
+ * @param[in] c
+ *	Character to wait for.
+ *
+ ******************************************************************************/
+void	 drvLEUART_RxSigFrame (char c)
+{
+    /* Wait for a previous write to be synchronized to the LF domain */
+    while (LEUART->SYNCBUSY & LEUART_SYNCBUSY_SIGFRAME)
+	;
+
+    LEUART->SIGFRAME = (uint8_t) c;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Wake up on the next received byte
+ *
+ * The signal frame only marks the start of a binary frame, see
+ * drvLEUART_RxSigFrame().  While the rest of a frame is pending, this
+ * routine arms the RXDATAV interrupt, which sets @ref g_flgIRQ once for the
+ * next byte, and is disabled again by the interrupt handler.  Data which
+ * has already arrived sets @ref g_flgIRQ at once.
+ *
+ * @param[in] enable
+ *	true to arm the interrupt, false to disarm it.
+ *
+ ******************************************************************************/
+void	 drvLEUART_RxWake (bool enable)
+{
+    if (! enable)
+    {
+	LEUART_IntDisable(LEUART, LEUART_IEN_RXDATAV);
+	return;
+    }
+
+    LEUART_IntEnable(LEUART, LEUART_IEN_RXDATAV);
+
+    /* A byte read by the DMA before has not triggered the interrupt */
+    if (rxPosWrite() != rxPosRd)
+	g_flgIRQ = true;
 }
 #endif
 
@@ -417,51 +844,153 @@ uint32_t leuartif, len;
  * @brief  Put string into transmit FIFO
  *
  * This routine writes the specified string into the transmit FIFO, where it
- * is transferred to the LEUART via DMA.  If there is no more space in the
- * FIFO, characters will be discarded.
+ * is transferred to the LEUART via DMA.  The space for the whole string is
+ * reserved at once, so strings from different contexts do not interleave.
+ * If there is not enough space in the FIFO, the string will be discarded.
  *
  * @param[in] pStr
  *	Address pointer of the string to write into the FIFO.
  *
+ * @note
+ * This routine does not disable interrupts, it may be called from thread
+ * and interrupt context.
+ *
  ******************************************************************************/
 void	 drvLEUART_puts (const char *pStr)
 {
-int16_t	cnt;			// free buffer space in number of bytes
-bool	sendCR = false;		// set true to write <CR> to buffer
+const char *pCh;		// pointer to walk through the string
+uint16_t cnt;			// number of bytes to write
+uint16_t idx;			// FIFO index of the reserved space
+bool	 flgLF2CRLF = g_flgLEUART_LF2CRLF;	// stable for this call
 
 
-    while (*pStr != EOS)
-    {
-	/* Non-blocking: discard string if FIFO is full */
-	cnt  = txIdxPut;
-	cnt -= txIdxGet;
-	if (cnt < 0)
-	    cnt += sizeof(txFIFO);
+    /* Calculate number of bytes, including <CR> for each <LF> */
+    for (cnt = 0, pCh = pStr;  *pCh != EOS;  pCh++)
+	cnt += (flgLF2CRLF  &&  *pCh == '\n') ? 2 : 1;
 
-	if (cnt > (int16_t)(sizeof(txFIFO) - 2))
-	    break;
+    if (cnt == 0)
+	return;
+
+    txReportDrops();
 
+    /* Non-blocking: discard string if FIFO is full */
+    if (! RingBufReserve(&txRing, cnt, &idx))
+	return;
+
+    for (pCh = pStr;  *pCh != EOS;  pCh++)
+    {
 	/* Check if to translate <LF> to <CR><LF> */
-	if (g_flgLEUART_LF2CRLF  &&  (*pStr == '\n')  &&  ! sendCR)
-	{
-	    /* Write <CR> to FIFO */
-	    txFIFO[txIdxPut] = '\r';
-	    sendCR = true;	// special character <CR>, set flag
-	}
-	else
+	if (flgLF2CRLF  &&  *pCh == '\n')
+	    RING_BUF_AT(&txRing, idx++) = '\r';
+
+	RING_BUF_AT(&txRing, idx++) = *pCh;
+    }
+
+    RingBufCommit(&txRing);
+
+    /* Be sure to enable DMA for data transfer */
+    dmaTransferStart();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Write binary data into the transmit FIFO
+ *
+ * This routine writes a block of binary data into the transmit FIFO.  In
+ * contrast to drvLEUART_puts(), the data is not modified, i.e. there is no
+ * \<LF> translation, and it may contain 0-bytes.  The space for the whole
+ * block is reserved at once, so a block is never split or interleaved with
+ * output from other contexts.
+ *
+ * @param[in] pData
+ *	Address of the data to write.
+ *
+ * @param[in] cnt
+ *	Number of bytes to write.
+ *
+ * @return
+ *	true if the data has been written, false if it has been discarded
+ *	because there was not enough space in the FIFO.
+ *
+ ******************************************************************************/
+bool	 drvLEUART_Write (const uint8_t *pData, uint16_t cnt)
+{
+LEUART_IOVEC vec;
+
+
+    vec.pData = pData;
+    vec.Cnt   = cnt;
+
+    return drvLEUART_WriteV (&vec, 1);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Write binary data from several parts into the transmit FIFO
+ *
+ * This routine works like drvLEUART_Write(), but the block is gathered from
+ * several parts, e.g. a header in RAM and data in the flash.  The data is
+ * copied directly into the FIFO, no intermediate buffer is required.  The
+ * space for all parts is reserved at once, so they are never separated.
+ *
+ * @param[in] pVec
+ *	Address of an array of parts.
+ *
+ * @param[in] vecCnt
+ *	Number of parts.
+ *
+ * @return
+ *	true if the data has been written, false if it has been discarded
+ *	because there was not enough space in the FIFO.
+ *
+ ******************************************************************************/
+bool	 drvLEUART_WriteV (const LEUART_IOVEC *pVec, int vecCnt)
+{
+const uint8_t *pData;		// source address
+uint16_t total = 0;		// number of bytes of all parts
+uint16_t cnt;			// bytes left of the current part
+uint16_t idx;			// FIFO index of the reserved space
+uint16_t span;			// contiguous part of the reserved space
+uint8_t	*pDst;			// destination address
+int	 i;
+
+
+    for (i = 0;  i < vecCnt;  i++)
+	total += pVec[i].Cnt;
+
+    if (total == 0)
+	return true;
+
+    txReportDrops();
+
+    /* Non-blocking: discard data if FIFO is full */
+    if (! RingBufReserve(&txRing, total, &idx))
+	return false;
+
+    /* Copy data, the reserved space may wrap around the end of the FIFO */
+    for (i = 0;  i < vecCnt;  i++)
+    {
+	pData = pVec[i].pData;
+	cnt   = pVec[i].Cnt;
+	while (cnt > 0)
 	{
-	    /* Write Byte to FIFO */
-	    txFIFO[txIdxPut] = *pStr++;
-	    sendCR = false;	// regular character, be sure to clear flag
+	    span = cnt;
+	    pDst = RingBufSpan (&txRing, idx, &span);
+	    memcpy (pDst, pData, span);
+	    pData += span;
+	    idx   += span;
+	    cnt   -= span;
 	}
-
-	/* Increment FIFO index */
-	if (++txIdxPut >= sizeof(txFIFO))
-	    txIdxPut = 0;	// wrap around
     }
 
+    RingBufCommit(&txRing);
+
     /* Be sure to enable DMA for data transfer */
     dmaTransferStart();
+
+    return true;
 }
 
 
@@ -490,3 +1019,366 @@ char	 buffer[2];	// temporary character buffer
     drvLEUART_puts (buffer);
 }
 
+
+/***************************************************************************//**
+ *
+ * @brief  Store a character via the formatter sink
+ *
+ * In counting mode the character is only counted, otherwise it is written
+ * directly into the reserved space of the transmit FIFO.  If enabled, a
+ * \<LF> is expanded to \<CR>\<LF> in the same pass.
+ *
+ ******************************************************************************/
+static void fmtPutc (FMT_SINK *pSink, char c)
+{
+    if (pSink->flgLF2CRLF  &&  c == '\n')
+    {
+	if (pSink->flgStore  &&  pSink->Cnt < pSink->Max)
+	    RING_BUF_AT(&txRing, pSink->Idx + pSink->Cnt) = '\r';
+	pSink->Cnt++;
+    }
+
+    if (pSink->flgStore  &&  pSink->Cnt < pSink->Max)
+	RING_BUF_AT(&txRing, pSink->Idx + pSink->Cnt) = c;
+    pSink->Cnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Output a field with padding
+ *
+ * Writes <b>len</b> characters of <b>pStr</b>, padded to <b>width</b>.
+ *
+ ******************************************************************************/
+static void fmtPutField (FMT_SINK *pSink, const char *pStr, int len,
+			 int width, bool flgLeft, char padChar)
+{
+    /* with zero padding, the sign comes before the zeros */
+    if (padChar == '0'  &&  len > 0  &&  *pStr == '-')
+    {
+	fmtPutc (pSink, *pStr++);
+	len--;
+	width--;
+    }
+
+    if (! flgLeft)
+	for ( ;  width > len;  width--)
+	    fmtPutc (pSink, padChar);
+
+    for ( ;  len > 0;  len--, width--)
+	fmtPutc (pSink, *pStr++);
+
+    for ( ;  width > 0;  width--)
+	fmtPutc (pSink, ' ');
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Minimal formatter
+ *
+ * Formats the string into the sink.  Supported are the conversions
+ * <b>d i u x X c s %</b>, the flags <b>-</b> and <b>0</b>, a field width,
+ * and the length modifier <b>l</b>.  Other conversions are copied verbatim.
+ * A precision, also given as <b>*</b>, limits the number of characters of
+ * a string, which then needs no terminating EOS, e.g. "%.*s".
+ *
+ ******************************************************************************/
+static void fmtFormat (FMT_SINK *pSink, const char *frmt, va_list args)
+{
+char	  numBuf[12];		// buffer for number conversion
+char	 *pNum;			// pointer into numBuf
+const char *pStr;		// string argument
+uint32_t  val;			// numeric argument
+bool	  flgLeft, flgNeg;	// left justified, negative value
+char	  padChar;		// padding character
+int	  width;		// minimum field width
+int	  prec;			// maximum string length, -1 for none
+int	  len;			// length of the string argument
+int	  base;			// number base
+const char *pDigits;		// digit characters to use
+
+
+    for ( ;  *frmt != EOS;  frmt++)
+    {
+	if (*frmt != '%')
+	{
+	    fmtPutc (pSink, *frmt);
+	    continue;
+	}
+
+	/* flags */
+	flgLeft = false;
+	padChar = ' ';
+	for (frmt++;  *frmt == '-'  ||  *frmt == '0';  frmt++)
+	{
+	    if (*frmt == '-')
+		flgLeft = true;
+	    else
+		padChar = '0';
+	}
+	if (flgLeft)
+	    padChar = ' ';
+
+	/* field width */
+	for (width = 0;  *frmt >= '0'  &&  *frmt <= '9';  frmt++)
+	    width = width * 10 + (*frmt - '0');
+
+	/* precision - only used for strings */
+	prec = -1;
+	if (*frmt == '.')
+	{
+	    if (*++frmt == '*')
+	    {
+		prec = va_arg(args, int);
+		frmt++;
+	    }
+	    else
+	    {
+		for (prec = 0;  *frmt >= '0'  &&  *frmt <= '9';  frmt++)
+		    prec = prec * 10 + (*frmt - '0');
+	    }
+	}
+
+	/* length modifier - int and long are both 32 bit */
+	if (*frmt == 'l')
+	    frmt++;
+
+	pDigits = "0123456789abcdef";
+	base = 10;
+	flgNeg = false;
+
+	switch (*frmt)
+	{
+	    case 'd':
+	    case 'i':
+		val = va_arg(args, int32_t);
+		if ((int32_t)val < 0)
+		{
+		    flgNeg = true;
+		    val = -val;
+		}
+		break;
+
+	    case 'u':
+		val = va_arg(args, uint32_t);
+		break;
+
+	    case 'X':
+		pDigits = "0123456789ABCDEF";
+		/* fall through */
+	    case 'x':
+		val = va_arg(args, uint32_t);
+		base = 16;
+		break;
+
+	    case 'c':
+		numBuf[0] = (char)va_arg(args, int);
+		fmtPutField (pSink, numBuf, 1, width, flgLeft, ' ');
+		continue;
+
+	    case 's':
+		pStr = va_arg(args, const char *);
+		if (pStr == NULL)
+		    pStr = "(null)";
+		for (len = 0;  len != prec  &&  pStr[len] != EOS;  len++)
+		    ;
+		fmtPutField (pSink, pStr, len, width, flgLeft, ' ');
+		continue;
+
+	    case EOS:
+		return;		// incomplete conversion at end of string
+
+	    default:		// '%' or unsupported conversion
+		fmtPutc (pSink, *frmt);
+		continue;
+	}
+
+	/* convert number, digits are generated from the end of the buffer */
+	pNum = numBuf + sizeof(numBuf);
+	do
+	{
+	    *--pNum = pDigits[val % base];
+	    val /= base;
+	} while (val != 0);
+
+	if (flgNeg)
+	    *--pNum = '-';
+
+	fmtPutField (pSink, pNum, numBuf + sizeof(numBuf) - pNum,
+		     width, flgLeft, padChar);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Report dropped bytes
+ *
+ * If bytes have been discarded since the last report, because the transmit
+ * FIFO was full, a marker with the number of dropped bytes is written.
+ *
+ ******************************************************************************/
+static void txReportDrops (void)
+{
+static uint32_t dropReported;	// drop count of the last report
+uint32_t dropCnt = txRing.DropCnt;
+uint32_t lost;			// number of bytes dropped since then
+
+
+    if (dropCnt == dropReported)
+	return;
+
+    /* update first, so the marker itself does not trigger a report */
+    lost = dropCnt - dropReported;
+    dropReported = dropCnt;
+
+    drvLEUART_printf ("\n*** LEUART: %lu bytes dropped ***\n", lost);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Formatted output into the transmit FIFO
+ *
+ * This routine formats the string directly into the transmit FIFO, there is
+ * no intermediate buffer.  A first pass over the format string calculates
+ * the length of the output, including \<CR> for each \<LF>, then exactly
+ * this space is reserved in the FIFO, and the second pass writes the
+ * characters into it.  If the FIFO has not enough space, the whole output is
+ * discarded, and a marker with the number of dropped bytes is written by the
+ * next successful output.
+ *
+ * @param[in] frmt
+ *	Format string, see fmtFormat() for the supported conversions.
+ *
+ * @param[in] args
+ *	Variable argument list.
+ *
+ * @return
+ *	Number of bytes written into the FIFO, or -1 if the output has been
+ *	dropped.
+ *
+ * @note
+ * This routine does not disable interrupts, it may be called from thread
+ * and interrupt context.
+ *
+ ******************************************************************************/
+int	 drvLEUART_vprintf (const char *frmt, va_list args)
+{
+FMT_SINK sink;			// formatter output sink
+va_list	 argsCnt;		// copy of the arguments for the first pass
+uint16_t cnt;			// number of bytes to write
+uint16_t idx;			// FIFO index of the reserved space
+
+
+    txReportDrops();
+
+    /* First pass: count only */
+    sink.Cnt = sink.Max = 0;
+    sink.flgStore = false;
+    sink.flgLF2CRLF = g_flgLEUART_LF2CRLF;
+
+    va_copy (argsCnt, args);
+    fmtFormat (&sink, frmt, argsCnt);
+    va_end (argsCnt);
+
+    if (sink.Cnt == 0)
+	return 0;
+
+    if (sink.Cnt > TX_FIFO_SIZE)
+    {
+	txRing.DropCnt += sink.Cnt;
+	return -1;
+    }
+    cnt = sink.Cnt;
+
+    /* Non-blocking: discard output if FIFO is full */
+    if (! RingBufReserve(&txRing, cnt, &idx))
+	return -1;
+
+    /* Second pass: format into the reserved space */
+    sink.Idx = idx;
+    sink.Cnt = 0;
+    sink.Max = cnt;
+    sink.flgStore = true;
+    fmtFormat (&sink, frmt, args);
+
+    /* A string argument may have become shorter in the meantime */
+    while (sink.Cnt < cnt)
+	RING_BUF_AT(&txRing, idx + sink.Cnt++) = ' ';
+
+    RingBufCommit(&txRing);
+
+    /* Be sure to enable DMA for data transfer */
+    dmaTransferStart();
+
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Formatted output into the transmit FIFO
+ *
+ * Same as drvLEUART_vprintf(), but with a variable number of arguments.
+ *
+ ******************************************************************************/
+int	 drvLEUART_printf (const char *frmt, ...)
+{
+va_list	 args;
+int	 cnt;
+
+
+    va_start (args, frmt);
+    cnt = drvLEUART_vprintf (frmt, args);
+    va_end (args);
+
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Get number of dropped bytes
+ *
+ * Returns the total number of bytes, which have been discarded because the
+ * transmit FIFO was full.
+ *
+ ******************************************************************************/
+uint32_t drvLEUART_DropCount (void)
+{
+    return txRing.DropCnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Get free space in the transmit FIFO
+ *
+ * Returns the number of bytes, which can be written into the transmit FIFO
+ * without being discarded.  Bulk transfers use this to wait instead of
+ * losing data.  The Tx DMA interrupt sets @ref g_flgIRQ when it has freed
+ * space, so there is no need to poll.
+ *
+ ******************************************************************************/
+uint16_t drvLEUART_TxFree (void)
+{
+    return RingBufFree (&txRing);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Check if the transmitter is idle
+ *
+ * Returns true, if the transmit FIFO is empty and the last character has
+ * left the shift register, e.g. before the power is switched off.
+ *
+ ******************************************************************************/
+bool	 drvLEUART_TxIdle (void)
+{
+    return RingBufUsed (&txRing) == 0
+	   &&  (LEUART->STATUS & LEUART_STATUS_TXC) != 0;
+}
@@ -2,9 +2,21 @@
  * @file
  * @brief	Header file of module LEUART.c
  * @author	Ralf Gerhauser
- * @version	2015-02-03
+ * @version	2026-10-18
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	Added prototype for drvLEUART_RxWake().
+2026-10-18,agent	Added drvLEUART_TxIdle() for the power-off sequence.
+2026-10-18,agent	Added LEUART_IOVEC and drvLEUART_WriteV().
+2026-10-18,agent	Added drvLEUART_TxFree().
+2026-10-18,agent	Added drvLEUART_RxSigFrame().
+2026-10-18,agent	Added drvLEUART_Write() for binary data.
+2026-10-18,agent	Enabled the receiver, replaced g_CmdLine by
+		drvLEUART_RxRead(). Added drvLEUART_RxOverruns().
+2026-10-18,agent	Added drvLEUART_printf(), drvLEUART_vprintf(), and
+		drvLEUART_DropCount().
+2026-10-18,agent	Added LEUART_TX_STATS, drvLEUART_TxStats() and
+		drvLEUART_TxRateTest().
 2015-02-03,rage	Initial version.
 */
 
@@ -14,6 +26,7 @@ Revision History:
 /*=============================== Header Files ===============================*/
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include "em_device.h"
 #include "em_gpio.h"
@@ -23,13 +36,33 @@ Revision History:
 /*=============================== Definitions ================================*/
 
     /*! Switch to enable the receive part of the driver */
-#define ENABLE_LEUART_RECEIVER	0
+#define ENABLE_LEUART_RECEIVER	1
+
+    /*! Theoretical throughput in [bytes/s] for 8 data and 2 stop bits */
+#define LEUART_TX_BYTES_PER_SEC(baud)	((baud) / 11)
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Transmit statistics, see drvLEUART_TxStats(). */
+typedef struct
+{
+    uint32_t	Bytes;		//!< number of bytes sent via DMA
+    uint32_t	ActiveTicks;	//!< RTC ticks the DMA has been busy
+    uint32_t	Starts;		//!< number of starts from idle state
+    uint32_t	Restarts;	//!< number of restarts after a late re-arm
+} LEUART_TX_STATS;
+
+/*!@brief Part of a block, see drvLEUART_WriteV(). */
+typedef struct
+{
+    const uint8_t *pData;	//!< address of the data, RAM or flash
+    uint16_t	Cnt;		//!< number of bytes
+} LEUART_IOVEC;
 
 /*================================ Global Data ===============================*/
 
 extern volatile bool	g_flgLEUART_LF2CRLF;
-extern volatile bool	g_flgCmdLine;
-extern uint8_t		g_CmdLine[];
+extern volatile bool	g_flgLEUART_RxLine;
 
 /*================================ Prototypes ================================*/
 
@@ -42,5 +75,46 @@ void	 drvLEUART_puts (const char *pStr);
 /* Put character into transmit FIFO */
 void	 drvLEUART_putc (char c);
 
+/* Put binary data into transmit FIFO */
+bool	 drvLEUART_Write (const uint8_t *pData, uint16_t cnt);
+
+/* Put binary data from several parts into transmit FIFO */
+bool	 drvLEUART_WriteV (const LEUART_IOVEC *pVec, int vecCnt);
+
+/* Formatted output into transmit FIFO */
+int	 drvLEUART_printf  (const char *frmt, ...);
+int	 drvLEUART_vprintf (const char *frmt, va_list args);
+
+/* Get number of bytes dropped because the FIFO was full */
+uint32_t drvLEUART_DropCount (void);
+
+/* Get free space in the transmit FIFO */
+uint16_t drvLEUART_TxFree (void);
+
+/* Check if all data has been sent */
+bool	 drvLEUART_TxIdle (void);
+
+#if ENABLE_LEUART_RECEIVER
+/* Read received data */
+int	 drvLEUART_RxRead (char *pBuf, int maxCnt);
+
+/* Set character which signals a complete frame */
+void	 drvLEUART_RxSigFrame (char c);
+
+/* Get number of receive overruns */
+uint32_t drvLEUART_RxOverruns (void);
+
+/* Wake up the main loop on the next received byte */
+void	 drvLEUART_RxWake (bool enable);
+#endif
+
+/* Get transmit statistics */
+void	 drvLEUART_TxStats (LEUART_TX_STATS *pStats);
+
+#ifdef DEBUG
+/* Measure transmit throughput */
+void	 drvLEUART_TxRateTest (void);
+#endif
+
 
 #endif /* __INC_LEUART_h */
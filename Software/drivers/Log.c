@@ -0,0 +1,1319 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Session Log in the Internal Flash
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module stores records, e.g. snapshots of all items, in the upper part
+ * of the internal flash, so they survive power-off and accumulate across
+ * sessions.  The log occupies @ref LOG_PAGE_CNT pages from @ref
+ * LOG_START_ADDR on, which is checked against the end of the firmware image
+ * by LogInit().
+ *
+ * The log is append-only, flash words are never written twice:
+ * - Each page starts with a header: @ref LOG_PAGE_MAGIC, the page sequence
+ *   number, the erase count of the page, the sequence number and the time of
+ *   its first record, the key of the pack connected at this time, and a CRC.
+ *   A page without valid header is free.
+ * - The records follow the header, each one consists of a @ref LOG_REC_HDR
+ *   with its own sequence number, the data padded to whole words, and a
+ *   CRC word.  The CRC word is written last, it commits the record.
+ * - When a page is full, the next physical page is erased and becomes the
+ *   head, i.e. the pages are used round-robin and all pages are erased
+ *   equally often (wear levelling).  When the log is full, the oldest page
+ *   is overwritten.
+ *
+ * At mount time, the page with the highest sequence number is the head.
+ * Its records are checked up to the first erased word.  If power was lost
+ * during a write, the incomplete record fails its CRC, then the head page is
+ * treated as full, so the next record goes to a new page and the damaged
+ * record is never touched again.  Readers skip the rest of such a page.
+ * tools/log_sim.py checks this with injected power losses.
+ *
+ * The flash is not readable while it is programmed, and a page erase takes
+ * about 20ms.  So LogAppend() does not write to the flash, it only builds the
+ * record in one of two staging buffers of @ref LOG_STAGE_SIZE bytes.
+ * LogCheck() is called from the main loop and programs the other buffer, at
+ * most @ref LOG_WRITE_WORDS words per call, while new records accumulate in
+ * the first one.  The next page is erased ahead, when the head page is
+ * nearly full and the main loop is idle, i.e. it would enter EM2 otherwise.
+ * LogFlush() writes all staged records at once.  LogHold() stops the
+ * programming and erasing by LogCheck(), while the records are still staged,
+ * e.g. to keep the log unchanged while it is exported, see Export.c.
+ *
+ * The page headers are a sparse index of the log.  The first record of a
+ * page always follows the header, so a reader can start at any page.
+ * LogSeek() finds the start of a time range by a binary search over the
+ * page headers, i.e. it reads about log2(@ref LOG_PAGE_CNT) headers instead
+ * of all records.  The time stamps must be ascending for this, a clock which
+ * has been set back only makes the search start at a page too late or too
+ * early.  The pack key changes with @ref LOG_TYPE_CONNECT records, written
+ * when a pack is connected or removed, see History.c, and is reset by each
+ * @ref LOG_TYPE_SESSION record.  The writer and each cursor follow these
+ * records, so every record can be assigned to a pack.
+ *
+ * The flash controller is unlocked only while writing.  The programming
+ * and erase sequences are local functions, placed in RAM by @ref LOG_RAMFUNC,
+ * because the emlib functions only have a section for the ARM compiler.  So
+ * the CPU waits in RAM instead of stalling on an instruction fetch.  Still
+ * interrupts are disabled during each operation, because the vector table
+ * and the handlers are in the flash.  An interrupt is therefore delayed by
+ * up to one erase, or one write step of LogCheck().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	LogImageEnd() uses __image_end__ of the linker script.
+2026-10-18,agent	The write and erase sequences execute from RAM, see
+		FlashProgram() and FlashErase().
+2026-10-18,agent	Added LogHold() to keep the log unchanged during an
+		export.
+2026-10-18,agent	Added LogFlushTimed().
+2026-10-18,agent	LogStats() returns the head page, see Download.c.
+2026-10-18,agent	The page header contains the time and the pack key of
+		its first record, added LogSeek() for time range queries.
+2026-10-18,agent	Added LogFind() and LogNextSeq(), the flash helpers are
+		public for the pack history index, see History.c.
+2026-10-18,agent	Records are staged in RAM and programmed by LogCheck()
+		in small steps, pages are erased ahead in idle windows.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_int.h"
+#include "em_msc.h"
+#include "Log.h"
+#include "Telemetry.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Address of a page. */
+#define PAGE_ADDR(page)		((uint32_t)(LOG_START_ADDR + (page) * FLASH_PAGE_SIZE))
+
+    /*!@brief Address behind a page. */
+#define PAGE_END(page)		(PAGE_ADDR(page) + FLASH_PAGE_SIZE)
+
+    /*!@brief Number of bytes a record occupies in the flash. */
+#define REC_SIZE(len)		(LOG_REC_HDR_SIZE + (((len) + 3) & ~3) + 4)
+
+    /*!@brief Content of an erased flash word. */
+#define ERASED_WORD		0xFFFFFFFF
+
+    /*!@brief Places a function in RAM, i.e. in the ".ram" input section of
+     * the linker script, which is copied with the initialized data.  The
+     * call from the flash needs a long call.
+     */
+#ifdef __GNUC__
+#define LOG_RAMFUNC	__attribute__ ((section(".ram"), long_call, noinline))
+#else
+#define LOG_RAMFUNC
+#endif
+
+    /*!@brief The next page is erased ahead, if the head page has less free
+     * bytes than this, i.e. the next staging buffer may not fit.
+     */
+#define ERASE_AHEAD_LIMIT	LOG_STAGE_SIZE
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Page header, as stored in the flash. */
+typedef struct
+{
+    uint32_t	 Magic;		//!< @ref LOG_PAGE_MAGIC
+    uint32_t	 PageSeq;	//!< Sequence number of the page, 0 if free
+    uint32_t	 EraseCnt;	//!< Number of times the page has been erased
+    uint32_t	 RecSeq;	//!< Sequence number of the first record
+    uint32_t	 FirstTime;	//!< Time of the first record
+    uint32_t	 PackKey;	//!< Pack key at the first record, 0 if none
+    uint32_t	 Crc;		//!< CRC-16 of the fields above
+} LOG_PAGE_HDR;
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool WriteStep (void);
+static void EraseAhead (void);
+static bool PageHdrGet (int page, LOG_PAGE_HDR *pHdr);
+static bool PageIsErased (int page);
+static int  PageOpen (uint32_t recSeq, uint32_t firstTime);
+static int  RecordCheck (uint32_t addr, uint32_t endAddr, LOG_REC_HDR *pHdr);
+static void PackKeyTrack (uint32_t *pKey, const LOG_REC_HDR *pHdr,
+			  const uint8_t *pData);
+static int  FlashProgram (uint32_t addr, const uint32_t *pData, int cnt)
+			  LOG_RAMFUNC;
+static int  FlashErase (uint32_t addr) LOG_RAMFUNC;
+
+/*================================ Global Data ===============================*/
+
+extern char const prjVersion[];
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Flag if the log is usable. */
+static bool		 l_flgMounted;
+
+    /*!@brief Index of the head page, i.e. the page written to. */
+static int		 l_Head;
+
+    /*!@brief Sequence number of the head page, 0 if no page is used. */
+static uint32_t		 l_PageSeq;
+
+    /*!@brief Address of the next record in the head page. */
+static uint32_t		 l_WriteAddr;
+
+    /*!@brief Sequence number of the next record. */
+static uint32_t		 l_NextSeq;
+
+    /*!@brief Pack key of the last record written, see PackKeyTrack(). */
+static uint32_t		 l_WrKey;
+
+    /*!@brief Page which has been erased ahead, -1 if none. */
+static int		 l_AheadPage = -1;
+
+    /*!@brief Erase count of the page which has been erased ahead. */
+static uint32_t		 l_AheadEraseCnt;
+
+    /*!@brief Staging buffers, and number of bytes in each of them. */
+static uint32_t		 l_Stage[2][LOG_STAGE_SIZE / 4];
+static int		 l_StageLen[2];
+
+    /*!@brief Index of the staging buffer new records are added to. */
+static int		 l_Fill;
+
+    /*!@brief Index of the staging buffer being programmed, -1 if none. */
+static int		 l_Prog = -1;
+
+    /*!@brief Offset of the current record in the buffer being programmed,
+     * and number of its bytes already programmed.
+     */
+static int		 l_ProgOffs;
+static int		 l_RecDone;
+
+    /*!@brief Number of failed attempts to write the current record. */
+static int		 l_Retry;
+
+    /*!@brief Number of flash operations, see LogActivity(). */
+static uint32_t		 l_Activity;
+
+    /*!@brief LogCheck() does not write to the flash, see LogHold(). */
+static bool		 l_flgHold;
+
+    /*!@brief Statistics, see LogStats(). */
+static uint32_t		 l_Torn;
+static uint32_t		 l_Errors;
+static uint32_t		 l_Dropped;
+static uint32_t		 l_LateErases;
+static uint32_t		 l_MaxWriteTicks;
+static uint32_t		 l_MaxEraseTicks;
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Log
+ *
+ * Mounts the log, i.e. finds the head page and the position of the next
+ * record, and appends a @ref LOG_TYPE_SESSION record with the reset cause
+ * and the firmware version.  This routine must be called once after the
+ * clock has been initialized.
+ *
+ * @return
+ *	0 if the log is usable, or a negative error code.
+ *
+ ******************************************************************************/
+int	LogInit (void)
+{
+LOG_PAGE_HDR pageHdr;
+LOG_REC_HDR  recHdr;
+uint8_t	 session[4 + 16];	// reset cause and version string
+uint32_t addr, cause, minErase = ERASED_WORD;
+int	 page, size, len;
+
+
+    l_flgMounted = false;
+    l_StageLen[0] = l_StageLen[1] = 0;
+    l_Prog = -1;
+    l_RecDone = 0;
+    l_Retry = 0;
+
+    /* The log must not overlap the firmware image and its init data */
+    if (LogImageEnd() > LOG_START_ADDR)
+	return logNotAvailable;
+
+    /* Find the head page, i.e. the highest page sequence number */
+    l_PageSeq = 0;
+    l_Head = LOG_PAGE_CNT - 1;
+    for (page = 0;  page < LOG_PAGE_CNT;  page++)
+    {
+	if (! PageHdrGet (page, &pageHdr))
+	    pageHdr.EraseCnt = 0;
+	else if (pageHdr.PageSeq > l_PageSeq)
+	{
+	    l_PageSeq = pageHdr.PageSeq;
+	    l_Head = page;
+	}
+
+	/* Without used pages, start behind the least erased one */
+	if (l_PageSeq == 0  &&  pageHdr.EraseCnt < minErase)
+	{
+	    minErase = pageHdr.EraseCnt;
+	    l_Head = (page + LOG_PAGE_CNT - 1) % LOG_PAGE_CNT;
+	}
+    }
+
+    l_NextSeq = 1;
+    l_WriteAddr = 0;
+    l_WrKey = 0;
+
+    if (l_PageSeq != 0)
+    {
+	/* Walk the records of the head page up to the first erased word */
+	PageHdrGet (l_Head, &pageHdr);
+	l_NextSeq = pageHdr.RecSeq;
+	l_WrKey = pageHdr.PackKey;
+	addr = PAGE_ADDR(l_Head) + LOG_PAGE_HDR_SIZE;
+
+	while (addr < PAGE_END(l_Head))
+	{
+	    size = RecordCheck (addr, PAGE_END(l_Head), &recHdr);
+	    if (size == 0)
+		break;			// free space starts here
+
+	    if (size < 0)
+	    {
+		/* Incomplete record, continue on the next page */
+		l_Torn++;
+		addr = PAGE_END(l_Head);
+		break;
+	    }
+
+	    l_NextSeq = recHdr.Seq + 1;
+	    PackKeyTrack (&l_WrKey, &recHdr,
+			  (const uint8_t *)(addr + LOG_REC_HDR_SIZE));
+	    addr += size;
+	}
+	l_WriteAddr = addr;
+    }
+
+    /* The next page may have been erased ahead before power-off */
+    l_AheadPage = -1;
+    page = (l_Head + 1) % LOG_PAGE_CNT;
+    if (PageIsErased (page))
+    {
+	l_AheadPage = page;
+	l_AheadEraseCnt = 1;
+	if (PageHdrGet (l_Head, &pageHdr))
+	    l_AheadEraseCnt = pageHdr.EraseCnt;		// lost, assume the same
+    }
+
+    l_flgMounted = true;
+
+    /* Record the start of this session */
+    cause = RMU->RSTCAUSE;
+    memcpy (session, &cause, 4);
+    len = strlen (prjVersion);
+    if (len > (int)sizeof(session) - 4)
+	len = sizeof(session) - 4;
+    memcpy (session + 4, prjVersion, len);
+
+    return LogAppend (LOG_TYPE_SESSION, session, 4 + len);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Append Record
+ *
+ * Builds a record in the staging buffer, it is written to the flash later
+ * by LogCheck().  This function does not access the flash, so it may be
+ * called from any place where data is sampled.
+ *
+ * @param[in] type
+ *	Type of the record.
+ *
+ * @param[in] pData
+ *	Address of the data.
+ *
+ * @param[in] len
+ *	Number of data bytes, up to @ref LOG_DATA_MAX.
+ *
+ * @return
+ *	0 if the record has been staged, or a negative error code.  @ref
+ *	logBusy is returned if both staging buffers are full.
+ *
+ ******************************************************************************/
+int	LogAppend (LOG_TYPE type, const void *pData, int len)
+{
+LOG_REC_HDR hdr;
+uint8_t	*pRec;
+uint32_t crc;
+int	 size = REC_SIZE(len);
+
+
+    if (! l_flgMounted)
+	return logNotAvailable;
+
+    if (len < 0  ||  len > LOG_DATA_MAX)
+	return logInvalidParameter;
+
+    if (l_StageLen[l_Fill] + size > LOG_STAGE_SIZE)
+    {
+	/* Buffer full, switch if the other one has been programmed */
+	if (l_Prog != -1)
+	{
+	    l_Dropped++;
+	    return logBusy;
+	}
+	l_Prog = l_Fill;
+	l_ProgOffs = 0;
+	l_Fill ^= 1;
+    }
+
+    hdr.Len   = len;
+    hdr.Type  = type;
+    hdr.Flags = 0;
+    hdr.Seq   = l_NextSeq++;
+    hdr.Time  = (uint32_t) time(NULL);
+
+    crc = TlmCRC16 (0xFFFF, (const uint8_t *) &hdr, LOG_REC_HDR_SIZE);
+    crc = TlmCRC16 (crc, pData, len);
+
+    /* Header, data padded with zeros, and CRC word */
+    pRec = (uint8_t *) l_Stage[l_Fill] + l_StageLen[l_Fill];
+    memcpy (pRec, &hdr, LOG_REC_HDR_SIZE);
+    memcpy (pRec + LOG_REC_HDR_SIZE, pData, len);
+    memset (pRec + LOG_REC_HDR_SIZE + len, 0, size - LOG_REC_HDR_SIZE - 4 - len);
+    memcpy (pRec + size - 4, &crc, 4);
+    l_StageLen[l_Fill] += size;
+
+    g_flgIRQ = true;		// do not enter EM2, LogCheck() has to write
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log Check
+ *
+ * This function must be called from the main loop, after all other
+ * modules.  It programs up to @ref LOG_WRITE_WORDS words of the staging
+ * buffer.  If nothing is to be written, and no other module needs the main
+ * loop, the next page is erased ahead if required.
+ *
+ ******************************************************************************/
+void	LogCheck (void)
+{
+    if (! l_flgMounted  ||  l_flgHold)
+	return;
+
+    if (WriteStep())
+	g_flgIRQ = true;	// do not enter EM2, call us again
+    else if (! g_flgIRQ  &&  g_EM1_ModuleMask == 0)
+	EraseAhead();		// idle window, the MCU would sleep now
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Flush the Log
+ *
+ * Writes all staged records to the flash, e.g. before power-off.  This is
+ * also done while the log is held, see LogHold().
+ *
+ ******************************************************************************/
+void	LogFlush (void)
+{
+    if (l_flgMounted)
+	while (WriteStep())
+	    ;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Flush the Log within a Time
+ *
+ * Writes staged records to the flash like LogFlush(), but stops after
+ * <b>maxTicks</b>, e.g. when the power is switched off.  A record which is
+ * interrupted by the loss of power is discarded at the next mount.
+ *
+ * @param[in] maxTicks
+ *	Maximum duration in RTC ticks.
+ *
+ * @return
+ *	true if all records have been written.
+ *
+ ******************************************************************************/
+bool	LogFlushTimed (uint32_t maxTicks)
+{
+uint32_t start = RTC->CNT;
+
+
+    if (! l_flgMounted)
+	return true;
+
+    while (WriteStep())
+	if (((RTC->CNT - start) & 0x00FFFFFF) >= maxTicks)
+	    return false;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Hold the Log
+ *
+ * While the log is held, LogCheck() neither programs staged records nor
+ * erases pages ahead, so the flash contents of the log do not change.  New
+ * records are still staged by LogAppend(), they are written after the log
+ * has been released.  If both staging buffers fill up meanwhile, further
+ * records are dropped, see @ref logBusy.  LogFlush() and LogFlushTimed()
+ * write the records anyway, since they are called when the power is lost.
+ *
+ * @param[in] flgHold
+ *	true to hold the log, false to release it.
+ *
+ ******************************************************************************/
+void	LogHold (bool flgHold)
+{
+    l_flgHold = flgHold;
+
+    if (! flgHold)
+	g_flgIRQ = true;	// LogCheck() has to write the staged records
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log Activity
+ *
+ * Returns the number of flash operations so far.  Other modules compare
+ * it with a previous value to see if the flash has been written meanwhile,
+ * e.g. to measure the influence of logging on the sampling.
+ *
+ ******************************************************************************/
+uint32_t LogActivity (void)
+{
+    return l_Activity;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Rewind Cursor
+ *
+ * Sets the cursor to the oldest record of the log.  Records which are still
+ * in the staging buffers cannot be read.
+ *
+ ******************************************************************************/
+void	LogRewind (LOG_CURSOR *pCursor)
+{
+    /* The page behind the head is the oldest one */
+    pCursor->Page = (l_Head + 1) % LOG_PAGE_CNT;
+    pCursor->PagesLeft = (l_flgMounted && l_PageSeq != 0 ? LOG_PAGE_CNT : 0);
+    pCursor->Addr = 0;
+    pCursor->PackKey = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read Record
+ *
+ * Reads the record at the cursor and advances the cursor to the next one.
+ * Records with a wrong CRC are skipped, together with the rest of the page.
+ * <b>PackKey</b> of the cursor is set to the pack key of the record.
+ *
+ * @param[in,out] pCursor
+ *	Cursor, see LogRewind().
+ *
+ * @param[out] pHdr
+ *	Address where to store the header of the record.
+ *
+ * @param[out] pBuf
+ *	Address where to store the data, may be NULL.
+ *
+ * @param[in] size
+ *	Size of the buffer, longer data is truncated.
+ *
+ * @return
+ *	Number of data bytes of the record, i.e. <b>Len</b> of the header, or
+ *	-1 if there are no more records.
+ *
+ ******************************************************************************/
+int	LogRead (LOG_CURSOR *pCursor, LOG_REC_HDR *pHdr,
+		 uint8_t *pBuf, int size)
+{
+LOG_PAGE_HDR pageHdr;
+int	 recSize;
+
+
+    while (pCursor->PagesLeft > 0)
+    {
+	if (pCursor->Addr == 0)
+	{
+	    /* Start of a page, skip free pages */
+	    if (PageHdrGet (pCursor->Page, &pageHdr)  &&  pageHdr.PageSeq != 0)
+	    {
+		pCursor->Addr = PAGE_ADDR(pCursor->Page) + LOG_PAGE_HDR_SIZE;
+		pCursor->PackKey = pageHdr.PackKey;
+	    }
+	}
+
+	if (pCursor->Addr != 0)
+	{
+	    recSize = RecordCheck (pCursor->Addr, PAGE_END(pCursor->Page), pHdr);
+	    if (recSize > 0)
+	    {
+		if (pBuf != NULL)
+		    memcpy (pBuf, (const void *)(pCursor->Addr + LOG_REC_HDR_SIZE),
+			    pHdr->Len < size ? pHdr->Len : size);
+		PackKeyTrack (&pCursor->PackKey, pHdr,
+			      (const uint8_t *)(pCursor->Addr + LOG_REC_HDR_SIZE));
+		pCursor->Addr += recSize;
+		return pHdr->Len;
+	    }
+	}
+
+	/* End of the page, or a damaged record */
+	pCursor->Page = (pCursor->Page + 1) % LOG_PAGE_CNT;
+	pCursor->PagesLeft--;
+	pCursor->Addr = 0;
+    }
+
+    return -1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Seek Time
+ *
+ * Sets the cursor to the newest page whose first record is older than the
+ * specified time, i.e. the first record of this time or later is in this
+ * page or behind it.  If no page is older, the cursor is set to
+ * the oldest record, as LogRewind() does.  The pages are found by a binary
+ * search over the page headers, free pages count as old.
+ *
+ * @param[out] pCursor
+ *	Cursor for LogRead().
+ *
+ * @param[in] time
+ *	Start of the time range, see time().
+ *
+ ******************************************************************************/
+void	LogSeek (LOG_CURSOR *pCursor, uint32_t time)
+{
+LOG_PAGE_HDR pageHdr;
+int	 lo, hi, mid, page;
+
+
+    LogRewind (pCursor);
+    if (pCursor->PagesLeft == 0)
+	return;
+
+    /* Pages in logical order: 1 is the oldest, LOG_PAGE_CNT the head */
+    lo = 1;
+    hi = LOG_PAGE_CNT;
+    while (lo < hi)
+    {
+	mid = (lo + hi + 1) / 2;
+	page = (l_Head + mid) % LOG_PAGE_CNT;
+	if (! PageHdrGet (page, &pageHdr)  ||  pageHdr.PageSeq == 0
+	||  pageHdr.FirstTime < time)
+	    lo = mid;		// the start is in this page or behind it
+	else
+	    hi = mid - 1;
+    }
+
+    pCursor->Page = (l_Head + lo) % LOG_PAGE_CNT;
+    pCursor->PagesLeft = LOG_PAGE_CNT - lo + 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find Record
+ *
+ * Reads the record with the specified sequence number.  The page which
+ * contains it is found by the page headers, so only the records of this page
+ * are walked through, i.e. the time does not depend on the size of the log.
+ *
+ * @param[in] seq
+ *	Sequence number of the record.
+ *
+ * @param[out] pHdr
+ *	Address where to store the header of the record.
+ *
+ * @param[out] pBuf
+ *	Address where to store the data, may be NULL.
+ *
+ * @param[in] size
+ *	Size of the buffer, longer data is truncated.
+ *
+ * @return
+ *	Number of data bytes of the record, or -1 if it is not in the log
+ *	(anymore), or still in the staging buffers.
+ *
+ ******************************************************************************/
+int	LogFind (uint32_t seq, LOG_REC_HDR *pHdr, uint8_t *pBuf, int size)
+{
+LOG_PAGE_HDR pageHdr;
+LOG_CURSOR cursor;
+int	 i, page, len;
+
+
+    if (! l_flgMounted  ||  l_PageSeq == 0)
+	return -1;
+
+    /* Find the newest page whose first record is not behind seq */
+    cursor.Page = -1;
+    for (i = 1;  i <= LOG_PAGE_CNT;  i++)
+    {
+	page = (l_Head + i) % LOG_PAGE_CNT;
+	if (PageHdrGet (page, &pageHdr)  &&  pageHdr.PageSeq != 0
+	&&  pageHdr.RecSeq <= seq)
+	    cursor.Page = page;
+    }
+
+    if (cursor.Page < 0)
+	return -1;
+
+    cursor.PagesLeft = 1;
+    cursor.Addr = 0;
+    while ((len = LogRead (&cursor, pHdr, pBuf, size)) >= 0)
+    {
+	if (pHdr->Seq == seq)
+	    return len;
+	if (pHdr->Seq > seq)
+	    break;
+    }
+
+    return -1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Next Sequence Number
+ *
+ * Returns the sequence number the next record of LogAppend() gets.
+ *
+ ******************************************************************************/
+uint32_t LogNextSeq (void)
+{
+    return l_NextSeq;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log Statistics
+ *
+ * Scans the page headers and returns the statistics of the log.
+ *
+ ******************************************************************************/
+void	LogStats (LOG_STATS *pStats)
+{
+LOG_PAGE_HDR pageHdr;
+int	 i, page;
+
+
+    memset (pStats, 0, sizeof(*pStats));
+    pStats->EraseMin = ERASED_WORD;
+    pStats->HeadPage = l_Head;
+    pStats->NextSeq  = l_NextSeq;
+    pStats->FirstSeq = l_NextSeq;
+    pStats->Torn     = l_Torn;
+    pStats->Errors   = l_Errors;
+    pStats->Pending  = l_StageLen[l_Fill];
+    if (l_Prog != -1)
+	pStats->Pending += l_StageLen[l_Prog] - l_ProgOffs - l_RecDone;
+    pStats->Dropped  = l_Dropped;
+    pStats->LateErases    = l_LateErases;
+    pStats->MaxWriteTicks = l_MaxWriteTicks;
+    pStats->MaxEraseTicks = l_MaxEraseTicks;
+
+    /* Start with the oldest page */
+    for (i = 1;  i <= LOG_PAGE_CNT;  i++)
+    {
+	page = (l_Head + i) % LOG_PAGE_CNT;
+	if (! PageHdrGet (page, &pageHdr))
+	{
+	    pageHdr.EraseCnt = (page == l_AheadPage ? l_AheadEraseCnt : 0);
+	    pageHdr.PageSeq = 0;
+	}
+
+	if (pageHdr.EraseCnt < pStats->EraseMin)
+	    pStats->EraseMin = pageHdr.EraseCnt;
+	if (pageHdr.EraseCnt > pStats->EraseMax)
+	    pStats->EraseMax = pageHdr.EraseCnt;
+
+	if (pageHdr.PageSeq != 0)
+	{
+	    if (pStats->PagesUsed++ == 0)
+		pStats->FirstSeq = pageHdr.RecSeq;
+	}
+    }
+
+    pStats->FreeBytes = (LOG_PAGE_CNT - pStats->PagesUsed)
+		      * (FLASH_PAGE_SIZE - LOG_PAGE_HDR_SIZE);
+    if (l_PageSeq != 0)
+	pStats->FreeBytes += PAGE_END(l_Head) - l_WriteAddr;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Erase the Log
+ *
+ * Discards the staged records and erases all pages.  Their erase counts
+ * are kept in free page headers, and the next record goes to the page
+ * behind the current head.  This takes about 20ms per page.
+ *
+ * @return
+ *	0 if all pages have been erased, or a negative error code.
+ *
+ ******************************************************************************/
+int	LogErase (void)
+{
+LOG_PAGE_HDR pageHdr;
+int	 page, status, result = mscReturnOk;
+
+
+    if (! l_flgMounted)
+	return logNotAvailable;
+
+    MSC_Init();
+
+    for (page = 0;  page < LOG_PAGE_CNT;  page++)
+    {
+	if (! PageHdrGet (page, &pageHdr))
+	    pageHdr.EraseCnt = (page == l_AheadPage ? l_AheadEraseCnt : 0);
+
+	pageHdr.Magic	 = LOG_PAGE_MAGIC;
+	pageHdr.PageSeq	 = 0;
+	pageHdr.EraseCnt++;
+	pageHdr.RecSeq	 = 0;
+	pageHdr.FirstTime = 0;
+	pageHdr.PackKey	 = 0;
+	pageHdr.Crc	 = TlmCRC16 (0xFFFF, (const uint8_t *) &pageHdr,
+				     offsetof(LOG_PAGE_HDR, Crc));
+
+	status = LogFlashErase (PAGE_ADDR(page));
+	if (status == mscReturnOk)
+	    status = LogFlashWrite (PAGE_ADDR(page), &pageHdr, sizeof(pageHdr));
+	if (status != mscReturnOk)
+	{
+	    l_Errors++;
+	    result = status;
+	}
+    }
+
+    MSC_Deinit();
+
+    l_StageLen[0] = l_StageLen[1] = 0;
+    l_Prog = -1;
+    l_RecDone = 0;
+    l_Retry = 0;
+    l_AheadPage = -1;
+    l_PageSeq = 0;
+    l_NextSeq = 1;
+    l_WriteAddr = 0;
+    l_WrKey = 0;
+    l_Torn = 0;
+
+    return result;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write Step
+ *
+ * Programs up to @ref LOG_WRITE_WORDS words of the current record.  When
+ * the buffer being programmed is done, the buffers are switched.  A record
+ * which does not fit into the head page opens a new page.  Each record is
+ * checked after its CRC word has been written, if this fails, it is written
+ * to a new page once more.
+ *
+ * @return
+ *	true if there is more to write.
+ *
+ ******************************************************************************/
+static bool WriteStep (void)
+{
+LOG_REC_HDR hdr;
+uint8_t	*pRec;
+uint32_t start = RTC->CNT;
+uint32_t ticks;
+int	 size, cnt, status;
+
+
+    if (l_Prog == -1)
+    {
+	if (l_StageLen[l_Fill] == 0)
+	    return false;		// nothing to write
+
+	/* Program the filled buffer, new records go to the other one */
+	l_Prog = l_Fill;
+	l_ProgOffs = 0;
+	l_Fill ^= 1;
+    }
+
+    pRec = (uint8_t *) l_Stage[l_Prog] + l_ProgOffs;
+    memcpy (&hdr, pRec, LOG_REC_HDR_SIZE);
+    size = REC_SIZE(hdr.Len);
+
+    MSC_Init();
+
+    status = mscReturnOk;
+    if (l_RecDone == 0
+    &&  (l_PageSeq == 0  ||  l_WriteAddr + size > PAGE_END(l_Head)))
+	status = PageOpen (hdr.Seq, hdr.Time);
+
+    if (status == mscReturnOk)
+    {
+	cnt = size - l_RecDone;
+	if (cnt > LOG_WRITE_WORDS * 4)
+	    cnt = LOG_WRITE_WORDS * 4;
+
+	status = LogFlashWrite (l_WriteAddr + l_RecDone, pRec + l_RecDone, cnt);
+	l_RecDone += cnt;
+
+	if (status == mscReturnOk  &&  l_RecDone == size
+	&&  RecordCheck (l_WriteAddr, PAGE_END(l_Head), NULL) != size)
+	    status = logVerifyFailed;
+    }
+
+    MSC_Deinit();
+
+    if (status != mscReturnOk)
+    {
+	/* Do not touch the damaged record again, use a new page */
+	l_Errors++;
+	l_WriteAddr = PAGE_END(l_Head);
+	l_RecDone = 0;
+	if (++l_Retry >= 2)
+	    l_RecDone = size;		// give up this record
+    }
+    else if (l_RecDone == size)
+    {
+	PackKeyTrack (&l_WrKey, &hdr, pRec + LOG_REC_HDR_SIZE);
+	l_WriteAddr += size;
+    }
+
+    if (l_RecDone == size)
+    {
+	/* Continue with the next record */
+	l_ProgOffs += size;
+	l_RecDone = 0;
+	l_Retry = 0;
+
+	if (l_ProgOffs >= l_StageLen[l_Prog])
+	{
+	    l_StageLen[l_Prog] = 0;
+	    l_Prog = -1;
+	}
+    }
+
+    ticks = (RTC->CNT - start) & 0x00FFFFFF;
+    if (ticks > l_MaxWriteTicks)
+	l_MaxWriteTicks = ticks;
+
+    return (l_Prog != -1  ||  l_StageLen[l_Fill] != 0);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Erase Ahead
+ *
+ * Erases the page behind the head, if the head page is nearly full.  The
+ * erase count is remembered, PageOpen() writes it into the header.
+ *
+ ******************************************************************************/
+static void EraseAhead (void)
+{
+LOG_PAGE_HDR pageHdr;
+int	 page = (l_Head + 1) % LOG_PAGE_CNT;
+
+
+    if (page == l_AheadPage
+    ||  (l_PageSeq != 0  &&  PAGE_END(l_Head) - l_WriteAddr >= ERASE_AHEAD_LIMIT))
+	return;
+
+    if (PageHdrGet (page, &pageHdr))
+	l_AheadEraseCnt = pageHdr.EraseCnt + 1;
+    else if (PageHdrGet (l_Head, &pageHdr))
+	l_AheadEraseCnt = pageHdr.EraseCnt;	// lost, assume the same
+    else
+	l_AheadEraseCnt = 1;
+
+    MSC_Init();
+    if (LogFlashErase (PAGE_ADDR(page)) == mscReturnOk)
+	l_AheadPage = page;
+    else
+	l_Errors++;
+    MSC_Deinit();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get Page Header
+ *
+ * @return
+ *	true if the page has a valid header, false if it is free.
+ *
+ ******************************************************************************/
+static bool PageHdrGet (int page, LOG_PAGE_HDR *pHdr)
+{
+    memcpy (pHdr, (const void *) PAGE_ADDR(page), sizeof(*pHdr));
+
+    return (pHdr->Magic == LOG_PAGE_MAGIC
+	&&  pHdr->Crc == TlmCRC16 (0xFFFF, (const uint8_t *) pHdr,
+				   offsetof(LOG_PAGE_HDR, Crc)));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if Page is Erased
+ *
+ ******************************************************************************/
+static bool PageIsErased (int page)
+{
+const uint32_t *pWord = (const uint32_t *) PAGE_ADDR(page);
+int	 i;
+
+
+    for (i = 0;  i < FLASH_PAGE_SIZE / 4;  i++)
+	if (pWord[i] != ERASED_WORD)
+	    return false;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Open Page
+ *
+ * Writes the header of the page behind the head, it then becomes the new
+ * head.  The page is erased now, if this has not been done ahead.  The
+ * flash controller must have been unlocked.
+ *
+ * @param[in] recSeq
+ *	Sequence number of the first record in the page.
+ *
+ * @param[in] firstTime
+ *	Time of the first record in the page.
+ *
+ * @return
+ *	0 if the page is usable, or a negative error code.
+ *
+ ******************************************************************************/
+static int  PageOpen (uint32_t recSeq, uint32_t firstTime)
+{
+LOG_PAGE_HDR pageHdr;
+uint32_t eraseCnt;
+int	 status = mscReturnOk;
+
+
+    /*
+     * If the page has never been used, or its erase count has been lost by
+     * a power failure, it should be at the level of the previous page.
+     */
+    eraseCnt = 1;
+    if (PageHdrGet (l_Head, &pageHdr)  &&  pageHdr.EraseCnt > 0)
+	eraseCnt = pageHdr.EraseCnt;
+
+    l_Head = (l_Head + 1) % LOG_PAGE_CNT;
+    l_WriteAddr = PAGE_END(l_Head);	// unusable until the header is written
+
+    if (l_Head == l_AheadPage)
+    {
+	eraseCnt = l_AheadEraseCnt;
+    }
+    else
+    {
+	if (PageHdrGet (l_Head, &pageHdr))
+	    eraseCnt = pageHdr.EraseCnt + 1;
+
+	l_LateErases++;
+	status = LogFlashErase (PAGE_ADDR(l_Head));
+    }
+    l_AheadPage = -1;
+
+    pageHdr.Magic    = LOG_PAGE_MAGIC;
+    pageHdr.PageSeq  = l_PageSeq + 1;
+    pageHdr.EraseCnt = eraseCnt;
+    pageHdr.RecSeq   = recSeq;
+    pageHdr.FirstTime = firstTime;
+    pageHdr.PackKey  = l_WrKey;
+    pageHdr.Crc	     = TlmCRC16 (0xFFFF, (const uint8_t *) &pageHdr,
+				 offsetof(LOG_PAGE_HDR, Crc));
+
+    if (status == mscReturnOk)
+	status = LogFlashWrite (PAGE_ADDR(l_Head), &pageHdr, sizeof(pageHdr));
+
+    if (status == mscReturnOk  &&  ! PageHdrGet (l_Head, &pageHdr))
+	status = logVerifyFailed;
+
+    if (status != mscReturnOk)
+	return status;
+
+    l_PageSeq++;
+    l_WriteAddr = PAGE_ADDR(l_Head) + LOG_PAGE_HDR_SIZE;
+
+    return mscReturnOk;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check Record
+ *
+ * Checks the length and the CRC of the record at the specified address.
+ *
+ * @param[in] addr
+ *	Address of the record.
+ *
+ * @param[in] endAddr
+ *	End of the page, the record must not exceed it.
+ *
+ * @param[out] pHdr
+ *	Address where to store the record header, may be NULL.
+ *
+ * @return
+ *	Number of bytes the record occupies, 0 if the flash is erased at this
+ *	address, or -1 if the record is damaged.
+ *
+ ******************************************************************************/
+static int  RecordCheck (uint32_t addr, uint32_t endAddr, LOG_REC_HDR *pHdr)
+{
+const uint32_t *pWord = (const uint32_t *) addr;
+LOG_REC_HDR hdr;
+int	 size;
+
+
+    if (addr + LOG_REC_HDR_SIZE + 4 > endAddr  ||  pWord[0] == ERASED_WORD)
+	return 0;
+
+    memcpy (&hdr, pWord, LOG_REC_HDR_SIZE);
+    if (hdr.Len > LOG_DATA_MAX)
+	return -1;
+
+    size = REC_SIZE(hdr.Len);
+    if (addr + size > endAddr
+    ||  pWord[size / 4 - 1] != TlmCRC16 (0xFFFF, (const uint8_t *) addr,
+					 LOG_REC_HDR_SIZE + hdr.Len))
+	return -1;
+
+    if (pHdr != NULL)
+	*pHdr = hdr;
+
+    return size;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Track Pack Key
+ *
+ * Updates the pack key by a record: a @ref LOG_TYPE_CONNECT record contains
+ * the new key, a @ref LOG_TYPE_SESSION record resets it, because the pack
+ * is not known after a reset.
+ *
+ ******************************************************************************/
+static void PackKeyTrack (uint32_t *pKey, const LOG_REC_HDR *pHdr,
+			  const uint8_t *pData)
+{
+    if (pHdr->Type == LOG_TYPE_SESSION)
+	*pKey = 0;
+    else if (pHdr->Type == LOG_TYPE_CONNECT  &&  pHdr->Len >= 4)
+	memcpy (pKey, pData, 4);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	End of the Firmware Image
+ *
+ * Returns the address behind the firmware image and its init data, i.e.
+ * the lowest address which may be used for data in the flash.  The symbol
+ * __image_end__ is defined by the linker scripts, which also reserve the
+ * flash from @ref HIST_START_ADDR on, so the image cannot grow into the
+ * pack history index and the log.
+ *
+ ******************************************************************************/
+uint32_t LogImageEnd (void)
+{
+#ifdef __GNUC__
+    extern uint32_t __image_end__;
+
+    return (uint32_t) &__image_end__;
+#else
+    return 0;
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write Flash
+ *
+ * Writes words with interrupts disabled, the address, the data and the count
+ * must be word aligned.  Other modules which keep data in
+ * the flash use this function too, so LogActivity() covers their writes.
+ * The flash controller must have been unlocked by MSC_Init().
+ *
+ ******************************************************************************/
+int	LogFlashWrite (uint32_t addr, const void *pData, int cnt)
+{
+int	 status;
+
+
+    EFM_ASSERT(((addr | (uint32_t) pData | cnt) & 3) == 0);
+
+    INT_Disable();
+    status = FlashProgram (addr, pData, cnt);
+    INT_Enable();
+
+    l_Activity++;
+
+    return status;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Erase Flash Page
+ *
+ * Erases a page with interrupts disabled, see LogFlashWrite().
+ *
+ ******************************************************************************/
+int	LogFlashErase (uint32_t addr)
+{
+uint32_t start = RTC->CNT;
+uint32_t ticks;
+int	 status;
+
+
+    INT_Disable();
+    status = FlashErase (addr);
+    INT_Enable();
+
+    l_Activity++;
+
+    ticks = (RTC->CNT - start) & 0x00FFFFFF;
+    if (ticks > l_MaxEraseTicks)
+	l_MaxEraseTicks = ticks;
+
+    return status;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Program Flash Words from RAM
+ *
+ * The programming sequence of MSC_WriteWord(), one word after the other.
+ * It executes from RAM and must not call functions in the flash, so it is
+ * only reached from LogFlashWrite() with interrupts disabled.
+ *
+ ******************************************************************************/
+static int  FlashProgram (uint32_t addr, const uint32_t *pData, int cnt)
+{
+uint32_t timeOut;
+int	 status = mscReturnOk;
+
+
+    MSC->WRITECTRL |= MSC_WRITECTRL_WREN;
+
+    for ( ;  cnt > 0;  cnt -= 4, addr += 4)
+    {
+	MSC->ADDRB    = addr;
+	MSC->WRITECMD = MSC_WRITECMD_LADDRIM;
+
+	if (MSC->STATUS & MSC_STATUS_INVADDR)
+	{
+	    status = mscReturnInvalidAddr;
+	    break;
+	}
+	if (MSC->STATUS & MSC_STATUS_LOCKED)
+	{
+	    status = mscReturnLocked;
+	    break;
+	}
+
+	for (timeOut = MSC_PROGRAM_TIMEOUT;  timeOut > 0;  timeOut--)
+	    if (MSC->STATUS & MSC_STATUS_WDATAREADY)
+		break;
+
+	if (timeOut > 0)
+	{
+	    MSC->WDATA    = *pData++;
+	    MSC->WRITECMD = MSC_WRITECMD_WRITEONCE;
+
+	    for (timeOut = MSC_PROGRAM_TIMEOUT;  timeOut > 0;  timeOut--)
+		if ((MSC->STATUS & MSC_STATUS_BUSY) == 0)
+		    break;
+	}
+
+	if (timeOut == 0)
+	{
+	    status = mscReturnTimeOut;
+	    break;
+	}
+    }
+
+    MSC->WRITECTRL &= ~MSC_WRITECTRL_WREN;
+
+    return status;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Erase a Flash Page from RAM
+ *
+ * The erase sequence of MSC_ErasePage(), see FlashProgram().
+ *
+ ******************************************************************************/
+static int  FlashErase (uint32_t addr)
+{
+uint32_t timeOut;
+int	 status = mscReturnOk;
+
+
+    MSC->WRITECTRL |= MSC_WRITECTRL_WREN;
+    MSC->ADDRB      = addr;
+    MSC->WRITECMD   = MSC_WRITECMD_LADDRIM;
+
+    if (MSC->STATUS & MSC_STATUS_INVADDR)
+	status = mscReturnInvalidAddr;
+    else if (MSC->STATUS & MSC_STATUS_LOCKED)
+	status = mscReturnLocked;
+    else
+    {
+	MSC->WRITECMD = MSC_WRITECMD_ERASEPAGE;
+
+	for (timeOut = MSC_PROGRAM_TIMEOUT;  timeOut > 0;  timeOut--)
+	    if ((MSC->STATUS & MSC_STATUS_BUSY) == 0)
+		break;
+
+	if (timeOut == 0)
+	    status = mscReturnTimeOut;
+    }
+
+    MSC->WRITECTRL &= ~MSC_WRITECTRL_WREN;
+
+    return status;
+}
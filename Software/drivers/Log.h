@@ -0,0 +1,165 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Log.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	LOG_START_ADDR is reserved by the linker scripts.
+2026-10-18,agent	Added LogHold().
+2026-10-18,agent	Added LOG_TYPE_PROFILE, see module Profile.c.
+2026-10-18,agent	Added LogFlushTimed() for the power-off sequence.
+2026-10-18,agent	Added HeadPage to LOG_STATS for the log download.
+2026-10-18,agent	Added LOG_TYPE_CONNECT, LogSeek(), and the pack key of
+		the LOG_CURSOR, the page header contains the time index.
+2026-10-18,agent	Added LOG_TYPE_PACK, LogFind(), LogNextSeq(),
+		LogImageEnd(), LogFlashWrite(), and LogFlashErase().
+2026-10-18,agent	Added LOG_TYPE_SERIES, see module Series.c.
+2026-10-18,agent	Added staging buffers, LogCheck(), LogFlush(), and
+		LogActivity().
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Log_h
+#define __INC_Log_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "em_msc.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Start address of the log in the internal flash.  The log uses
+     * the upper part of the flash, which is reserved together with the pack
+     * history index by the linker scripts, see region HRDDATA.  Both must be
+     * changed together.
+     */
+#ifndef LOG_START_ADDR
+    #define LOG_START_ADDR	0x18000
+#endif
+
+    /*!@brief Number of flash pages of the log. */
+#ifndef LOG_PAGE_CNT
+    #define LOG_PAGE_CNT	((int)((FLASH_SIZE - LOG_START_ADDR) / FLASH_PAGE_SIZE))
+#endif
+
+    /*!@brief Size of the log in bytes. */
+#define LOG_SIZE		(LOG_PAGE_CNT * FLASH_PAGE_SIZE)
+
+    /*!@brief Magic number of a page header, "HLG2".  Pages of the previous
+     * format "HLOG" without time index are treated as free.
+     */
+#define LOG_PAGE_MAGIC		0x32474C48
+
+    /*!@brief Size of the page header in bytes. */
+#define LOG_PAGE_HDR_SIZE	28
+
+    /*!@brief Size of the record header in bytes. */
+#define LOG_REC_HDR_SIZE	12
+
+    /*!@brief Size of each of the two staging buffers in bytes. */
+#ifndef LOG_STAGE_SIZE
+    #define LOG_STAGE_SIZE	256
+#endif
+
+    /*!@brief Maximum number of data bytes of a record, it must fit into a
+     * staging buffer.
+     */
+#define LOG_DATA_MAX		(LOG_STAGE_SIZE - LOG_REC_HDR_SIZE - 4)
+
+    /*!@brief Number of words LogCheck() programs per call. */
+#ifndef LOG_WRITE_WORDS
+    #define LOG_WRITE_WORDS	8
+#endif
+
+    /*!@brief Default interval in [s] to log a snapshot of all items. */
+#ifndef LOG_SNAPSHOT_INTERVAL
+    #define LOG_SNAPSHOT_INTERVAL	300
+#endif
+
+    /*!@name Error codes, additionally to @ref msc_Return_TypeDef */
+//@{
+#define logInvalidParameter	-10	//!< record too large
+#define logNotAvailable		-11	//!< log region overlaps the firmware
+#define logVerifyFailed		-12	//!< record could not be written
+#define logBusy			-13	//!< both staging buffers are full
+//@}
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Record types. */
+typedef enum
+{
+    LOG_TYPE_SESSION = 1,	//!< Start of a session: reset cause, version
+    LOG_TYPE_SNAPSHOT,		//!< Telemetry records of all items
+    LOG_TYPE_SERIES,		//!< Compressed samples, see Series.c
+    LOG_TYPE_PACK,		//!< Session of a battery pack, see History.c
+    LOG_TYPE_CONNECT,		//!< Pack key of the connected pack, 0 if none
+    LOG_TYPE_PROFILE,		//!< EM residency of the session, see Profile.c
+} LOG_TYPE;
+
+    /*!@brief Record header, as stored in the flash. */
+typedef struct
+{
+    uint16_t	 Len;		//!< Number of data bytes
+    uint8_t	 Type;		//!< Record type, see @ref LOG_TYPE
+    uint8_t	 Flags;		//!< Reserved, 0
+    uint32_t	 Seq;		//!< Sequence number of the record
+    uint32_t	 Time;		//!< Time of the record, see time()
+} LOG_REC_HDR;
+
+    /*!@brief Read position, see LogRewind() and LogRead(). */
+typedef struct
+{
+    int		 Page;		//!< Index of the current page
+    int		 PagesLeft;	//!< Number of pages still to read
+    uint32_t	 Addr;		//!< Address of the next record, 0 at page start
+    uint32_t	 PackKey;	//!< Pack key of the record read last, 0 if none
+} LOG_CURSOR;
+
+    /*!@brief Statistics, see LogStats(). */
+typedef struct
+{
+    int		 PagesUsed;	//!< Number of pages which contain records
+    int		 HeadPage;	//!< Index of the page written to
+    uint32_t	 FirstSeq;	//!< Sequence number of the oldest record
+    uint32_t	 NextSeq;	//!< Sequence number of the next record
+    uint32_t	 EraseMin;	//!< Lowest erase count of all pages
+    uint32_t	 EraseMax;	//!< Highest erase count of all pages
+    uint32_t	 FreeBytes;	//!< Bytes left before the oldest page is lost
+    uint32_t	 Torn;		//!< Incomplete records found at mount time
+    uint32_t	 Errors;	//!< Failed write or erase operations
+    uint32_t	 Pending;	//!< Bytes in the staging buffers
+    uint32_t	 Dropped;	//!< Records not staged, see @ref logBusy
+    uint32_t	 LateErases;	//!< Erases which could not be done ahead
+    uint32_t	 MaxWriteTicks;	//!< Longest write step of LogCheck()
+    uint32_t	 MaxEraseTicks;	//!< Longest erase
+} LOG_STATS;
+
+/*================================ Prototypes ================================*/
+
+int	LogInit (void);
+int	LogAppend (LOG_TYPE type, const void *pData, int len);
+void	LogCheck (void);
+void	LogFlush (void);
+bool	LogFlushTimed (uint32_t maxTicks);
+void	LogHold (bool flgHold);
+uint32_t LogActivity (void);
+void	LogRewind (LOG_CURSOR *pCursor);
+int	LogRead (LOG_CURSOR *pCursor, LOG_REC_HDR *pHdr,
+		 uint8_t *pBuf, int size);
+void	LogSeek (LOG_CURSOR *pCursor, uint32_t time);
+int	LogFind (uint32_t seq, LOG_REC_HDR *pHdr, uint8_t *pBuf, int size);
+uint32_t LogNextSeq (void);
+void	LogStats (LOG_STATS *pStats);
+int	LogErase (void);
+uint32_t LogImageEnd (void);
+int	LogFlashWrite (uint32_t addr, const void *pData, int cnt);
+int	LogFlashErase (uint32_t addr);
+
+
+#endif /* __INC_Log_h */
@@ -0,0 +1,258 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Unattended Monitor Mode
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module implements the monitor mode for a long-term recording of the
+ * connected pack, powered by the CR2032 alone.  When started, see
+ * MonitorStart(),
+ * - the device is no longer switched off after @ref POWER_OFF_TIMEOUT, and
+ *   the LCD is switched off, see DisplayAutoPowerOff(),
+ * - the series samples the pack every <b>interval</b> seconds, and writes
+ *   its blocks to the session log, see Series.c,
+ * - the RTC wakes the MCU only every few seconds, see ClockTickSet(), so
+ *   it stays in EM2 in between,
+ * - the SMBus pins are only enabled while transactions are queued, see
+ *   BatteryMonPowerSave().
+ *
+ * The period of the RTC interrupt is the largest divisor of the interval up
+ * to @ref CLOCK_TICK_MAX seconds, so an interval of 60s wakes the MCU every
+ * 30s, a prime number every second.  While a transfer of the console, e.g.
+ * an export or a download, is running, the period is one second, because
+ * these modules count their timeouts in seconds.
+ *
+ * The residency in EM0, EM1, and EM2 since the start is taken from the
+ * profiler, see Profile.c.  From this, MonitorStats() projects the lifetime
+ * of the CR2032.  The currents of each mode are typical values of the data
+ * sheet, see @ref PROF_EM0_NA, so the projection is only as good as these
+ * values, and it does not include the self-discharge of the cell.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	The residency is taken from the profiler, see Profile.c.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_device.h"
+#include "em_assert.h"
+#include "Monitor.h"
+#include "AlarmClock.h"
+#include "Display.h"
+#include "BatteryMon.h"
+#include "Series.h"
+#include "Supply.h"
+#include "Bridge.h"
+#include "DataFlash.h"
+#include "Export.h"
+#include "Download.h"
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Flag if the monitor mode is active. */
+static bool		 l_flgActive;
+
+    /*!@brief Sample interval, and period of the RTC interrupt in [s]. */
+static int		 l_Interval;
+static int		 l_Tick;
+
+    /*!@brief Sample interval of the series before the monitor mode. */
+static int		 l_SeriesInterval;
+
+    /*!@brief Profiler totals at the start, and at the stop of the monitor
+     * mode, in RTC ticks.
+     */
+static uint64_t		 l_StartTicks[PROF_EM_CNT];
+static uint64_t		 l_StopTicks[PROF_EM_CNT];
+
+    /*!@brief Profiler wake-ups at the start, and at the stop. */
+static uint32_t		 l_StartWakeups;
+static uint32_t		 l_StopWakeups;
+
+    /*!@brief Supply current of each mode in [nA], see Profile.h. */
+static const uint32_t	 l_CurrentNA[PROF_EM_CNT] =
+{
+    PROF_EM0_NA + PROF_BOARD_NA,
+    PROF_EM1_NA + PROF_BOARD_NA,
+    PROF_EM2_NA + PROF_BOARD_NA
+};
+
+    /*!@brief Buffer for the profiler totals, too large for the stack. */
+static PROF_STATS	 l_Prof;
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start the Monitor Mode
+ *
+ * Starts the monitor mode, or changes the interval if it is already active.
+ * The residency counters start again from zero.
+ *
+ * @param[in] interval
+ *	Sample interval in seconds, from 1 to @ref MONITOR_INTERVAL_MAX.
+ *
+ * @return
+ *	The interval in use, or 0 if the supply is low, see SupplyIsLow().
+ *
+ ******************************************************************************/
+int	MonitorStart (int interval)
+{
+int	 i;
+
+
+    if (interval < 1)
+	interval = 1;
+    else if (interval > MONITOR_INTERVAL_MAX)
+	interval = MONITOR_INTERVAL_MAX;
+
+    if (SupplyIsLow())
+	return 0;		// the series is stopped, see Supply.c
+
+    if (! l_flgActive)
+	l_SeriesInterval = SeriesIntervalGet();
+
+    /* Largest divisor of the interval, so no sample is delayed */
+    for (l_Tick = CLOCK_TICK_MAX;  interval % l_Tick != 0;  l_Tick--)
+	;
+
+    l_Interval = interval;
+    SeriesIntervalSet (interval);
+    DisplayAutoPowerOff (false);
+    BatteryMonPowerSave (true);
+    ClockTickSet (l_Tick);
+
+    ProfileStats (&l_Prof);
+    for (i = 0;  i < PROF_EM_CNT;  i++)
+	l_StartTicks[i] = l_Prof.Ticks[i];
+    l_StartWakeups = l_Prof.Wakeups;
+
+    l_flgActive = true;
+
+    return interval;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop the Monitor Mode
+ *
+ * Restores the sample interval of the series, the one-second tick, the
+ * SMBus pins, and the automatic power-off.  The statistics are kept until
+ * the next start.
+ *
+ ******************************************************************************/
+void	MonitorStop (void)
+{
+int	 i;
+
+
+    if (! l_flgActive)
+	return;
+
+    ProfileStats (&l_Prof);
+    for (i = 0;  i < PROF_EM_CNT;  i++)
+	l_StopTicks[i] = l_Prof.Ticks[i];
+    l_StopWakeups = l_Prof.Wakeups;
+    l_flgActive = false;
+
+    ClockTickSet (1);
+    BatteryMonPowerSave (false);
+    DisplayAutoPowerOff (true);
+    SeriesIntervalSet (l_SeriesInterval);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Monitor Mode is active
+ *
+ ******************************************************************************/
+bool	MonitorIsActive (void)
+{
+    return l_flgActive;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Monitor Check
+ *
+ * This function must be called from the main loop.  It selects the period
+ * of the RTC interrupt: one second while a transfer of the console is
+ * running, else the period for the interval.
+ *
+ ******************************************************************************/
+void	MonitorCheck (void)
+{
+int	 tick;
+
+
+    if (! l_flgActive)
+	return;
+
+    if (BridgeIsActive()  ||  DFlashIsActive()  ||  ExportIsActive()
+    ||  DownloadIsActive())
+	tick = 1;
+    else
+	tick = l_Tick;
+
+    if (ClockTickGet() != tick)
+	ClockTickSet (tick);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Monitor Statistics
+ *
+ * Returns the residency in each energy mode since the start of the monitor
+ * mode, the resulting average current, and the projected lifetime of a new
+ * CR2032 of @ref MONITOR_CR2032_MAH.
+ *
+ ******************************************************************************/
+void	MonitorStats (MONITOR_STATS *pStats)
+{
+uint64_t total = 0;		// in RTC ticks
+uint64_t charge = 0;		// in [nA * ticks]
+uint32_t avg;
+int	 i;
+
+
+    EFM_ASSERT(pStats != NULL);
+
+    pStats->flgActive = l_flgActive;
+    pStats->Interval  = l_Interval;
+    pStats->Tick      = ClockTickGet();
+
+    if (l_flgActive)
+    {
+	ProfileStats (&l_Prof);
+	for (i = 0;  i < PROF_EM_CNT;  i++)
+	    l_StopTicks[i] = l_Prof.Ticks[i];
+	l_StopWakeups = l_Prof.Wakeups;
+    }
+
+    pStats->Wakeups = l_StopWakeups - l_StartWakeups;
+
+    for (i = 0;  i < PROF_EM_CNT;  i++)
+    {
+	pStats->Ticks[i] = l_StopTicks[i] - l_StartTicks[i];
+	total  += pStats->Ticks[i];
+	charge += pStats->Ticks[i] * l_CurrentNA[i];
+    }
+
+    if (total == 0)
+    {
+	pStats->AvgCurrentNA  = 0;
+	pStats->LifetimeHours = 0;
+	return;
+    }
+
+    avg = (uint32_t)(charge / total);
+    if (avg == 0)
+	avg = 1;			// no division by zero
+    pStats->AvgCurrentNA  = avg;
+    pStats->LifetimeHours = (uint32_t)(MONITOR_CR2032_MAH * 1000000ULL / avg);
+}
@@ -0,0 +1,62 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Monitor.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	The residency is taken from the profiler, see Profile.c,
+		the currents are PROF_EM0_NA etc. now.  Removed MonitorSleep().
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Monitor_h
+#define __INC_Monitor_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "Profile.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Default sample interval of the monitor mode in [s]. */
+#ifndef MONITOR_INTERVAL
+    #define MONITOR_INTERVAL	60
+#endif
+
+    /*!@brief Maximum sample interval of the monitor mode in [s]. */
+#define MONITOR_INTERVAL_MAX	3600
+
+    /*!@brief Nominal capacity of the CR2032 in [mAh]. */
+#ifndef MONITOR_CR2032_MAH
+    #define MONITOR_CR2032_MAH	225
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Statistics, see MonitorStats(). */
+typedef struct
+{
+    bool	 flgActive;	//!< Monitor mode is active
+    int		 Interval;	//!< Sample interval in [s]
+    int		 Tick;		//!< Period of the RTC interrupt in [s]
+    uint32_t	 Wakeups;	//!< Number of wake-ups from EM1 or EM2
+    uint64_t	 Ticks[PROF_EM_CNT];	//!< Time in each mode in RTC ticks
+    uint32_t	 AvgCurrentNA;	//!< Average supply current in [nA]
+    uint32_t	 LifetimeHours;	//!< Projected lifetime of the CR2032 in [h]
+} MONITOR_STATS;
+
+/*================================ Prototypes ================================*/
+
+int	MonitorStart (int interval);
+void	MonitorStop (void);
+bool	MonitorIsActive (void);
+void	MonitorCheck (void);
+void	MonitorStats (MONITOR_STATS *pStats);
+
+
+#endif /* __INC_Monitor_h */
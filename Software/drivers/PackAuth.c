@@ -0,0 +1,385 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Battery Pack Authentication
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module detects counterfeit battery packs, e.g. at incoming
+ * inspection.  The bq40z50 implements a SHA-1 based challenge-response
+ * authentication with a 128-bit key K, which is programmed into genuine
+ * packs:
+ * - The challenge M of 20 bytes is written to Authenticate() (0x2F) as
+ *   SMBus block.
+ * - The controller calculates the digest SHA1(K | SHA1(K | M)), this takes
+ *   up to @ref AUTH_DELAY_MS.
+ * - The digest of 20 bytes is read from Authenticate() as block.
+ *
+ * The HRD calculates the same digest with its copy of the key, while the
+ * controller is busy, and compares both.  PackAuthStart() sends the
+ * challenge, then a high-resolution timer wakes up the main loop, and
+ * PackAuthCheck() reads the digest, so the MCU sleeps while it waits.  The
+ * key is stored in the user data page at @ref AUTH_KEY_ADDR, behind @ref
+ * AUTH_KEY_MAGIC, see tools/pack_auth.py.
+ *
+ * The challenge must not be predictable, otherwise a counterfeit pack could
+ * replay recorded digests.  There is no random number generator, so each
+ * challenge is the SHA-1 of the previous one, the RTC counter, the time,
+ * and the unique ID of the device.  The RTC counter at the time the command
+ * is entered is the only source of entropy, a challenge may also be given
+ * by the PC.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	PackAuthenticate() has been split into PackAuthStart()
+		and PackAuthCheck(), a timer wakes up the main loop for
+		the digest.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_i2c.h"
+#include "PackAuth.h"
+#include "BatteryMon.h"
+#include "AlarmClock.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Interval in [ms] to poll for the digest. */
+#define AUTH_POLL_MS		20
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Known answer test. */
+typedef struct
+{
+    const char	*pMsg;		//!< Message, for the TI digest the challenge
+    int		 MsgLen;	//!< Length of the message
+    bool	 flgAuth;	//!< Calculate the TI digest instead of SHA-1
+    uint8_t	 Digest[SHA1_DIGEST_SIZE];	//!< Expected result
+} AUTH_VECTOR;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void AuthTimerFct (TIM_HDL hdl);
+static int  AuthElapsed (void);
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Default key of the bq40z50, only used for the self test. */
+static const uint8_t l_TestKey[AUTH_KEY_SIZE] =
+{
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+    0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10,
+};
+
+    /*!@brief Known answer tests, SHA-1 from FIPS 180-2, and the digest for
+     * challenge 00 01 .. 13 with @ref l_TestKey, see tools/pack_auth.py.
+     */
+static const AUTH_VECTOR l_Vector[] =
+{
+    {	"abc", 3, false,
+	{ 0xA9, 0x99, 0x3E, 0x36, 0x47, 0x06, 0x81, 0x6A, 0xBA, 0x3E,
+	  0x25, 0x71, 0x78, 0x50, 0xC2, 0x6C, 0x9C, 0xD0, 0xD8, 0x9D } },
+    {	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, false,
+	{ 0x84, 0x98, 0x3E, 0x44, 0x1C, 0x3B, 0xD2, 0x6E, 0xBA, 0xAE,
+	  0x4A, 0xA1, 0xF9, 0x51, 0x29, 0xE5, 0xE5, 0x46, 0x70, 0xF1 } },
+    {	"\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09"
+	"\x0A\x0B\x0C\x0D\x0E\x0F\x10\x11\x12\x13", 20, true,
+	{ 0xB7, 0x80, 0x43, 0x01, 0x2B, 0xB4, 0x0F, 0x9F, 0xF8, 0x64,
+	  0x04, 0xF6, 0x45, 0xC2, 0xAB, 0x6A, 0x9F, 0x28, 0xEA, 0xF3 } },
+};
+
+    /*!@brief Last challenge, input for the next one. */
+static uint8_t		 l_Challenge[SHA1_DIGEST_SIZE];
+
+    /*!@brief SHA-1 context, static to keep it off the stack. */
+static SHA1_CTX		 l_Ctx;
+
+    /*!@brief Result of the running authentication, NULL if none. */
+static AUTH_RESULT	*l_pResult;
+
+    /*!@brief RTC counter when the challenge has been sent. */
+static uint32_t		 l_Start;
+
+    /*!@brief Timer for the next read of the digest, and the flag set by
+     * AuthTimerFct() when it has expired.
+     */
+static TIM_HDL		 l_hdlTimer = -1;
+static volatile bool	 l_flgPoll;
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start the Authentication of the Battery Pack
+ *
+ * Sends a challenge to the battery controller, and calculates the expected
+ * digest while the controller is busy.  A high-resolution timer wakes up
+ * the main loop after @ref AUTH_DELAY_MS, then PackAuthCheck() reads the
+ * digest.
+ *
+ * @param[in] pChallenge
+ *	Challenge of @ref AUTH_CHALLENGE_SIZE bytes, or NULL to generate one.
+ *
+ * @param[out] pResult
+ *	Address of a persistent structure where to store the result.
+ *
+ * @return
+ *	0 if the challenge has been sent, or a negative error code.  @ref
+ *	i2cNoAuthKey is returned if no key is programmed.
+ *
+ ******************************************************************************/
+int	PackAuthStart (const uint8_t *pChallenge, AUTH_RESULT *pResult)
+{
+const uint32_t *pKey = (const uint32_t *) AUTH_KEY_ADDR;
+uint32_t ticks, value;
+int	 status, elapsed;
+
+
+    PackAuthAbort();
+
+    if (g_BatteryCtrlType != BCT_TI)
+	return i2cInvalidParameter;
+
+    if (pKey[0] != AUTH_KEY_MAGIC)
+	return i2cNoAuthKey;
+
+    if (l_hdlTimer < 0)
+	l_hdlTimer = msTimerCreate (AuthTimerFct);
+
+    memset (pResult, 0, sizeof(*pResult));
+
+    if (pChallenge != NULL)
+    {
+	memcpy (pResult->Challenge, pChallenge, AUTH_CHALLENGE_SIZE);
+    }
+    else
+    {
+	/* Next challenge from the previous one and the current time */
+	Sha1Init (&l_Ctx);
+	Sha1Update (&l_Ctx, l_Challenge, sizeof(l_Challenge));
+	value = RTC->CNT;
+	Sha1Update (&l_Ctx, (uint8_t *) &value, sizeof(value));
+	value = (uint32_t) time(NULL);
+	Sha1Update (&l_Ctx, (uint8_t *) &value, sizeof(value));
+	value = DEVINFO->UNIQUEL;
+	Sha1Update (&l_Ctx, (uint8_t *) &value, sizeof(value));
+	value = DEVINFO->UNIQUEH;
+	Sha1Update (&l_Ctx, (uint8_t *) &value, sizeof(value));
+	Sha1Final (&l_Ctx, l_Challenge);
+
+	memcpy (pResult->Challenge, l_Challenge, AUTH_CHALLENGE_SIZE);
+    }
+
+    l_Start = RTC->CNT;
+
+    status = BatteryRegWriteBlock (SBS_Authenticate, pResult->Challenge,
+				   AUTH_CHALLENGE_SIZE);
+    if (status != i2cTransferDone)
+	return status;
+
+    /* Calculate the expected digest while the controller is busy */
+    ticks = RTC->CNT;
+    PackAuthDigest ((const uint8_t *)(pKey + 1), pResult->Challenge,
+		    pResult->Expected);
+    pResult->HashTicks = (RTC->CNT - ticks) & 0x00FFFFFF;
+
+    /* Wait for the digest, the timer wakes up the main loop */
+    l_pResult = pResult;
+    l_flgPoll = false;
+    elapsed = AuthElapsed();
+    msTimerStart (l_hdlTimer, elapsed < AUTH_DELAY_MS
+		  ? AUTH_DELAY_MS - elapsed : AUTH_POLL_MS);
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Authentication Check
+ *
+ * Must be called from the main loop while PackAuthIsActive() is true.  When
+ * the timer has expired, it reads the digest once.  If the controller is
+ * still busy, the timer is started again for @ref AUTH_POLL_MS, until
+ * @ref AUTH_TIMEOUT_MS have passed since the challenge.
+ *
+ * @return
+ *	1 while the authentication is in progress, 0 if the digest has been
+ *	read, then <b>flgGenuine</b> of the result tells if the pack is
+ *	genuine, or a negative error code.
+ *
+ ******************************************************************************/
+int	PackAuthCheck (void)
+{
+uint8_t	 rdBuf[1 + SHA1_DIGEST_SIZE];	// byte count and digest
+AUTH_RESULT *pResult = l_pResult;
+int	 status;
+
+
+    if (pResult == NULL)
+	return i2cInvalidParameter;
+
+    if (! l_flgPoll)
+	return 1;			// timer still running
+
+    l_flgPoll = false;
+
+    status = BatteryRegReadBlock (SBS_Authenticate, rdBuf, sizeof(rdBuf));
+    if (status != i2cTransferDone  ||  rdBuf[0] != SHA1_DIGEST_SIZE)
+    {
+	if (AuthElapsed() < AUTH_TIMEOUT_MS)
+	{
+	    msTimerStart (l_hdlTimer, AUTH_POLL_MS);	// controller still busy
+	    return 1;
+	}
+
+	l_pResult = NULL;
+	return (status != i2cTransferDone ? status : i2cTransferTimeout);
+    }
+
+    memcpy (pResult->Digest, rdBuf + 1, SHA1_DIGEST_SIZE);
+    pResult->flgGenuine = (memcmp (pResult->Digest, pResult->Expected,
+				   SHA1_DIGEST_SIZE) == 0);
+    pResult->TotalTicks = (RTC->CNT - l_Start) & 0x00FFFFFF;
+    l_pResult = NULL;
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Abort the Authentication
+ *
+ * Stops a running authentication, the result is not completed.
+ *
+ ******************************************************************************/
+void	PackAuthAbort (void)
+{
+    if (l_hdlTimer >= 0)
+	msTimerCancel (l_hdlTimer);
+
+    l_pResult = NULL;
+    l_flgPoll = false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Authentication in Progress
+ *
+ * @return
+ *	true while an authentication waits for the digest.
+ *
+ ******************************************************************************/
+bool	PackAuthIsActive (void)
+{
+    return (l_pResult != NULL);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Calculate Authentication Digest
+ *
+ * Calculates SHA1(K | SHA1(K | M)), as the battery controller does.
+ *
+ * @param[in] pKey
+ *	Key K of @ref AUTH_KEY_SIZE bytes.
+ *
+ * @param[in] pChallenge
+ *	Challenge M of @ref AUTH_CHALLENGE_SIZE bytes.
+ *
+ * @param[out] pDigest
+ *	Address where to store the @ref SHA1_DIGEST_SIZE bytes of the digest.
+ *
+ ******************************************************************************/
+void	PackAuthDigest (const uint8_t *pKey, const uint8_t *pChallenge,
+			uint8_t *pDigest)
+{
+    Sha1Init (&l_Ctx);
+    Sha1Update (&l_Ctx, pKey, AUTH_KEY_SIZE);
+    Sha1Update (&l_Ctx, pChallenge, AUTH_CHALLENGE_SIZE);
+    Sha1Final (&l_Ctx, pDigest);
+
+    Sha1Init (&l_Ctx);
+    Sha1Update (&l_Ctx, pKey, AUTH_KEY_SIZE);
+    Sha1Update (&l_Ctx, pDigest, SHA1_DIGEST_SIZE);
+    Sha1Final (&l_Ctx, pDigest);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Self Test
+ *
+ * Checks SHA-1 and the digest calculation with known answer tests.
+ *
+ * @return
+ *	Number of failed tests, 0 if all passed.
+ *
+ ******************************************************************************/
+int	PackAuthSelfTest (void)
+{
+uint8_t	 digest[SHA1_DIGEST_SIZE];
+int	 i, failed = 0;
+
+
+    for (i = 0;  i < (int) ELEM_CNT(l_Vector);  i++)
+    {
+	if (l_Vector[i].flgAuth)
+	{
+	    PackAuthDigest (l_TestKey, (const uint8_t *) l_Vector[i].pMsg,
+			    digest);
+	}
+	else
+	{
+	    Sha1Init (&l_Ctx);
+	    Sha1Update (&l_Ctx, (const uint8_t *) l_Vector[i].pMsg,
+			l_Vector[i].MsgLen);
+	    Sha1Final (&l_Ctx, digest);
+	}
+
+	if (memcmp (digest, l_Vector[i].Digest, SHA1_DIGEST_SIZE) != 0)
+	    failed++;
+    }
+
+    return failed;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Authentication Timer Function
+ *
+ * Called by the high-resolution timer in interrupt context, when the next
+ * read of the digest is due.  It wakes up the main loop.
+ *
+ ******************************************************************************/
+static void AuthTimerFct (TIM_HDL hdl)
+{
+    (void) hdl;
+
+    l_flgPoll = true;
+    g_flgIRQ = true;		// keep on running
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Time since the Challenge
+ *
+ * @return
+ *	Time in [ms] since the challenge has been sent.
+ *
+ ******************************************************************************/
+static int  AuthElapsed (void)
+{
+    return (int)(((RTC->CNT - l_Start) & 0x00FFFFFF) * 1000UL
+		 / RTC_COUNTS_PER_SEC);
+}
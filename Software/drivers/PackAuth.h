@@ -0,0 +1,79 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module PackAuth.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	PackAuthStart(), PackAuthCheck(), PackAuthAbort(), and
+		PackAuthIsActive() replace PackAuthenticate().
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_PackAuth_h
+#define __INC_PackAuth_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "Sha1.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Address of the authentication key in the user data page,
+     * behind the export keys, see Export.h.
+     */
+#ifndef AUTH_KEY_ADDR
+    #define AUTH_KEY_ADDR	(USERDATA_BASE + 0x40)
+#endif
+
+    /*!@brief Magic number in front of the key, "HRDA" */
+#define AUTH_KEY_MAGIC		0x41445248
+
+    /*!@brief Size of the authentication key in bytes. */
+#define AUTH_KEY_SIZE		16
+
+    /*!@brief Size of the challenge in bytes. */
+#define AUTH_CHALLENGE_SIZE	20
+
+    /*!@brief Time in [ms] the controller needs to calculate the digest. */
+#ifndef AUTH_DELAY_MS
+    #define AUTH_DELAY_MS	250
+#endif
+
+    /*!@brief Maximum time in [ms] to wait for the digest. */
+#define AUTH_TIMEOUT_MS		1000
+
+    /*!@brief Error code if no key is programmed, additionally to
+     * @ref I2C_TransferReturn_TypeDef
+     */
+#define i2cNoAuthKey		-16
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Result of an authentication. */
+typedef struct
+{
+    uint8_t	 Challenge[AUTH_CHALLENGE_SIZE];	//!< Challenge sent
+    uint8_t	 Digest[SHA1_DIGEST_SIZE];	//!< Digest of the controller
+    uint8_t	 Expected[SHA1_DIGEST_SIZE];	//!< Digest calculated here
+    bool	 flgGenuine;	//!< Digests match
+    uint32_t	 TotalTicks;	//!< RTC ticks from challenge to result
+    uint32_t	 HashTicks;	//!< RTC ticks for the calculation
+} AUTH_RESULT;
+
+/*================================ Prototypes ================================*/
+
+int	PackAuthStart (const uint8_t *pChallenge, AUTH_RESULT *pResult);
+int	PackAuthCheck (void);
+void	PackAuthAbort (void);
+bool	PackAuthIsActive (void);
+void	PackAuthDigest (const uint8_t *pKey, const uint8_t *pChallenge,
+			uint8_t *pDigest);
+int	PackAuthSelfTest (void);
+
+
+#endif /* __INC_PackAuth_h */
@@ -0,0 +1,214 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Energy Mode Residency Profiler
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module measures how long the MCU is in EM0, EM1, and EM2, and who
+ * kept it awake.  The main loop calls
+ * - ProfileTask() before each of its check functions, the EM0 time since
+ *   the previous call is charged to the previous task,
+ * - ProfileSleep() just before EMU_EnterEM1() or EMU_EnterEM2(), with the
+ *   current @ref g_EM1_ModuleMask,
+ * - ProfileWake() just after the MCU woke up again.
+ *
+ * All time stamps are taken from RTC->CNT, i.e. with a resolution of about
+ * 30us.  A single check function often takes less than one tick, so its
+ * share is a statistical one, which is accurate over many iterations.  The
+ * interrupt handlers which wake the MCU are executed before ProfileWake(),
+ * their time is counted as sleep time.  The EM1 time is charged to each bit
+ * of @ref g_EM1_ModuleMask that was set when EM1 was entered, so with more
+ * than one bit the module times add up to more than the EM1 time.
+ *
+ * The totals cover the whole session, i.e. the time since power-on.  They
+ * are converted into a charge with the typical currents @ref PROF_EM0_NA,
+ * @ref PROF_EM1_NA, and @ref PROF_EM2_NA, plus @ref PROF_BOARD_NA for the
+ * rest of the board, so firmware changes can be compared in [uAh].  These
+ * are estimates, not measurements.  ProfileLog() appends the totals to the
+ * session log as @ref LOG_TYPE_PROFILE record, this is done by the
+ * power-off sequence, see SupplyPowerOff().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_device.h"
+#include "em_assert.h"
+#include "Profile.h"
+#include "AlarmClock.h"
+#include "Log.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief RTC ticks since a time stamp, the counter has 24 bits. */
+#define TICKS_SINCE(cnt)	((RTC->CNT - (cnt)) & 0x00FFFFFF)
+
+    /*!@brief RTC ticks per hour, to convert [nA * ticks] into [nAh]. */
+#define TICKS_PER_HOUR		((uint64_t) RTC_COUNTS_PER_SEC * 3600)
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Time in each energy mode, in RTC ticks. */
+static uint64_t		 l_Ticks[PROF_EM_CNT];
+
+    /*!@brief EM0 time of each task, in RTC ticks. */
+static uint64_t		 l_TaskTicks[PROF_TASK_CNT];
+
+    /*!@brief EM1 time of each bit of @ref g_EM1_ModuleMask, in RTC ticks. */
+static uint64_t		 l_ModTicks[END_EM1_MODULES];
+
+    /*!@brief Number of wake-ups. */
+static uint32_t		 l_Wakeups;
+
+    /*!@brief Task which is currently running, and its start. */
+static PROF_TASK	 l_Task = PROF_TASK_LOOP;
+static uint32_t		 l_Mark;
+
+    /*!@brief Module mask when the sleep phase has been entered. */
+static uint16_t		 l_SleepMask;
+
+    /*!@brief Supply current of each mode in [nA]. */
+static const uint32_t	 l_CurrentNA[PROF_EM_CNT] =
+{
+    PROF_EM0_NA + PROF_BOARD_NA,
+    PROF_EM1_NA + PROF_BOARD_NA,
+    PROF_EM2_NA + PROF_BOARD_NA
+};
+
+
+/***************************************************************************//**
+ *
+ * @brief	Switch to a Task
+ *
+ * Charges the EM0 time since the last time stamp to the current task, and
+ * makes @p task the current one.
+ *
+ * @param[in] task
+ *	Task of the main loop which is called next.
+ *
+ ******************************************************************************/
+void	ProfileTask (PROF_TASK task)
+{
+uint32_t ticks = TICKS_SINCE(l_Mark);
+
+
+    l_Mark += ticks;
+    l_Ticks[PROF_EM0] += ticks;
+    l_TaskTicks[l_Task] += ticks;
+    l_Task = task;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enter a Sleep Phase
+ *
+ * This function must be called just before EM1 or EM2 is entered.  It
+ * charges the last EM0 time, and stamps the entry.
+ *
+ * @param[in] em1Mask
+ *	Value of @ref g_EM1_ModuleMask, 0 if EM2 is entered.
+ *
+ ******************************************************************************/
+void	ProfileSleep (uint16_t em1Mask)
+{
+    ProfileTask (PROF_TASK_LOOP);
+    l_SleepMask = em1Mask;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Leave a Sleep Phase
+ *
+ * This function must be called just after the MCU woke up from EM1 or EM2.
+ * It charges the sleep time to the energy mode, and for EM1 to each module
+ * bit which was set.  The following EM0 time belongs to the loop until the
+ * next call of ProfileTask().
+ *
+ ******************************************************************************/
+void	ProfileWake (void)
+{
+uint32_t ticks = TICKS_SINCE(l_Mark);
+int	 i;
+
+
+    l_Mark += ticks;
+    l_Wakeups++;
+
+    if (l_SleepMask == 0)
+    {
+	l_Ticks[PROF_EM2] += ticks;
+	return;
+    }
+
+    l_Ticks[PROF_EM1] += ticks;
+    for (i = 0;  i < END_EM1_MODULES;  i++)
+    {
+	if (l_SleepMask & (1 << i))
+	    l_ModTicks[i] += ticks;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Profiler Statistics
+ *
+ * Returns the totals of the session up to the last time stamp, and the
+ * charge of each energy mode.
+ *
+ ******************************************************************************/
+void	ProfileStats (PROF_STATS *pStats)
+{
+int	 i;
+
+
+    EFM_ASSERT(pStats != NULL);
+
+    for (i = 0;  i < PROF_EM_CNT;  i++)
+    {
+	pStats->Ticks[i] = l_Ticks[i];
+	pStats->ChargeNAh[i] = (uint32_t)(l_Ticks[i] * l_CurrentNA[i]
+					  / TICKS_PER_HOUR);
+    }
+
+    for (i = 0;  i < PROF_TASK_CNT;  i++)
+	pStats->TaskTicks[i] = l_TaskTicks[i];
+
+    for (i = 0;  i < END_EM1_MODULES;  i++)
+	pStats->ModTicks[i] = l_ModTicks[i];
+
+    pStats->Wakeups = l_Wakeups;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log the Session Totals
+ *
+ * Appends the time and the charge of each energy mode as @ref
+ * LOG_TYPE_PROFILE record to the session log.  The record is staged, it is
+ * written by LogCheck() or LogFlush().
+ *
+ ******************************************************************************/
+void	ProfileLog (void)
+{
+PROF_STATS  stats;
+PROF_RECORD rec;
+int	 i;
+
+
+    ProfileStats (&stats);
+
+    for (i = 0;  i < PROF_EM_CNT;  i++)
+    {
+	rec.Seconds[i] = (uint32_t)(stats.Ticks[i] / RTC_COUNTS_PER_SEC);
+	rec.ChargeNAh[i] = stats.ChargeNAh[i];
+    }
+
+    LogAppend (LOG_TYPE_PROFILE, &rec, sizeof(rec));
+}
@@ -0,0 +1,94 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Profile.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Profile_h
+#define __INC_Profile_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Supply current in [nA] of the MCU in EM0, EM1, and EM2, and of
+     * the rest of the board.  These are typical values of the data sheet of
+     * the EFM32G230 with the HFRCO at 14MHz, not measurements of the HRD.
+     * The board current must be measured and defined for a real projection.
+     */
+#ifndef PROF_EM0_NA
+    #define PROF_EM0_NA		2800000
+#endif
+#ifndef PROF_EM1_NA
+    #define PROF_EM1_NA		630000
+#endif
+#ifndef PROF_EM2_NA
+    #define PROF_EM2_NA		900
+#endif
+#ifndef PROF_BOARD_NA
+    #define PROF_BOARD_NA	0
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Energy modes in which the time is measured. */
+typedef enum
+{
+    PROF_EM0,			//!< Active, i.e. not sleeping
+    PROF_EM1,			//!< Sleep mode
+    PROF_EM2,			//!< Deep sleep mode
+    PROF_EM_CNT
+} PROF_EM;
+
+    /*!@brief Tasks of the main loop, the EM0 time is charged to them. */
+typedef enum
+{
+    PROF_TASK_LOOP,		//!< Wake-up and the EM decision of the loop
+    PROF_TASK_SUPPLY,		//!< SupplyCheck()
+    PROF_TASK_DISPLAY,		//!< DisplayUpdateCheck()
+    PROF_TASK_CONSOLE,		//!< ConsoleCheck() and its transfers
+    PROF_TASK_WATCH,		//!< WatchCheck()
+    PROF_TASK_SERIES,		//!< SeriesCheck()
+    PROF_TASK_HISTORY,		//!< HistoryCheck()
+    PROF_TASK_SMBUS,		//!< BatteryMonCheck()
+    PROF_TASK_LOG,		//!< LogCheck()
+    PROF_TASK_MONITOR,		//!< MonitorCheck()
+    PROF_TASK_CNT
+} PROF_TASK;
+
+    /*!@brief Statistics, see ProfileStats().  All times are in RTC ticks. */
+typedef struct
+{
+    uint64_t	 Ticks[PROF_EM_CNT];	  //!< Time in each energy mode
+    uint64_t	 TaskTicks[PROF_TASK_CNT]; //!< EM0 time of each task
+    uint64_t	 ModTicks[END_EM1_MODULES]; //!< EM1 time of each module bit
+    uint32_t	 Wakeups;	//!< Number of wake-ups from EM1 or EM2
+    uint32_t	 ChargeNAh[PROF_EM_CNT]; //!< Charge of each mode in [nAh]
+} PROF_STATS;
+
+    /*!@brief Totals of a session, stored as @ref LOG_TYPE_PROFILE record. */
+typedef struct
+{
+    uint32_t	 Seconds[PROF_EM_CNT];	 //!< Time in each energy mode in [s]
+    uint32_t	 ChargeNAh[PROF_EM_CNT]; //!< Charge of each mode in [nAh]
+} PROF_RECORD;
+
+/*================================ Prototypes ================================*/
+
+void	ProfileTask (PROF_TASK task);
+void	ProfileSleep (uint16_t em1Mask);
+void	ProfileWake (void);
+void	ProfileStats (PROF_STATS *pStats);
+void	ProfileLog (void);
+
+
+#endif /* __INC_Profile_h */
@@ -0,0 +1,384 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Lock-free Ring Buffer
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module implements a byte oriented ring buffer, which can be shared
+ * between thread and interrupt context without disabling interrupts:
+ * - RingBufWrite() and RingBufRead() are the simple single-producer,
+ *   single-consumer (SPSC) interface.  Only the producer modifies
+ *   <b>Head</b>, only the consumer modifies <b>Tail</b>.
+ * - RingBufReserve() and RingBufCommit() allow multiple producers, e.g. the
+ *   main loop and several interrupt service routines.  A producer reserves
+ *   a range of bytes, fills it in place (zero-copy) via RING_BUF_AT() or
+ *   RingBufSpan(), and commits it.  The reservation counter is updated with
+ *   LDREX/STREX, <b>Head</b> is published when the last outstanding
+ *   reservation has been committed.
+ * - RingBufPeek() and RingBufConsume() allow a consumer to pass the data
+ *   directly to a DMA channel.  If the consumer may be invoked from several
+ *   contexts, RingBufConsumerLock() ensures only one of them is active.
+ *
+ * @note
+ * Do not mix RingBufWrite() and RingBufReserve() on the same buffer.
+ *
+ * @note
+ * The Cortex-M3 clears the exclusive monitor on every exception entry and
+ * return, so a STREX fails if an interrupt has been taken between LDREX and
+ * STREX, and the operation is simply repeated.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_device.h"
+#include "em_assert.h"
+#include "RingBuf.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Reservation count is stored in the upper half of <b>Prod</b> */
+#define PROD_PENDING_1		0x10000
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize ring buffer
+ *
+ * This routine must be called once to initialize a ring buffer.
+ *
+ * @param[in] pRB
+ *	Address of the ring buffer control structure.
+ *
+ * @param[in] pBuf
+ *	Address of the data buffer.
+ *
+ * @param[in] size
+ *	Size of the data buffer in bytes, must be a power of 2 and not larger
+ *	than @ref RING_BUF_MAX_SIZE.
+ *
+ ******************************************************************************/
+void	RingBufInit (RING_BUF *pRB, uint8_t *pBuf, uint16_t size)
+{
+    /* Parameter check */
+    EFM_ASSERT(pRB != NULL  &&  pBuf != NULL);
+    EFM_ASSERT(size != 0  &&  size <= RING_BUF_MAX_SIZE
+	       &&  (size & (size - 1)) == 0);
+
+    pRB->pBuf = pBuf;
+    pRB->Mask = size - 1;
+    pRB->Head = pRB->Tail = 0;
+    pRB->Prod = 0;
+    pRB->ConsLock = 0;
+    pRB->DropCnt = 0;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Number of used bytes
+ *
+ * Returns the number of committed bytes, which can be read by the consumer.
+ *
+ ******************************************************************************/
+uint16_t RingBufUsed (const RING_BUF *pRB)
+{
+    return (uint16_t)(pRB->Head - pRB->Tail);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Number of free bytes
+ *
+ * Returns the number of bytes, which can be written by a single producer.
+ * For multiple producers, the value is only a hint, since other producers
+ * may have outstanding reservations.
+ *
+ ******************************************************************************/
+uint16_t RingBufFree (const RING_BUF *pRB)
+{
+    return (uint16_t)(pRB->Mask + 1 - (uint16_t)(pRB->Head - pRB->Tail));
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Write data (single producer)
+ *
+ * Copies as many bytes as fit into the ring buffer and makes them visible
+ * for the consumer.  Bytes which do not fit are counted in <b>DropCnt</b>.
+ *
+ * @param[in] pRB
+ *	Address of the ring buffer control structure.
+ *
+ * @param[in] pData
+ *	Address of the data to write.
+ *
+ * @param[in] cnt
+ *	Number of bytes to write.
+ *
+ * @return
+ *	Number of bytes that have been written.
+ *
+ ******************************************************************************/
+uint16_t RingBufWrite (RING_BUF *pRB, const uint8_t *pData, uint16_t cnt)
+{
+uint16_t head = pRB->Head;	// local copy, only we change it
+uint16_t free = RingBufFree(pRB);
+uint16_t i;
+
+
+    if (cnt > free)
+    {
+	pRB->DropCnt += cnt - free;
+	cnt = free;
+    }
+
+    for (i = 0;  i < cnt;  i++)
+	RING_BUF_AT(pRB, head + i) = pData[i];
+
+    /* publish data */
+    pRB->Head = head + cnt;
+
+    return cnt;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Read data (single consumer)
+ *
+ * Copies up to <b>cnt</b> bytes from the ring buffer and releases them.
+ *
+ * @param[in] pRB
+ *	Address of the ring buffer control structure.
+ *
+ * @param[out] pData
+ *	Address of the destination buffer.
+ *
+ * @param[in] cnt
+ *	Size of the destination buffer in bytes.
+ *
+ * @return
+ *	Number of bytes that have been read.
+ *
+ ******************************************************************************/
+uint16_t RingBufRead (RING_BUF *pRB, uint8_t *pData, uint16_t cnt)
+{
+uint16_t tail = pRB->Tail;	// local copy, only we change it
+uint16_t used = RingBufUsed(pRB);
+uint16_t i;
+
+
+    if (cnt > used)
+	cnt = used;
+
+    for (i = 0;  i < cnt;  i++)
+	pData[i] = RING_BUF_AT(pRB, tail + i);
+
+    /* release space */
+    pRB->Tail = tail + cnt;
+
+    return cnt;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Reserve space (multiple producers)
+ *
+ * Reserves <b>cnt</b> bytes in the ring buffer.  The caller may then fill
+ * them in place and must call RingBufCommit() afterwards, even if it decides
+ * not to use the space.  Between reservation and commit, data of other
+ * producers is held back, so keep this interval short.
+ *
+ * @param[in] pRB
+ *	Address of the ring buffer control structure.
+ *
+ * @param[in] cnt
+ *	Number of bytes to reserve.
+ *
+ * @param[out] pIdx
+ *	Free-running index of the first reserved byte, use RING_BUF_AT() or
+ *	RingBufSpan() to access the data.
+ *
+ * @return
+ *	true if the space has been reserved, false if the buffer has not enough
+ *	free space.  In this case <b>cnt</b> is added to <b>DropCnt</b> and
+ *	RingBufCommit() must <b>not</b> be called.
+ *
+ ******************************************************************************/
+bool	RingBufReserve (RING_BUF *pRB, uint16_t cnt, uint16_t *pIdx)
+{
+uint32_t prod;			// reservation state
+uint16_t idx;			// next index to reserve
+
+
+    do
+    {
+	prod = __LDREXW((uint32_t *)&pRB->Prod);
+	idx  = (uint16_t)prod;
+
+	if ((uint16_t)(idx - pRB->Tail) + cnt > (uint32_t)pRB->Mask + 1)
+	{
+	    __CLREX();
+	    pRB->DropCnt += cnt;
+	    return false;
+	}
+
+	prod = ((prod & 0xFFFF0000) + PROD_PENDING_1) | (uint16_t)(idx + cnt);
+    } while (__STREXW(prod, (uint32_t *)&pRB->Prod) != 0);
+
+    *pIdx = idx;
+    return true;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Commit reserved space (multiple producers)
+ *
+ * Marks a reservation from RingBufReserve() as complete.  If this was the
+ * last outstanding reservation, all reserved bytes become visible for the
+ * consumer.
+ *
+ * @note
+ * <b>Head</b> is written before the STREX.  If the STREX fails, another
+ * producer has reserved in between and the loop is repeated, so the final
+ * value of <b>Head</b> is always written while the reservation count drops
+ * to zero.  An intermediate value is harmless, since all bytes up to it are
+ * already complete.
+ *
+ ******************************************************************************/
+void	RingBufCommit (RING_BUF *pRB)
+{
+uint32_t prod;			// reservation state
+
+
+    do
+    {
+	prod = __LDREXW((uint32_t *)&pRB->Prod);
+
+	EFM_ASSERT(prod >= PROD_PENDING_1);	// commit without reserve
+
+	prod -= PROD_PENDING_1;
+	if (prod < PROD_PENDING_1)
+	    pRB->Head = (uint16_t)prod;		// last one - publish data
+    } while (__STREXW(prod, (uint32_t *)&pRB->Prod) != 0);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Get contiguous span of the buffer
+ *
+ * Returns the address of the byte at index <b>idx</b> and reduces <b>*pCnt</b>
+ * to the number of bytes which can be accessed linearly from there, i.e.
+ * until the end of the data buffer.  This allows zero-copy writers to use
+ * memcpy() or similar functions on a reserved range.
+ *
+ * @param[in] pRB
+ *	Address of the ring buffer control structure.
+ *
+ * @param[in] idx
+ *	Free-running index, e.g. from RingBufReserve().
+ *
+ * @param[in,out] pCnt
+ *	Number of bytes requested, on return the contiguous part of it.
+ *
+ * @return
+ *	Address of the first byte.
+ *
+ ******************************************************************************/
+uint8_t *RingBufSpan (RING_BUF *pRB, uint16_t idx, uint16_t *pCnt)
+{
+uint16_t contig = pRB->Mask + 1 - (idx & pRB->Mask);
+
+
+    if (*pCnt > contig)
+	*pCnt = contig;
+
+    return &RING_BUF_AT(pRB, idx);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Peek at contiguous data (consumer)
+ *
+ * Returns the address and size of the committed data block at <b>Tail</b>,
+ * which is contiguous in memory.  The data stays in the buffer until it is
+ * released by RingBufConsume(), so it can be passed to a DMA channel.
+ *
+ * @param[in] pRB
+ *	Address of the ring buffer control structure.
+ *
+ * @param[out] ppData
+ *	Address of the first byte.
+ *
+ * @return
+ *	Number of contiguous bytes, 0 if the buffer is empty.
+ *
+ ******************************************************************************/
+uint16_t RingBufPeek (RING_BUF *pRB, uint8_t **ppData)
+{
+uint16_t cnt = RingBufUsed(pRB);
+
+
+    *ppData = RingBufSpan (pRB, pRB->Tail, &cnt);
+
+    return cnt;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Release data (consumer)
+ *
+ * Releases <b>cnt</b> bytes, which have been obtained via RingBufPeek().
+ *
+ ******************************************************************************/
+void	RingBufConsume (RING_BUF *pRB, uint16_t cnt)
+{
+    EFM_ASSERT(cnt <= RingBufUsed(pRB));
+
+    pRB->Tail += cnt;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Claim consumer role
+ *
+ * Atomically tests and sets the consumer lock of the ring buffer.  This is
+ * used when the consumer may be started from several contexts, e.g. a
+ * producer that kicks a DMA transfer and the DMA completion interrupt.
+ *
+ * @return
+ *	true if the caller is the consumer now, false if another context already
+ *	owns this role.
+ *
+ * @note
+ * After RingBufConsumerUnlock(), the caller must check RingBufUsed() again,
+ * because a producer may have committed data while the lock was held, and
+ * its attempt to start the consumer failed.
+ *
+ ******************************************************************************/
+bool	RingBufConsumerLock (RING_BUF *pRB)
+{
+    do
+    {
+	if (__LDREXW((uint32_t *)&pRB->ConsLock) != 0)
+	{
+	    __CLREX();
+	    return false;	// already claimed
+	}
+    } while (__STREXW(1, (uint32_t *)&pRB->ConsLock) != 0);
+
+    return true;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Release consumer role
+ *
+ * Releases the consumer lock obtained by RingBufConsumerLock().
+ *
+ ******************************************************************************/
+void	RingBufConsumerUnlock (RING_BUF *pRB)
+{
+    pRB->ConsLock = 0;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module RingBuf.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_RingBuf_h
+#define __INC_RingBuf_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Maximum size of a ring buffer in bytes (must be a power of 2). */
+#define RING_BUF_MAX_SIZE	32768
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Ring buffer control structure.
+ *
+ * The indices <b>Head</b> and <b>Tail</b> are free-running 16 bit counters,
+ * they are only masked with <b>Mask</b> when accessing the buffer.  This way
+ * a full and an empty buffer can be distinguished without wasting a byte.
+ *
+ * <b>Prod</b> is only used by the multi-producer functions RingBufReserve()
+ * and RingBufCommit().  Bits [15:0] hold the index of the next byte to be
+ * reserved, bits [31:16] the number of outstanding reservations.
+ *
+ * <b>ConsLock</b> allows several contexts to act as consumer, see
+ * RingBufConsumerLock().
+ *
+ * All elements are private to module RingBuf.c, use the functions below.
+ */
+typedef struct
+{
+    uint8_t		*pBuf;		//!< data buffer
+    uint16_t		 Mask;		//!< buffer size - 1
+    volatile uint16_t	 Head;		//!< index behind last committed byte
+    volatile uint16_t	 Tail;		//!< index of the next byte to read
+    volatile uint32_t	 Prod;		//!< multi-producer reservation state
+    volatile uint32_t	 ConsLock;	//!< consumer lock, 1 if claimed
+    volatile uint32_t	 DropCnt;	//!< number of bytes discarded
+} RING_BUF;
+
+/*================================== Macros ==================================*/
+
+    /*!@brief Access byte at (free-running) index <b>idx</b> of a ring buffer. */
+#define RING_BUF_AT(pRB, idx)	((pRB)->pBuf[(uint16_t)(idx) & (pRB)->Mask])
+
+/*================================ Prototypes ================================*/
+
+    /* Initialization and status */
+void	 RingBufInit  (RING_BUF *pRB, uint8_t *pBuf, uint16_t size);
+uint16_t RingBufUsed  (const RING_BUF *pRB);
+uint16_t RingBufFree  (const RING_BUF *pRB);
+
+    /* Single producer, single consumer */
+uint16_t RingBufWrite (RING_BUF *pRB, const uint8_t *pData, uint16_t cnt);
+uint16_t RingBufRead  (RING_BUF *pRB, uint8_t *pData, uint16_t cnt);
+
+    /* Multiple producers */
+bool	 RingBufReserve (RING_BUF *pRB, uint16_t cnt, uint16_t *pIdx);
+void	 RingBufCommit  (RING_BUF *pRB);
+uint8_t *RingBufSpan    (RING_BUF *pRB, uint16_t idx, uint16_t *pCnt);
+
+    /* Zero-copy consumer */
+uint16_t RingBufPeek    (RING_BUF *pRB, uint8_t **ppData);
+void	 RingBufConsume (RING_BUF *pRB, uint16_t cnt);
+bool	 RingBufConsumerLock   (RING_BUF *pRB);
+void	 RingBufConsumerUnlock (RING_BUF *pRB);
+
+
+#endif /* __INC_RingBuf_h */
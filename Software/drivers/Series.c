@@ -0,0 +1,406 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Compressed Time Series in the Session Log
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module samples the main values of the battery, i.e. Voltage,
+ * Current, Temperature, RelativeStateOfCharge, and BatteryStatus, every
+ * @ref SERIES_INTERVAL seconds and writes them compressed into the session
+ * log, see Log.c.  Uncompressed, a sample needs @ref SERIES_RAW_SIZE bytes.
+ * But successive values differ by a few LSBs, the status word rarely
+ * changes, and the time stamps are almost perfectly regular, so most
+ * samples are stored in 1 to 4 bytes.
+ *
+ * The samples are encoded one by one into a block of up to @ref
+ * SERIES_BLOCK_SIZE bytes, i.e. the memory does not depend on the number of
+ * samples.  A full block is appended to the log as @ref LOG_TYPE_SERIES
+ * record.  Each block can be decoded on its own, so the loss of the oldest
+ * page of the log does not affect the remaining blocks.
+ *
+ * Block layout, varints are encoded as for the telemetry frames, see
+ * Telemetry.c:
+ * <pre>
+ *   CNT  XORMASK  ADDR[CNT]  INTERVAL  TIME[4]  VALUE[CNT]  SAMPLES...
+ * </pre>
+ * - <b>CNT</b> is the number of channels, <b>ADDR</b> their SBS register
+ *   addresses.
+ * - <b>XORMASK</b> has bit n set, if channel n is a status word.
+ * - <b>INTERVAL</b> (varint) is the nominal sample interval in seconds.
+ * - <b>TIME</b> (little-endian) and <b>VALUE</b> (varints) are the time and
+ *   the values of the first sample.
+ *
+ * Each further sample starts with a control byte:
+ * - Bit 7 clear: bits [5:0] tell which channels have changed, bit 6 is set
+ *   if the time is not regular.  Then follow the delta-of-delta of the time
+ *   stamp, i.e. the difference between the current and the previous
+ *   interval, as ZigZag varint if bit 6 is set, and a varint for each
+ *   changed channel.  For a value this is the 16 bit difference to the
+ *   previous value, ZigZag encoded, for a status word it is the XOR with the
+ *   previous one, i.e. the bits which have toggled.
+ * - Bit 7 set: bits [6:0] + 1 samples follow with regular time and no
+ *   changed channel, i.e. runs of unchanged samples are stored in one byte.
+ *
+ * At the start of a block the previous interval is INTERVAL, so with
+ * regular sampling no time information is stored at all.
+ *
+ * The block in RAM is lost at power-off, SeriesFlush() appends it to the log
+ * early.  The host tool tools/series_bench.py contains the same encoder and
+ * a decoder, it measures the bytes per sample on recorded curves.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	SeriesCheck() counts the elapsed seconds, the RTC
+		interrupt may occur less often than every second, see
+		ClockTickSet().
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "Series.h"
+#include "AlarmClock.h"
+#include "BatteryMon.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Bits of the control byte of a sample. */
+#define CTRL_TIME		0x40	//!< time is not regular
+#define CTRL_RUN		0x80	//!< run of unchanged samples
+
+    /*!@brief Maximum number of samples of a run. */
+#define RUN_MAX			128
+
+    /*!@brief Maximum size of an encoded sample: control byte, 5 bytes
+     * delta-of-delta, and 3 bytes per channel.
+     */
+#define SAMPLE_MAX		(1 + 5 + 3 * SERIES_CHAN_CNT)
+
+    /*!@brief ZigZag encoding, i.e. 0, -1, 1, -2 become 0, 1, 2, 3. */
+#define ZIGZAG(x)		(((uint32_t)(x) << 1) ^ (uint32_t)((x) >> 31))
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Channel, i.e. register sampled. */
+typedef struct
+{
+    SBS_CMD	 Cmd;		//!< Register to read
+    bool	 flgXor;	//!< Status word, store toggled bits
+} SERIES_CHAN;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void BlockBegin (uint32_t now, const uint16_t *pValue);
+static void PutRun (void);
+static void PutVarint (uint32_t value);
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Channels of each sample. */
+static const SERIES_CHAN l_Chan[SERIES_CHAN_CNT] =
+{
+    { SBS_Voltage,		false },
+    { SBS_Current,		false },
+    { SBS_Temperature,		false },
+    { SBS_RelativeStateOfCharge, false },
+    { SBS_BatteryStatus,	true  },
+};
+
+    /*!@brief Sample interval in [s], 0 if disabled. */
+static int		 l_Interval = SERIES_INTERVAL;
+
+    /*!@brief Block being encoded, and its length, 0 if no block is open. */
+static uint8_t		 l_Block[SERIES_BLOCK_SIZE];
+static int		 l_Len;
+
+    /*!@brief Time, interval, and values of the previous sample. */
+static uint32_t		 l_PrevTime;
+static int32_t		 l_PrevDelta;
+static uint16_t		 l_Prev[SERIES_CHAN_CNT];
+
+    /*!@brief Number of unchanged samples not stored yet. */
+static int		 l_Run;
+
+    /*!@brief Statistics. */
+static SERIES_STATS	 l_Stats;
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Series
+ *
+ * This routine must be called once, after LogInit().
+ *
+ ******************************************************************************/
+void	SeriesInit (void)
+{
+    l_Len = 0;
+    l_Run = 0;
+    memset (&l_Stats, 0, sizeof(l_Stats));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Series Check
+ *
+ * This function must be called from the main loop.  Every @ref
+ * SERIES_INTERVAL seconds, it reads the registers of all channels and adds
+ * a sample.  When the battery is removed, the current block is appended to
+ * the log, so a new battery starts a new block.
+ *
+ * The seconds are counted from the changes of <b>tm_sec</b>, so the interval
+ * is also kept with a tick period longer than one second, see ClockTickSet().
+ *
+ ******************************************************************************/
+void	SeriesCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+static int seconds;		// seconds since the last sample
+uint16_t value[SERIES_CHAN_CNT];
+uint32_t data;
+int	 elapsed;
+int	 i;
+
+
+    if (prevSeconds == g_CurrDateTime.tm_sec)
+	return;
+
+    elapsed = (g_CurrDateTime.tm_sec - prevSeconds + 60) % 60;
+    prevSeconds = g_CurrDateTime.tm_sec;
+
+    if (g_BatteryCtrlType == BCT_UNKNOWN)
+    {
+	SeriesFlush();
+	seconds = 0;
+	return;
+    }
+
+    seconds += elapsed;
+    if (l_Interval == 0  ||  seconds < l_Interval)
+	return;
+
+    seconds = 0;
+
+    for (i = 0;  i < SERIES_CHAN_CNT;  i++)
+    {
+	if (BatteryRegReadShared (l_Chan[i].Cmd, &data) < 0)
+	    return;		// skip this sample
+
+	value[i] = (uint16_t) data;
+    }
+
+    SeriesAdd ((uint32_t) time(NULL), value);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add Sample
+ *
+ * Encodes a sample into the current block.  If the block is full, it is
+ * appended to the log, and a new block starts with this sample.
+ *
+ * @param[in] now
+ *	Time of the sample in seconds, see time().
+ *
+ * @param[in] pValue
+ *	Values of the @ref SERIES_CHAN_CNT channels.
+ *
+ ******************************************************************************/
+void	SeriesAdd (uint32_t now, const uint16_t *pValue)
+{
+int32_t	 delta, dod;
+uint8_t	 ctrl;
+int	 i;
+
+
+    l_Stats.Samples++;
+
+    /* Keep room for a pending run and the largest sample */
+    if (l_Len > 0  &&  l_Len + 1 + SAMPLE_MAX > SERIES_BLOCK_SIZE)
+	SeriesFlush();
+
+    if (l_Len == 0)
+    {
+	BlockBegin (now, pValue);
+	return;
+    }
+
+    delta = (int32_t)(now - l_PrevTime);
+    dod = delta - l_PrevDelta;
+    l_PrevTime = now;
+    l_PrevDelta = delta;
+
+    ctrl = (dod != 0 ? CTRL_TIME : 0);
+    for (i = 0;  i < SERIES_CHAN_CNT;  i++)
+	if (pValue[i] != l_Prev[i])
+	    ctrl |= (1 << i);
+
+    if (ctrl == 0)
+    {
+	/* Unchanged sample, extend the run */
+	if (++l_Run == RUN_MAX)
+	    PutRun();
+	return;
+    }
+
+    PutRun();
+    l_Block[l_Len++] = ctrl;
+
+    if (dod != 0)
+	PutVarint (ZIGZAG(dod));
+
+    for (i = 0;  i < SERIES_CHAN_CNT;  i++)
+    {
+	if (pValue[i] == l_Prev[i])
+	    continue;
+
+	if (l_Chan[i].flgXor)
+	    PutVarint (pValue[i] ^ l_Prev[i]);
+	else
+	    PutVarint (ZIGZAG((int32_t)(int16_t)(pValue[i] - l_Prev[i])));
+
+	l_Prev[i] = pValue[i];
+    }
+
+    EFM_ASSERT(l_Len <= SERIES_BLOCK_SIZE);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Flush the Series
+ *
+ * Appends the current block to the log, the next sample starts a new one.
+ *
+ ******************************************************************************/
+void	SeriesFlush (void)
+{
+    if (l_Len == 0)
+	return;
+
+    PutRun();
+
+    if (LogAppend (LOG_TYPE_SERIES, l_Block, l_Len) == 0)
+	l_Stats.Blocks++;
+    else
+	l_Stats.Dropped++;
+
+    l_Stats.Bytes += l_Len;
+    l_Len = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set Sample Interval
+ *
+ * Sets the sample interval in seconds, 0 disables the series.  The current
+ * block is appended to the log, because its header contains the interval.
+ *
+ ******************************************************************************/
+void	SeriesIntervalSet (int interval)
+{
+    SeriesFlush();
+    l_Interval = (interval < 0 ? 0 : interval);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get Sample Interval
+ *
+ ******************************************************************************/
+int	SeriesIntervalGet (void)
+{
+    return l_Interval;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Series Statistics
+ *
+ * Returns the statistics, <b>Bytes</b> includes the current block.
+ *
+ ******************************************************************************/
+void	SeriesStats (SERIES_STATS *pStats)
+{
+    *pStats = l_Stats;
+    pStats->Bytes += l_Len + (l_Run > 0 ? 1 : 0);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Begin Block
+ *
+ * Writes the block header and the first sample with absolute values.
+ *
+ ******************************************************************************/
+static void BlockBegin (uint32_t now, const uint16_t *pValue)
+{
+uint8_t	 xorMask = 0;
+int	 i;
+
+
+    l_Block[0] = SERIES_CHAN_CNT;
+    for (i = 0;  i < SERIES_CHAN_CNT;  i++)
+    {
+	l_Block[2 + i] = SBS_CMD_ADDR(l_Chan[i].Cmd);
+	if (l_Chan[i].flgXor)
+	    xorMask |= (1 << i);
+    }
+    l_Block[1] = xorMask;
+    l_Len = 2 + SERIES_CHAN_CNT;
+
+    PutVarint (l_Interval);
+    memcpy (l_Block + l_Len, &now, 4);
+    l_Len += 4;
+
+    for (i = 0;  i < SERIES_CHAN_CNT;  i++)
+    {
+	PutVarint (pValue[i]);
+	l_Prev[i] = pValue[i];
+    }
+
+    l_PrevTime = now;
+    l_PrevDelta = l_Interval;
+    l_Run = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Store pending Run
+ *
+ ******************************************************************************/
+static void PutRun (void)
+{
+    if (l_Run > 0)
+    {
+	l_Block[l_Len++] = CTRL_RUN | (l_Run - 1);
+	l_Run = 0;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Store Varint
+ *
+ ******************************************************************************/
+static void PutVarint (uint32_t value)
+{
+    while (value >= 0x80)
+    {
+	l_Block[l_Len++] = (uint8_t)(value | 0x80);
+	value >>= 7;
+    }
+    l_Block[l_Len++] = (uint8_t) value;
+}
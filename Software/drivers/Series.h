@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Series.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Series_h
+#define __INC_Series_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "Log.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Default sample interval in [s], 0 disables the series. */
+#ifndef SERIES_INTERVAL
+    #define SERIES_INTERVAL	1
+#endif
+
+    /*!@brief Number of channels, i.e. registers per sample, up to 6. */
+#define SERIES_CHAN_CNT		5
+
+    /*!@brief Maximum size of a block, i.e. of a log record. */
+#define SERIES_BLOCK_SIZE	LOG_DATA_MAX
+
+    /*!@brief Size of an uncompressed sample: time and 16 bit values. */
+#define SERIES_RAW_SIZE		(4 + 2 * SERIES_CHAN_CNT)
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Statistics, see SeriesStats(). */
+typedef struct
+{
+    uint32_t	 Samples;	//!< Number of samples encoded
+    uint32_t	 Blocks;	//!< Number of blocks written to the log
+    uint32_t	 Bytes;		//!< Encoded bytes, including block headers
+    uint32_t	 Dropped;	//!< Blocks the log did not accept
+} SERIES_STATS;
+
+/*================================ Prototypes ================================*/
+
+void	SeriesInit (void);
+void	SeriesCheck (void);
+void	SeriesAdd (uint32_t now, const uint16_t *pValue);
+void	SeriesFlush (void);
+void	SeriesIntervalSet (int interval);
+int	SeriesIntervalGet (void);
+void	SeriesStats (SERIES_STATS *pStats);
+
+
+#endif /* __INC_Series_h */
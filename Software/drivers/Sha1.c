@@ -0,0 +1,210 @@
+/***************************************************************************//**
+ * @file
+ * @brief	SHA-1 Hash Function
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module implements SHA-1 according to FIPS 180-4, as required for the
+ * authentication of the battery controller, see PackAuth.c.
+ *
+ * The compression function is optimized for the Cortex-M3:
+ * - All 80 rounds are unrolled, so the five state variables stay in
+ *   registers, and the rotation of the variables costs nothing.
+ * - The message schedule is calculated in place in the 16 words of the
+ *   block buffer of the context, no other memory is needed.
+ * - The words are converted to big endian with the REV instruction.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "Sha1.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Rotate left. */
+#define ROL(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+    /*!@brief Convert a word from or to big endian. */
+#define BE32(x)		__REV(x)
+
+    /*!@brief Next word of the message schedule, stored in place. */
+#define W(i)	(pW[(i) & 15] = ROL(pW[((i) + 13) & 15] ^ pW[((i) + 8) & 15] \
+				  ^ pW[((i) + 2) & 15] ^ pW[(i) & 15], 1))
+
+    /*!@name Round functions, the caller rotates the variables. */
+//@{
+#define R0(a, b, c, d, e, i)						\
+	e += (((b) & ((c) ^ (d))) ^ (d)) + pW[i] + 0x5A827999 + ROL(a, 5); \
+	b = ROL(b, 30)
+#define R1(a, b, c, d, e, i)						\
+	e += (((b) & ((c) ^ (d))) ^ (d)) + W(i) + 0x5A827999 + ROL(a, 5); \
+	b = ROL(b, 30)
+#define R2(a, b, c, d, e, i)						\
+	e += ((b) ^ (c) ^ (d)) + W(i) + 0x6ED9EBA1 + ROL(a, 5);		\
+	b = ROL(b, 30)
+#define R3(a, b, c, d, e, i)						\
+	e += ((((b) | (c)) & (d)) | ((b) & (c))) + W(i) + 0x8F1BBCDC	\
+	     + ROL(a, 5);						\
+	b = ROL(b, 30)
+#define R4(a, b, c, d, e, i)						\
+	e += ((b) ^ (c) ^ (d)) + W(i) + 0xCA62C1D6 + ROL(a, 5);		\
+	b = ROL(b, 30)
+//@}
+
+    /*!@brief Five rounds, after which the variables are in order again. */
+#define R5(R, i)	R(a, b, c, d, e, (i));	  R(e, a, b, c, d, (i) + 1); \
+			R(d, e, a, b, c, (i) + 2); R(c, d, e, a, b, (i) + 3); \
+			R(b, c, d, e, a, (i) + 4)
+
+/*=========================== Forward Declarations ===========================*/
+
+static void Sha1Block (SHA1_CTX *pCtx);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize SHA-1 Context
+ *
+ ******************************************************************************/
+void	Sha1Init (SHA1_CTX *pCtx)
+{
+    pCtx->H[0] = 0x67452301;
+    pCtx->H[1] = 0xEFCDAB89;
+    pCtx->H[2] = 0x98BADCFE;
+    pCtx->H[3] = 0x10325476;
+    pCtx->H[4] = 0xC3D2E1F0;
+    pCtx->Len  = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Hash Data
+ *
+ * May be called several times to hash data in pieces.
+ *
+ * @param[in] pCtx
+ *	SHA-1 context.
+ *
+ * @param[in] pData
+ *	Address of the data.
+ *
+ * @param[in] cnt
+ *	Number of bytes.
+ *
+ ******************************************************************************/
+void	Sha1Update (SHA1_CTX *pCtx, const uint8_t *pData, size_t cnt)
+{
+uint8_t	*pBuf = (uint8_t *) pCtx->Buf;
+size_t	 offs, n;
+
+
+    while (cnt > 0)
+    {
+	offs = pCtx->Len % SHA1_BLOCK_SIZE;
+	n = SHA1_BLOCK_SIZE - offs;
+	if (n > cnt)
+	    n = cnt;
+
+	memcpy (pBuf + offs, pData, n);
+	pCtx->Len += n;
+	pData += n;
+	cnt -= n;
+
+	if (offs + n == SHA1_BLOCK_SIZE)
+	    Sha1Block (pCtx);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Finish Hash
+ *
+ * Appends the padding and the length, and stores the digest.  The context
+ * must be initialized again for the next hash.
+ *
+ * @param[in] pCtx
+ *	SHA-1 context.
+ *
+ * @param[out] pDigest
+ *	Address where to store the @ref SHA1_DIGEST_SIZE bytes of the digest.
+ *
+ ******************************************************************************/
+void	Sha1Final (SHA1_CTX *pCtx, uint8_t *pDigest)
+{
+uint8_t	*pBuf = (uint8_t *) pCtx->Buf;
+uint32_t bitLen = pCtx->Len << 3;
+size_t	 offs = pCtx->Len % SHA1_BLOCK_SIZE;
+int	 i;
+
+
+    pBuf[offs++] = 0x80;
+    if (offs > SHA1_BLOCK_SIZE - 8)
+    {
+	/* No room for the length, it goes into another block */
+	memset (pBuf + offs, 0, SHA1_BLOCK_SIZE - offs);
+	Sha1Block (pCtx);
+	offs = 0;
+    }
+    memset (pBuf + offs, 0, SHA1_BLOCK_SIZE - 8 - offs);
+
+    pCtx->Buf[14] = BE32(pCtx->Len >> 29);
+    pCtx->Buf[15] = BE32(bitLen);
+    Sha1Block (pCtx);
+
+    for (i = 0;  i < 5;  i++)
+    {
+	pDigest[4*i + 0] = (uint8_t)(pCtx->H[i] >> 24);
+	pDigest[4*i + 1] = (uint8_t)(pCtx->H[i] >> 16);
+	pDigest[4*i + 2] = (uint8_t)(pCtx->H[i] >>  8);
+	pDigest[4*i + 3] = (uint8_t)(pCtx->H[i]);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	SHA-1 Compression Function
+ *
+ * Processes the block in the buffer of the context.  The buffer is used for
+ * the message schedule, i.e. its contents is destroyed.
+ *
+ ******************************************************************************/
+static void Sha1Block (SHA1_CTX *pCtx)
+{
+uint32_t *pW = pCtx->Buf;
+uint32_t a, b, c, d, e;
+int	 i;
+
+
+    for (i = 0;  i < 16;  i++)
+	pW[i] = BE32(pW[i]);
+
+    a = pCtx->H[0];
+    b = pCtx->H[1];
+    c = pCtx->H[2];
+    d = pCtx->H[3];
+    e = pCtx->H[4];
+
+    R5(R0,  0);  R5(R0,  5);  R5(R0, 10);
+    R0(a, b, c, d, e, 15);	R1(e, a, b, c, d, 16);
+    R1(d, e, a, b, c, 17);	R1(c, d, e, a, b, 18);
+    R1(b, c, d, e, a, 19);
+
+    R5(R2, 20);  R5(R2, 25);  R5(R2, 30);  R5(R2, 35);
+    R5(R3, 40);  R5(R3, 45);  R5(R3, 50);  R5(R3, 55);
+    R5(R4, 60);  R5(R4, 65);  R5(R4, 70);  R5(R4, 75);
+
+    pCtx->H[0] += a;
+    pCtx->H[1] += b;
+    pCtx->H[2] += c;
+    pCtx->H[3] += d;
+    pCtx->H[4] += e;
+}
@@ -0,0 +1,46 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Sha1.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Sha1_h
+#define __INC_Sha1_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of a SHA-1 digest in bytes. */
+#define SHA1_DIGEST_SIZE	20
+
+    /*!@brief Size of a SHA-1 block in bytes. */
+#define SHA1_BLOCK_SIZE		64
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief SHA-1 context, the caller provides the memory. */
+typedef struct
+{
+    uint32_t	 H[5];		//!< Intermediate hash value
+    uint32_t	 Len;		//!< Number of bytes hashed so far
+    uint32_t	 Buf[SHA1_BLOCK_SIZE / 4];	//!< Incomplete block
+} SHA1_CTX;
+
+/*================================ Prototypes ================================*/
+
+void	Sha1Init   (SHA1_CTX *pCtx);
+void	Sha1Update (SHA1_CTX *pCtx, const uint8_t *pData, size_t cnt);
+void	Sha1Final  (SHA1_CTX *pCtx, uint8_t *pDigest);
+
+
+#endif /* __INC_Sha1_h */
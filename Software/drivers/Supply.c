@@ -0,0 +1,337 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Supply Voltage Warning and Power-off Sequence
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module watches the voltage of the CR2032 with the voltage comparator
+ * (VCMP).  A sagging cell could otherwise reset the MCU in the middle of a
+ * flash write.  The log survives this, see Log.c, but the staged records and
+ * the current series block in RAM would be lost, and the session of the
+ * connected pack would remain open.
+ *
+ * The VCMP compares VDD with a trigger level of 1.667V + n * 34mV, the
+ * default is @ref SUPPLY_WARN_MV.  Its edge interrupt also wakes the MCU from
+ * EM2, so the supply is watched without polling the ADC.  When the voltage
+ * falls below the threshold, SupplyCheck() prepares for the loss of power:
+ * - The series is stopped, its current block is appended to the log.
+ * - The session of the connected pack is closed, see HistoryClose().
+ * - All staged records are written to the flash, see LogFlush().
+ * - A warning is shown on the LCD and the console.
+ *
+ * No new session is opened and no samples are taken while the supply is
+ * low.  The normal operation is resumed after the voltage has been above the
+ * threshold for @ref SUPPLY_RECOVER_TIME seconds, e.g. when the load of the
+ * LCD backlight has been removed.  tools/supply_sim.py simulates this with
+ * a scripted voltage ramp.
+ *
+ * The VCMP runs with half bias current and a hysteresis of 20mV.
+ *
+ * SupplyPowerOff() is called before the hold-power FET is released, see
+ * Display.c.  Within @ref SUPPLY_OFF_DEADLINE milliseconds, it
+ * -# waits for the SMBus transactions, and aborts them after a quarter of
+ *    the time, so a write to the battery controller is rarely cut,
+ * -# appends the energy mode profile, the series block and the session of
+ *    the pack to the log, see ProfileLog(), and writes the staged records
+ *    until three quarters of the time are over,
+ * -# sends the rest of the LEUART FIFO as long as there is time left.
+ *
+ * Records which are not written in time are lost, the log itself stays
+ * consistent, see Log.c.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	SupplyCheck(): a dip below the threshold restarts the
+		recovery time, also between two seconds.
+2026-10-18,agent	SupplyPowerOff() logs the energy mode profile of the
+		session.
+2026-10-18,agent	Added SupplyPowerOff() for a bounded power-off sequence.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_cmu.h"
+#include "em_vcmp.h"
+#include "Supply.h"
+#include "AlarmClock.h"
+#include "Display.h"
+#include "Log.h"
+#include "Series.h"
+#include "Profile.h"
+#include "History.h"
+#include "BatteryMon.h"
+#include "LEUART.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Trigger level of the VCMP for a voltage in [mV], rounded. */
+#define MV_TO_LEVEL(mV)	(((mV) - SUPPLY_MV_MIN + SUPPLY_MV_STEP / 2)	\
+			 / SUPPLY_MV_STEP)
+
+    /*!@brief Voltage in [mV] of a trigger level. */
+#define LEVEL_TO_MV(level)	(SUPPLY_MV_MIN + (level) * SUPPLY_MV_STEP)
+
+    /*!@brief RTC ticks since the start of the power-off sequence. */
+#define OFF_ELAPSED()		((RTC->CNT - start) & 0x00FFFFFF)
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Flag set by the interrupt handler if the comparator output has
+     * changed.
+     */
+static volatile bool	 l_flgEdge;
+
+    /*!@brief Trigger level of the VCMP. */
+static int		 l_Level = MV_TO_LEVEL(SUPPLY_WARN_MV);
+
+    /*!@brief Sample interval of the series before the warning. */
+static int		 l_SeriesInterval;
+
+    /*!@brief Seconds the supply has been above the threshold again. */
+static int		 l_RecoverSeconds;
+
+    /*!@brief Statistics. */
+static SUPPLY_STATS	 l_Stats;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void SupplyWarn (void);
+static void SupplyRecover (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Supply Warning
+ *
+ * Enables the VCMP and its edge interrupt.  This routine must be called
+ * once, after LogInit(), HistoryInit(), and SeriesInit().  If the supply is
+ * already low, the warning is raised by the first call of SupplyCheck().
+ *
+ ******************************************************************************/
+void	SupplyInit (void)
+{
+VCMP_Init_TypeDef init = VCMP_INIT_DEFAULT;
+
+
+    init.irqFalling   = true;
+    init.irqRising    = true;
+    init.hyst         = vcmpHyst20mV;
+    init.triggerLevel = l_Level;
+
+    CMU_ClockEnable (cmuClock_VCMP, true);
+    VCMP_Init (&init);
+
+    while (! VCMP_Ready())
+	;
+
+    VCMP_IntClear (VCMP_IFC_EDGE | VCMP_IFC_WARMUP);
+    VCMP_IntEnable (VCMP_IEN_EDGE);
+    NVIC_ClearPendingIRQ (VCMP_IRQn);
+    NVIC_EnableIRQ (VCMP_IRQn);
+
+    l_Stats.ThresholdMV = LEVEL_TO_MV(l_Level);
+    l_flgEdge = true;		// check the current state
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Supply Check
+ *
+ * This function must be called from the main loop, before all modules which
+ * write to the log.  It raises the warning when the comparator reports a low
+ * supply, and resumes the normal operation when it has recovered.
+ *
+ ******************************************************************************/
+void	SupplyCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+
+
+    if (l_flgEdge)
+    {
+	l_flgEdge = false;
+
+	if (VCMP_VDDLower()  &&  ! l_Stats.flgLow)
+	    SupplyWarn();
+	else
+	    l_RecoverSeconds = 0;	// any edge while low restarts the time
+    }
+
+    if (! l_Stats.flgLow  ||  prevSeconds == g_CurrDateTime.tm_sec)
+	return;
+
+    prevSeconds = g_CurrDateTime.tm_sec;
+
+    if (VCMP_VDDLower())
+	l_RecoverSeconds = 0;
+    else if (++l_RecoverSeconds >= SUPPLY_RECOVER_TIME)
+	SupplyRecover();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Supply is low
+ *
+ * Returns true from the warning until the supply has recovered.  Modules
+ * must not start new activities, e.g. open a session, while it is low.
+ *
+ ******************************************************************************/
+bool	SupplyIsLow (void)
+{
+    return l_Stats.flgLow;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set the Warning Threshold
+ *
+ * The threshold is rounded to the nearest trigger level of the VCMP, and
+ * limited to @ref SUPPLY_MV_MIN and @ref SUPPLY_MV_MAX.
+ *
+ * @param[in] mV
+ *	Threshold in [mV].
+ *
+ * @return
+ *	Threshold which has been set in [mV].
+ *
+ ******************************************************************************/
+int	SupplyThresholdSet (int mV)
+{
+    if (mV < SUPPLY_MV_MIN)
+	mV = SUPPLY_MV_MIN;
+    else if (mV > SUPPLY_MV_MAX)
+	mV = SUPPLY_MV_MAX;
+
+    l_Level = MV_TO_LEVEL(mV);
+    VCMP_TriggerSet (l_Level);
+    l_Stats.ThresholdMV = LEVEL_TO_MV(l_Level);
+    l_flgEdge = true;		// the state may have changed
+
+    return l_Stats.ThresholdMV;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Supply Statistics
+ *
+ ******************************************************************************/
+void	SupplyStats (SUPPLY_STATS *pStats)
+{
+    *pStats = l_Stats;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Power-off Sequence
+ *
+ * Completes or aborts the SMBus transactions, commits the tail of the log,
+ * and drains the LEUART, within @ref SUPPLY_OFF_DEADLINE.  The caller
+ * releases the hold-power FET afterwards.
+ *
+ ******************************************************************************/
+void	SupplyPowerOff (void)
+{
+uint32_t start = RTC->CNT;
+uint32_t deadline = MS2TICS(SUPPLY_OFF_DEADLINE);
+bool	 flgAborted = false;
+bool	 flgLogDone;
+
+
+    /* Give the SMBus transactions a quarter of the time */
+    while (BatteryMonIsBusy()  &&  OFF_ELAPSED() < deadline / 4)
+	BatteryMonCheck();
+
+    if (BatteryMonIsBusy())
+    {
+	BatteryMonAbort();
+	flgAborted = true;
+    }
+
+    /* Commit the tail of the log */
+    ProfileLog();
+    SeriesFlush();
+    HistoryClose();
+    flgLogDone = LogFlushTimed (deadline * 3 / 4 > OFF_ELAPSED()
+				? deadline * 3 / 4 - OFF_ELAPSED() : 0);
+
+    ConsolePrintf ("Power-off sequence: %lu ms%s%s\n\n",
+		   (unsigned long)(OFF_ELAPSED() * 1000 / RTC_COUNTS_PER_SEC),
+		   flgAborted ? ", SMBus aborted" : "",
+		   flgLogDone ? "" : ", log incomplete");
+
+    /* Send as much of the LEUART FIFO as possible */
+    while (! drvLEUART_TxIdle()  &&  OFF_ELAPSED() < deadline)
+	;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Supply Warning
+ *
+ * Stops the series, closes the session, and writes all staged records to
+ * the flash, before the voltage is too low for the MCU.
+ *
+ ******************************************************************************/
+static void SupplyWarn (void)
+{
+    l_Stats.flgLow = true;
+    l_Stats.Warnings++;
+    l_Stats.LastTime = (uint32_t) time(NULL);
+    l_RecoverSeconds = 0;
+
+    l_SeriesInterval = SeriesIntervalGet();
+    SeriesIntervalSet (0);		// appends the current block
+    HistoryClose();
+    LogFlush();
+
+    DisplayText (1, "Low Supply!");
+    DisplayText (2, "below %d.%03dV", l_Stats.ThresholdMV / 1000,
+		 l_Stats.ThresholdMV % 1000);
+    DisplayNext (10, NULL, 0);
+
+    ConsolePrintf ("Supply below %d mV, log flushed\n", l_Stats.ThresholdMV);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Supply Recovered
+ *
+ * Resumes the series, HistoryCheck() opens the session again.
+ *
+ ******************************************************************************/
+static void SupplyRecover (void)
+{
+    l_Stats.flgLow = false;
+    SeriesIntervalSet (l_SeriesInterval);
+
+    ConsolePrintf ("Supply above %d mV again\n", l_Stats.ThresholdMV);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Interrupt Handler for the VCMP
+ *
+ * This Interrupt Service Routine (ISR) gets called when the supply voltage
+ * crosses the threshold in either direction.  It only sets a flag, the
+ * actions are taken by SupplyCheck() in the main loop.
+ *
+ ******************************************************************************/
+void	VCMP_IRQHandler (void)
+{
+    VCMP_IntClear (VCMP_IFC_EDGE);
+
+    l_flgEdge = true;
+    g_flgIRQ = true;	// do not enter EM2, call us again
+}
@@ -0,0 +1,70 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Supply.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Added SupplyPowerOff() and SUPPLY_OFF_DEADLINE.
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Supply_h
+#define __INC_Supply_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Default warning threshold of the supply voltage in [mV].  The
+     * MCU and the flash work down to 1.98V, so this leaves time to write the
+     * log while the CR2032 sags further.
+     */
+#ifndef SUPPLY_WARN_MV
+    #define SUPPLY_WARN_MV	2200
+#endif
+
+    /*!@brief Range of the threshold, see the trigger levels of the VCMP. */
+#define SUPPLY_MV_MIN		1667
+#define SUPPLY_MV_STEP		34
+#define SUPPLY_MV_MAX		(SUPPLY_MV_MIN + 63 * SUPPLY_MV_STEP)
+
+    /*!@brief Seconds the voltage must stay above the threshold, before the
+     * normal operation is resumed.
+     */
+#define SUPPLY_RECOVER_TIME	10
+
+    /*!@brief Maximum duration of the power-off sequence in [ms], so the
+     * POWER button still switches the device off at once.
+     */
+#ifndef SUPPLY_OFF_DEADLINE
+    #define SUPPLY_OFF_DEADLINE	250
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Statistics, see SupplyStats(). */
+typedef struct
+{
+    int		 ThresholdMV;	//!< Warning threshold in [mV]
+    bool	 flgLow;	//!< Supply is below the threshold
+    uint32_t	 Warnings;	//!< Number of warnings since power-on
+    uint32_t	 LastTime;	//!< Time of the last warning, see time()
+} SUPPLY_STATS;
+
+/*================================ Prototypes ================================*/
+
+void	SupplyInit (void);
+void	SupplyCheck (void);
+bool	SupplyIsLow (void);
+int	SupplyThresholdSet (int mV);
+void	SupplyStats (SUPPLY_STATS *pStats);
+void	SupplyPowerOff (void);
+
+
+#endif /* __INC_Supply_h */
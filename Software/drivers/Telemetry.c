@@ -0,0 +1,631 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Binary Telemetry Frames
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module builds compact binary frames for the serial link.  In text
+ * mode the LCD content is mirrored to the LEUART as ASCII lines of about 33
+ * characters, which transport a single value.  In binary mode a value only
+ * needs a few bytes, so snapshot sweeps and traces can be sent many times
+ * faster.
+ *
+ * Frame layout, all multi-byte fields are little-endian:
+ * <pre>
+ *   SYNC  LEN  TYPE  TIME[4]  RECORDS[LEN]  CRC[2]
+ * </pre>
+ * - <b>SYNC</b> is always @ref TLM_SYNC.
+ * - <b>LEN</b> is the number of bytes of the records.
+ * - <b>TYPE</b> is the frame type, see @ref TLM_TYPE.
+ * - <b>TIME</b> is the RTC time in seconds since 1970, see time().
+ * - <b>CRC</b> is a CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+ *   over LEN, TYPE, TIME, and RECORDS.
+ *
+ * Each record consists of variable length integers (varints): 7 bits per
+ * byte, least significant group first, bit 7 set if another byte follows.
+ * The first varint is the record ID, shifted left by @ref TLM_ID_SHIFT,
+ * where the lower bits are @ref TLM_ID_FLAG_BLOCK and @ref TLM_ID_FLAG_DELTA.
+ * Record IDs 0x00 to 0xFF are SBS register addresses, higher IDs are defined
+ * in Telemetry.h.
+ * - For a value record the second varint is the value.
+ * - For a delta record the second varint is the difference to the previous
+ *   value of this ID, ZigZag encoded, i.e. 0, -1, 1, -2 become 0, 1, 2, 3.
+ * - For a block record the second varint is the number of data bytes, which
+ *   follow unchanged.
+ *
+ * Delta streaming sends the whole register set periodically, see
+ * TlmStreamBegin().  The encoder keeps the last value sent for each record
+ * ID.  In a @ref TLM_TYPE_DELTA frame, unchanged registers are left out and
+ * small changes are sent as delta records.  Every @ref TLM_KEYFRAME_INTERVAL
+ * sweeps, a @ref TLM_TYPE_KEYFRAME with absolute values is sent, so a
+ * receiver which has lost a frame can resynchronize.  For blocks, only a
+ * CRC is kept, and the whole block is sent again when it has changed.
+ *
+ * A host-side decoder can be found in tools/tlm_decode.py.
+ *
+ * @note
+ * The frame functions must only be called from the main loop.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Added TlmFrameSendDirect() to send data from the flash
+		without a frame buffer.
+2026-10-18,agent	Delta streaming: only registers which changed since the
+		last frame are sent, with periodic keyframes for
+		resynchronization.
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Maximum size of a value record: 3 bytes ID and 5 bytes value. */
+#define TLM_VALUE_REC_MAX	8
+
+    /*!@brief Maximum size of a block record header: 3 bytes ID, 2 bytes len. */
+#define TLM_BLOCK_HDR_MAX	5
+
+    /*!@brief Check if frame type uses the delta cache */
+#define IS_STREAM_TYPE(type)	((type) == TLM_TYPE_KEYFRAME		\
+				 ||  (type) == TLM_TYPE_DELTA)
+
+    /*!@brief Frame offsets */
+#define OFFS_LEN		1
+#define OFFS_TYPE		2
+#define OFFS_TIME		3
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Current output mode. */
+static volatile TLM_MODE l_Mode = TLM_MODE_TEXT;
+
+    /*!@brief Frame to collect captured data, see TlmCapture(). */
+static TLM_FRAME	*l_pCaptureFrame;
+
+    /*!@brief CRC-16/CCITT table, one entry per nibble. */
+static const uint16_t	 l_CRC16_Tab[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+    /*!@brief Last value sent per record ID, or CRC for blocks. */
+static uint32_t		 l_LastValue[TLM_ID_CNT];
+
+    /*!@brief Bit mask of valid entries in @ref l_LastValue. */
+static uint32_t		 l_LastValid[(TLM_ID_CNT + 31) / 32];
+
+    /*!@brief Sweep counter to insert keyframes. */
+static int		 l_SweepCnt;
+
+    /*!@brief Flag to force a keyframe, e.g. after a frame was dropped. */
+static bool		 l_flgForceKeyframe;
+
+    /*!@brief Statistics of the delta streaming. */
+static TLM_STREAM_STATS	 l_Stats;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void PutVarint (TLM_FRAME *pFrame, uint32_t value);
+static int  VarintSize (uint32_t value);
+static bool DeltaCheck (TLM_FRAME *pFrame, uint16_t id, uint32_t value,
+			int fullSize);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set Output Mode
+ *
+ * Selects whether the serial link carries the ASCII mirror of the LCD, or
+ * binary telemetry frames.
+ *
+ ******************************************************************************/
+void	TlmModeSet (TLM_MODE mode)
+{
+    l_Mode = mode;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get Output Mode
+ *
+ ******************************************************************************/
+TLM_MODE TlmModeGet (void)
+{
+    return l_Mode;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Begin a new Frame
+ *
+ * Initializes the frame header with the frame type and the current time.
+ *
+ * @param[out] pFrame
+ *	Address of the frame buffer.
+ *
+ * @param[in] type
+ *	Frame type.
+ *
+ ******************************************************************************/
+void	TlmFrameBegin (TLM_FRAME *pFrame, TLM_TYPE type)
+{
+uint32_t now = (uint32_t) time(NULL);
+
+
+    EFM_ASSERT(pFrame != NULL);
+
+    pFrame->Len = 0;
+    pFrame->FullLen = 0;
+    pFrame->Buf[0] = TLM_SYNC;
+    pFrame->Buf[OFFS_TYPE]   = (uint8_t) type;
+    pFrame->Buf[OFFS_TIME+0] = (uint8_t) (now);
+    pFrame->Buf[OFFS_TIME+1] = (uint8_t) (now >>  8);
+    pFrame->Buf[OFFS_TIME+2] = (uint8_t) (now >> 16);
+    pFrame->Buf[OFFS_TIME+3] = (uint8_t) (now >> 24);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send Frame
+ *
+ * Completes the frame with its length and CRC, and writes it to the LEUART.
+ * Empty frames are not sent.  Afterwards the frame is empty again and may
+ * be used for further records of the same type.
+ *
+ * If a streaming frame cannot be written because the LEUART FIFO is full,
+ * the receiver would miss the changes, so the next sweep is a keyframe.
+ *
+ ******************************************************************************/
+void	TlmFrameSend (TLM_FRAME *pFrame)
+{
+uint16_t crc;
+uint16_t size = TLM_HDR_SIZE + pFrame->Len;
+bool	 flgStream = IS_STREAM_TYPE(pFrame->Buf[OFFS_TYPE]);
+
+
+    /* Without delta encoding, this frame would have been sent in any case */
+    if (flgStream  &&  pFrame->FullLen > 0)
+	l_Stats.FullBytes += TLM_HDR_SIZE + pFrame->FullLen + TLM_CRC_SIZE;
+
+    if (pFrame->Len == 0)
+    {
+	pFrame->FullLen = 0;
+	return;
+    }
+
+    pFrame->Buf[OFFS_LEN] = (uint8_t) pFrame->Len;
+
+    crc = TlmCRC16 (0xFFFF, pFrame->Buf + OFFS_LEN, size - OFFS_LEN);
+    pFrame->Buf[size++] = (uint8_t) (crc);
+    pFrame->Buf[size++] = (uint8_t) (crc >> 8);
+
+    if (drvLEUART_Write (pFrame->Buf, size))
+    {
+	if (flgStream)
+	    l_Stats.SentBytes += size;
+    }
+    else if (flgStream)
+    {
+	l_flgForceKeyframe = true;	// frame is lost, resynchronize
+    }
+
+    /* Re-use frame for the same type */
+    TlmFrameBegin (pFrame, (TLM_TYPE) pFrame->Buf[OFFS_TYPE]);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send Frame directly
+ *
+ * Sends a frame whose payload consists of a header and a data block, e.g.
+ * from the flash.  Only the frame header and the CRC are built on the
+ * stack, the payload is copied directly into the LEUART FIFO, so no frame
+ * buffer is required.  The frame is sent completely or not at all.
+ *
+ * @param[in] type
+ *	Frame type.
+ *
+ * @param[in] pHdr
+ *	Address of the payload header.
+ *
+ * @param[in] hdrLen
+ *	Number of bytes of the payload header.
+ *
+ * @param[in] pData
+ *	Address of the data.
+ *
+ * @param[in] dataLen
+ *	Number of data bytes, together with hdrLen up to @ref TLM_PAYLOAD_MAX.
+ *
+ * @return
+ *	true if the frame has been written, false if there was not enough
+ *	space in the LEUART FIFO.
+ *
+ ******************************************************************************/
+bool	TlmFrameSendDirect (TLM_TYPE type, const uint8_t *pHdr, int hdrLen,
+			    const uint8_t *pData, int dataLen)
+{
+uint32_t now = (uint32_t) time(NULL);
+uint8_t	 head[TLM_HDR_SIZE];
+uint8_t	 tail[TLM_CRC_SIZE];
+uint16_t crc;
+LEUART_IOVEC vec[4];
+
+
+    EFM_ASSERT(hdrLen + dataLen <= TLM_PAYLOAD_MAX);
+
+    head[0] = TLM_SYNC;
+    head[OFFS_LEN]    = (uint8_t) (hdrLen + dataLen);
+    head[OFFS_TYPE]   = (uint8_t) type;
+    head[OFFS_TIME+0] = (uint8_t) (now);
+    head[OFFS_TIME+1] = (uint8_t) (now >>  8);
+    head[OFFS_TIME+2] = (uint8_t) (now >> 16);
+    head[OFFS_TIME+3] = (uint8_t) (now >> 24);
+
+    crc = TlmCRC16 (0xFFFF, head + OFFS_LEN, TLM_HDR_SIZE - OFFS_LEN);
+    crc = TlmCRC16 (crc, pHdr, hdrLen);
+    crc = TlmCRC16 (crc, pData, dataLen);
+    tail[0] = (uint8_t) (crc);
+    tail[1] = (uint8_t) (crc >> 8);
+
+    vec[0].pData = head;
+    vec[0].Cnt   = TLM_HDR_SIZE;
+    vec[1].pData = pHdr;
+    vec[1].Cnt   = hdrLen;
+    vec[2].pData = pData;
+    vec[2].Cnt   = dataLen;
+    vec[3].pData = tail;
+    vec[3].Cnt   = TLM_CRC_SIZE;
+
+    return drvLEUART_WriteV (vec, 4);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add Value Record
+ *
+ * Appends a value record to the frame.  If the frame is full, it is sent
+ * and a new frame of the same type is started.  In a delta frame, the value
+ * is left out if it has not changed, or is sent as difference if this is
+ * shorter.
+ *
+ * @param[in] pFrame
+ *	Address of the frame buffer.
+ *
+ * @param[in] id
+ *	Record ID, i.e. the SBS register address, or one of the TLM_ID_xxx
+ *	defines.
+ *
+ * @param[in] value
+ *	Value to add.
+ *
+ ******************************************************************************/
+void	TlmAddValue (TLM_FRAME *pFrame, uint16_t id, uint32_t value)
+{
+uint32_t key = (uint32_t)id << TLM_ID_SHIFT;	// encoded record ID
+int32_t	 diff;			// difference to the previous value
+uint32_t zigzag;		// ZigZag encoded difference
+bool	 flgValid;		// previous value is known
+
+
+    if (pFrame->Len + TLM_VALUE_REC_MAX > TLM_PAYLOAD_MAX)
+	TlmFrameSend (pFrame);
+
+    if (IS_STREAM_TYPE(pFrame->Buf[OFFS_TYPE])  &&  id < TLM_ID_CNT)
+    {
+	flgValid = (l_LastValid[id / 32] & (1UL << (id % 32))) != 0;
+	diff = (int32_t)(value - l_LastValue[id]);
+
+	if (! DeltaCheck (pFrame, id, value,
+			  VarintSize(key) + VarintSize(value)))
+	    return;		// unchanged
+
+	zigzag = ((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31);
+
+	if (flgValid  &&  pFrame->Buf[OFFS_TYPE] == TLM_TYPE_DELTA
+	&&  VarintSize(zigzag) < VarintSize(value))
+	{
+	    PutVarint (pFrame, key | TLM_ID_FLAG_DELTA);
+	    PutVarint (pFrame, zigzag);
+	    return;
+	}
+    }
+
+    PutVarint (pFrame, key);
+    PutVarint (pFrame, value);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add Block Record
+ *
+ * Appends a block record, e.g. a string or a hexdump, to the frame.  If the
+ * frame is full, it is sent and a new frame of the same type is started.
+ * In a delta frame, the block is left out if it has not changed.
+ *
+ * @param[in] pFrame
+ *	Address of the frame buffer.
+ *
+ * @param[in] id
+ *	Record ID, i.e. the SBS register address.
+ *
+ * @param[in] pData
+ *	Address of the data bytes.
+ *
+ * @param[in] len
+ *	Number of data bytes.
+ *
+ ******************************************************************************/
+void	TlmAddBlock (TLM_FRAME *pFrame, uint16_t id,
+		     const uint8_t *pData, uint8_t len)
+{
+    EFM_ASSERT(len + TLM_BLOCK_HDR_MAX <= TLM_PAYLOAD_MAX);
+
+    if (pFrame->Len + TLM_BLOCK_HDR_MAX + len > TLM_PAYLOAD_MAX)
+	TlmFrameSend (pFrame);
+
+    if (IS_STREAM_TYPE(pFrame->Buf[OFFS_TYPE])  &&  id < TLM_ID_CNT)
+    {
+	if (! DeltaCheck (pFrame, id, TlmCRC16 (0xFFFF, pData, len),
+			  VarintSize((uint32_t)id << TLM_ID_SHIFT)
+			  + VarintSize(len) + len))
+	    return;		// unchanged
+    }
+
+    PutVarint (pFrame, ((uint32_t)id << TLM_ID_SHIFT) | TLM_ID_FLAG_BLOCK);
+    PutVarint (pFrame, len);
+
+    memcpy (pFrame->Buf + TLM_HDR_SIZE + pFrame->Len, pData, len);
+    pFrame->Len += len;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add Raw Data
+ *
+ * Appends bytes to the payload without record encoding.  This is used by
+ * frame types with their own payload format, e.g. @ref TLM_TYPE_BRIDGE.
+ * In contrast to the record functions, a full frame is not sent
+ * automatically, because the caller may need to repeat a payload header.
+ *
+ * @return
+ *	true if the data has been added, false if there is not enough room.
+ *
+ ******************************************************************************/
+bool	TlmAddRaw (TLM_FRAME *pFrame, const uint8_t *pData, int len)
+{
+    if (pFrame->Len + len > TLM_PAYLOAD_MAX)
+	return false;
+
+    memcpy (pFrame->Buf + TLM_HDR_SIZE + pFrame->Len, pData, len);
+    pFrame->Len += len;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Begin a Streaming Sweep
+ *
+ * Starts a frame for the next sweep over the whole register set.  This is a
+ * @ref TLM_TYPE_KEYFRAME every @ref TLM_KEYFRAME_INTERVAL sweeps, or if a
+ * previous frame has been lost, otherwise a @ref TLM_TYPE_DELTA frame.
+ *
+ * @param[out] pFrame
+ *	Address of the frame buffer.
+ *
+ ******************************************************************************/
+void	TlmStreamBegin (TLM_FRAME *pFrame)
+{
+    if (l_SweepCnt == 0  ||  l_flgForceKeyframe)
+    {
+	l_flgForceKeyframe = false;
+	l_SweepCnt = 0;
+	l_Stats.Keyframes++;
+	TlmFrameBegin (pFrame, TLM_TYPE_KEYFRAME);
+    }
+    else
+    {
+	l_Stats.Deltas++;
+	TlmFrameBegin (pFrame, TLM_TYPE_DELTA);
+    }
+
+    if (++l_SweepCnt >= TLM_KEYFRAME_INTERVAL)
+	l_SweepCnt = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get Streaming Statistics
+ *
+ * Returns a copy of the delta streaming statistics.  The compression ratio
+ * is <b>FullBytes</b> / <b>SentBytes</b>.
+ *
+ ******************************************************************************/
+void	TlmStreamStats (TLM_STREAM_STATS *pStats)
+{
+    *pStats = l_Stats;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Capture Item Data
+ *
+ * Specifies a frame, where the raw data read by ItemDataString() should be
+ * added to.  This allows to use the same register read for the LCD and for
+ * the serial link.  Call with NULL to stop capturing.
+ *
+ ******************************************************************************/
+void	TlmCapture (TLM_FRAME *pFrame)
+{
+    l_pCaptureFrame = pFrame;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Capture Value
+ *
+ * Adds a value record to the capture frame, if there is one.
+ *
+ ******************************************************************************/
+void	TlmCaptureValue (uint16_t id, uint32_t value)
+{
+    if (l_pCaptureFrame != NULL)
+	TlmAddValue (l_pCaptureFrame, id, value);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Capture Block
+ *
+ * Adds a block record to the capture frame, if there is one.
+ *
+ ******************************************************************************/
+void	TlmCaptureBlock (uint16_t id, const uint8_t *pData, uint8_t len)
+{
+    if (l_pCaptureFrame != NULL)
+	TlmAddBlock (l_pCaptureFrame, id, pData, len);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Calculate CRC-16/CCITT
+ *
+ * Updates the CRC with the specified data.  Start with 0xFFFF for a new
+ * calculation.
+ *
+ * @param[in] crc
+ *	Previous CRC value.
+ *
+ * @param[in] pData
+ *	Address of the data.
+ *
+ * @param[in] cnt
+ *	Number of bytes.
+ *
+ * @return
+ *	Updated CRC value.
+ *
+ ******************************************************************************/
+uint16_t TlmCRC16 (uint16_t crc, const uint8_t *pData, int cnt)
+{
+    while (cnt-- > 0)
+    {
+	crc = (crc << 4) ^ l_CRC16_Tab[(crc >> 12) ^ (*pData >> 4)];
+	crc = (crc << 4) ^ l_CRC16_Tab[(crc >> 12) ^ (*pData & 0x0F)];
+	pData++;
+    }
+
+    return crc;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Store Varint
+ *
+ * Stores <b>value</b> as variable length integer at the end of the frame.
+ *
+ ******************************************************************************/
+static void PutVarint (TLM_FRAME *pFrame, uint32_t value)
+{
+uint8_t	*pDst = pFrame->Buf + TLM_HDR_SIZE + pFrame->Len;
+
+
+    while (value >= 0x80)
+    {
+	*pDst++ = (uint8_t)(value | 0x80);
+	value >>= 7;
+	pFrame->Len++;
+    }
+    *pDst = (uint8_t) value;
+    pFrame->Len++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Size of a Varint
+ *
+ * Returns the number of bytes <b>value</b> needs as variable length integer.
+ *
+ ******************************************************************************/
+static int  VarintSize (uint32_t value)
+{
+int	 cnt = 1;
+
+    while (value >= 0x80)
+    {
+	value >>= 7;
+	cnt++;
+    }
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check Record for Delta Streaming
+ *
+ * Accounts the full size of the record and checks if it must be sent.  In a
+ * keyframe every record is sent, in a delta frame only if the value differs
+ * from the last one sent.  The last value is updated in both cases.
+ *
+ * @param[in] pFrame
+ *	Address of the frame buffer.
+ *
+ * @param[in] id
+ *	Record ID, must be less than @ref TLM_ID_CNT.
+ *
+ * @param[in] value
+ *	Value, or CRC of a block.
+ *
+ * @param[in] fullSize
+ *	Size of the record without delta encoding.
+ *
+ * @return
+ *	true if the record has to be sent, false if it is unchanged.
+ *
+ ******************************************************************************/
+static bool DeltaCheck (TLM_FRAME *pFrame, uint16_t id, uint32_t value,
+			int fullSize)
+{
+uint32_t validBit = 1UL << (id % 32);
+
+
+    pFrame->FullLen += fullSize;
+
+    if (pFrame->Buf[OFFS_TYPE] == TLM_TYPE_DELTA
+    &&  (l_LastValid[id / 32] & validBit)  &&  l_LastValue[id] == value)
+    {
+	l_Stats.Unchanged++;
+	return false;
+    }
+
+    l_LastValue[id] = value;
+    l_LastValid[id / 32] |= validBit;
+
+    return true;
+}
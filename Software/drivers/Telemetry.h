@@ -0,0 +1,146 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Telemetry.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Added TLM_TYPE_DOWNLOAD and TlmFrameSendDirect().
+2026-10-18,agent	Added TLM_TYPE_LOG for log queries, see Console.c.
+2026-10-18,agent	Added TLM_TYPE_EXPORT for the encrypted export.
+2026-10-18,agent	Added TLM_TYPE_DFLASH for the data flash backup.
+2026-10-18,agent	Added TLM_ID_MAC for the fields of MAC status blocks.
+2026-10-18,agent	Added TLM_TYPE_BRIDGE and TlmAddRaw() for the SMBus
+		bridge.
+2026-10-18,agent	Added TLM_TYPE_WATCH for the watch list, see Watch.c.
+2026-10-18,agent	Added delta streaming: TLM_TYPE_KEYFRAME,
+		TLM_TYPE_DELTA, TlmStreamBegin(), and TlmStreamStats().
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Telemetry_h
+#define __INC_Telemetry_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Sync byte at the start of each frame. */
+#define TLM_SYNC		0xA5
+
+    /*!@brief Size of the frame header: SYNC, LEN, TYPE, 4 bytes TIME. */
+#define TLM_HDR_SIZE		7
+
+    /*!@brief Size of the CRC at the end of a frame. */
+#define TLM_CRC_SIZE		2
+
+    /*!@brief Maximum number of payload bytes (records) of a frame. */
+#define TLM_PAYLOAD_MAX		240
+
+    /*!@brief Flags in bits [1:0] of the encoded record ID. */
+#define TLM_ID_FLAG_BLOCK	0x01	//!< block record
+#define TLM_ID_FLAG_DELTA	0x02	//!< value is a difference, see Telemetry.c
+#define TLM_ID_SHIFT		2	//!< record ID starts at this bit
+
+    /*!@brief Number of streaming sweeps after which a keyframe is sent. */
+#ifndef TLM_KEYFRAME_INTERVAL
+    #define TLM_KEYFRAME_INTERVAL	16
+#endif
+
+    /*!@name Record IDs for values which are not SBS registers */
+//@{
+#define TLM_ID_CR2032		0x100	//!< Voltage of the CR2032 in [mV]
+#define TLM_ID_BAT_CTRL		0x101	//!< SMBus address of the controller
+#define TLM_ID_CNT		0x102	//!< number of record IDs
+//@}
+
+    /*!@brief Record ID of the first MAC field, see BatteryMac.c.  These IDs
+     * are beyond @ref TLM_ID_CNT, i.e. they are not delta encoded.
+     */
+#define TLM_ID_MAC		0x200
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Output mode of the serial link. */
+typedef enum
+{
+    TLM_MODE_TEXT,	//!< ASCII mirror of the LCD (default)
+    TLM_MODE_BINARY,	//!< Binary telemetry frames
+} TLM_MODE;
+
+    /*!@brief Frame types. */
+typedef enum
+{
+    TLM_TYPE_SAMPLE = 1,	//!< Periodic sample of the displayed item
+    TLM_TYPE_SNAPSHOT,		//!< Sweep over all items
+    TLM_TYPE_TRACE,		//!< Repeated reads of one register
+    TLM_TYPE_KEYFRAME,		//!< Streaming: all registers, absolute values
+    TLM_TYPE_DELTA,		//!< Streaming: changed registers only
+    TLM_TYPE_WATCH,		//!< Registers of the watch list which are due
+    TLM_TYPE_BRIDGE,		//!< SMBus bridge results, see Bridge.c
+    TLM_TYPE_DFLASH,		//!< Data flash chunks, see DataFlash.c
+    TLM_TYPE_EXPORT,		//!< Encrypted export, see Export.c
+    TLM_TYPE_LOG,		//!< Records of the session log, see Console.c
+    TLM_TYPE_DOWNLOAD,		//!< Blocks of the log download, see Download.c
+} TLM_TYPE;
+
+    /*!@brief Statistics of the delta streaming, see TlmStreamStats().
+     *
+     * <b>FullBytes</b> is the number of bytes all streaming frames would have
+     * needed without delta encoding, i.e. with every register as absolute
+     * value.  <b>SentBytes</b> is the number of bytes actually sent, so the
+     * compression ratio is FullBytes / SentBytes.
+     */
+typedef struct
+{
+    uint32_t	FullBytes;	//!< Bytes without delta encoding
+    uint32_t	SentBytes;	//!< Bytes actually sent
+    uint32_t	Keyframes;	//!< Number of keyframe sweeps
+    uint32_t	Deltas;		//!< Number of delta sweeps
+    uint32_t	Unchanged;	//!< Number of records suppressed
+} TLM_STREAM_STATS;
+
+    /*!@brief Frame buffer.
+     *
+     * The frame is built in place, i.e. <b>Buf</b> contains the complete
+     * frame including header and space for the CRC, so it can be written to
+     * the LEUART in one piece.
+     */
+typedef struct
+{
+    uint16_t	Len;		//!< Number of payload bytes
+    uint16_t	FullLen;	//!< Payload bytes without delta encoding
+    uint8_t	Buf[TLM_HDR_SIZE + TLM_PAYLOAD_MAX + TLM_CRC_SIZE];
+} TLM_FRAME;
+
+/*================================ Prototypes ================================*/
+
+void	 TlmModeSet (TLM_MODE mode);
+TLM_MODE TlmModeGet (void);
+
+void	 TlmFrameBegin (TLM_FRAME *pFrame, TLM_TYPE type);
+void	 TlmFrameSend  (TLM_FRAME *pFrame);
+bool	 TlmFrameSendDirect (TLM_TYPE type, const uint8_t *pHdr, int hdrLen,
+			     const uint8_t *pData, int dataLen);
+void	 TlmAddValue   (TLM_FRAME *pFrame, uint16_t id, uint32_t value);
+void	 TlmAddBlock   (TLM_FRAME *pFrame, uint16_t id,
+			const uint8_t *pData, uint8_t len);
+
+bool	 TlmAddRaw     (TLM_FRAME *pFrame, const uint8_t *pData, int len);
+
+void	 TlmStreamBegin (TLM_FRAME *pFrame);
+void	 TlmStreamStats (TLM_STREAM_STATS *pStats);
+
+void	 TlmCapture      (TLM_FRAME *pFrame);
+void	 TlmCaptureValue (uint16_t id, uint32_t value);
+void	 TlmCaptureBlock (uint16_t id, const uint8_t *pData, uint8_t len);
+
+uint16_t TlmCRC16 (uint16_t crc, const uint8_t *pData, int cnt);
+
+
+#endif /* __INC_Telemetry_h */
@@ -0,0 +1,334 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Register Watch List
+ * @author	agent
+ * @version	2026-10-18
+ *
+ * This module allows a client on the serial console to subscribe to a set
+ * of registers of the battery controller, each with its own period, e.g.
+ * Current every second and RelativeStateOfCharge every 10 seconds.  This is
+ * independent from the item shown on the LCD.
+ *
+ * Once per second, WatchCheck() collects all registers which are due, reads
+ * them, and sends them in one line, or in one @ref TLM_TYPE_WATCH frame in
+ * binary mode.  The text is formatted directly into the transmit FIFO by
+ * drvLEUART_printf(), one register after the other.  Each register appears
+ * only once in the list, subscribing it again just changes its period.  In
+ * text mode, signed registers like Current are shown with their sign, binary
+ * frames carry the raw value.
+ *
+ * The registers are read via BatteryRegReadShared(), the same as the display
+ * poll in ItemDataString().  So a register that is due for both is read only
+ * once from the SMBus.  There is no separate poll plan which merges the
+ * watch list and the display: each consumer reads the registers it needs
+ * when they are due, and the cache of BatteryRegReadShared() removes the
+ * duplicate reads within the same second.  Registers with different periods
+ * are not aligned to common seconds, a plan would save these reads only if
+ * it moved them, i.e. changed the periods the client asked for.
+ *
+ * WatchCheck() also measures the sampling latency, i.e. the time from the
+ * RTC tick which started the second until it runs.  The maximum is kept
+ * separately for seconds with and without flash activity of the log, see
+ * WatchLatency().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Text output via drvLEUART_printf() instead of a line
+		buffer.
+2026-10-18,agent	Documented that the shared register cache replaces a
+		separate poll plan.
+2026-10-18,agent	The latency and the periods use the actual tick period,
+		see ClockTickLast() and ClockTickSet().
+2026-10-18,agent	Text mode shows signed registers, e.g. Current, with
+		sign.
+2026-10-18,agent	Measure the sampling latency, see WatchLatency().
+2026-10-18,agent	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_assert.h"
+#include "Watch.h"
+#include "AlarmClock.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+#include "Log.h"
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Watch list. */
+static WATCH		 l_Watch[WATCH_MAX];
+
+    /*!@brief Registers with a signed 16 bit value. */
+static const SBS_CMD	 l_SignedCmd[] =
+{
+    SBS_AtRate, SBS_Current, SBS_AverageCurrent,
+    SBS_BTPDischargeSet, SBS_BTPChargeSet
+};
+
+    /*!@brief Telemetry frame for binary mode. */
+static TLM_FRAME	 l_Frame;
+
+    /*!@brief Maximum sampling latency in RTC ticks, without and with flash
+     * activity of the log during the previous second.
+     */
+static uint32_t		 l_MaxLatency[2];
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Watch List
+ *
+ * This routine must be called once to clear the watch list.
+ *
+ ******************************************************************************/
+void	WatchInit (void)
+{
+int	 i;
+
+    for (i = 0;  i < WATCH_MAX;  i++)
+	l_Watch[i].Cmd = SBS_NONE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add Register to the Watch List
+ *
+ * Subscribes the specified register.  If it is already in the list, only
+ * its period is changed.  Only registers of up to 4 bytes can be watched.
+ *
+ * @param[in] cmd
+ *	SBS command, i.e. the register address and size.
+ *
+ * @param[in] period
+ *	Period in seconds, 1 to @ref WATCH_PERIOD_MAX.
+ *
+ * @return
+ *	0 if the register has been added, -1 for an invalid parameter, or -2
+ *	if the list is full.
+ *
+ ******************************************************************************/
+int	WatchAdd (SBS_CMD cmd, int period)
+{
+int	 i, free = -1;
+
+
+    if (SBS_CMD_SIZE(cmd) < 1  ||  SBS_CMD_SIZE(cmd) > 4
+    ||  period < 1  ||  period > WATCH_PERIOD_MAX)
+	return -1;
+
+    for (i = 0;  i < WATCH_MAX;  i++)
+    {
+	if (l_Watch[i].Cmd == SBS_NONE)
+	{
+	    if (free < 0)
+		free = i;
+	}
+	else if (SBS_CMD_ADDR(l_Watch[i].Cmd) == SBS_CMD_ADDR(cmd))
+	{
+	    break;		// already subscribed
+	}
+    }
+
+    if (i >= WATCH_MAX)
+    {
+	if (free < 0)
+	    return -2;		// list is full
+	i = free;
+    }
+
+    l_Watch[i].Period = (uint16_t) period;
+    l_Watch[i].Left   = 1;	// read with the next cycle
+    l_Watch[i].Cmd    = cmd;
+
+    return 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Remove Register from the Watch List
+ *
+ * @param[in] addr
+ *	Register address to remove, or -1 to clear the whole list.
+ *
+ * @return
+ *	Number of entries removed.
+ *
+ ******************************************************************************/
+int	WatchRemove (int addr)
+{
+int	 i, cnt = 0;
+
+
+    for (i = 0;  i < WATCH_MAX;  i++)
+    {
+	if (l_Watch[i].Cmd != SBS_NONE
+	&&  (addr < 0  ||  SBS_CMD_ADDR(l_Watch[i].Cmd) == addr))
+	{
+	    l_Watch[i].Cmd = SBS_NONE;
+	    cnt++;
+	}
+    }
+
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	List Watched Registers
+ *
+ * Prints the watch list and the number of shared register reads to the
+ * console.
+ *
+ ******************************************************************************/
+void	WatchList (void)
+{
+uint32_t reads, hits;
+int	 i, cnt = 0;
+
+
+    for (i = 0;  i < WATCH_MAX;  i++)
+    {
+	if (l_Watch[i].Cmd == SBS_NONE)
+	    continue;
+
+	ConsolePrintf ("Watch [%02X] every %ds\n",
+		       SBS_CMD_ADDR(l_Watch[i].Cmd), l_Watch[i].Period);
+	cnt++;
+    }
+
+    if (cnt == 0)
+	ConsolePrintf ("Watch list is empty\n");
+
+    BatteryRegSharedStats (&reads, &hits);
+    ConsolePrintf ("Shared reads: %lu from bus, %lu shared\n", reads, hits);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check for a Signed Register
+ *
+ * Returns true if the value of the specified register is a signed 16 bit
+ * integer, see @ref l_SignedCmd.
+ *
+ ******************************************************************************/
+static bool IsSigned (SBS_CMD cmd)
+{
+unsigned int i;
+
+    for (i = 0;  i < ELEM_CNT(l_SignedCmd);  i++)
+	if (l_SignedCmd[i] == cmd)
+	    return true;
+
+    return false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Watch Check
+ *
+ * This function must be called from the main loop.  Once per second, it
+ * reads all registers which are due and sends their values to the LEUART.
+ *
+ ******************************************************************************/
+void	WatchCheck (void)
+{
+static int prevSeconds;		// to detect the next second
+bool	 flgBinary = (TlmModeGet() == TLM_MODE_BINARY);
+static uint32_t prevActivity;	// to detect flash activity of the log
+uint32_t value, latency, activity;
+int	 i, cnt = 0;
+int	 elapsed;		// seconds since the last check
+
+
+    if (prevSeconds == g_CurrDateTime.tm_sec)
+	return;
+
+    /* The RTC interrupt may occur less often, see ClockTickSet() */
+    elapsed = (g_CurrDateTime.tm_sec - prevSeconds + 60) % 60;
+    prevSeconds = g_CurrDateTime.tm_sec;
+
+    /* Time since the tick which started this second */
+    latency = (RTC->CNT - ClockTickLast()) & 0x00FFFFFF;
+    activity = LogActivity();
+    i = (activity != prevActivity);
+    prevActivity = activity;
+    if (latency > l_MaxLatency[i])
+	l_MaxLatency[i] = latency;
+
+    for (i = 0;  i < WATCH_MAX;  i++)
+    {
+	if (l_Watch[i].Cmd == SBS_NONE)
+	    continue;		// not subscribed
+
+	if (l_Watch[i].Left > elapsed)
+	{
+	    l_Watch[i].Left -= elapsed;
+	    continue;		// not due
+	}
+
+	l_Watch[i].Left = l_Watch[i].Period;
+
+	if (cnt++ == 0)
+	{
+	    /* First register in this cycle */
+	    if (flgBinary)
+		TlmFrameBegin (&l_Frame, TLM_TYPE_WATCH);
+	    else
+		drvLEUART_printf ("W %02d:%02d:%02d", g_CurrDateTime.tm_hour,
+				  g_CurrDateTime.tm_min, g_CurrDateTime.tm_sec);
+	}
+
+	if (BatteryRegReadShared (l_Watch[i].Cmd, &value) < 0)
+	{
+	    if (! flgBinary)
+		drvLEUART_printf (" [%02X]=ERR", SBS_CMD_ADDR(l_Watch[i].Cmd));
+	    continue;
+	}
+
+	if (flgBinary)
+	    TlmAddValue (&l_Frame, SBS_CMD_ADDR(l_Watch[i].Cmd), value);
+	else if (IsSigned (l_Watch[i].Cmd))
+	    drvLEUART_printf (" [%02X]=%d",
+			      SBS_CMD_ADDR(l_Watch[i].Cmd), (int16_t) value);
+	else
+	    drvLEUART_printf (" [%02X]=%lu",
+			      SBS_CMD_ADDR(l_Watch[i].Cmd), value);
+    }
+
+    if (cnt == 0)
+	return;			// nothing to send
+
+    if (flgBinary)
+	TlmFrameSend (&l_Frame);
+    else
+	drvLEUART_printf ("\n");
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Sampling Latency
+ *
+ * Returns the maximum time from the start of a second until WatchCheck()
+ * has been called, in RTC ticks, see @ref RTC_COUNTS_PER_SEC.
+ *
+ * @param[out] pMaxIdle
+ *	Maximum of the seconds without flash activity of the log.
+ *
+ * @param[out] pMaxLog
+ *	Maximum of the seconds with flash activity of the log.
+ *
+ ******************************************************************************/
+void	WatchLatency (uint32_t *pMaxIdle, uint32_t *pMaxLog)
+{
+    *pMaxIdle = l_MaxLatency[0];
+    *pMaxLog  = l_MaxLatency[1];
+}
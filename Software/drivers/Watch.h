@@ -0,0 +1,53 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Watch.c
+ * @author	agent
+ * @version	2026-10-18
+ ****************************************************************************//*
+Revision History:
+2026-10-18,agent	Added WatchLatency().
+2026-10-18,agent	Initial version.
+*/
+
+#ifndef __INC_Watch_h
+#define __INC_Watch_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "BatteryMon.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Maximum number of registers in the watch list. */
+#ifndef WATCH_MAX
+    #define WATCH_MAX		8
+#endif
+
+    /*!@brief Maximum period of a subscription in [s]. */
+#define WATCH_PERIOD_MAX	3600
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Entry of the watch list. */
+typedef struct
+{
+    SBS_CMD	 Cmd;		//!< Register to read, SBS_NONE if entry is free
+    uint16_t	 Period;	//!< Period in [s]
+    uint16_t	 Left;		//!< Seconds until the next read
+} WATCH;
+
+/*================================ Prototypes ================================*/
+
+void	 WatchInit   (void);
+int	 WatchAdd    (SBS_CMD cmd, int period);
+int	 WatchRemove (int addr);
+void	 WatchList   (void);
+void	 WatchCheck  (void);
+void	 WatchLatency (uint32_t *pMaxIdle, uint32_t *pMaxLog);
+
+
+#endif /* __INC_Watch_h */
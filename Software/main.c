@@ -2,7 +2,7 @@
  * @file
  * @brief	HRD
  * @author	Peter Loes
- * @version	2020-01-13
+ * @version	2026-10-18
  *
  * This application consists of the following modules:
  * - ExtInt.c - External interrupt handler.
@@ -14,6 +14,22 @@
  * - Display.c - Display manager for LCD.
  * - BatteryMon.c - Battery monitor, allows to read the state of the
  *   battery via the SMBus.
+ * - BatteryMac.c - MAC status blocks of the TI controller.
+ * - DataFlash.c - Data flash backup and restore of the TI controller.
+ * - Export.c - Encrypted and authenticated export with the AES hardware.
+ * - Sha1.c - SHA-1 hash function.
+ * - PackAuth.c - Authentication of the battery pack.
+ * - Log.c - Session log in the internal flash.
+ * - Series.c - Compressed time series of the main battery values.
+ * - History.c - Sessions of each battery pack, indexed by its identity.
+ * - Download.c - Resumable block download of the session log.
+ * - Supply.c - Low supply warning with the VCMP, power-off sequence.
+ * - Monitor.c - Unattended monitor mode, lifetime of the CR2032.
+ * - Profile.c - Residency in the energy modes, charge per session.
+ * - Console.c - Command console on the LEUART.
+ * - Telemetry.c - Binary telemetry frames for the serial link.
+ * - Watch.c - Registers subscribed via the console.
+ * - Bridge.c - Serial to SMBus bridge for PC tools.
  *
  * Parts of the code are based on the example code of AN0006 "tickless calender"
  * from Energy Micro AS.
@@ -49,6 +65,29 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-18,agent	The main loop time stamps each task and each sleep phase
+		for the profiler, see module Profile.c.  Added the hidden item
+		"EM0/1/2 [uAh]" to l_Item.
+2026-10-18,agent	Added the monitor mode, see module Monitor.c.  The main
+		loop reports the time spent in EM1 and EM2 to it.
+2026-10-18,agent	Flush the log on a low supply voltage, see module
+		Supply.c.
+2026-10-18,agent	Record the sessions of each pack, see module History.c.
+2026-10-18,agent	Record a compressed time series, see module Series.c.
+2026-10-18,agent	The main loop calls LogCheck() to program staged log
+		records.
+2026-10-18,agent	Mount the session log in the internal flash, see module
+		Log.c.
+2026-10-18,agent	Added SMBus bridge mode, see module Bridge.c.  The main
+		loop handles timeouts of queued SMBus transactions.
+2026-10-18,agent	Added watch list, see module Watch.c.
+2026-10-18,agent	Added command console, see module Console.c.
+2026-10-18,agent	ConsolePrintf() formats directly into the LEUART FIFO.
+2026-10-18,agent	DEBUG: Measure the LEUART transmit throughput at
+		start-up.
+2026-10-18,agent	Added debounce window for the keys to l_ExtIntCfg.
+2026-10-18,agent	DEBUG: Report CPU cycles of the calendar update at
+		start-up.
 2020-01-13,rage	Merged with version from Peter Loes, updated documentation.
 		Calculate the LCD contrast depending on the CR2032 voltage.
 		ConsolePrintf() allows formated output to the serial console.
@@ -131,12 +170,18 @@ Revision History:
  * -# The Battery Monitor is initialized
  * -# If a Battery Pack is connected via SMBus, the controller type is probed
  *    and displayed
+ * -# The session log in the internal flash is mounted, and the start of the
+ *    session is recorded
+ * -# The pack history index is checked, and rebuilt from the log if it is
+ *    not valid
  *
  * The program then enters the Service Execution Loop which takes care of:
  * - Power management for the LC-Display
  * - Manual or timed Power-Off
  * - Battery controller probing requests via POWER button
  * - Battery monitoring
+ * - Recording the time series of the main battery values
+ * - The monitor mode for long-term recordings, see Monitor.c
  * - Entering the right energy mode
  */
 /*=============================== Header Files ===============================*/
@@ -154,6 +199,14 @@ Revision History:
 #include "Display.h"
 #include "LCD_DOGM162.h"
 #include "LEUART.h"
+#include "Console.h"
+#include "Watch.h"
+#include "Log.h"
+#include "Series.h"
+#include "History.h"
+#include "Supply.h"
+#include "Monitor.h"
+#include "Profile.h"
 
 /*================================ Global Data ===============================*/
 
@@ -170,8 +223,9 @@ extern char const prjDate[];
  * zero.  There is a total of 16 entries in the array.  The first 8 are used
  * for the primary DMA structures, the second 8 for alternate DMA structures
  * as used for DMA scatter-gather mode, where one buffer is still available,
- * while the other can be re-configured.  This application uses only the first
- * 8 entries.
+ * while the other can be re-configured.  The LEUART driver uses both the
+ * primary and alternate structure of its Tx channel in ping-pong mode, all
+ * other channels use only the primary structure.
  *
  * @see  DMA Channel Assignment
  *
@@ -236,9 +290,9 @@ volatile uint16_t	g_EM1_ModuleMask;
      * Connect the external interrupts of the push buttons to the key handler.
      */
 static const EXTI_INIT  l_ExtIntCfg[] =
-{   //	IntBitMask,	IntFct
-    {	KEY_EXTI_MASK,	KeyHandler	},	// Keys
-    {	0,		NULL		}
+{   //	IntBitMask,	IntFct,		DebounceMs
+    {	KEY_EXTI_MASK,	KeyHandler,	KEY_DEBOUNCE_TIME },	// Keys
+    {	0,		NULL,		0		  }
 };
 
     /*!
@@ -338,6 +392,8 @@ static const ITEM l_Item[] =
     { "Cell #3 Voltage",    SBS_CellVoltage3,		FRMT_MILLIVOLT	},
     { "Cell #4 Voltage",    SBS_CellVoltage4,		FRMT_MILLIVOLT	},
     { "State-of-Health",    SBS_StateOfHealth,		FRMT_PERCENT	},
+	/* Hidden, shown by the console command "prof lcd" */
+    { "EM0/1/2 [uAh]",      SBS_NONE,			FRMT_EM_PROFILE	},
 };
 #define ITEM_CNT	ELEM_CNT(l_Item)
 
@@ -391,6 +447,14 @@ int main( void )
     /* Initialize the Alarm Clock module */
     AlarmClockInit();
 
+#ifdef DEBUG
+    /* Report CPU cycles of the calendar update in the RTC interrupt */
+    ClockCycleCompare();
+
+    /* Report the achieved LEUART transmit throughput */
+    drvLEUART_TxRateTest();
+#endif
+
     /* Verify element count */
     EFM_ASSERT(ELEM_CNT(l_LCD_Field) == LCD_FIELD_ID_CNT);
 
@@ -409,6 +473,18 @@ int main( void )
     /* Initialize Battery Monitor */
     BatteryMonInit();
 
+    /* Mount the session log, this records the start of the session */
+    LogInit();
+    HistoryInit();
+    SeriesInit();
+
+    /* Watch the supply voltage, flush the log before it is too low */
+    SupplyInit();
+
+    /* Initialize command console */
+    ConsoleInit (l_Item, ITEM_CNT);
+    WatchInit();
+
     /* Enable all other External Interrupts */
     ExtIntEnableAll();
 
@@ -418,9 +494,42 @@ int main( void )
      * ============================================ */
     while (1)
     {
+	/* Flush the log and close the session if the supply is low */
+	ProfileTask (PROF_TASK_SUPPLY);
+	SupplyCheck();
+
 	/* Update or power-off the LC-Display, update measurements */
+	ProfileTask (PROF_TASK_DISPLAY);
 	DisplayUpdateCheck();
 
+	/* Execute commands received via the serial console */
+	ProfileTask (PROF_TASK_CONSOLE);
+	ConsoleCheck();
+
+	/* Read and send registers of the watch list */
+	ProfileTask (PROF_TASK_WATCH);
+	WatchCheck();
+
+	/* Sample the main battery values into the session log */
+	ProfileTask (PROF_TASK_SERIES);
+	SeriesCheck();
+
+	/* Open or close the session of the connected pack */
+	ProfileTask (PROF_TASK_HISTORY);
+	HistoryCheck();
+
+	/* Handle timeouts of queued SMBus transactions */
+	ProfileTask (PROF_TASK_SMBUS);
+	BatteryMonCheck();
+
+	/* Program staged log records, erase pages ahead when idle */
+	ProfileTask (PROF_TASK_LOG);
+	LogCheck();
+
+	/* Select the tick period of the monitor mode */
+	ProfileTask (PROF_TASK_MONITOR);
+	MonitorCheck();
+
 	/*
 	 * Check for current power mode:  If a minimum of one active module
 	 * requires EM1, i.e. <g_EM1_ModuleMask> is not 0, this will be
@@ -428,13 +537,18 @@ int main( void )
 	 */
 	if (! g_flgIRQ)		// enter EM only if no IRQ occured
 	{
+	    ProfileSleep (g_EM1_ModuleMask);	// time stamp the entry
+
 	    if (g_EM1_ModuleMask)
 		EMU_EnterEM1();		// EM1 - Sleep Mode
 	    else
 		EMU_EnterEM2(true);	// EM2 - Deep Sleep Mode
+
+	    ProfileWake();		// time stamp the exit
 	}
 	else
 	{
+	    ProfileTask (PROF_TASK_LOOP);
 	    g_flgIRQ = false;	// clear flag to enter EM the next time
 	}
     }
@@ -488,21 +602,21 @@ static void cmuSetup(void)
  * @brief	Print string to serial console
  *
  * This routine is used to print text to the serial console, i.e. LEUART.
+ * The text is formatted directly into the transmit FIFO of the LEUART.
  *
  * @param[in] frmt
- *	Format string of the text to print - same as for printf().
+ *	Format string of the text to print, see drvLEUART_vprintf() for the
+ *	supported conversions.
  *
- * @see		drvLEUART_puts()
+ * @see		drvLEUART_vprintf()
  *
  ******************************************************************************/
 void ConsolePrintf (const char *frmt, ...)
 {
-char	 buffer[120];
 va_list	 args;
 
 
     va_start (args, frmt);
-    vsprintf (buffer, frmt, args);
-    drvLEUART_puts (buffer);
+    drvLEUART_vprintf (frmt, args);
     va_end (args);
 }
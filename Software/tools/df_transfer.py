@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Back up or restore the data flash of a bq40z50 through the HRD.
+
+The backup sends the console command "dfbackup", collects the chunks of the
+TLM_TYPE_DFLASH frames, and writes them to an image file.  The restore sends
+"dfrestore" and the image in chunks, with up to WINDOW chunks in flight, and
+repeats chunks which were not acknowledged.  The formats are described in
+drivers/DataFlash.c.  To compare the throughput, run the transfer at several
+SMBus clock rates, the HRD reports the bytes per second at the end.
+
+Usage:
+    df_transfer.py /dev/ttyUSB0 backup df.bin [--khz 100]   (requires pyserial)
+    df_transfer.py /dev/ttyUSB0 restore df.bin [--khz 100]
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from tlm_decode import Decoder, crc16
+
+SYNC = 0x5A
+TYPE_DFLASH = 8
+START_ADDR = 0x4000
+END_ADDR = 0x6000
+ADDR_END = 0xFFFF
+CHUNK_SIZE = 32
+
+WINDOW = 4          # chunks in flight, DF_PIPELINE
+TIMEOUT = 2.0       # seconds until a chunk is repeated
+IDLE_TIMEOUT = 30   # seconds without frames, DF_IDLE_TIMEOUT
+
+STATUS_NAMES = {-1: "nack", -4: "aborted", -10: "timeout",
+                -11: "invalid parameter", -13: "address mismatch",
+                -14: "verify failed"}
+
+
+class DFlashDecoder(Decoder):
+    """Collects the (address, status, data) of TLM_TYPE_DFLASH frames."""
+
+    def __init__(self):
+        super().__init__()
+        self.chunks = []
+
+    def print_frame(self, frame):
+        if frame[2] != TYPE_DFLASH:
+            return              # telemetry of other modules
+        payload = frame[7:-2]
+        addr, status = struct.unpack_from("<Hb", payload)
+        self.chunks.append((addr, status, bytes(payload[3:])))
+
+
+def chunk_frame(addr, data):
+    """Build a restore frame, a frame without data ends the restore."""
+    body = struct.pack("<H", addr) + data
+    head = bytes([len(body)]) + body
+    return bytes([SYNC]) + head + struct.pack("<H", crc16(head))
+
+
+def status_text(status):
+    return STATUS_NAMES.get(status, "error %d" % status)
+
+
+def wait_chunks(port, dec):
+    """Read from the port and return the chunks received so far."""
+    data = port.read(port.in_waiting or 1)
+    if data:
+        dec.feed(data)
+    chunks, dec.chunks = dec.chunks, []
+    return chunks
+
+
+def backup(port, dec, filename):
+    image = bytearray(b"\xff" * (END_ADDR - START_ADDR))
+    errors = 0
+    last = time.time()
+    while True:
+        chunks = wait_chunks(port, dec)
+        if chunks:
+            last = time.time()
+        elif time.time() - last > IDLE_TIMEOUT:
+            sys.exit("no data from the HRD")
+        for addr, status, data in chunks:
+            if addr == ADDR_END:
+                with open(filename, "wb") as out:
+                    out.write(image)
+                return status, errors
+            if status:
+                print("%04X: %s" % (addr, status_text(status)))
+                errors += 1
+                continue
+            image[addr - START_ADDR:addr - START_ADDR + len(data)] = data
+            print("\r%3d%%" % ((addr + len(data) - START_ADDR) * 100
+                               // len(image)), end="", file=sys.stderr)
+
+
+def restore(port, dec, filename):
+    with open(filename, "rb") as inp:
+        image = inp.read()
+    if len(image) != END_ADDR - START_ADDR:
+        sys.exit("%s: image must have %d bytes" % (filename,
+                                                   END_ADDR - START_ADDR))
+    todo = list(range(START_ADDR, END_ADDR, CHUNK_SIZE))
+    pending = {}                # addr -> send time
+    errors = 0
+    while todo or pending:
+        # Keep the window of chunks in flight filled
+        while todo and len(pending) < WINDOW:
+            addr = todo.pop(0)
+            offs = addr - START_ADDR
+            port.write(chunk_frame(addr, image[offs:offs + CHUNK_SIZE]))
+            pending[addr] = time.time()
+
+        for addr, status, _ in wait_chunks(port, dec):
+            if addr == ADDR_END:
+                sys.exit("restore aborted: %s" % status_text(status))
+            if addr not in pending:
+                continue        # late answer to a repeated chunk
+            del pending[addr]
+            if status:
+                print("%04X: %s" % (addr, status_text(status)))
+                errors += 1
+            print("\r%3d%%" % ((addr + CHUNK_SIZE - START_ADDR) * 100
+                               // len(image)), end="", file=sys.stderr)
+
+        for addr, sent in list(pending.items()):
+            if time.time() - sent > TIMEOUT:
+                # lost frame, repeat it behind the others
+                del pending[addr]
+                todo.insert(0, addr)
+
+    port.write(chunk_frame(ADDR_END, b""))
+    while True:
+        for addr, status, _ in wait_chunks(port, dec):
+            if addr == ADDR_END:
+                return status, errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port")
+    parser.add_argument("action", choices=("backup", "restore"))
+    parser.add_argument("image", help="image file")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--khz", type=int, help="SMBus clock rate, 10..100")
+    args = parser.parse_args()
+
+    import serial  # pyserial
+    with serial.Serial(args.port, args.baud, timeout=0.05) as port:
+        port.write(b"\nmode bin\n")
+        time.sleep(0.5)
+        port.reset_input_buffer()
+        cmd = "df" + args.action
+        if args.khz:
+            cmd += " %d" % args.khz
+        port.write(cmd.encode() + b"\n")
+
+        dec = DFlashDecoder()
+        start = time.time()
+        if args.action == "backup":
+            status, errors = backup(port, dec, args.image)
+        else:
+            status, errors = restore(port, dec, args.image)
+        elapsed = time.time() - start
+        time.sleep(0.5)
+        report = port.read(port.in_waiting).decode("ascii", "replace")
+
+    print(file=sys.stderr)
+    for line in report.splitlines():
+        if line.startswith("DF "):
+            print(line)         # statistics of the HRD
+    print("%s %s in %.1fs, %d failed chunks, %d CRC errors"
+          % (args.action, "done" if status == 0 else status_text(status),
+             elapsed, errors, dec.crc_errors), file=sys.stderr)
+    sys.exit(0 if status == 0 else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""Verify and decrypt an encrypted export of the HRD.
+
+The export is started with the console command "export", see
+drivers/Export.c.  The TLM_TYPE_EXPORT frames are read from a capture file
+or a serial port, the data is decrypted with key K1, and the AES-CMAC over
+header and data is checked with key K2.  Any modification of the export
+makes the check fail.
+
+The keys are generated with --genkey.  The key file is also the image for
+the user data page (0x0FE00000), it has to be programmed into the HRD once,
+e.g. with the J-Link Commander: "loadbin keys.bin 0x0FE00000".
+
+Usage:
+    export_verify.py --genkey keys.bin
+    export_verify.py capture.bin --key keys.bin -o df.bin
+    export_verify.py /dev/ttyUSB0 --key keys.bin -o df.bin --start df
+    export_verify.py /dev/ttyUSB0 --key keys.bin -o log.bin --start log
+                                                        (requires pyserial)
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+from tlm_decode import Decoder
+
+TYPE_EXPORT = 9
+KEY_MAGIC = b"HRDK"
+HDR_MAGIC = b"HRDX"
+SOURCES = {1: "df", 2: "log"}
+STATUS_NAMES = {-4: "aborted", -10: "timeout", -11: "invalid parameter",
+                -13: "address mismatch", -15: "no export key",
+                -17: "source changed during the export, export again"}
+
+SBOX = bytes.fromhex(
+    "637c777bf26b6fc53001672bfed7ab76ca82c97dfa5947f0add4a2af9ca472c0"
+    "b7fd9326363ff7cc34a5e5f171d8311504c723c31896059a071280e2eb27b275"
+    "09832c1a1b6e5aa0523bd6b329e32f8453d100ed20fcb15b6acbbe394a4c58cf"
+    "d0efaafb434d338545f9027f503c9fa851a3408f929d38f5bcb6da2110fff3d2"
+    "cd0c13ec5f974417c4a77e3d645d197360814fdc222a908846eeb814de5e0bdb"
+    "e0323a0a4906245cc2d3ac629195e479e7c8376d8dd54ea96c56f4ea657aae08"
+    "ba78252e1ca6b4c6e8dd741f4bbd8b8a703eb5664803f60e613557b986c11d9e"
+    "e1f8981169d98e949b1e87e9ce5528df8ca1890dbfe6426841992d0fb054bb16")
+
+
+def xtime(a):
+    return ((a << 1) ^ (0x1B if a & 0x80 else 0)) & 0xFF
+
+
+class AES128:
+    """Encryption only, which is all CTR and CMAC need."""
+
+    def __init__(self, key):
+        rk = bytearray(key)
+        rcon = 1
+        while len(rk) < 176:
+            t = rk[-4:]
+            if len(rk) % 16 == 0:
+                t = bytearray([SBOX[t[1]] ^ rcon, SBOX[t[2]], SBOX[t[3]],
+                               SBOX[t[0]]])
+                rcon = xtime(rcon)
+            rk += bytes(a ^ b for a, b in zip(rk[-16:-12], t))
+        self.rk = bytes(rk)
+
+    def encrypt(self, block):
+        s = [b ^ k for b, k in zip(block, self.rk)]
+        for rnd in range(1, 11):
+            s = [SBOX[s[(i + 4 * (i % 4)) % 16]] for i in range(16)]
+            if rnd < 10:
+                m = []
+                for c in range(0, 16, 4):
+                    a = s[c:c + 4]
+                    t = a[0] ^ a[1] ^ a[2] ^ a[3]
+                    m += [a[i] ^ t ^ xtime(a[i] ^ a[(i + 1) % 4])
+                          for i in range(4)]
+                s = m
+            s = [b ^ k for b, k in zip(s, self.rk[16 * rnd:16 * rnd + 16])]
+        return bytes(s)
+
+
+def xor(a, b):
+    return bytes(x ^ y for x, y in zip(a, b))
+
+
+def cmac(aes, data):
+    """AES-CMAC, RFC 4493."""
+    def shift(k):
+        v = (int.from_bytes(k, "big") << 1) & ((1 << 128) - 1)
+        return (v ^ (0x87 if k[0] & 0x80 else 0)).to_bytes(16, "big")
+    k1 = shift(aes.encrypt(bytes(16)))
+    k2 = shift(k1)
+    blocks = [data[i:i + 16] for i in range(0, len(data), 16)] or [b""]
+    last = blocks.pop()
+    if len(last) == 16:
+        last = xor(last, k1)
+    else:
+        last = xor(last + b"\x80" + bytes(15 - len(last)), k2)
+    x = bytes(16)
+    for block in blocks + [last]:
+        x = aes.encrypt(xor(x, block))
+    return x
+
+
+def ctr(aes, counter, data):
+    """CTR mode, the last 32 bits of the counter are incremented."""
+    counter = bytearray(counter)
+    out = bytearray()
+    for i in range(0, len(data), 16):
+        out += xor(data[i:i + 16], aes.encrypt(bytes(counter)))
+        low = (int.from_bytes(counter[12:], "big") + 1) & 0xFFFFFFFF
+        counter[12:] = low.to_bytes(4, "big")
+    return bytes(out)
+
+
+class ExportDecoder(Decoder):
+    """Collects the TLM_TYPE_EXPORT frames."""
+
+    def __init__(self):
+        super().__init__()
+        self.header = self.mac = self.status = None
+        self.chunks = {}        # offset -> encrypted data
+
+    def print_frame(self, frame):
+        if frame[2] != TYPE_EXPORT:
+            return              # telemetry of other modules
+        payload = frame[7:-2]
+        kind = payload[:1]
+        if kind == b"H":
+            self.header, self.mac = payload[1:33], payload[33:49]
+        elif kind == b"D":
+            offs, = struct.unpack_from("<I", payload, 1)
+            self.chunks[offs] = payload[5:]
+        elif kind == b"E":
+            self.status, = struct.unpack_from("<b", payload, 1)
+
+
+def verify(dec, key):
+    """Decrypt and check the export, returns the plaintext."""
+    if dec.status is None:
+        sys.exit("export incomplete, no end frame")
+    if dec.status:
+        sys.exit("export failed: %s" % STATUS_NAMES.get(dec.status,
+                                                         dec.status))
+    if dec.header is None or dec.header[:4] != HDR_MAGIC:
+        sys.exit("no export header")
+    _, version, source, length, stamp, uid = struct.unpack_from(
+        "<4sBB2xIIQ", dec.header)
+    cipher = bytearray()
+    for offs in sorted(dec.chunks):
+        if offs != len(cipher):
+            sys.exit("data missing at offset %d" % offs)
+        cipher += dec.chunks[offs]
+    if len(cipher) != length:
+        sys.exit("data incomplete: %d of %d bytes" % (len(cipher), length))
+
+    counter = bytearray(dec.mac)
+    counter[12] &= 0x7F
+    plain = ctr(AES128(key[:16]), counter, bytes(cipher))
+    if cmac(AES128(key[16:]), dec.header + plain) != dec.mac:
+        sys.exit("VERIFICATION FAILED: the export has been modified, or "
+                 "the key is wrong")
+    print("export OK: version %d, source %s, %d bytes, %s, device %016X"
+          % (version, SOURCES.get(source, source), length,
+             time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(stamp)), uid),
+          file=sys.stderr)
+    return plain
+
+
+def read_key(filename):
+    with open(filename, "rb") as inp:
+        data = inp.read()
+    if len(data) < 36 or data[:4] != KEY_MAGIC:
+        sys.exit("%s: not a key file" % filename)
+    return data[4:36]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", nargs="?",
+                        help="capture file or serial port")
+    parser.add_argument("--genkey", metavar="FILE",
+                        help="generate a new key file")
+    parser.add_argument("--key", help="key file")
+    parser.add_argument("-o", "--output", help="write decrypted data")
+    parser.add_argument("--start", metavar="SOURCE", choices=("df", "log"),
+                        help="send the export command first")
+    parser.add_argument("--baud", type=int, default=9600)
+    args = parser.parse_args()
+
+    if args.genkey:
+        with open(args.genkey, "wb") as out:
+            out.write(KEY_MAGIC + os.urandom(32))
+        return
+    if not args.source or not args.key:
+        parser.error("source and --key are required")
+    key = read_key(args.key)
+
+    dec = ExportDecoder()
+    if os.path.isfile(args.source):
+        with open(args.source, "rb") as inp:
+            dec.feed(inp.read())
+    else:
+        import serial  # pyserial
+        with serial.Serial(args.source, args.baud, timeout=0.5) as port:
+            if args.start:
+                port.write(b"\nexport %s\n" % args.start.encode())
+            while dec.status is None:
+                dec.feed(port.read(port.in_waiting or 1))
+
+    plain = verify(dec, key)
+    if args.output:
+        with open(args.output, "wb") as out:
+            out.write(plain)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,344 @@
+#!/usr/bin/env python3
+"""Simulate the pack history index of the HRD with simulated packs.
+
+The model follows drivers/History.c: the identity key (FNV-1a), the hash
+table with linear probing in one flash page, the compaction into the other
+page, and the rebuild from the log.  The log is the model of log_sim.py.
+
+A set of packs is connected and removed again in random order, some of
+them more often than others.  Each session appends snapshots to the log,
+so the log wraps around and old sessions are overwritten.  Two of the
+packs have different identities, but the same key.  Between the sessions
+the index is damaged now and then, i.e. both pages are erased, or a bit of
+the header of one or both pages is cleared.  The power is lost while a
+slot or a page is written, which also discards the staged log records.
+The index is then initialized again, see HistoryInit().
+
+When a pack is connected, the lookup is compared with the newest session
+of this pack which is still in the log.  The following rules are checked,
+a violation is printed and the exit code is 1:
+- A lookup never returns the session of another pack.
+- The newest session of the pack which is in the log is found, unless the
+  pack has been dropped from the index, because HIST_PACK_MAX other packs
+  have newer sessions.
+- The chain of previous sessions only contains sessions of this pack, in
+  descending order.
+
+This is a model of the firmware, it must be changed together with
+History.c.
+
+Usage:
+    history_sim.py [--sessions 3000] [--packs 40] [--seed 1]
+"""
+
+import argparse
+import random
+import struct
+import sys
+
+from log_sim import Flash, Log, PowerLoss, PAGE_SIZE, PAGE_CNT, DATA_MAX, \
+    ERASED_WORD, crc16
+
+# Definitions of drivers/History.h and History.c
+PAGE_MAGIC = 0x58444948
+PAGE_HDR_SIZE = 16
+SLOT_CNT = (PAGE_SIZE - PAGE_HDR_SIZE) // 8
+PACK_MAX = SLOT_CNT // 2
+NAME_MAX = 22
+SESSION_FMT = "<IIIIHHHHH%ds" % NAME_MAX
+SESSION_SIZE = struct.calcsize(SESSION_FMT)
+TYPE_SNAPSHOT = 2
+TYPE_PACK = 4
+TYPE_CONNECT = 5
+
+
+def identity_key(name, serial, date):
+    value = 2166136261
+    for byte in name[:NAME_MAX] + struct.pack("<HH", serial, date):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value - 1 if value == ERASED_WORD else value
+
+
+# Two identities with the same key, found by a search over the names
+COLLIDING = [(b"P329599", 1234, 0x4321), (b"P532382", 1234, 0x4321)]
+
+
+class History:
+    """History.c, without the SMBus part."""
+
+    def __init__(self, flash):
+        self.flash = flash
+        self.gen = 0
+        self.rebuilds = 0
+        self.page = -1
+        self.used = 0
+
+    def slot(self, page, i):
+        return struct.unpack_from("<II", self.flash.mem,
+                                  page * PAGE_SIZE + PAGE_HDR_SIZE + i * 8)
+
+    # HistoryInit()
+
+    def init(self, log):
+        self.log = log
+        self.page = -1
+        damaged = False
+        for page in range(2):
+            raw = bytes(self.flash.mem[page * PAGE_SIZE:
+                                       page * PAGE_SIZE + PAGE_HDR_SIZE])
+            magic, gen, cnt, crc = struct.unpack("<4I", raw)
+            if magic == PAGE_MAGIC and cnt == SLOT_CNT \
+                    and crc == crc16(raw[:12]):
+                if self.page < 0 or gen > self.gen:
+                    self.page = page
+                    self.gen = gen
+            elif magic != ERASED_WORD:
+                damaged = True
+        if self.page < 0 or damaged:
+            self.rebuild()
+            return
+        self.used = sum(1 for i in range(SLOT_CNT)
+                        if self.slot(self.page, i)[0] != ERASED_WORD)
+
+    # HistoryClose()
+
+    def close(self, session):
+        seq = self.log.next_seq
+        if self.log.append(TYPE_PACK, session):
+            self.insert(struct.unpack_from("<I", session, 4)[0], seq)
+        self.log.append(TYPE_CONNECT, struct.pack("<I", 0))
+
+    # HistoryLookup(), HistoryRead()
+
+    def lookup(self, ident):
+        if self.page < 0:
+            return 0
+        key = identity_key(*ident)
+        best = 0
+        i = key % SLOT_CNT
+        for _ in range(SLOT_CNT):
+            slot_key, seq = self.slot(self.page, i)
+            if slot_key == ERASED_WORD:
+                break
+            if slot_key == key and seq != ERASED_WORD and seq > best:
+                session = self.read(seq)
+                if session and session_ident(session) == ident:
+                    best = seq
+            i = (i + 1) % SLOT_CNT
+        return best
+
+    def read(self, seq):
+        record = self.log.find(seq) if seq else None
+        if not record or record[1] != TYPE_PACK \
+                or len(record[3]) != SESSION_SIZE:
+            return None
+        return struct.unpack(SESSION_FMT, record[3])
+
+    # HistoryRebuild()
+
+    def rebuild(self):
+        self.tab = []
+        for seq, rtype, _, data in self.log.read_all():
+            if rtype == TYPE_PACK and len(data) == SESSION_SIZE:
+                self.tab_add(struct.unpack(SESSION_FMT, data), seq)
+        self.rebuilds += 1
+        self.page_write()
+
+    # IndexInsert(), PageWrite(), SlotWrite(), TabAdd()
+
+    def insert(self, key, seq):
+        ok = True
+        if self.page < 0 or self.used >= SLOT_CNT - 1:
+            self.tab = []
+            for i in range(SLOT_CNT if self.page >= 0 else 0):
+                slot_key, slot_seq = self.slot(self.page, i)
+                session = self.read(slot_seq)
+                if slot_key != ERASED_WORD and session \
+                        and session[1] == slot_key:
+                    self.tab_add(session, slot_seq)
+            ok = self.page_write()
+        if ok and self.slot_write(self.page, key, seq):
+            self.used += 1
+
+    def page_write(self):
+        page = 0 if self.page < 0 else (self.page + 1) % 2
+        self.flash.erase(page)
+        for key, seq in self.tab:
+            if not self.slot_write(page, key, seq):
+                return False
+        raw = struct.pack("<3I", PAGE_MAGIC, self.gen + 1, SLOT_CNT)
+        raw += struct.pack("<I", crc16(raw))
+        self.flash.write(page * PAGE_SIZE, raw)
+        if bytes(self.flash.mem[page * PAGE_SIZE:
+                                page * PAGE_SIZE + PAGE_HDR_SIZE]) != raw:
+            return False
+        self.page = page
+        self.gen += 1
+        self.used = len(self.tab)
+        return True
+
+    def slot_write(self, page, key, seq):
+        i = key % SLOT_CNT
+        for _ in range(SLOT_CNT):
+            if self.slot(page, i)[0] == ERASED_WORD:
+                self.flash.write(page * PAGE_SIZE + PAGE_HDR_SIZE + i * 8,
+                                 struct.pack("<II", key, seq))
+                return True
+            i = (i + 1) % SLOT_CNT
+        return False
+
+    def tab_add(self, session, seq):
+        oldest = 0
+        for i, entry in enumerate(self.tab):
+            other = self.read(entry[1]) if entry[0] == session[1] else None
+            if other and session_ident(other) == session_ident(session):
+                entry[1] = max(entry[1], seq)
+                return
+            if entry[1] < self.tab[oldest][1]:
+                oldest = i
+        if len(self.tab) < PACK_MAX:
+            self.tab.append([session[1], seq])
+        elif seq > self.tab[oldest][1]:
+            self.tab[oldest] = [session[1], seq]
+
+
+def session_ident(session):
+    return (session[9].split(b"\0")[0], session[4], session[5])
+
+
+def newest_sessions(log):
+    """Newest session per identity in the log."""
+    newest = {}
+    for seq, rtype, _, data in log.read_all():
+        if rtype == TYPE_PACK and len(data) == SESSION_SIZE:
+            ident = session_ident(struct.unpack(SESSION_FMT, data))
+            newest[ident] = max(newest.get(ident, 0), seq)
+    return newest
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--sessions", type=int, default=3000,
+                        help="number of sessions")
+    parser.add_argument("--packs", type=int, default=40,
+                        help="number of packs, two more have the same key")
+    parser.add_argument("--log-pages", type=int, default=PAGE_CNT,
+                        help="number of pages of the log")
+    parser.add_argument("--seed", type=int, default=1,
+                        help="seed of the random numbers")
+    args = parser.parse_args()
+
+    rand = random.Random(args.seed)
+    packs = [(b"SIM%02d" % (i % 7), rand.getrandbits(16),
+              rand.getrandbits(16)) for i in range(args.packs)]
+    assert identity_key(*COLLIDING[0]) == identity_key(*COLLIDING[1])
+    packs += COLLIDING
+    weights = [1.0 / (i + 1) for i in range(len(packs))]
+    weights[-1] = weights[-2] = weights[0]
+
+    log_flash = Flash(args.log_pages, rand)
+    idx_flash = Flash(2, rand)
+    log = Log(log_flash)
+    log.mount()
+    hist = History(idx_flash)
+    hist.init(log)
+
+    ever = {}                   # identity: newest session ever committed
+    stats = {"found": 0, "dropped": 0, "losses": 0, "damaged": 0}
+    errors = []
+
+    for n in range(args.sessions):
+        log.flush()
+        for record, _, _ in log.committed.values():
+            if record[1] == TYPE_PACK:
+                ident = session_ident(struct.unpack(SESSION_FMT, record[3]))
+                ever[ident] = max(ever.get(ident, 0), record[0])
+        log.committed.clear()
+
+        # Damage the index now and then
+        if rand.random() < 0.02:
+            stats["damaged"] += 1
+            if rand.random() < 0.3:
+                idx_flash.mem[:] = b"\xFF" * len(idx_flash.mem)
+            for page in range(2):
+                if rand.random() < 0.5:
+                    # Clear a bit of the header
+                    addr = page * PAGE_SIZE + rand.randrange(0, 16, 4)
+                    word = idx_flash.word(addr)
+                    if word:
+                        bits = [b for b in range(32) if word >> b & 1]
+                        idx_flash.program(addr,
+                                          ~(1 << rand.choice(bits)))
+            hist.init(log)
+
+        # Connect a pack, SessionOpen()
+        ident = rand.choices(packs, weights)[0]
+        expected = newest_sessions(log).get(ident, 0)
+        prev = hist.lookup(ident)
+        session = hist.read(prev)
+        if prev == expected:
+            stats["found"] += 1 if prev else 0
+        elif prev != 0 and (not session or session_ident(session) != ident):
+            errors.append("session %d: lookup of %r returned %d"
+                          % (n, ident, prev))
+        elif prev != 0:
+            errors.append("session %d: lookup of %r returned %d, not %d"
+                          % (n, ident, prev, expected))
+        elif sum(1 for seq in ever.values() if seq > expected) < PACK_MAX:
+            errors.append("session %d: session %d of %r not found"
+                          % (n, expected, ident))
+        else:
+            stats["dropped"] += 1
+
+        seq = prev
+        while seq:
+            session = hist.read(seq)
+            if not session:
+                break
+            if session_ident(session) != ident or session[0] >= seq:
+                errors.append("session %d: chain of %r broken at %d"
+                              % (n, ident, seq))
+                break
+            seq = session[0]
+
+        # The session with some snapshots
+        key = identity_key(*ident)
+        log.append(TYPE_CONNECT, struct.pack("<I", key))
+        for _ in range(rand.randint(1, 6)):
+            log.append(TYPE_SNAPSHOT,
+                       bytes(rand.getrandbits(8)
+                             for _ in range(rand.randint(20, DATA_MAX))))
+            log.flush()
+        session = struct.pack(SESSION_FMT, prev, key, n, n + 1, ident[1],
+                              ident[2], n // 10, 100 - n // 100, 3000,
+                              ident[0])
+
+        # Remove it, the power may fail while the index is written
+        if rand.random() < 0.05:
+            idx_flash.ops_left = rand.randint(1, 80)
+        try:
+            hist.close(session)
+        except PowerLoss:
+            stats["losses"] += 1
+            idx_flash.ops_left = None
+            log = Log(log_flash)
+            log.mount()
+            hist.init(log)
+        idx_flash.ops_left = None
+
+        if len(errors) >= 20:
+            break
+
+    print("%d sessions, %d packs: %d found, %d dropped from the index"
+          % (n + 1, len(packs), stats["found"], stats["dropped"]))
+    print("index damaged %d times, %d power losses, generation %d, "
+          "%d rebuilds" % (stats["damaged"], stats["losses"], hist.gen,
+                           hist.rebuilds))
+    for line in errors:
+        print("error: " + line)
+    print("ok" if not errors else "FAILED")
+    sys.exit(0 if not errors else 1)
+
+
+if __name__ == "__main__":
+    main()
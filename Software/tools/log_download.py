@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Download the flash image of the HRD session log, resumable.
+
+The console command "download <first> <count>" sends the blocks of the log
+in TLM_TYPE_DOWNLOAD frames, each with its CRC-32, see drivers/Download.c.
+Each received block is acknowledged, the HRD repeats the blocks which are
+missing.  The received blocks are written to the image file at once, and
+the list of them to a state file, so an interrupted download continues with
+the missing blocks when the tool is started again.
+
+The log may be written while it is downloaded.  The header of each download
+contains the head page and the sequence number of the next record, the
+pages written since the previous download are fetched again.  Running the
+tool on a complete image updates it in the same way.
+
+The image can be read by series_bench.py --log.
+
+Usage:
+    log_download.py /dev/ttyUSB0 log.bin [--baud 9600]   (requires pyserial)
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import time
+import zlib
+
+from tlm_decode import Decoder, crc16
+
+SYNC = 0x5A
+TYPE_DOWNLOAD = 11
+PAGE_SIZE = 512                 # FLASH_PAGE_SIZE
+IDLE_TIMEOUT = 30               # seconds without frames, DL_IDLE_TIMEOUT
+START_TIMEOUT = 5               # seconds until the header must be there
+ACK_INTERVAL = 1.0              # seconds until an acknowledgement is repeated
+MAX_RUNS = 16                   # downloads per call, the log may be written
+
+STATUS_NAMES = {-10: "invalid parameter", -13: "busy", -14: "timeout",
+                -15: "aborted"}
+
+
+class DownloadDecoder(Decoder):
+    """Collects the header, the blocks, and the end of a download."""
+
+    def __init__(self):
+        super().__init__()
+        self.header = None      # (block_size, block_cnt, first, end, head,
+                                #  next_seq)
+        self.blocks = []        # (block, data) with a valid CRC-32
+        self.bad_blocks = 0
+        self.end = None         # (status, sent, repeated)
+
+    def print_frame(self, frame):
+        if frame[2] != TYPE_DOWNLOAD:
+            return              # telemetry of other modules
+        payload = frame[7:-2]
+        kind = payload[0:1]
+        if kind == b"H":
+            self.header = struct.unpack_from("<HHHHHI", payload, 1)
+        elif kind == b"D":
+            block, crc = struct.unpack_from("<HI", payload, 1)
+            data = bytes(payload[7:])
+            if zlib.crc32(data) == crc:
+                self.blocks.append((block, data))
+            else:
+                self.bad_blocks += 1
+        elif kind == b"E":
+            self.end = struct.unpack_from("<bHH", payload, 1)
+
+
+def ack_frame(base, received):
+    """Acknowledge all blocks below base, and those of the set above it."""
+    mask = 0
+    for i in range(32):
+        if base + 1 + i in received:
+            mask |= 1 << i
+    head = bytes([7]) + struct.pack("<cHI", b"A", base, mask)
+    return bytes([SYNC]) + head + struct.pack("<H", crc16(head))
+
+
+def abort_frame():
+    head = bytes([7]) + struct.pack("<cHI", b"X", 0, 0)
+    return bytes([SYNC]) + head + struct.pack("<H", crc16(head))
+
+
+def status_text(status):
+    return STATUS_NAMES.get(status, "error %d" % status)
+
+
+class State:
+    """Blocks received so far, and the log position of the last download."""
+
+    def __init__(self, filename):
+        self.filename = filename
+        self.block_size = self.block_cnt = None
+        self.head = self.next_seq = None
+        self.received = set()
+        if os.path.isfile(filename):
+            with open(filename) as f:
+                state = json.load(f)
+            self.block_size = state["block_size"]
+            self.block_cnt = state["block_cnt"]
+            self.head = state["head"]
+            self.next_seq = state["next_seq"]
+            self.received = set(state["received"])
+
+    def save(self):
+        with open(self.filename + ".tmp", "w") as f:
+            json.dump({"block_size": self.block_size,
+                       "block_cnt": self.block_cnt, "head": self.head,
+                       "next_seq": self.next_seq,
+                       "received": sorted(self.received)}, f)
+        os.replace(self.filename + ".tmp", self.filename)
+
+    def update(self, block_size, block_cnt, head, next_seq):
+        """Forget the blocks of the pages written since the last download."""
+        if (block_size, block_cnt) != (self.block_size, self.block_cnt):
+            self.received.clear()       # other firmware, start over
+        elif next_seq != self.next_seq:
+            per_page = PAGE_SIZE // block_size
+            page_cnt = block_cnt // per_page
+            # Each page holds at least one record
+            written = min(next_seq - self.next_seq + 1, page_cnt)
+            if next_seq < self.next_seq:
+                written = page_cnt      # log erased
+            page = self.head
+            changed = {page}
+            while page != head and len(changed) < written:
+                page = (page + 1) % page_cnt
+                changed.add(page)
+            if page != head:
+                changed = set(range(page_cnt))
+            self.received -= {b for b in self.received
+                              if b // per_page in changed}
+        self.block_size, self.block_cnt = block_size, block_cnt
+        self.head, self.next_seq = head, next_seq
+
+    def missing_runs(self):
+        """Return the (first, count) ranges of blocks still missing."""
+        runs = []
+        block = 0
+        while block < self.block_cnt:
+            if block in self.received:
+                block += 1
+                continue
+            first = block
+            while block < self.block_cnt and block not in self.received:
+                block += 1
+            runs.append((first, block - first))
+        return runs
+
+
+def download(port, dec, state, image, first, cnt):
+    """Run one download of cnt blocks, return the status of the HRD."""
+    port.write(b"\ndownload %d %d\n" % (first, cnt))
+    got = set()
+    base = first
+    started = False
+    last_rx = last_ack = time.time()
+    while dec.end is None:
+        data = port.read(port.in_waiting or 1)
+        now = time.time()
+        if data:
+            dec.feed(data)
+            last_rx = now
+        if dec.header is not None:
+            block_size, block_cnt, first, end, head, next_seq = dec.header
+            state.update(block_size, block_cnt, head, next_seq)
+            dec.header = None
+            state.save()
+            base, cnt = first, end - first
+            started = True
+        if dec.blocks:
+            for block, data in dec.blocks:
+                image.seek(block * state.block_size)
+                image.write(data)
+                got.add(block)
+                state.received.add(block)
+            dec.blocks = []
+            state.save()
+            while base in got:
+                base += 1
+            port.write(ack_frame(base, got))
+            last_ack = now
+            print("\r%d of %d blocks" % (base - first, cnt), end="",
+                  file=sys.stderr)
+        elif got and now - last_ack > ACK_INTERVAL:
+            port.write(ack_frame(base, got))   # the last one may be lost
+            last_ack = now
+        if not started and now - last_rx > START_TIMEOUT:
+            return -10          # the HRD did not accept the command
+        if now - last_rx > IDLE_TIMEOUT:
+            port.write(abort_frame())
+            return -14
+    image.flush()
+    state.save()
+    status, dec.end = dec.end[0], None
+    return status
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port")
+    parser.add_argument("image", help="image file")
+    parser.add_argument("--state", help="state file, default <image>.state")
+    parser.add_argument("--baud", type=int, default=9600)
+    args = parser.parse_args()
+
+    state = State(args.state or args.image + ".state")
+    if not os.path.isfile(args.image):
+        state.received.clear()
+        open(args.image, "wb").close()
+
+    import serial  # pyserial
+    dec = DownloadDecoder()
+    start = time.time()
+    status = 0
+    with serial.Serial(args.port, args.baud, timeout=0.05) as port, \
+            open(args.image, "r+b") as image:
+        port.write(b"\n")
+        time.sleep(0.5)
+        port.reset_input_buffer()
+        if state.block_cnt is None:
+            runs = [(0, 0)]                 # whole log
+        else:
+            runs = state.missing_runs()
+            if not runs:                    # update, see what was written
+                per_page = PAGE_SIZE // state.block_size
+                runs = [(state.head * per_page, per_page)]
+        for _ in range(MAX_RUNS):
+            if not runs or status != 0:
+                break
+            status = download(port, dec, state, image, *runs[0])
+            runs = state.missing_runs()
+        if state.block_cnt is not None:
+            image.truncate(state.block_cnt * state.block_size)
+        time.sleep(0.5)
+        report = port.read(port.in_waiting).decode("ascii", "replace")
+
+    print(file=sys.stderr)
+    for line in report.splitlines():
+        if line.startswith("Download "):
+            print(line)             # statistics of the HRD
+    if status == 0 and runs:
+        print("log written too often, run again for the missing blocks",
+              file=sys.stderr)
+    print("download %s in %.1fs, %d of %d blocks, %d bad blocks, "
+          "%d CRC errors"
+          % ("done" if status == 0 else status_text(status),
+             time.time() - start, len(state.received), state.block_cnt or 0,
+             dec.bad_blocks, dec.crc_errors), file=sys.stderr)
+    sys.exit(0 if status == 0 and not runs else 1)
+
+
+if __name__ == "__main__":
+    main()
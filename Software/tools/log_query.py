@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Receive the records of a time range of the HRD session log.
+
+The query is started with the console command "log query <minutes> [<key>]"
+in binary mode, see drivers/Console.c.  The TLM_TYPE_LOG frames are read
+from a capture file or a serial port and put together to records again.
+The records are listed, the samples of the series records can be written
+as CSV, see series_bench.py.  Only the pages of the time range are sent, the
+start is found by the time index in the page headers, see drivers/Log.c.
+
+Usage:
+    log_query.py capture.bin [--csv out.csv]
+    log_query.py /dev/ttyUSB0 --minutes 30 [--key 1A2B3C4D] [--csv out.csv]
+                                                        (requires pyserial)
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+import time
+
+from tlm_decode import Decoder
+from series_bench import REC_HDR_SIZE, TYPE_SERIES, decode_block
+
+TYPE_LOG = 10
+QUERY_END = 0xFF
+TYPE_NAMES = {1: "session", 2: "snapshot", 3: "series", 4: "pack",
+              5: "connect"}
+
+
+class QueryDecoder(Decoder):
+    """Collects the records of the TLM_TYPE_LOG frames."""
+
+    def __init__(self):
+        super().__init__()
+        self.records = []       # (seq, time, type, data)
+        self.partial = bytearray()
+        self.sent = None        # number of records, from the end frame
+        self.lost = 0
+
+    def print_frame(self, frame):
+        if frame[2] != TYPE_LOG:
+            return              # telemetry of other modules
+        payload = frame[7:-2]
+        offs = payload[0]
+        if offs == QUERY_END:
+            self.sent, = struct.unpack_from("<I", payload, 1)
+            return
+        if offs != len(self.partial):
+            self.lost += 1      # frame missing, drop the record
+            self.partial = bytearray()
+            if offs:
+                return
+        self.partial += payload[1:]
+        if len(self.partial) < REC_HDR_SIZE:
+            return
+        length, rec_type, _, seq, stamp = struct.unpack_from(
+            "<HBBII", self.partial)
+        if len(self.partial) >= REC_HDR_SIZE + length:
+            self.records.append((seq, stamp, rec_type,
+                                 bytes(self.partial[REC_HDR_SIZE:])))
+            self.partial = bytearray()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="capture file or serial port")
+    parser.add_argument("--minutes", type=int,
+                        help="send the query command first")
+    parser.add_argument("--key", default="",
+                        help="pack key in hex or \"all\", default is the "
+                        "connected pack")
+    parser.add_argument("--csv", help="write the series samples as CSV")
+    parser.add_argument("--baud", type=int, default=9600)
+    args = parser.parse_args()
+
+    dec = QueryDecoder()
+    if os.path.isfile(args.source):
+        with open(args.source, "rb") as inp:
+            dec.feed(inp.read())
+    else:
+        import serial  # pyserial
+        with serial.Serial(args.source, args.baud, timeout=0.5) as port:
+            if args.minutes is not None:
+                port.write(b"\nmode bin\nlog query %d %s\n"
+                           % (args.minutes, args.key.encode()))
+            while dec.sent is None:
+                dec.feed(port.read(port.in_waiting or 1))
+
+    samples = []
+    for seq, stamp, rec_type, data in dec.records:
+        print("#%d %s %-8s %d bytes"
+              % (seq, time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(stamp)),
+                 TYPE_NAMES.get(rec_type, "?"), len(data)))
+        if rec_type == TYPE_SERIES:
+            samples += decode_block(data)
+    if dec.sent is None:
+        print("query incomplete, no end frame", file=sys.stderr)
+    elif dec.sent != len(dec.records) or dec.lost:
+        print("%d of %d records received" % (len(dec.records), dec.sent),
+              file=sys.stderr)
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            out = csv.writer(f)
+            out.writerow(["time", "voltage", "current", "temperature",
+                          "rsoc", "status"])
+            for stamp, values in samples:
+                out.writerow([stamp] + list(values))
+    sys.exit(0 if dec.sent == len(dec.records) else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,499 @@
+#!/usr/bin/env python3
+"""Simulate power losses while the HRD writes its session log.
+
+The model follows drivers/Log.c: page headers with sequence number, erase
+count and CRC, records with a CRC word which is written last, the staging
+buffers, the write steps of LogCheck(), the erase ahead in idle windows,
+and the mount at LogInit().  The flash is simulated with single word
+writes and page erases, a bit can only be programmed from 1 to 0.
+
+Each run mounts the log, appends records of random types and sizes, and
+calls LogCheck() or LogFlush() like the main loop, until the power is lost
+at a random flash operation.  The word which is being written is left
+partially programmed, an erase which is interrupted leaves a mix of old,
+erased and weak words.  Then the log is mounted again and read, and the
+following rules are checked, a violation is printed and the exit code is
+1:
+- Every record which had been committed, i.e. whose CRC word had been
+  written and verified, is read back, unless its page has been erased
+  meanwhile to be reused.
+- No other data is returned, i.e. every record read has been appended
+  with this sequence number and contents.
+- The sequence numbers are ascending.
+
+The flash persists across the runs, so the log wraps around many times.
+At the end, the erase counts of the pages are shown.  This is a model of
+the firmware, it must be changed together with Log.c.
+
+Usage:
+    log_sim.py [--runs 3000] [--pages 64] [--seed 1]
+"""
+
+import argparse
+import binascii
+import random
+import struct
+import sys
+
+# Definitions of drivers/Log.h and Log.c
+PAGE_SIZE = 512
+PAGE_CNT = 64                   # 0x18000 up to the end of 128 KB
+PAGE_MAGIC = 0x32474C48
+PAGE_HDR_SIZE = 28
+REC_HDR_SIZE = 12
+STAGE_SIZE = 256
+DATA_MAX = STAGE_SIZE - REC_HDR_SIZE - 4
+WRITE_WORDS = 8
+ERASE_AHEAD_LIMIT = STAGE_SIZE
+ERASED_WORD = 0xFFFFFFFF
+TYPE_SESSION = 1
+TYPE_CONNECT = 5
+
+
+def crc16(data):
+    """Same as crc16() of tlm_decode.py, but fast."""
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+def rec_size(length):
+    return REC_HDR_SIZE + ((length + 3) & ~3) + 4
+
+
+class PowerLoss(Exception):
+    pass
+
+
+class Flash:
+    """Internal flash of the log, with power loss at a given operation."""
+
+    def __init__(self, pages, rand):
+        self.pages = pages
+        self.mem = bytearray(b"\xFF" * pages * PAGE_SIZE)
+        self.rand = rand
+        self.ops_left = None    # no power loss
+        self.erases = [0] * pages
+        self.started = [0] * pages  # erases started, also interrupted ones
+
+    def word(self, addr):
+        return struct.unpack_from("<I", self.mem, addr)[0]
+
+    def tick(self):
+        if self.ops_left is not None:
+            self.ops_left -= 1
+            if self.ops_left <= 0:
+                return True
+        return False
+
+    def write(self, addr, data):
+        for i in range(0, len(data), 4):
+            value = struct.unpack_from("<I", data, i)[0]
+            if self.tick():
+                # Power lost while programming: only some bits are 0
+                value |= self.rand.getrandbits(32)
+                self.program(addr + i, value)
+                raise PowerLoss()
+            self.program(addr + i, value)
+
+    def program(self, addr, value):
+        struct.pack_into("<I", self.mem, addr, self.word(addr) & value)
+
+    def erase(self, page):
+        start = page * PAGE_SIZE
+        self.started[page] += 1
+        if self.tick():
+            # Interrupted erase: some words erased, some weak
+            for addr in range(start, start + PAGE_SIZE, 4):
+                choice = self.rand.random()
+                if choice < 0.4:
+                    value = ERASED_WORD
+                elif choice < 0.8:
+                    value = self.word(addr)
+                else:
+                    value = self.word(addr) | self.rand.getrandbits(32)
+                struct.pack_into("<I", self.mem, addr, value)
+            raise PowerLoss()
+        self.mem[start:start + PAGE_SIZE] = b"\xFF" * PAGE_SIZE
+        self.erases[page] += 1
+
+
+class Log:
+    """Log.c, with page indices instead of addresses."""
+
+    def __init__(self, flash):
+        self.flash = flash
+        self.pages = flash.pages
+        self.committed = {}     # seq: (record, page, erases of the page)
+        self.time = 0
+
+    # Page headers and records
+
+    def page_hdr(self, page):
+        raw = bytes(self.flash.mem[page * PAGE_SIZE:
+                                   page * PAGE_SIZE + PAGE_HDR_SIZE])
+        hdr = struct.unpack("<7I", raw)
+        if hdr[0] != PAGE_MAGIC or hdr[6] != crc16(raw[:24]):
+            return None
+        return {"seq": hdr[1], "erase": hdr[2], "rec_seq": hdr[3],
+                "time": hdr[4], "key": hdr[5]}
+
+    def page_is_erased(self, page):
+        start = page * PAGE_SIZE
+        return self.flash.mem[start:start + PAGE_SIZE] == \
+            b"\xFF" * PAGE_SIZE
+
+    def page_end(self, page):
+        return (page + 1) * PAGE_SIZE
+
+    def record_check(self, addr, end):
+        """Return (size, record), size is 0 if erased, -1 if damaged."""
+        if addr + REC_HDR_SIZE + 4 > end \
+                or self.flash.word(addr) == ERASED_WORD:
+            return 0, None
+        length, rtype, _, seq, time = struct.unpack_from(
+            "<HBBII", self.flash.mem, addr)
+        if length > DATA_MAX:
+            return -1, None
+        size = rec_size(length)
+        raw = bytes(self.flash.mem[addr:addr + REC_HDR_SIZE + length])
+        if addr + size > end \
+                or self.flash.word(addr + size - 4) != crc16(raw):
+            return -1, None
+        return size, (seq, rtype, time, raw[REC_HDR_SIZE:])
+
+    @staticmethod
+    def key_track(key, record):
+        seq, rtype, time, data = record
+        if rtype == TYPE_SESSION:
+            return 0
+        if rtype == TYPE_CONNECT and len(data) >= 4:
+            return struct.unpack_from("<I", data)[0]
+        return key
+
+    # LogInit()
+
+    def mount(self):
+        self.stage = [bytearray(), bytearray()]
+        self.fill = 0
+        self.prog = -1
+        self.prog_offs = 0
+        self.rec_done = 0
+        self.retry = 0
+        self.torn = 0
+
+        self.page_seq = 0
+        self.head = self.pages - 1
+        min_erase = ERASED_WORD
+        for page in range(self.pages):
+            hdr = self.page_hdr(page)
+            erase = hdr["erase"] if hdr else 0
+            if hdr and hdr["seq"] > self.page_seq:
+                self.page_seq = hdr["seq"]
+                self.head = page
+            if self.page_seq == 0 and erase < min_erase:
+                min_erase = erase
+                self.head = (page + self.pages - 1) % self.pages
+
+        self.next_seq = 1
+        self.write_addr = 0
+        self.wr_key = 0
+
+        if self.page_seq != 0:
+            hdr = self.page_hdr(self.head)
+            self.next_seq = hdr["rec_seq"]
+            self.wr_key = hdr["key"]
+            addr = self.head * PAGE_SIZE + PAGE_HDR_SIZE
+            end = self.page_end(self.head)
+            while addr < end:
+                size, record = self.record_check(addr, end)
+                if size == 0:
+                    break
+                if size < 0:
+                    self.torn += 1
+                    addr = end
+                    break
+                self.next_seq = record[0] + 1
+                self.wr_key = self.key_track(self.wr_key, record)
+                addr += size
+            self.write_addr = addr
+
+        self.ahead_page = -1
+        page = (self.head + 1) % self.pages
+        if self.page_is_erased(page):
+            self.ahead_page = page
+            self.ahead_erase = 1
+            hdr = self.page_hdr(self.head)
+            if hdr:
+                self.ahead_erase = hdr["erase"]
+
+        return self.append(TYPE_SESSION, b"\x01\x00\x00\x00HRD sim")
+
+    # LogAppend()
+
+    def append(self, rtype, data):
+        size = rec_size(len(data))
+        if len(self.stage[self.fill]) + size > STAGE_SIZE:
+            if self.prog != -1:
+                return None             # logBusy
+            self.prog = self.fill
+            self.prog_offs = 0
+            self.fill ^= 1
+
+        seq = self.next_seq
+        self.next_seq += 1
+        self.time += 1
+        raw = struct.pack("<HBBII", len(data), rtype, 0, seq, self.time) \
+            + data
+        rec = raw + b"\0" * (size - 4 - len(raw)) \
+            + struct.pack("<I", crc16(raw))
+        self.stage[self.fill] += rec
+        return seq, rtype, self.time, bytes(data)
+
+    # LogCheck(), LogFlush()
+
+    def check(self, idle):
+        if self.write_step():
+            return True
+        if idle:
+            self.erase_ahead()
+        return False
+
+    def flush(self):
+        while self.write_step():
+            pass
+
+    def write_step(self):
+        if self.prog == -1:
+            if not self.stage[self.fill]:
+                return False
+            self.prog = self.fill
+            self.prog_offs = 0
+            self.fill ^= 1
+
+        buf = self.stage[self.prog]
+        length = struct.unpack_from("<H", buf, self.prog_offs)[0]
+        size = rec_size(length)
+        rec = buf[self.prog_offs:self.prog_offs + size]
+
+        ok = True
+        if self.rec_done == 0 and (self.page_seq == 0 or self.write_addr
+                                   + size > self.page_end(self.head)):
+            ok = self.page_open(*struct.unpack_from("<II", rec, 4))
+
+        if ok:
+            cnt = min(size - self.rec_done, WRITE_WORDS * 4)
+            self.flash.write(self.write_addr + self.rec_done,
+                             rec[self.rec_done:self.rec_done + cnt])
+            self.rec_done += cnt
+            if self.rec_done == size:
+                check, record = self.record_check(
+                    self.write_addr, self.page_end(self.head))
+                ok = check == size
+
+        if not ok:
+            self.write_addr = self.page_end(self.head)
+            self.rec_done = 0
+            self.retry += 1
+            if self.retry >= 2:
+                self.rec_done = size
+        elif self.rec_done == size:
+            self.committed[record[0]] = (record, self.head,
+                                         self.flash.started[self.head])
+            self.wr_key = self.key_track(self.wr_key, record)
+            self.write_addr += size
+
+        if self.rec_done == size:
+            self.prog_offs += size
+            self.rec_done = 0
+            self.retry = 0
+            if self.prog_offs >= len(buf):
+                self.stage[self.prog] = bytearray()
+                self.prog = -1
+
+        return self.prog != -1 or len(self.stage[self.fill]) != 0
+
+    def erase_ahead(self):
+        page = (self.head + 1) % self.pages
+        if page == self.ahead_page or (self.page_seq != 0 and
+                                       self.page_end(self.head)
+                                       - self.write_addr
+                                       >= ERASE_AHEAD_LIMIT):
+            return
+        hdr = self.page_hdr(page)
+        if hdr:
+            self.ahead_erase = hdr["erase"] + 1
+        else:
+            hdr = self.page_hdr(self.head)
+            self.ahead_erase = hdr["erase"] if hdr else 1
+        self.flash.erase(page)
+        self.ahead_page = page
+
+    def page_open(self, rec_seq, first_time):
+        erase = 1
+        hdr = self.page_hdr(self.head)
+        if hdr and hdr["erase"] > 0:
+            erase = hdr["erase"]
+
+        self.head = (self.head + 1) % self.pages
+        self.write_addr = self.page_end(self.head)
+
+        if self.head == self.ahead_page:
+            erase = self.ahead_erase
+        else:
+            hdr = self.page_hdr(self.head)
+            if hdr:
+                erase = hdr["erase"] + 1
+            self.flash.erase(self.head)
+        self.ahead_page = -1
+
+        raw = struct.pack("<6I", PAGE_MAGIC, self.page_seq + 1, erase,
+                          rec_seq, first_time, self.wr_key)
+        self.flash.write(self.head * PAGE_SIZE,
+                         raw + struct.pack("<I", crc16(raw)))
+        if not self.page_hdr(self.head):
+            return False
+
+        self.page_seq += 1
+        self.write_addr = self.head * PAGE_SIZE + PAGE_HDR_SIZE
+        return True
+
+    # LogRewind(), LogRead()
+
+    def read_all(self):
+        records = []
+        if self.page_seq == 0:
+            return records
+        for i in range(1, self.pages + 1):
+            page = (self.head + i) % self.pages
+            hdr = self.page_hdr(page)
+            if not hdr or hdr["seq"] == 0:
+                continue
+            addr = page * PAGE_SIZE + PAGE_HDR_SIZE
+            while True:
+                size, record = self.record_check(addr, self.page_end(page))
+                if size <= 0:
+                    break
+                records.append(record)
+                addr += size
+        return records
+
+    # LogFind()
+
+    def find(self, seq):
+        if self.page_seq == 0:
+            return None
+        found = -1
+        for i in range(1, self.pages + 1):
+            page = (self.head + i) % self.pages
+            hdr = self.page_hdr(page)
+            if hdr and hdr["seq"] != 0 and hdr["rec_seq"] <= seq:
+                found = page
+        if found < 0:
+            return None
+        addr = found * PAGE_SIZE + PAGE_HDR_SIZE
+        while True:
+            size, record = self.record_check(addr, self.page_end(found))
+            if size <= 0 or record[0] > seq:
+                return None
+            if record[0] == seq:
+                return record
+            addr += size
+
+
+def random_record(rand):
+    rtype = rand.choice((2, 2, 2, 3, 3, 4, 5))
+    if rtype == TYPE_CONNECT:
+        data = struct.pack("<I", rand.getrandbits(32))
+    elif rand.random() < 0.1:
+        data = bytes(rand.getrandbits(8) for _ in range(DATA_MAX))
+    else:
+        data = bytes(rand.getrandbits(8)
+                     for _ in range(rand.randint(0, 120)))
+    return rtype, data
+
+
+def run(log, rand, appended):
+    """Main loop until the power is lost."""
+    log.flash.ops_left = rand.randint(1, 400)
+    try:
+        record = log.mount()
+        appended.setdefault(record[0], []).append(record)
+        while True:
+            action = rand.random()
+            if action < 0.3:
+                record = log.append(*random_record(rand))
+                if record:
+                    appended.setdefault(record[0], []).append(record)
+            elif action < 0.32:
+                log.flush()
+            else:
+                log.check(idle=rand.random() < 0.5)
+    except PowerLoss:
+        pass
+    log.flash.ops_left = None
+
+
+def verify(log, appended, committed):
+    """Mount again and read all records."""
+    errors = []
+    log.mount()
+    records = log.read_all()
+
+    prev = 0
+    for record in records:
+        if record[0] <= prev:
+            errors.append("sequence %d after %d" % (record[0], prev))
+        prev = record[0]
+        if record not in appended.get(record[0], []):
+            errors.append("record %d has not been appended" % record[0])
+
+    read = {record[0]: record for record in records}
+    for seq, (record, page, erases) in committed.items():
+        if log.flash.started[page] == erases and read.get(seq) != record:
+            errors.append("committed record %d lost" % seq)
+    return errors, len(records)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--runs", type=int, default=3000,
+                        help="number of power losses")
+    parser.add_argument("--pages", type=int, default=PAGE_CNT,
+                        help="number of pages of the log")
+    parser.add_argument("--seed", type=int, default=1,
+                        help="seed of the random numbers")
+    args = parser.parse_args()
+
+    rand = random.Random(args.seed)
+    flash = Flash(args.pages, rand)
+    appended = {}               # seq: records appended with this number
+    committed = {}              # seq: newest committed record
+    torn = read = 0
+    errors = []
+
+    for i in range(args.runs):
+        log = Log(flash)
+        run(log, rand, appended)
+        committed.update(log.committed)
+
+        check = Log(flash)
+        found, count = verify(check, appended, committed)
+        torn += check.torn
+        read = count
+        for line in found[:5]:
+            errors.append("run %d: %s" % (i + 1, line))
+        if len(errors) >= 20:
+            break
+
+    print("%d power losses, %d torn records found at mount, %d records "
+          "committed, %d in the log at the end"
+          % (i + 1, torn, len(committed), read))
+    print("erase counts of the pages: %d to %d"
+          % (min(flash.erases), max(flash.erases)))
+    for line in errors:
+        print("error: " + line)
+    print("ok" if not errors else "FAILED")
+    sys.exit(0 if not errors else 1)
+
+
+if __name__ == "__main__":
+    main()
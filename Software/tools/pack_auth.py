@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Check the battery pack authentication of the HRD against known vectors.
+
+The digest of the bq40z50 is SHA1(K | SHA1(K | M)) with the 128-bit key K
+and the 20-byte challenge M, see drivers/PackAuth.c.  This tool calculates
+it with Python's hashlib, which serves as reference for the SHA-1 code of
+the firmware:
+
+- --vectors checks the reference against the FIPS 180-2 vectors, and
+  prints the known answer tests built into the firmware ("auth test").
+- With a serial port, random challenges are sent with the console command
+  "auth <challenge>".  The digest the HRD calculated is compared with the
+  reference, and the digest of the pack with both.
+- --provision writes the key into a user data page image, e.g. the key file
+  of export_verify.py, which is then programmed into the HRD.
+
+Usage:
+    pack_auth.py --vectors
+    pack_auth.py --provision 0123456789abcdeffedcba9876543210 keys.bin
+    pack_auth.py /dev/ttyUSB0 --key 0123456789abcdeffedcba9876543210 [-n 10]
+                                                        (requires pyserial)
+"""
+
+import argparse
+import hashlib
+import os
+import re
+import sys
+import time
+
+KEY_MAGIC = b"HRDA"
+KEY_OFFSET = 0x40           # AUTH_KEY_ADDR in the user data page
+DEFAULT_KEY = bytes.fromhex("0123456789abcdeffedcba9876543210")
+
+FIPS_VECTORS = [
+    (b"abc", "a9993e364706816aba3e25717850c26c9cd0d89d"),
+    (b"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+     "84983e441c3bd26ebaae4aa1f95129e5e54670f1"),
+]
+
+
+def digest(key, challenge):
+    """Authentication digest of the bq40z50."""
+    inner = hashlib.sha1(key + challenge).digest()
+    return hashlib.sha1(key + inner).digest()
+
+
+def vectors():
+    for msg, expected in FIPS_VECTORS:
+        if hashlib.sha1(msg).hexdigest() != expected:
+            sys.exit("SHA-1 reference failed for %r" % msg)
+    challenge = bytes(range(20))
+    print("SHA-1 reference OK")
+    print("firmware vector: key %s, challenge %s"
+          % (DEFAULT_KEY.hex(), challenge.hex()))
+    print("                 digest %s" % digest(DEFAULT_KEY, challenge).hex())
+
+
+def provision(key, filename):
+    image = bytearray()
+    if os.path.exists(filename):
+        with open(filename, "rb") as inp:
+            image = bytearray(inp.read())
+    if len(image) < KEY_OFFSET:
+        image += b"\xff" * (KEY_OFFSET - len(image))
+    image[KEY_OFFSET:KEY_OFFSET + 20] = KEY_MAGIC + key
+    with open(filename, "wb") as out:
+        out.write(image)
+
+
+def run(port, key, count):
+    def command(text):
+        port.reset_input_buffer()
+        port.write(b"\n" + text.encode() + b"\n")
+        lines, start = {}, time.time()
+        while time.time() - start < 3:
+            line = port.readline().decode("ascii", "replace").strip()
+            match = re.match(r"(\w+)\s*:\s*(.*)", line)
+            if match:
+                lines[match.group(1)] = match.group(2)
+            if line.startswith("Auth ") or line.startswith("auth:"):
+                return lines, line
+        sys.exit("no answer to \"%s\"" % text)
+
+    _, line = command("auth test")
+    print(line)
+    kernel_errors = pack_errors = 0
+    for _ in range(count):
+        challenge = os.urandom(20)
+        lines, line = command("auth " + challenge.hex())
+        if line.startswith("auth:"):
+            sys.exit(line)
+        expected = bytes.fromhex(lines["Expected"].replace(" ", ""))
+        received = bytes.fromhex(lines["Digest"].replace(" ", ""))
+        reference = digest(key, challenge)
+        if expected != reference:
+            kernel_errors += 1
+            print("SHA-1 of the HRD differs for challenge %s"
+                  % challenge.hex())
+        if received != reference:
+            pack_errors += 1
+        print(line)
+    print("%d challenges: %d firmware errors, %d digests of the pack wrong"
+          % (count, kernel_errors, pack_errors))
+    sys.exit(1 if kernel_errors or pack_errors else 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", nargs="?", help="serial port")
+    parser.add_argument("--key", type=bytes.fromhex, default=DEFAULT_KEY,
+                        help="authentication key (hex)")
+    parser.add_argument("-n", type=int, default=10,
+                        help="number of challenges")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--vectors", action="store_true",
+                        help="check the reference and print the vectors")
+    parser.add_argument("--provision", nargs=2, metavar=("KEY", "IMAGE"),
+                        help="write the key into a user data page image")
+    args = parser.parse_args()
+
+    if args.vectors:
+        vectors()
+    elif args.provision:
+        provision(bytes.fromhex(args.provision[0]), args.provision[1])
+    elif args.port:
+        import serial  # pyserial
+        with serial.Serial(args.port, args.baud, timeout=0.5) as port:
+            run(port, args.key, args.n)
+    else:
+        parser.error("nothing to do")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,286 @@
+#!/usr/bin/env python3
+"""Benchmark the time series compression of the HRD.
+
+The encoder is the same as in drivers/Series.c: delta-of-delta time stamps,
+ZigZag varint deltas for the values, the XOR for status words, and one
+byte for a run of unchanged samples.  Samples are read from CSV files with
+the columns time, voltage, current, temperature, rsoc, and status (one
+sample per line, the first line may be a header), or decoded from an image
+of the session log, e.g. "export_verify.py ... -o log.bin --start log".
+Each input is encoded, decoded again, and compared, then the bytes per
+sample are printed.
+
+--synthetic generates a modelled discharge curve instead.  It is only
+meant to check the tool, the numbers of real recordings are what counts.
+
+Usage:
+    series_bench.py discharge1.csv discharge2.csv
+    series_bench.py --log log.bin [--csv out.csv]
+    series_bench.py --synthetic 10800
+"""
+
+import argparse
+import csv
+import math
+import random
+import struct
+import sys
+
+from tlm_decode import crc16, varint, unzigzag
+
+# Definitions of drivers/Series.h and Series.c
+CHANNELS = (0x09, 0x0A, 0x08, 0x0D, 0x16)   # V, I, T, RSOC, BatteryStatus
+XOR_MASK = 0x10                             # BatteryStatus is a status word
+BLOCK_SIZE = 240                            # LOG_DATA_MAX
+RAW_SIZE = 4 + 2 * len(CHANNELS)
+CTRL_TIME = 0x40
+CTRL_RUN = 0x80
+RUN_MAX = 128
+SAMPLE_MAX = 1 + 5 + 3 * len(CHANNELS)
+
+# Definitions of drivers/Log.h
+PAGE_SIZE = 512
+PAGE_MAGIC = 0x32474C48
+PAGE_HDR_SIZE = 28
+REC_HDR_SIZE = 12
+TYPE_SERIES = 3
+
+
+def zigzag(value):
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def put_varint(buf, value):
+    while value >= 0x80:
+        buf.append((value & 0x7F) | 0x80)
+        value >>= 7
+    buf.append(value)
+
+
+def rec_size(length):
+    """Bytes a record occupies in the log, see REC_SIZE() in Log.c."""
+    return REC_HDR_SIZE + ((length + 3) & ~3) + 4
+
+
+class Encoder:
+    """Same encoder as SeriesAdd(), collects the finished blocks."""
+
+    def __init__(self, interval):
+        self.interval = interval
+        self.blocks = []
+        self.block = bytearray()
+        self.run = 0
+
+    def add(self, time, values):
+        if self.block and len(self.block) + 1 + SAMPLE_MAX > BLOCK_SIZE:
+            self.flush()
+        if not self.block:
+            self.begin(time, values)
+            return
+        delta = time - self.prev_time
+        dod = delta - self.prev_delta
+        self.prev_time, self.prev_delta = time, delta
+        ctrl = CTRL_TIME if dod else 0
+        for i, value in enumerate(values):
+            if value != self.prev[i]:
+                ctrl |= 1 << i
+        if not ctrl:
+            self.run += 1
+            if self.run == RUN_MAX:
+                self.put_run()
+            return
+        self.put_run()
+        self.block.append(ctrl)
+        if dod:
+            put_varint(self.block, zigzag(dod))
+        for i, value in enumerate(values):
+            if value == self.prev[i]:
+                continue
+            if XOR_MASK & (1 << i):
+                put_varint(self.block, value ^ self.prev[i])
+            else:
+                diff = (value - self.prev[i]) & 0xFFFF
+                put_varint(self.block, zigzag(diff - 0x10000 if diff & 0x8000
+                                              else diff))
+            self.prev[i] = value
+
+    def begin(self, time, values):
+        self.block = bytearray([len(CHANNELS), XOR_MASK]) + bytes(CHANNELS)
+        put_varint(self.block, self.interval)
+        self.block += struct.pack("<I", time)
+        for value in values:
+            put_varint(self.block, value)
+        self.prev = list(values)
+        self.prev_time, self.prev_delta = time, self.interval
+        self.run = 0
+
+    def put_run(self):
+        if self.run:
+            self.block.append(CTRL_RUN | (self.run - 1))
+            self.run = 0
+
+    def flush(self):
+        if self.block:
+            self.put_run()
+            self.blocks.append(bytes(self.block))
+            self.block = bytearray()
+
+
+def decode_block(block):
+    """Return the list of (time, values) of a block."""
+    cnt, xor_mask = block[0], block[1]
+    pos = 2 + cnt
+    interval, pos = varint(block, pos)
+    time, = struct.unpack_from("<I", block, pos)
+    pos += 4
+    values = []
+    for _ in range(cnt):
+        value, pos = varint(block, pos)
+        values.append(value)
+    samples = [(time, tuple(values))]
+    delta = interval
+    while pos < len(block):
+        ctrl = block[pos]
+        pos += 1
+        if ctrl & CTRL_RUN:
+            for _ in range((ctrl & 0x7F) + 1):
+                time += delta
+                samples.append((time, tuple(values)))
+            continue
+        if ctrl & CTRL_TIME:
+            dod, pos = varint(block, pos)
+            delta += unzigzag(dod)
+        time += delta
+        for i in range(cnt):
+            if ctrl & (1 << i):
+                diff, pos = varint(block, pos)
+                if xor_mask & (1 << i):
+                    values[i] ^= diff
+                else:
+                    values[i] = (values[i] + unzigzag(diff)) & 0xFFFF
+        samples.append((time, tuple(values)))
+    return samples
+
+
+def read_csv(filename):
+    samples = []
+    with open(filename, newline="") as f:
+        for row in csv.reader(f):
+            try:
+                numbers = [int(float(x)) for x in row[:1 + len(CHANNELS)]]
+            except ValueError:
+                continue                    # header line
+            if len(numbers) == 1 + len(CHANNELS):
+                samples.append((numbers[0],
+                                tuple(x & 0xFFFF for x in numbers[1:])))
+    return samples
+
+
+def read_log(filename):
+    """Decode all series blocks of a log image, oldest page first."""
+    with open(filename, "rb") as f:
+        image = f.read()
+    pages = []
+    for offs in range(0, len(image) - PAGE_SIZE + 1, PAGE_SIZE):
+        magic, page_seq, _, _, _, _, crc = struct.unpack_from("<7I", image,
+                                                              offs)
+        if (magic == PAGE_MAGIC and page_seq
+                and crc == crc16(image[offs:offs + PAGE_HDR_SIZE - 4])):
+            pages.append((page_seq, offs))
+    samples = []
+    for _, offs in sorted(pages):
+        pos, end = offs + PAGE_HDR_SIZE, offs + PAGE_SIZE
+        while pos + REC_HDR_SIZE + 4 <= end:
+            length, rec_type, _, _, _ = struct.unpack_from("<HBBII", image,
+                                                           pos)
+            size = rec_size(length)
+            if length == 0xFFFF or pos + size > end:
+                break
+            crc, = struct.unpack_from("<I", image, pos + size - 4)
+            if crc != crc16(image[pos:pos + REC_HDR_SIZE + length]):
+                break                       # torn record, skip the page
+            if rec_type == TYPE_SERIES:
+                block = image[pos + REC_HDR_SIZE:pos + REC_HDR_SIZE + length]
+                samples += decode_block(block)
+            pos += size
+    return samples
+
+
+def synthetic(count, seed=1):
+    """Modelled constant current discharge of a 4-cell pack, 1s interval."""
+    rnd = random.Random(seed)
+    samples = []
+    time = 1760000000
+    status = 0x00C0
+    for i in range(count):
+        soc = 1.0 - i / count
+        volts = 12000 + 4000 * soc + 800 * math.exp(-i / 300.0)
+        volts -= 1500 * math.exp(-soc * 20)
+        current = -2000 + rnd.randint(-3, 3)
+        temp = 2981 + int(40 * (1 - math.exp(-i / 1800.0)))
+        if soc < 0.1:
+            status = 0x08C0                 # remaining capacity alarm
+        samples.append((time, (int(volts) + rnd.randint(-2, 2),
+                               current & 0xFFFF, temp, int(soc * 100),
+                               status)))
+        time += 2 if rnd.random() < 0.002 else 1
+    return samples
+
+
+def bench(name, samples, interval):
+    if not samples:
+        print("%s: no samples" % name)
+        return True
+    enc = Encoder(interval)
+    for time, values in samples:
+        enc.add(time, values)
+    enc.flush()
+    decoded = [s for block in enc.blocks for s in decode_block(block)]
+    ok = decoded == samples
+    data = sum(len(block) for block in enc.blocks)
+    flash = sum(rec_size(len(block)) for block in enc.blocks)
+    print("%s: %d samples, %d blocks, %.2f bytes/sample in blocks, "
+          "%.2f in flash, raw %d, ratio %.1f%s"
+          % (name, len(samples), len(enc.blocks), data / len(samples),
+             flash / len(samples), RAW_SIZE,
+             RAW_SIZE * len(samples) / flash,
+             "" if ok else ", DECODE MISMATCH"))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("csv_files", nargs="*", metavar="CSV",
+                        help="recorded samples")
+    parser.add_argument("--log", help="image of the session log")
+    parser.add_argument("--csv", help="write the samples of --log as CSV")
+    parser.add_argument("--synthetic", type=int, metavar="N",
+                        help="generate N samples of a modelled discharge")
+    parser.add_argument("--interval", type=int, default=1,
+                        help="nominal sample interval in [s]")
+    args = parser.parse_args()
+
+    inputs = [(name, read_csv(name)) for name in args.csv_files]
+    if args.log:
+        samples = read_log(args.log)
+        inputs.append((args.log, samples))
+        if args.csv:
+            with open(args.csv, "w", newline="") as f:
+                out = csv.writer(f)
+                out.writerow(["time", "voltage", "current", "temperature",
+                              "rsoc", "status"])
+                for time, values in samples:
+                    out.writerow([time] + list(values))
+    if args.synthetic:
+        inputs.append(("synthetic", synthetic(args.synthetic)))
+    if not inputs:
+        parser.error("nothing to do")
+
+    ok = True
+    for name, samples in inputs:
+        ok &= bench(name, samples, args.interval)
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Read battery registers through the SMBus bridge mode of the HRD.
+
+Enters bridge mode with the console command "bridge", sends the register
+reads as pipelined request batches, and prints the results.  The request
+and response formats are described in drivers/Bridge.c, the response
+frames use the telemetry framing of drivers/Telemetry.c.
+
+Usage:
+    smb_bridge.py /dev/ttyUSB0 [--baud 9600]            (requires pyserial)
+    smb_bridge.py /dev/ttyUSB0 --regs 08-0f,16,20-22
+    smb_bridge.py /dev/ttyUSB0 --write 04:f4ff --regs 04-07   (AtRate -12mA)
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from tlm_decode import Decoder, REG_NAMES, crc16, shown
+
+SYNC = 0x5A
+OP_READ = 0x01
+OP_WRITE = 0x02
+OP_WRITE_READ = 0x03
+OP_EXIT = 0xFF
+IDX_BATCH = 0xFF
+TYPE_BRIDGE = 7
+
+ERR_BUSY = -20
+STATUS_NAMES = {-10: "timeout", -11: "invalid parameter", -20: "busy",
+                -21: "invalid operation"}
+
+WINDOW = 4          # batches in flight, BRIDGE_BATCH_CNT
+OPS_PER_BATCH = 16  # operations per request
+TIMEOUT = 2.0       # seconds until a request is repeated
+
+# Registers which are read as blocks: length byte and up to 32 characters
+BLOCK_REGS = {0x20: 33, 0x21: 33, 0x22: 33, 0x23: 33}
+
+
+def request(seq, ops):
+    """Build a request frame from a list of operations (bytes)."""
+    body = bytes([seq]) + b"".join(ops)
+    data = bytes([len(body)]) + body
+    return bytes([SYNC]) + data + struct.pack("<H", crc16(data))
+
+
+class BridgeDecoder(Decoder):
+    """Collects the entries of TLM_TYPE_BRIDGE frames."""
+
+    def __init__(self):
+        super().__init__()
+        self.entries = []       # (seq, idx, status, data)
+
+    def print_frame(self, frame):
+        if frame[2] != TYPE_BRIDGE:
+            return              # telemetry of other modules
+        payload = frame[7:-2]
+        seq, pos = payload[0], 1
+        while pos + 3 <= len(payload):
+            idx, status, cnt = struct.unpack_from("<BbB", payload, pos)
+            pos += 3
+            self.entries.append((seq, idx, status,
+                                 bytes(payload[pos:pos + cnt])))
+            pos += cnt
+
+
+def op_write(reg, data):
+    return bytes([OP_WRITE, reg, len(data)]) + data
+
+
+def op_write_read(reg, data, rd_reg, rd_cnt):
+    """Write, then read as one unit on the SMBus."""
+    return bytes([OP_WRITE_READ, reg, len(data)]) + data \
+        + bytes([rd_reg, rd_cnt])
+
+
+def parse_regs(text):
+    """Parse a list like "08-0f,16" into register addresses."""
+    regs = []
+    for part in text.split(","):
+        first, _, last = part.partition("-")
+        regs.extend(range(int(first, 16), int(last or first, 16) + 1))
+    return regs
+
+
+def run(port, regs, writes=()):
+    dec = BridgeDecoder()
+
+    def poll():
+        data = port.read(port.in_waiting or 1)
+        if data:
+            dec.feed(data)
+
+    port.write(b"\nbridge\n")
+    time.sleep(0.5)
+    port.reset_input_buffer()
+
+    # Writes go first, in a batch of their own
+    batches = []
+    if writes:
+        batches.append(([None] * len(writes),
+                        [op_write(reg, data) for reg, data in writes]))
+    for i in range(0, len(regs), OPS_PER_BATCH):
+        chunk = regs[i:i + OPS_PER_BATCH]
+        batches.append((chunk, [bytes([OP_READ, reg, BLOCK_REGS.get(reg, 2)])
+                                for reg in chunk]))
+
+    results = {}
+    pending = {}                # seq -> [batch index, send time, results]
+    next_batch = 0
+    start = time.time()
+    while next_batch < len(batches) or pending:
+        # Keep the window of batches in flight filled
+        while next_batch < len(batches) and len(pending) < WINDOW:
+            seq = next_batch & 0xFF
+            port.write(request(seq, batches[next_batch][1]))
+            pending[seq] = [next_batch, time.time(), {}]
+            next_batch += 1
+
+        poll()
+        for seq, idx, status, data in dec.entries:
+            if seq not in pending:
+                continue        # late answer to a repeated request
+            if idx == IDX_BATCH:
+                if status != ERR_BUSY:
+                    sys.exit("request %d rejected: %s"
+                             % (seq, STATUS_NAMES.get(status, status)))
+                pending[seq][1] = 0     # busy: repeat now
+                continue
+            pending[seq][2][idx] = (status, data)
+        dec.entries.clear()
+
+        for seq, (num, sent, done) in list(pending.items()):
+            chunk, ops = batches[num]
+            if len(done) == len(chunk):
+                for idx, reg in enumerate(chunk):
+                    if reg is None:
+                        if done[idx][0]:
+                            print("write %02X failed: %s" % (writes[idx][0],
+                                  STATUS_NAMES.get(done[idx][0], done[idx][0])))
+                    else:
+                        results[reg] = done[idx]
+                del pending[seq]
+            elif time.time() - sent > TIMEOUT:
+                port.write(request(seq, ops))   # lost or busy, repeat it
+                pending[seq] = [num, time.time(), {}]
+    elapsed = time.time() - start
+
+    port.write(request(0, [bytes([OP_EXIT])]))
+
+    for reg in regs:
+        status, data = results[reg]
+        if status:
+            text = "error %s" % STATUS_NAMES.get(status, status)
+        elif len(data) == 2:
+            value, = struct.unpack("<H", data)
+            text = shown(value)
+        else:
+            text = shown(data[1:1 + data[0]] if data else data)
+        print("[%02X] %-22s %s" % (reg, REG_NAMES.get(reg, ""), text))
+
+    print("%d registers in %.2fs, %d CRC errors"
+          % (len(regs), elapsed, dec.crc_errors), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--regs", default="00-5f",
+                        help="register addresses (hex), default 00-5f")
+    parser.add_argument("--write", action="append", default=[],
+                        metavar="ADDR:DATA",
+                        help="write bytes (hex, little endian) before reading")
+    args = parser.parse_args()
+    writes = []
+    for arg in args.write:
+        reg, _, data = arg.partition(":")
+        writes.append((int(reg, 16), bytes.fromhex(data)))
+
+    import serial  # pyserial
+    with serial.Serial(args.port, args.baud, timeout=0.05) as port:
+        run(port, parse_regs(args.regs), writes)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""Simulate the supply warning of the HRD with a scripted voltage ramp.
+
+The model follows drivers/Supply.c: the VCMP with its trigger level and
+hysteresis, the edge interrupt which wakes the main loop, SupplyCheck() at
+every edge and every second, and the session of a connected pack, which
+HistoryCheck() opens again when the supply is no longer low.  The ramp is
+a list of "time:mV" points in [s], the voltage is interpolated linearly
+between them, and the simulation runs in steps of one millisecond.
+
+The following rules are checked, a violation is printed and the exit code
+is 1:
+- The warning is raised in the same main loop pass as the falling edge.
+- No session is open while the supply is low.
+- The normal operation is resumed after the voltage has been above the
+  threshold for SUPPLY_RECOVER_TIME seconds, not earlier than one second
+  before and not later than one second after, as SupplyCheck() counts
+  the seconds of the calendar.  A dip below the threshold starts again.
+- When VDD falls below the minimum of the MCU, the log has been flushed
+  at least --flush-ms before.
+
+This is a model of the firmware, it must be changed together with
+Supply.c.  Without a ramp, all built-in scenarios are run.
+
+Usage:
+    supply_sim.py
+    supply_sim.py --scenario dip -v
+    supply_sim.py --ramp 0:3000,30:2100,40:2100,41:2600,60:2600 \\
+                  --threshold 2250
+"""
+
+import argparse
+import sys
+
+# Definitions of drivers/Supply.h and Supply.c
+SUPPLY_WARN_MV = 2200
+SUPPLY_MV_MIN = 1667
+SUPPLY_MV_STEP = 34
+SUPPLY_MV_MAX = SUPPLY_MV_MIN + 63 * SUPPLY_MV_STEP
+SUPPLY_RECOVER_TIME = 10
+VCMP_HYST_MV = 20               # vcmpHyst20mV
+MCU_MIN_MV = 1980               # lowest VDD of the MCU and the flash
+
+# A flush erases at most one page (20 ms) and writes 128 words
+FLUSH_MS = 25
+
+SCENARIOS = {
+    # the cell sags slowly until the MCU resets
+    "sag": "0:3000,20:2900,80:1900",
+    # the backlight is switched on and off again
+    "recover": "0:3000,10:3000,10.5:2150,15:2150,15.5:2600,40:2600",
+    # a short dip between two seconds while the supply recovers
+    "dip": "0:3000,5:2150,6:2600,10.4:2600,10.45:2150,10.7:2150,"
+           "10.75:2600,40:2600",
+    # the voltage hovers around the threshold with a ripple of 30 mV
+    "ripple": ",".join("%g:%d" % (t / 4.0, 2195 + (15 if t % 2 else -15))
+                       for t in range(0, 160)),
+    # a fast drop, e.g. a pulse load on an old cell
+    "drop": "0:3000,5:3000,5.2:1950,10:1950",
+}
+
+
+def mv_to_level(mv):
+    return (mv - SUPPLY_MV_MIN + SUPPLY_MV_STEP // 2) // SUPPLY_MV_STEP
+
+
+def level_to_mv(level):
+    return SUPPLY_MV_MIN + level * SUPPLY_MV_STEP
+
+
+def parse_ramp(text):
+    points = []
+    for item in text.split(","):
+        t, mv = item.split(":")
+        points.append((float(t), float(mv)))
+    if len(points) < 2 or any(points[i][0] >= points[i + 1][0]
+                              for i in range(len(points) - 1)):
+        raise ValueError("the ramp needs two or more points in time order")
+    return points
+
+
+def voltage(points, t):
+    for (t0, v0), (t1, v1) in zip(points, points[1:]):
+        if t <= t1:
+            return v0 + (v1 - v0) * (t - t0) / (t1 - t0)
+    return points[-1][1]
+
+
+class Vcmp:
+    """Comparator output with hysteresis, edge flag of the interrupt."""
+
+    def __init__(self, threshold):
+        self.threshold = threshold
+        self.lower = False
+        self.edge = False
+
+    def sample(self, vdd):
+        if self.lower:
+            lower = vdd < self.threshold + VCMP_HYST_MV
+        else:
+            lower = vdd < self.threshold
+        if lower != self.lower:
+            self.lower = lower
+            self.edge = True        # VCMP_IRQHandler()
+
+
+class Supply:
+    """SupplyCheck() and the state it controls."""
+
+    def __init__(self, vcmp, log):
+        self.vcmp = vcmp
+        self.log = log
+        self.flg_edge = True        # SupplyInit()
+        self.flg_low = False
+        self.recover_seconds = 0
+        self.prev_seconds = 0
+        self.warnings = 0
+        self.session_open = False
+        self.staged = True          # records wait in the staging buffer
+
+    def check(self, now):
+        if self.vcmp.edge:          # the ISR sets g_flgIRQ
+            self.vcmp.edge = False
+            self.flg_edge = True
+
+        if self.flg_edge:
+            self.flg_edge = False
+
+            if self.vcmp.lower and not self.flg_low:
+                self.warn(now)
+            else:
+                self.recover_seconds = 0
+
+        seconds = int(now) % 60
+        if self.flg_low and self.prev_seconds != seconds:
+            self.prev_seconds = seconds
+
+            if self.vcmp.lower:
+                self.recover_seconds = 0
+            else:
+                self.recover_seconds += 1
+                if self.recover_seconds >= SUPPLY_RECOVER_TIME:
+                    self.flg_low = False
+                    self.log("%8.3f s  supply recovered" % now)
+
+        # HistoryCheck(): a new session while the supply is good
+        if not self.flg_low and not self.session_open:
+            self.session_open = True
+            self.staged = True
+            self.log("%8.3f s  session opened" % now)
+
+    def warn(self, now):
+        self.flg_low = True
+        self.warnings += 1
+        self.recover_seconds = 0
+        self.session_open = False   # HistoryClose()
+        self.staged = False         # LogFlush()
+        self.log("%8.3f s  warning, session closed, log flushed" % now)
+
+
+def simulate(name, points, threshold_mv, flush_ms, verbose):
+    threshold = level_to_mv(mv_to_level(
+        min(max(threshold_mv, SUPPLY_MV_MIN), SUPPLY_MV_MAX)))
+    errors = []
+    events = []
+    vcmp = Vcmp(threshold)
+    supply = Supply(vcmp, events.append)
+    above_since = 0.0           # comparator output high since
+    warn_time = None
+    steps = int(points[-1][0] * 1000) + 1
+
+    for step in range(steps):
+        now = step / 1000.0
+        vdd = voltage(points, now)
+
+        if vdd < MCU_MIN_MV:
+            if not supply.flg_low or supply.staged:
+                errors.append("%.3f s: reset with unflushed log" % now)
+            elif now - warn_time < flush_ms / 1000.0:
+                errors.append("%.3f s: reset %d ms after the warning"
+                              % (now, (now - warn_time) * 1000))
+            events.append("%8.3f s  reset at %d mV" % (now, vdd))
+            break
+
+        was_low = supply.flg_low
+        was_lower = vcmp.lower
+        vcmp.sample(vdd)
+        if vcmp.lower and not was_lower:
+            above_since = None
+        elif was_lower and not vcmp.lower:
+            above_since = now
+
+        supply.check(now)
+
+        if supply.flg_low and not was_low:
+            warn_time = now
+        if vcmp.lower and not supply.flg_low:
+            errors.append("%.3f s: supply below %d mV without warning"
+                          % (now, threshold))
+        if supply.flg_low and supply.session_open:
+            errors.append("%.3f s: session open while low" % now)
+        if was_low and not supply.flg_low:
+            if above_since is None \
+                    or now - above_since < SUPPLY_RECOVER_TIME - 1:
+                errors.append("%.3f s: recovered too early" % now)
+        if supply.flg_low and above_since is not None \
+                and now - above_since > SUPPLY_RECOVER_TIME + 1:
+            errors.append("%.3f s: not recovered after %.1f s"
+                          % (now, now - above_since))
+        if errors and not verbose:
+            break
+
+    print("%s: threshold %d mV, %d warnings, %s"
+          % (name, threshold, supply.warnings,
+             "ok" if not errors else "FAILED"))
+    if verbose or errors:
+        for line in events:
+            print("  " + line)
+    for line in errors[:10]:
+        print("  error: " + line)
+    return not errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--ramp", help="time:mV points, e.g. 0:3000,30:2100")
+    parser.add_argument("--scenario", choices=sorted(SCENARIOS),
+                        help="run one built-in scenario")
+    parser.add_argument("--threshold", type=int, default=SUPPLY_WARN_MV,
+                        help="warning threshold in [mV], see \"supply\"")
+    parser.add_argument("--flush-ms", type=int, default=FLUSH_MS,
+                        help="time needed by LogFlush() in [ms]")
+    parser.add_argument("-v", "--verbose", action="store_true",
+                        help="list the events")
+    args = parser.parse_args()
+
+    if args.ramp:
+        runs = [("ramp", args.ramp)]
+    elif args.scenario:
+        runs = [(args.scenario, SCENARIOS[args.scenario])]
+    else:
+        runs = sorted(SCENARIOS.items())
+
+    ok = True
+    for name, ramp in runs:
+        try:
+            points = parse_ramp(ramp)
+        except ValueError as e:
+            parser.error("%s: %s" % (name, e))
+        ok &= simulate(name, points, args.threshold, args.flush_ms,
+                       args.verbose)
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
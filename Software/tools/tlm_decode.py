@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""Decoder for the binary telemetry stream of the HRD.
+
+Reads the serial stream from a file or a serial port, searches for frames,
+verifies their CRC, and prints the records.  Text output of the console,
+which may be interleaved with the frames, is skipped.  The frame format is
+described in drivers/Telemetry.c.
+
+Usage:
+    tlm_decode.py capture.bin
+    tlm_decode.py /dev/ttyUSB0 [--baud 9600]      (requires pyserial)
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+SYNC = 0xA5
+HDR_SIZE = 7
+CRC_SIZE = 2
+
+FRAME_TYPES = {1: "SAMPLE", 2: "SNAPSHOT", 3: "TRACE", 4: "KEYFRAME",
+               5: "DELTA", 6: "WATCH", 7: "BRIDGE", 8: "DFLASH",
+               9: "EXPORT", 10: "LOG", 11: "DOWNLOAD"}
+TYPE_KEYFRAME = 4
+TYPE_DELTA = 5
+
+ID_SHIFT = 2
+FLAG_BLOCK = 0x01
+FLAG_DELTA = 0x02
+
+# Names of the SBS registers and of the special record IDs
+REG_NAMES = {
+    0x08: "Temperature", 0x09: "Voltage", 0x0A: "Current",
+    0x0B: "AverageCurrent", 0x0D: "RelativeStateOfCharge",
+    0x0E: "AbsoluteStateOfCharge", 0x0F: "RemainingCapacity",
+    0x10: "FullChargeCapacity", 0x11: "RunTimeToEmpty",
+    0x16: "BatteryStatus", 0x17: "CycleCount", 0x18: "DesignCapacity",
+    0x19: "DesignVoltage", 0x1B: "ManufactureDate", 0x1C: "SerialNumber",
+    0x20: "ManufacturerName", 0x21: "DeviceName", 0x22: "DeviceChemistry",
+    0x23: "ManufacturerData", 0x4F: "StateOfHealth",
+    0x100: "CR2032[mV]", 0x101: "BatteryCtrlAddr",
+}
+
+# Fields of the MAC status blocks, IDs from 0x200 on, see drivers/BatteryMac.c
+MAC_FIELDS = (
+    ["CellVoltage%d" % i for i in range(1, 5)] + ["BatVoltage", "PackVoltage"]
+    + ["CellCurrent%d" % i for i in range(1, 5)]
+    + ["CellPower%d" % i for i in range(1, 5)] + ["Power", "AveragePower"]
+    + ["IntTemperature"] + ["TS%dTemperature" % i for i in range(1, 5)]
+    + ["CellTemperature", "FETTemperature"]
+    + ["TrueRemQ", "TrueRemE", "InitialQ", "InitialE", "TrueFullChgQ",
+       "TrueFullChgE", "TSim", "TAmbient"]
+    + ["MaxCellVoltage%d" % i for i in range(1, 5)]
+    + ["MinCellVoltage%d" % i for i in range(1, 5)]
+    + ["MaxDeltaCellVolt", "MaxChargeCurrent", "MaxDsgCurrent",
+       "MaxAvgDsgCurrent", "MaxAvgDsgPower", "MaxTempCell", "MinTempCell",
+       "MaxDeltaCellTemp", "MaxTempIntSensor", "MinTempIntSensor",
+       "MaxTempFET"]
+    + ["ChargingStatus"])
+REG_NAMES.update((0x200 + i, name) for i, name in enumerate(MAC_FIELDS))
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT, polynomial 0x1021, initial value 0xFFFF."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def varint(buf, pos):
+    """Return (value, new position) of the varint at buf[pos]."""
+    value = shift = 0
+    while True:
+        if pos >= len(buf):
+            raise ValueError("truncated varint")
+        byte = buf[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def records(payload):
+    """Yield (id, flags, value) tuples, value is bytes for block records."""
+    pos = 0
+    while pos < len(payload):
+        key, pos = varint(payload, pos)
+        reg_id = key >> ID_SHIFT
+        flags = key & ((1 << ID_SHIFT) - 1)
+        if flags & FLAG_BLOCK:
+            cnt, pos = varint(payload, pos)
+            yield reg_id, flags, bytes(payload[pos:pos + cnt])
+            pos += cnt
+        else:
+            value, pos = varint(payload, pos)
+            yield reg_id, flags, value
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+class Decoder:
+    """Incremental frame decoder, feed it with arbitrary chunks of data."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.frames = 0
+        self.crc_errors = 0
+        self.skipped = 0
+        self.state = {}         # last value per record ID (delta streaming)
+        self.synced = False     # state is valid, i.e. no frame lost
+        self.stream_bytes = 0   # bytes of KEYFRAME and DELTA frames
+
+    def feed(self, data):
+        self.buf += data
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                self.skipped += len(self.buf)
+                self.buf.clear()
+                return
+            self.skipped += start
+            del self.buf[:start]
+            if len(self.buf) < HDR_SIZE:
+                return
+            size = HDR_SIZE + self.buf[1] + CRC_SIZE
+            if len(self.buf) < size:
+                return
+            frame = bytes(self.buf[:size])
+            crc, = struct.unpack_from("<H", frame, size - CRC_SIZE)
+            if crc16(frame[1:size - CRC_SIZE]) != crc:
+                # not a frame, or a damaged one - resync behind this byte
+                self.crc_errors += 1
+                self.synced = False
+                self.skipped += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:size]
+            self.frames += 1
+            self.print_frame(frame)
+
+    def print_frame(self, frame):
+        ftype = frame[2]
+        stamp, = struct.unpack_from("<I", frame, 3)
+        payload = frame[HDR_SIZE:-CRC_SIZE]
+        stream = ftype in (TYPE_KEYFRAME, TYPE_DELTA)
+        if stream:
+            self.stream_bytes += len(frame)
+            if ftype == TYPE_KEYFRAME:
+                self.synced = True
+        print("%s %-8s len=%d%s" % (time.strftime("%Y-%m-%d %H:%M:%S",
+                                                  time.gmtime(stamp)),
+                                    FRAME_TYPES.get(ftype, "TYPE%d" % ftype),
+                                    len(payload),
+                                    "" if self.synced or not stream
+                                    else "  (not synced, wait for keyframe)"))
+        try:
+            for reg_id, flags, value in records(payload):
+                if flags & FLAG_DELTA:
+                    if reg_id not in self.state:
+                        print("    [%03X] delta without base value" % reg_id)
+                        continue
+                    value = (self.state[reg_id] + unzigzag(value)) \
+                        & 0xFFFFFFFF
+                if stream:
+                    self.state[reg_id] = value
+                print("    [%03X] %-22s %s%s"
+                      % (reg_id, REG_NAMES.get(reg_id, ""), shown(value),
+                         " (delta)" if flags & FLAG_DELTA else ""))
+        except ValueError as err:
+            print("    decode error: %s" % err)
+
+
+def shown(value):
+    """Format a record value for the output."""
+    if isinstance(value, bytes):
+        text = value.split(b"\0")[0]
+        if text and all(32 <= c < 127 for c in text):
+            return '"%s"' % text.decode("ascii")
+        return value.hex(" ")
+    return "0x%X (%d)" % (value, value)
+
+
+def open_source(name, baud):
+    if name == "-":
+        return sys.stdin.buffer
+    try:
+        return open(name, "rb")
+    except OSError:
+        import serial  # pyserial, only needed for live capture
+        return serial.Serial(name, baud, timeout=0.5)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="capture file, serial port, or -")
+    parser.add_argument("--baud", type=int, default=9600)
+    args = parser.parse_args()
+
+    src = open_source(args.source, args.baud)
+    dec = Decoder()
+    try:
+        while True:
+            data = src.read(256)
+            if not data:
+                if hasattr(src, "in_waiting"):
+                    continue    # serial port: wait for more data
+                break
+            dec.feed(data)
+    except KeyboardInterrupt:
+        pass
+
+    print("%d frames, %d CRC errors, %d bytes skipped"
+          % (dec.frames, dec.crc_errors, dec.skipped), file=sys.stderr)
+    if dec.stream_bytes:
+        print("%d bytes of streaming frames, see \"cnt\" on the device for "
+              "the compression ratio" % dec.stream_bytes, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()